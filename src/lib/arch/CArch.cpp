@@ -28,6 +28,7 @@ CArch::CArch()
 {
 	assert(s_instance == NULL);
 	s_instance = this;
+	m_usb = static_cast<ARCH_USB*>(this);
 }
 
 CArch::~CArch()
@@ -48,6 +49,17 @@ CArch::init()
 #endif
 }
 
+void
+CArch::setUsb(IArchUsbDataLink* usb)
+{
+	if (usb == NULL) {
+		m_usb = static_cast<ARCH_USB*>(this);
+	}
+	else {
+		m_usb = usb;
+	}
+}
+
 CArch*
 CArch::getInstance()
 {
@@ -110,6 +110,19 @@ public:
 	*/
 	virtual void init();
 
+	//
+	// manipulators
+	//
+
+	//! Replace the USB backend
+	/*!
+	Routes USB transfers made through usb() to \c usb instead of the
+	platform implementation, e.g. to benchmark the USB data link against
+	a software loopback.  The caller keeps ownership.  NULL restores the
+	platform implementation.
+	*/
+	void				setUsb(IArchUsbDataLink* usb);
+
 	//
 	// accessors
 	//
@@ -123,9 +136,13 @@ public:
 
 	ARCH_PLUGIN&		plugin() const { return (ARCH_PLUGIN&)m_plugin; }
 
+	//! Return the USB backend
+	IArchUsbDataLink&	usb() const { return *m_usb; }
+
 private:
 	static CArch*		s_instance;
 	ARCH_PLUGIN			m_plugin;
+	IArchUsbDataLink*	m_usb;
 };
 
 //! Convenience object to lock/unlock an arch mutex
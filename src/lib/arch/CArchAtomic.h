@@ -0,0 +1,232 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CARCHATOMIC_H
+#define CARCHATOMIC_H
+
+#include "BasicTypes.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedExchange, _InterlockedExchangeAdd, \
+					_InterlockedCompareExchange, _InterlockedCompareExchange64)
+#endif
+
+//! Atomic operations
+/*!
+Lock free operations on an aligned SInt32 shared between threads.  The
+operations are sequentially consistent with one another.  Unlike the
+rest of the arch layer these are inline and not virtual because they're
+used where a mutex would cost too much.
+
+There's also load() and compareAndSwap() for an SInt64, which must be
+8 byte aligned, for when a single word is too small to hold something
+that must change in one step.
+*/
+class CArchAtomic {
+public:
+	//! Read value
+	static SInt32		load(const volatile SInt32* value);
+
+	//! Write value
+	static void			store(volatile SInt32* value, SInt32 newValue);
+
+	//! Add to value
+	/*!
+	Adds \c delta to \c *value and returns the result.
+	*/
+	static SInt32		add(volatile SInt32* value, SInt32 delta);
+
+	//! Compare and swap value
+	/*!
+	Sets \c *value to \c newValue iff it's \c oldValue.  Returns true
+	iff it was set.
+	*/
+	static bool			compareAndSwap(volatile SInt32* value,
+							SInt32 oldValue, SInt32 newValue);
+
+	//! Read 64 bit value
+	static SInt64		load(const volatile SInt64* value);
+
+	//! Compare and swap 64 bit value
+	/*!
+	Sets \c *value to \c newValue iff it's \c oldValue.  Returns true
+	iff it was set.
+	*/
+	static bool			compareAndSwap(volatile SInt64* value,
+							SInt64 oldValue, SInt64 newValue);
+};
+
+#if defined(__ATOMIC_SEQ_CST)
+
+inline
+SInt32
+CArchAtomic::load(const volatile SInt32* value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline
+void
+CArchAtomic::store(volatile SInt32* value, SInt32 newValue)
+{
+	__atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+inline
+SInt32
+CArchAtomic::add(volatile SInt32* value, SInt32 delta)
+{
+	return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt32* value,
+				SInt32 oldValue, SInt32 newValue)
+{
+	return __atomic_compare_exchange_n(value, &oldValue, newValue, false,
+							__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+inline
+SInt64
+CArchAtomic::load(const volatile SInt64* value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt64* value,
+				SInt64 oldValue, SInt64 newValue)
+{
+	return __atomic_compare_exchange_n(value, &oldValue, newValue, false,
+							__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#elif defined(__GNUC__)
+
+inline
+SInt32
+CArchAtomic::load(const volatile SInt32* value)
+{
+	return __sync_add_and_fetch(const_cast<volatile SInt32*>(value), 0);
+}
+
+inline
+void
+CArchAtomic::store(volatile SInt32* value, SInt32 newValue)
+{
+	__sync_synchronize();
+	*value = newValue;
+	__sync_synchronize();
+}
+
+inline
+SInt32
+CArchAtomic::add(volatile SInt32* value, SInt32 delta)
+{
+	return __sync_add_and_fetch(value, delta);
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt32* value,
+				SInt32 oldValue, SInt32 newValue)
+{
+	return __sync_bool_compare_and_swap(value, oldValue, newValue);
+}
+
+inline
+SInt64
+CArchAtomic::load(const volatile SInt64* value)
+{
+	// a plain read of 64 bits isn't atomic on 32 bit targets
+	return __sync_add_and_fetch(const_cast<volatile SInt64*>(value), 0);
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt64* value,
+				SInt64 oldValue, SInt64 newValue)
+{
+	return __sync_bool_compare_and_swap(value, oldValue, newValue);
+}
+
+#elif defined(_MSC_VER)
+
+// volatile reads and writes have acquire and release semantics with
+// msvc.  the interlocked functions are full barriers.
+
+inline
+SInt32
+CArchAtomic::load(const volatile SInt32* value)
+{
+	return *value;
+}
+
+inline
+void
+CArchAtomic::store(volatile SInt32* value, SInt32 newValue)
+{
+	_InterlockedExchange(reinterpret_cast<volatile long*>(value), newValue);
+}
+
+inline
+SInt32
+CArchAtomic::add(volatile SInt32* value, SInt32 delta)
+{
+	return _InterlockedExchangeAdd(
+							reinterpret_cast<volatile long*>(value), delta) +
+							delta;
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt32* value,
+				SInt32 oldValue, SInt32 newValue)
+{
+	return (_InterlockedCompareExchange(
+							reinterpret_cast<volatile long*>(value),
+							newValue, oldValue) == oldValue);
+}
+
+inline
+SInt64
+CArchAtomic::load(const volatile SInt64* value)
+{
+	// a plain read of 64 bits isn't atomic on 32 bit targets so use a
+	// compare and swap that never changes the value
+	return _InterlockedCompareExchange64(
+							const_cast<volatile __int64*>(value), 0, 0);
+}
+
+inline
+bool
+CArchAtomic::compareAndSwap(volatile SInt64* value,
+				SInt64 oldValue, SInt64 newValue)
+{
+	return (_InterlockedCompareExchange64(value,
+							newValue, oldValue) == oldValue);
+}
+
+#else
+#error "no atomic operations for this compiler"
+#endif
+
+#endif
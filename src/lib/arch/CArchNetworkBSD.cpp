@@ -29,6 +29,8 @@
 #	include <netinet/tcp.h>
 #endif
 #include <arpa/inet.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
@@ -44,6 +46,10 @@
 #	endif
 #endif
 
+#if HAVE_SYS_EPOLL_H
+#	include <sys/epoll.h>
+#endif
+
 #if !HAVE_INET_ATON
 #	include <stdio.h>
 #endif
@@ -57,6 +63,19 @@ static const int s_type[] = {
 	SOCK_STREAM
 };
 
+// most buffers passed to one writev() call.  POSIX guarantees at least
+// 16 (_XOPEN_IOV_MAX);  any left over are written by the next call.
+static const int s_maxWriteBuffers = 16;
+
+#if HAVE_SYS_EPOLL_H
+// marks the unblock pipe in a poll set.  it just has to be unique.
+static char s_unblockMark;
+
+// most ready sockets returned by one waitPollSet() call.  any others
+// are level triggered and so are returned by the next call.
+static const int s_maxPollSetEvents = 64;
+#endif
+
 #if !HAVE_INET_ATON
 // parse dotted quad addresses.  we don't bother with the weird BSD'ism
 // of handling octal and hex and partial forms.
@@ -135,6 +154,23 @@ CArchNetworkBSD::copySocket(CArchSocket s)
 	return s;
 }
 
+CArchSocket
+CArchNetworkBSD::newSocketFromDescriptor(int fd)
+{
+	// poll a duplicate so the owner of fd can close it at any time.
+	// leave the blocking mode alone since it's shared with the owner.
+	int newFd = dup(fd);
+	if (newFd == -1) {
+		throwError(errno);
+	}
+
+	// allocate socket object
+	CArchSocketImpl* newSocket = new CArchSocketImpl;
+	newSocket->m_fd            = newFd;
+	newSocket->m_refCount      = 1;
+	return newSocket;
+}
+
 void
 CArchNetworkBSD::closeSocket(CArchSocket s)
 {
@@ -506,6 +542,185 @@ CArchNetworkBSD::unblockPollSocket(CArchThread thread)
 	}
 }
 
+#if HAVE_SYS_EPOLL_H
+
+CArchPollSet
+CArchNetworkBSD::newPollSet()
+{
+	int fd = epoll_create(s_maxPollSetEvents);
+	if (fd == -1) {
+		// kernel without epoll.  caller falls back to pollSocket().
+		return NULL;
+	}
+
+	CArchPollSetImpl* ps = new CArchPollSetImpl;
+	ps->m_fd             = fd;
+	ps->m_unblockFd      = -1;
+	return ps;
+}
+
+void
+CArchNetworkBSD::closePollSet(CArchPollSet ps)
+{
+	assert(ps != NULL);
+
+	close(ps->m_fd);
+	delete ps;
+}
+
+void
+CArchNetworkBSD::setPollSetSocket(CArchPollSet ps, CArchSocket s,
+				unsigned short events, void* data)
+{
+	assert(ps != NULL);
+	assert(s  != NULL);
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	if ((events & kPOLLIN) != 0) {
+		ev.events |= EPOLLIN;
+	}
+	if ((events & kPOLLOUT) != 0) {
+		ev.events |= EPOLLOUT;
+	}
+	ev.data.ptr = data;
+
+	// changing interest is much more common than adding a socket
+	if (epoll_ctl(ps->m_fd, EPOLL_CTL_MOD, s->m_fd, &ev) == -1) {
+		if (errno != ENOENT ||
+			epoll_ctl(ps->m_fd, EPOLL_CTL_ADD, s->m_fd, &ev) == -1) {
+			throwError(errno);
+		}
+	}
+}
+
+void
+CArchNetworkBSD::removePollSetSocket(CArchPollSet ps, CArchSocket s)
+{
+	assert(ps != NULL);
+	assert(s  != NULL);
+
+	// old kernels require a non-NULL event even though it's ignored
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	if (epoll_ctl(ps->m_fd, EPOLL_CTL_DEL, s->m_fd, &ev) == -1) {
+		if (errno != ENOENT) {
+			throwError(errno);
+		}
+	}
+}
+
+int
+CArchNetworkBSD::waitPollSet(CArchPollSet ps,
+				CPollSetEvent events[], int num, double timeout)
+{
+	assert(ps     != NULL);
+	assert(events != NULL || num == 0);
+
+	// watch the unblock pipe of the waiting thread
+	const int* unblockPipe = getUnblockPipe();
+	if (unblockPipe != NULL && unblockPipe[0] != ps->m_unblockFd) {
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		if (ps->m_unblockFd != -1) {
+			epoll_ctl(ps->m_fd, EPOLL_CTL_DEL, ps->m_unblockFd, &ev);
+			ps->m_unblockFd = -1;
+		}
+		ev.events   = EPOLLIN;
+		ev.data.ptr = &s_unblockMark;
+		if (epoll_ctl(ps->m_fd, EPOLL_CTL_ADD, unblockPipe[0], &ev) != -1) {
+			ps->m_unblockFd = unblockPipe[0];
+		}
+	}
+
+	// prepare timeout
+	int t = (timeout < 0.0) ? -1 : static_cast<int>(1000.0 * timeout);
+
+	// do the wait
+	struct epoll_event ev[s_maxPollSetEvents];
+	if (num > s_maxPollSetEvents) {
+		num = s_maxPollSetEvents;
+	}
+	int n = epoll_wait(ps->m_fd, ev, num, t);
+
+	// handle results
+	if (n == -1) {
+		if (errno == EINTR) {
+			// interrupted system call
+			ARCH->testCancelThread();
+			return 0;
+		}
+		throwError(errno);
+	}
+
+	// translate back
+	int m = 0;
+	for (int i = 0; i < n; ++i) {
+		if (ev[i].data.ptr == &s_unblockMark) {
+			// the unblock event was signalled.  flush the pipe.
+			char dummy[100];
+			int ignore;
+
+			do {
+				ignore = read(unblockPipe[0], dummy, sizeof(dummy));
+			} while (errno != EAGAIN);
+			continue;
+		}
+
+		events[m].m_data    = ev[i].data.ptr;
+		events[m].m_revents = 0;
+		if ((ev[i].events & EPOLLIN) != 0) {
+			events[m].m_revents |= kPOLLIN;
+		}
+		if ((ev[i].events & EPOLLOUT) != 0) {
+			events[m].m_revents |= kPOLLOUT;
+		}
+		if ((ev[i].events & EPOLLERR) != 0) {
+			events[m].m_revents |= kPOLLERR;
+		}
+		++m;
+	}
+
+	return m;
+}
+
+#else
+
+CArchPollSet
+CArchNetworkBSD::newPollSet()
+{
+	// no kernel poll sets.  caller falls back to pollSocket().
+	return NULL;
+}
+
+void
+CArchNetworkBSD::closePollSet(CArchPollSet)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+void
+CArchNetworkBSD::setPollSetSocket(CArchPollSet, CArchSocket,
+				unsigned short, void*)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+void
+CArchNetworkBSD::removePollSetSocket(CArchPollSet, CArchSocket)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+int
+CArchNetworkBSD::waitPollSet(CArchPollSet, CPollSetEvent[], int, double)
+{
+	assert(0 && "poll sets are not supported");
+	return 0;
+}
+
+#endif
+
 size_t
 CArchNetworkBSD::readSocket(CArchSocket s, void* buf, size_t len)
 {
@@ -536,6 +751,32 @@ CArchNetworkBSD::writeSocket(CArchSocket s, const void* buf, size_t len)
 	return n;
 }
 
+size_t
+CArchNetworkBSD::writevSocket(CArchSocket s, const CSocketBuffer bufs[], int num)
+{
+	assert(s    != NULL);
+	assert(bufs != NULL || num == 0);
+
+	// translate buffers
+	struct iovec iov[s_maxWriteBuffers];
+	if (num > s_maxWriteBuffers) {
+		num = s_maxWriteBuffers;
+	}
+	for (int i = 0; i < num; ++i) {
+		iov[i].iov_base = const_cast<void*>(bufs[i].m_data);
+		iov[i].iov_len  = bufs[i].m_size;
+	}
+
+	ssize_t n = writev(s->m_fd, iov, num);
+	if (n == -1) {
+		if (errno == EINTR || errno == EAGAIN) {
+			return 0;
+		}
+		throwError(errno);
+	}
+	return n;
+}
+
 void
 CArchNetworkBSD::throwErrorOnSocket(CArchSocket s)
 {
@@ -555,6 +796,18 @@ CArchNetworkBSD::throwErrorOnSocket(CArchSocket s)
 	}
 }
 
+size_t
+CArchNetworkBSD::getReadableSizeOnSocket(CArchSocket s)
+{
+	assert(s != NULL);
+
+	int n = 0;
+	if (ioctl(s->m_fd, FIONREAD, &n) == -1 || n < 0) {
+		return 0;
+	}
+	return static_cast<size_t>(n);
+}
+
 void
 CArchNetworkBSD::setBlockingOnSocket(int fd, bool blocking)
 {
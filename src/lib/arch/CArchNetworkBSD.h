@@ -45,6 +45,12 @@ public:
 	int					m_refCount;
 };
 
+class CArchPollSetImpl {
+public:
+	int					m_fd;
+	int					m_unblockFd;
+};
+
 class CArchNetAddressImpl {
 public:
 	CArchNetAddressImpl() : m_len(sizeof(m_addr)) { }
@@ -64,7 +70,9 @@ public:
 
 	// IArchNetwork overrides
 	virtual CArchSocket     newSocket(EAddressFamily, ESocketType);
-	virtual CArchSocket     copySocket(CArchSocket s);	virtual void		closeSocket(CArchSocket s);
+	virtual CArchSocket     copySocket(CArchSocket s);
+	virtual CArchSocket	newSocketFromDescriptor(int fd);
+	virtual void		closeSocket(CArchSocket s);
 	virtual void		closeSocketForRead(CArchSocket s);
 	virtual void		closeSocketForWrite(CArchSocket s);
 	virtual void		bindSocket(CArchSocket s, CArchNetAddress addr);
@@ -73,10 +81,21 @@ public:
 	virtual bool		connectSocket(CArchSocket s, CArchNetAddress name);
 	virtual int			pollSocket(CPollEntry[], int num, double timeout);
 	virtual void		unblockPollSocket(CArchThread thread);
+	virtual CArchPollSet	newPollSet();
+	virtual void		closePollSet(CArchPollSet ps);
+	virtual void		setPollSetSocket(CArchPollSet ps, CArchSocket s,
+							unsigned short events, void* data);
+	virtual void		removePollSetSocket(CArchPollSet ps, CArchSocket s);
+	virtual int			waitPollSet(CArchPollSet ps,
+							CPollSetEvent events[], int num,
+							double timeout);
 	virtual size_t		readSocket(CArchSocket s, void* buf, size_t len);
 	virtual size_t		writeSocket(CArchSocket s,
 							const void* buf, size_t len);
+	virtual size_t		writevSocket(CArchSocket s,
+							const CSocketBuffer bufs[], int num);
 	virtual void		throwErrorOnSocket(CArchSocket);
+	virtual size_t		getReadableSizeOnSocket(CArchSocket);
 	virtual bool		setNoDelayOnSocket(CArchSocket, bool noDelay);
 	virtual bool		setReuseAddrOnSocket(CArchSocket, bool reuse);
 	virtual std::string		getHostName();
@@ -33,6 +33,10 @@ static const int s_type[] = {
 	SOCK_STREAM
 };
 
+// most buffers passed to one WSASend() call.  any left over are
+// written by the next call.
+static const int s_maxWriteBuffers = 16;
+
 static SOCKET (PASCAL FAR *accept_winsock)(SOCKET s, struct sockaddr FAR *addr, int FAR *addrlen);
 static int (PASCAL FAR *bind_winsock)(SOCKET s, const struct sockaddr FAR *addr, int namelen);
 static int (PASCAL FAR *close_winsock)(SOCKET s);
@@ -49,6 +53,7 @@ static u_short (PASCAL FAR *ntohs_winsock)(u_short v);
 static int (PASCAL FAR *recv_winsock)(SOCKET s, void FAR * buf, int len, int flags);
 static int (PASCAL FAR *select_winsock)(int nfds, fd_set FAR *readfds, fd_set FAR *writefds, fd_set FAR *exceptfds, const struct timeval FAR *timeout);
 static int (PASCAL FAR *send_winsock)(SOCKET s, const void FAR * buf, int len, int flags);
+static int (PASCAL FAR *WSASend_winsock)(SOCKET s, LPWSABUF bufs, DWORD count, LPDWORD sent, DWORD flags, LPWSAOVERLAPPED overlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine);
 static int (PASCAL FAR *setsockopt_winsock)(SOCKET s, int level, int optname, const void FAR * optval, int optlen);
 static int (PASCAL FAR *shutdown_winsock)(SOCKET s, int how);
 static SOCKET (PASCAL FAR *socket_winsock)(int af, int type, int protocol);
@@ -181,6 +186,7 @@ CArchNetworkWinsock::initModule(HMODULE module)
 	setfunc(recv_winsock, recv, int (PASCAL FAR *)(SOCKET s, void FAR * buf, int len, int flags));
 	setfunc(select_winsock, select, int (PASCAL FAR *)(int nfds, fd_set FAR *readfds, fd_set FAR *writefds, fd_set FAR *exceptfds, const struct timeval FAR *timeout));
 	setfunc(send_winsock, send, int (PASCAL FAR *)(SOCKET s, const void FAR * buf, int len, int flags));
+	setfunc(WSASend_winsock, WSASend, int (PASCAL FAR *)(SOCKET s, LPWSABUF bufs, DWORD count, LPDWORD sent, DWORD flags, LPWSAOVERLAPPED overlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine));
 	setfunc(setsockopt_winsock, setsockopt, int (PASCAL FAR *)(SOCKET s, int level, int optname, const void FAR * optval, int optlen));
 	setfunc(shutdown_winsock, shutdown, int (PASCAL FAR *)(SOCKET s, int how));
 	setfunc(socket_winsock, socket, SOCKET (PASCAL FAR *)(int af, int type, int protocol));
@@ -236,6 +242,13 @@ CArchNetworkWinsock::copySocket(CArchSocket s)
 	return s;
 }
 
+CArchSocket
+CArchNetworkWinsock::newSocketFromDescriptor(int)
+{
+	// winsock can only wait on sockets
+	throw XArchNetworkSupport("cannot poll descriptors");
+}
+
 void
 CArchNetworkWinsock::closeSocket(CArchSocket s)
 {
@@ -537,6 +550,39 @@ CArchNetworkWinsock::unblockPollSocket(CArchThread thread)
 	}
 }
 
+CArchPollSet
+CArchNetworkWinsock::newPollSet()
+{
+	// no kernel poll sets here.  callers fall back to pollSocket().
+	return NULL;
+}
+
+void
+CArchNetworkWinsock::closePollSet(CArchPollSet)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+void
+CArchNetworkWinsock::setPollSetSocket(CArchPollSet, CArchSocket,
+				unsigned short, void*)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+void
+CArchNetworkWinsock::removePollSetSocket(CArchPollSet, CArchSocket)
+{
+	assert(0 && "poll sets are not supported");
+}
+
+int
+CArchNetworkWinsock::waitPollSet(CArchPollSet, CPollSetEvent[], int, double)
+{
+	assert(0 && "poll sets are not supported");
+	return 0;
+}
+
 size_t
 CArchNetworkWinsock::readSocket(CArchSocket s, void* buf, size_t len)
 {
@@ -573,6 +619,38 @@ CArchNetworkWinsock::writeSocket(CArchSocket s, const void* buf, size_t len)
 	return static_cast<size_t>(n);
 }
 
+size_t
+CArchNetworkWinsock::writevSocket(CArchSocket s, const CSocketBuffer bufs[], int num)
+{
+	assert(s    != NULL);
+	assert(bufs != NULL || num == 0);
+
+	// translate buffers
+	WSABUF wsaBufs[s_maxWriteBuffers];
+	if (num > s_maxWriteBuffers) {
+		num = s_maxWriteBuffers;
+	}
+	for (int i = 0; i < num; ++i) {
+		wsaBufs[i].buf = static_cast<CHAR*>(const_cast<void*>(bufs[i].m_data));
+		wsaBufs[i].len = static_cast<ULONG>(bufs[i].m_size);
+	}
+
+	DWORD n = 0;
+	if (WSASend_winsock(s->m_socket, wsaBufs, (DWORD)num,
+								&n, 0, NULL, NULL) == SOCKET_ERROR) {
+		int err = getsockerror_winsock();
+		if (err == WSAEINTR) {
+			return 0;
+		}
+		if (err == WSAEWOULDBLOCK) {
+			s->m_pollWrite = true;
+			return 0;
+		}
+		throwError(err);
+	}
+	return static_cast<size_t>(n);
+}
+
 void
 CArchNetworkWinsock::throwErrorOnSocket(CArchSocket s)
 {
@@ -592,6 +670,18 @@ CArchNetworkWinsock::throwErrorOnSocket(CArchSocket s)
 	}
 }
 
+size_t
+CArchNetworkWinsock::getReadableSizeOnSocket(CArchSocket s)
+{
+	assert(s != NULL);
+
+	u_long n = 0;
+	if (ioctl_winsock(s->m_socket, FIONREAD, &n) == SOCKET_ERROR) {
+		return 0;
+	}
+	return static_cast<size_t>(n);
+}
+
 void
 CArchNetworkWinsock::setBlockingOnSocket(SOCKET s, bool blocking)
 {
@@ -2,10 +2,25 @@
 #include "XArch.h"
 #include "CArchUsbDataLink.h"
 #include <libusb.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_POLL
+#	include <poll.h>
+#endif
+
+class CArchUsbDataLink::CCallbacks {
+public:
+	static void LIBUSB_CALL	transfer(libusb_transfer* transfer);
+	static void LIBUSB_CALL	pollfdAdded(int fd, short events, void* userData);
+	static void LIBUSB_CALL	pollfdRemoved(int fd, void* userData);
+};
 
 CArchUsbDataLink::CArchUsbDataLink() :
 	m_thread(NULL),
-	m_usbContext(NULL)
+	m_usbContext(NULL),
+	m_pollfdAdded(NULL),
+	m_pollfdRemoved(NULL),
+	m_pollfdUserData(NULL)
 {
 }
 
@@ -34,6 +49,27 @@ void CArchUsbDataLink::usbInit()
 		throw XArchNetwork("libusb_init failed");
 	}
 
+	startThread();
+}
+
+void CArchUsbDataLink::usbShut()
+{
+	stopThread();
+
+	if (m_usbContext)
+	{
+		libusb_set_pollfd_notifiers(m_usbContext, NULL, NULL, NULL);
+		m_pollfdAdded = NULL;
+		m_pollfdRemoved = NULL;
+		m_pollfdUserData = NULL;
+
+		libusb_exit(m_usbContext);
+		m_usbContext = NULL;
+	}
+}
+
+void CArchUsbDataLink::startThread()
+{
 	m_thread = ARCH->newThread(&CArchUsbDataLink::threadFunc, m_usbContext);
 	if (m_thread == NULL) 
 	{
@@ -42,7 +78,7 @@ void CArchUsbDataLink::usbInit()
 	}
 }
 
-void CArchUsbDataLink::usbShut()
+void CArchUsbDataLink::stopThread()
 {
 	if (m_thread)
 	{
@@ -51,12 +87,6 @@ void CArchUsbDataLink::usbShut()
 		ARCH->closeThread(m_thread);
 		m_thread = NULL;
 	}
-
-	if (m_usbContext)
-	{
-		libusb_exit(m_usbContext);
-		m_usbContext = NULL;
-	}
 }
 
 void* CArchUsbDataLink::threadFunc(void* ctx)
@@ -146,13 +176,13 @@ void CArchUsbDataLink::usbGetDeviceInfo(USBDeviceEnumerator devEnum, struct USBD
 	info.idProduct = desc.idProduct;
 	info.busNumber = libusb_get_bus_number(devEnum);
 	info.deviceAddress = libusb_get_device_address(devEnum);
+	info.validEndpointInfo = false;
 
 	r = libusb_get_active_config_descriptor(devEnum, &config_desc);
 	if( r>=0 )
 	{
 		//Investigate device interfaces. Detect 'in' and 'out' bulk endpoints
 		//in specific interface and save their numbers.
-		info.validEndpointInfo = false;
 		if( config_desc->interface != NULL )
 		{
 			for(int n=0; n < config_desc->interface->num_altsetting; n++ )
@@ -250,6 +280,16 @@ USBDeviceHandle CArchUsbDataLink::usbOpenDevice(struct USBDeviceInfo &devInfo, i
 				(info.deviceAddress == devInfo.deviceAddress || devInfo.deviceAddress == (unsigned char)-1))
 			{
 				handle = usbOpenDevice(iter, ifid);
+
+				// report the endpoints of the device we opened
+				devInfo.validEndpointInfo = info.validEndpointInfo;
+				if (info.validEndpointInfo) {
+					devInfo.inputEndpoint = info.inputEndpoint;
+					devInfo.outputEndpoint = info.outputEndpoint;
+					devInfo.interfaceNumber = info.interfaceNumber;
+					devInfo.inputEndpointMaxPacketSize = info.inputEndpointMaxPacketSize;
+					devInfo.outputEndpointMaxPacketSize = info.outputEndpointMaxPacketSize;
+				}
 				break;
 			}
 		}
@@ -293,6 +333,175 @@ int CArchUsbDataLink::usbBulkTransfer(USBDeviceHandle dev, bool write, unsigned
 	return transferred;
 }
 
+USBTransfer* CArchUsbDataLink::usbAllocTransfer()
+{
+	libusb_transfer* transfer = libusb_alloc_transfer(0);
+	if (transfer == NULL)
+	{
+		throw XArchNetwork("libusb_alloc_transfer failed");
+	}
+
+	USBTransfer* result = new USBTransfer;
+	memset(result, 0, sizeof(USBTransfer));
+	result->m_backend = transfer;
+	transfer->user_data = result;
+	return result;
+}
+
+void CArchUsbDataLink::usbFreeTransfer(USBTransfer* transfer)
+{
+	if (transfer)
+	{
+		libusb_free_transfer(reinterpret_cast<libusb_transfer*>(transfer->m_backend));
+		delete transfer;
+	}
+}
+
+bool CArchUsbDataLink::usbSubmitTransfer(USBTransfer* transfer)
+{
+	libusb_transfer* usbTransfer = reinterpret_cast<libusb_transfer*>(transfer->m_backend);
+
+	libusb_fill_bulk_transfer(
+		usbTransfer,
+		transfer->m_device,
+		transfer->m_endpoint,
+		transfer->m_buffer,
+		transfer->m_length,
+		&CCallbacks::transfer,
+		transfer,
+		transfer->m_timeout);
+	usbTransfer->flags = transfer->m_zeroPacket ? LIBUSB_TRANSFER_ADD_ZERO_PACKET : 0;
+
+	return (libusb_submit_transfer(usbTransfer) == 0);
+}
+
+void CArchUsbDataLink::usbCancelTransfer(USBTransfer* transfer)
+{
+	libusb_cancel_transfer(reinterpret_cast<libusb_transfer*>(transfer->m_backend));
+}
+
+void LIBUSB_CALL CArchUsbDataLink::CCallbacks::transfer(libusb_transfer* usbTransfer)
+{
+	USBTransfer* transfer = reinterpret_cast<USBTransfer*>(usbTransfer->user_data);
+
+	transfer->m_actualLength = usbTransfer->actual_length;
+	switch (usbTransfer->status)
+	{
+	case LIBUSB_TRANSFER_COMPLETED:
+		transfer->m_status = USBTransfer::kCompleted;
+		break;
+
+	case LIBUSB_TRANSFER_CANCELLED:
+		transfer->m_status = USBTransfer::kCancelled;
+		break;
+
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		transfer->m_status = USBTransfer::kTimedOut;
+		break;
+
+	default:
+		transfer->m_status = USBTransfer::kFailed;
+		break;
+	}
+
+	transfer->m_callback(transfer);
+}
+
+//
+// EVENTS
+//
+
+bool CArchUsbDataLink::usbSetPollfdNotifiers(USBPollfdAddedFunc added, USBPollfdRemovedFunc removed, void* userData)
+{
+	if (!m_usbContext)
+	{
+		return false;
+	}
+
+	if (added == NULL || removed == NULL)
+	{
+		// go back to handling events on our own thread
+		libusb_set_pollfd_notifiers(m_usbContext, NULL, NULL, NULL);
+		m_pollfdAdded = NULL;
+		m_pollfdRemoved = NULL;
+		m_pollfdUserData = NULL;
+
+		if (!m_thread)
+		{
+			startThread();
+		}
+		return true;
+	}
+
+	// the caller has no timers so libusb must be able to handle its
+	// timeouts through a descriptor too
+	if (!libusb_pollfds_handle_timeouts(m_usbContext))
+	{
+		return false;
+	}
+
+	// install notifiers before asking for the current descriptors so
+	// none are missed.  the caller must tolerate being told twice.
+	m_pollfdAdded = added;
+	m_pollfdRemoved = removed;
+	m_pollfdUserData = userData;
+	libusb_set_pollfd_notifiers(m_usbContext, &CCallbacks::pollfdAdded, &CCallbacks::pollfdRemoved, this);
+
+	const libusb_pollfd** pollfds = libusb_get_pollfds(m_usbContext);
+	if (pollfds == NULL)
+	{
+		// descriptors aren't available on this platform
+		libusb_set_pollfd_notifiers(m_usbContext, NULL, NULL, NULL);
+		m_pollfdAdded = NULL;
+		m_pollfdRemoved = NULL;
+		m_pollfdUserData = NULL;
+		return false;
+	}
+
+	stopThread();
+
+	for (const libusb_pollfd** i = pollfds; *i != NULL; ++i)
+	{
+		CCallbacks::pollfdAdded((*i)->fd, (*i)->events, this);
+	}
+	free(pollfds);
+
+	return true;
+}
+
+void CArchUsbDataLink::usbHandleEvents()
+{
+	struct timeval tv;
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	libusb_handle_events_timeout(m_usbContext, &tv);
+}
+
+void LIBUSB_CALL CArchUsbDataLink::CCallbacks::pollfdAdded(int fd, short events, void* userData)
+{
+	CArchUsbDataLink* this_ = reinterpret_cast<CArchUsbDataLink*>(userData);
+	if (this_->m_pollfdAdded)
+	{
+#if HAVE_POLL
+		bool readable = ((events & POLLIN) != 0);
+		bool writable = ((events & POLLOUT) != 0);
+#else
+		bool readable = true;
+		bool writable = false;
+#endif
+		this_->m_pollfdAdded(fd, readable, writable, this_->m_pollfdUserData);
+	}
+}
+
+void LIBUSB_CALL CArchUsbDataLink::CCallbacks::pollfdRemoved(int fd, void* userData)
+{
+	CArchUsbDataLink* this_ = reinterpret_cast<CArchUsbDataLink*>(userData);
+	if (this_->m_pollfdRemoved)
+	{
+		this_->m_pollfdRemoved(fd, this_->m_pollfdUserData);
+	}
+}
+
 int CArchUsbDataLink::usbTryBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout)
 {
 	unsigned char iomode = write ? LIBUSB_ENDPOINT_OUT : LIBUSB_ENDPOINT_IN;
@@ -49,11 +49,31 @@ public:
 	int usbBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout);
 	int usbTryBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout);
 
+	USBTransfer* usbAllocTransfer();
+	void usbFreeTransfer(USBTransfer* transfer);
+	bool usbSubmitTransfer(USBTransfer* transfer);
+	void usbCancelTransfer(USBTransfer* transfer);
+
+	bool usbSetPollfdNotifiers(USBPollfdAddedFunc added, USBPollfdRemovedFunc removed, void* userData);
+	void usbHandleEvents();
+
 private:
 	static void*		threadFunc(void*);
 
+	// the libusb callbacks, defined with the rest of the libusb code so
+	// this header doesn't need libusb's
+	class CCallbacks;
+	friend class CCallbacks;
+
+	void startThread();
+	void stopThread();
+
 	USBContextHandle m_usbContext;
 	CArchThread	m_thread;
+
+	USBPollfdAddedFunc		m_pollfdAdded;
+	USBPollfdRemovedFunc	m_pollfdRemoved;
+	void*					m_pollfdUserData;
 };
 
 #endif
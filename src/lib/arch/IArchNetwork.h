@@ -54,6 +54,21 @@ An opaque type representing a network address.
 */
 typedef CArchNetAddressImpl* CArchNetAddress;
 
+/*!      
+\class CArchPollSetImpl
+\brief Internal poll set data.
+An architecture dependent type holding the necessary data for a poll set.
+*/
+class CArchPollSetImpl;
+
+/*!      
+\var CArchPollSet
+\brief Opaque poll set type.
+An opaque type representing a set of sockets registered for readiness
+notification.
+*/
+typedef CArchPollSetImpl* CArchPollSet;
+
 //! Interface for architecture dependent networking
 /*!
 This interface defines the networking operations required by
@@ -102,6 +117,26 @@ public:
 		unsigned short	m_revents;
 	};
 
+	//! A buffer for \c writevSocket()
+	class CSocketBuffer {
+	public:
+		//! The data to write
+		const void*		m_data;
+
+		//! The number of bytes at \c m_data
+		size_t			m_size;
+	};
+
+	//! A ready socket reported by \c waitPollSet()
+	class CPollSetEvent {
+	public:
+		//! The data passed to \c setPollSetSocket() for the socket
+		void*			m_data;
+
+		//! The result events
+		unsigned short	m_revents;
+	};
+
 	//! @name manipulators
 	//@{
 
@@ -117,6 +152,16 @@ public:
 	*/
 	virtual CArchSocket	copySocket(CArchSocket s) = 0;
 
+	//! Create a socket object for a descriptor
+	/*!
+	Returns a socket object referring to a duplicate of the platform
+	file descriptor \c fd, so a descriptor owned by some other library
+	can be polled like a socket.  Closing the socket doesn't close
+	\c fd.  Throws XArchNetworkSupport if descriptors can't be polled
+	on this platform.
+	*/
+	virtual CArchSocket	newSocketFromDescriptor(int fd) = 0;
+
 	//! Release a socket reference
 	/*!
 	Deletes the given socket object.  This does not destroy the socket
@@ -197,6 +242,52 @@ public:
 	*/
 	virtual void		unblockPollSocket(CArchThread thread) = 0;
 
+	//! Create a poll set
+	/*!
+	Returns a new, empty poll set or NULL if the platform has no kernel
+	readiness notification, in which case the caller should use
+	\c pollSocket().  Sockets stay registered in a poll set between
+	waits so changing the registration costs O(1) and a wait returns
+	only the sockets that are ready.
+	*/
+	virtual CArchPollSet	newPollSet() = 0;
+
+	//! Destroy a poll set
+	virtual void		closePollSet(CArchPollSet ps) = 0;
+
+	//! Add or change a socket in a poll set
+	/*!
+	Registers socket \c s in poll set \c ps for \c events, which can
+	be any combination of kPOLLIN and kPOLLOUT, replacing any previous
+	registration of \c s.  Errors are always reported.  \c data is
+	returned in \c m_data of events for the socket.  This may be called
+	while another thread is in \c waitPollSet().
+	*/
+	virtual void		setPollSetSocket(CArchPollSet ps, CArchSocket s,
+							unsigned short events, void* data) = 0;
+
+	//! Remove a socket from a poll set
+	/*!
+	Removes socket \c s from poll set \c ps.  The socket must be removed
+	before it's closed.  This may be called while another thread is in
+	\c waitPollSet() but that thread may still report the socket from
+	a wait that has already returned.
+	*/
+	virtual void		removePollSetSocket(CArchPollSet ps, CArchSocket s) = 0;
+
+	//! Wait on a poll set
+	/*!
+	Waits up to \c timeout seconds (or indefinitely if \c timeout < 0)
+	for some socket in \c ps to become ready, fills in at most \c num
+	entries of \c events and returns the number filled in.  Returns 0
+	if the wait timed out or was interrupted by \c unblockPollSocket().
+
+	(Cancellation point)
+	*/
+	virtual int			waitPollSet(CArchPollSet ps,
+							CPollSetEvent events[], int num,
+							double timeout) = 0;
+
 	//! Read data from socket
 	/*!
 	Read up to \c len bytes from socket \c s in \c buf and return the
@@ -216,6 +307,17 @@ public:
 	virtual size_t		writeSocket(CArchSocket s,
 							const void* buf, size_t len) = 0;
 
+	//! Write data from several buffers to socket
+	/*!
+	Like \c writeSocket() but writes the \c num buffers in \c bufs, in
+	order, as if they were one contiguous buffer.  Where the platform
+	allows this is done in a single call without copying.  Returns the
+	total number of bytes written, which can be less than the total
+	size of the buffers.
+	*/
+	virtual size_t		writevSocket(CArchSocket s,
+							const CSocketBuffer bufs[], int num) = 0;
+
 	//! Check error on socket
 	/*!
 	If the socket \c s is in an error state then throws an appropriate
@@ -223,6 +325,13 @@ public:
 	*/
 	virtual void		throwErrorOnSocket(CArchSocket s) = 0;
 
+	//! Get number of bytes waiting on socket
+	/*!
+	Returns the number of bytes that can be read from socket \c s
+	without blocking or 0 if that's unknown.
+	*/
+	virtual size_t		getReadableSizeOnSocket(CArchSocket s) = 0;
+
 	//! Turn Nagle algorithm on or off on socket
 	/*!
 	Set socket to send messages immediately (true) or to collect small
@@ -48,6 +48,43 @@ struct USBDataLinkConfig: USBDeviceInfo
 	int bulkout;
 };
 
+// called when libusb starts or stops waiting on a file descriptor
+typedef void (*USBPollfdAddedFunc)(int fd, bool readable, bool writable, void* userData);
+typedef void (*USBPollfdRemovedFunc)(int fd, void* userData);
+
+struct USBTransfer;
+
+// called when an asynchronous transfer finishes
+typedef void (*USBTransferFunc)(USBTransfer* transfer);
+
+//! Asynchronous bulk transfer
+/*!
+Filled in by the caller and handed to usbSubmitTransfer().  The backend
+sets \c m_actualLength and \c m_status before calling \c m_callback,
+which may happen on any thread.
+*/
+struct USBTransfer
+{
+	enum EStatus {
+		kCompleted,
+		kCancelled,
+		kTimedOut,
+		kFailed
+	};
+
+	USBDeviceHandle	m_device;
+	unsigned char	m_endpoint;
+	unsigned char*	m_buffer;
+	int				m_length;
+	int				m_actualLength;
+	EStatus			m_status;
+	unsigned int	m_timeout;		// milliseconds, 0 for none
+	bool			m_zeroPacket;	// end a write of whole packets with a short packet
+	USBTransferFunc	m_callback;
+	void*			m_userData;
+	void*			m_backend;		// owned by the backend
+};
+
 
 //! Interface for architecture dependent USB
 /*!
@@ -72,6 +109,24 @@ public:
 	virtual void usbCloseDevice(USBDeviceHandle dev, int ifid) = 0;
 	virtual int usbBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout) = 0;
 	virtual int usbTryBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout) = 0;
+
+	// asynchronous transfers.  a transfer may be submitted again once its
+	// callback has been called and is freed only when it's not in flight.
+	virtual USBTransfer* usbAllocTransfer() = 0;
+	virtual void usbFreeTransfer(USBTransfer* transfer) = 0;
+	virtual bool usbSubmitTransfer(USBTransfer* transfer) = 0;
+	virtual void usbCancelTransfer(USBTransfer* transfer) = 0;
+
+	// hands libusb event handling over to the caller's readiness loop.
+	// stops the internal event thread, reports the file descriptors libusb
+	// waits on now and whenever they change, and expects usbHandleEvents()
+	// to be called when one is ready.  NULL callbacks restart the internal
+	// thread.  returns false, leaving the thread running, if libusb can't
+	// be driven by descriptors alone on this platform.
+	virtual bool usbSetPollfdNotifiers(USBPollfdAddedFunc added, USBPollfdRemovedFunc removed, void* userData) = 0;
+
+	// handles pending libusb events without blocking
+	virtual void usbHandleEvents() = 0;
 };
 
 #endif
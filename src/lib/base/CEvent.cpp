@@ -18,6 +18,7 @@
 
 #include "CEvent.h"
 #include "CEventQueue.h"
+#include "CEventDataPool.h"
 
 //
 // CEvent
@@ -85,7 +86,7 @@ CEvent::deleteData(const CEvent& event)
 
 	default:
 		if ((event.getFlags() & kDontFreeData) == 0) {
-			free(event.getData());
+			CEventDataPool::release(event.getData());
 			delete event.getDataObject();
 		}
 		break;
@@ -0,0 +1,141 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CEventDataPool.h"
+#include "CArchAtomic.h"
+#include <stdlib.h>
+
+// the pool is static data so it's usable before main() and needs no
+// construction.  everything starts zeroed.  kBlockSize must be a
+// multiple of 8.
+static const size_t		kBlockSize = 64;
+static const UInt32		kNumBlocks = 1024;
+
+static UInt64			s_blocks[kNumBlocks][kBlockSize / sizeof(UInt64)];
+
+// the free list is a stack of block indices.  the head holds the index
+// plus one of the top block, or zero when the stack is empty, in the
+// low 32 bits and a count of changes in the high 32 bits.  the count
+// stops a thread that was preempted between reading the head and
+// swapping it from replacing a head that was popped and pushed back in
+// the meantime.  that could only go wrong if the thread slept through
+// exactly 2^32 changes.  s_next[i] holds the index plus one of the
+// block below block i.
+static volatile SInt64	s_head = 0;
+static volatile SInt32	s_next[kNumBlocks];
+
+// blocks at or above s_used have never been allocated and aren't on
+// the free list
+static volatile SInt32	s_used = 0;
+
+static volatile SInt32	s_hits   = 0;
+static volatile SInt32	s_misses = 0;
+
+//
+// CEventDataPool
+//
+
+void*
+CEventDataPool::alloc(size_t size)
+{
+	if (size <= kBlockSize) {
+		void* data = pop();
+		if (data != NULL) {
+			CArchAtomic::add(&s_hits, 1);
+			return data;
+		}
+	}
+	CArchAtomic::add(&s_misses, 1);
+	return malloc(size);
+}
+
+void
+CEventDataPool::release(void* data)
+{
+	if (isPooled(data)) {
+		push(data);
+	}
+	else {
+		free(data);
+	}
+}
+
+UInt32
+CEventDataPool::getHits()
+{
+	return (UInt32)CArchAtomic::load(&s_hits);
+}
+
+UInt32
+CEventDataPool::getMisses()
+{
+	return (UInt32)CArchAtomic::load(&s_misses);
+}
+
+bool
+CEventDataPool::isPooled(const void* data)
+{
+	const char* p = static_cast<const char*>(data);
+	return (p >= reinterpret_cast<const char*>(s_blocks) &&
+			p <  reinterpret_cast<const char*>(s_blocks + kNumBlocks));
+}
+
+void*
+CEventDataPool::pop()
+{
+	for (;;) {
+		UInt64 head  = (UInt64)CArchAtomic::load(&s_head);
+		UInt32 index = (UInt32)head;
+		if (index == 0) {
+			break;
+		}
+
+		// s_next[index - 1] may be stale if another thread took the
+		// block first but then the swap fails because the count changed
+		UInt64 next  = (UInt32)CArchAtomic::load(&s_next[index - 1]);
+		UInt64 count = (UInt32)((head >> 32) + 1);
+		if (CArchAtomic::compareAndSwap(&s_head, (SInt64)head,
+								(SInt64)((count << 32) | next))) {
+			return s_blocks[index - 1];
+		}
+	}
+
+	// free list is empty.  take a block that's never been used.
+	if ((UInt32)CArchAtomic::load(&s_used) < kNumBlocks) {
+		UInt32 index = (UInt32)CArchAtomic::add(&s_used, 1) - 1;
+		if (index < kNumBlocks) {
+			return s_blocks[index];
+		}
+	}
+	return NULL;
+}
+
+void
+CEventDataPool::push(void* data)
+{
+	UInt32 index = (UInt32)((static_cast<UInt64*>(data) - s_blocks[0]) /
+								(kBlockSize / sizeof(UInt64))) + 1;
+	for (;;) {
+		UInt64 head  = (UInt64)CArchAtomic::load(&s_head);
+		UInt64 count = (UInt32)((head >> 32) + 1);
+		CArchAtomic::store(&s_next[index - 1], (SInt32)(UInt32)head);
+		if (CArchAtomic::compareAndSwap(&s_head, (SInt64)head,
+								(SInt64)((count << 32) | index))) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CEVENTDATAPOOL_H
+#define CEVENTDATAPOOL_H
+
+#include "BasicTypes.h"
+#include <stddef.h>
+
+//! Event data pool
+/*!
+A fixed size pool of small blocks for \c CEvent data.  Input events
+carry a few bytes of data and are sent hundreds of times a second so
+taking their data from the pool saves a malloc() and free() for each
+one.  Blocks are taken and returned without a lock so any thread can
+allocate data that another thread releases.  Requests that are too
+large or that come when every block is in use fall back to malloc().
+
+Data from \c alloc() must be released with \c release(), which
+\c CEvent::deleteData() does.  \c release() also accepts data from
+malloc() so event data may come from either.
+*/
+class CEventDataPool {
+public:
+	//! @name manipulators
+	//@{
+
+	//! Allocate event data
+	/*!
+	Returns \p size bytes of uninitialized memory aligned for any
+	POD event data.
+	*/
+	static void*		alloc(size_t size);
+
+	//! Release event data
+	/*!
+	Returns \p data to the pool if it came from the pool, otherwise
+	free()s it.  \p data may be NULL.
+	*/
+	static void			release(void* data);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Get the number of allocations served by the pool
+	static UInt32		getHits();
+
+	//! Get the number of allocations that fell back to malloc()
+	static UInt32		getMisses();
+
+	//! Test if data came from the pool
+	static bool			isPooled(const void* data);
+
+	//@}
+
+private:
+	static void*		pop();
+	static void			push(void* data);
+};
+
+#endif
@@ -18,10 +18,12 @@
 
 #include "CEventQueue.h"
 #include "CLog.h"
-#include "CSimpleEventQueueBuffer.h"
+#include "CEventDataPool.h"
+#include "CLockFreeEventQueueBuffer.h"
 #include "CStopwatch.h"
 #include "IEventJob.h"
 #include "CArch.h"
+#include "CArchAtomic.h"
 
 // interrupt handler.  this just adds a quit event to the queue.
 static
@@ -31,26 +33,45 @@ interrupt(CArch::ESignal, void*)
 	EVENTQUEUE->addEvent(CEvent(CEvent::kQuit));
 }
 
+// the handler table never shrinks below this many entries
+static const UInt32		kMinHandlerTableSize = 64;
+static const UInt32		kNoIndex             = 0xffffffffu;
+
+// the timer wheel turns once every kNumTimerSlots / kTimerTickRate
+// seconds.  kNumTimerSlots must be a power of two.
+static const double		kTimerTickRate       = 32.0;
+static const UInt32		kNumTimerSlots       = 1024;
+
+// number of events the event table holds without a lock.  must be a
+// power of two.
+static const UInt32		kNumEventSlots       = 4096;
+
 
 //
 // CEventQueue
 //
 
 CEventQueue::CEventQueue() :
-	m_nextType(CEvent::kLast)
+	m_nextType(CEvent::kLast),
+	m_adding(0),
+	m_adopting(0)
 {
 	setInstance(this);
-	m_mutex = ARCH->newMutex();
+	m_mutex      = ARCH->newMutex();
+	m_timerMutex = ARCH->newMutex();
 	ARCH->setSignalHandler(CArch::kINTERRUPT, &interrupt, NULL);
 	ARCH->setSignalHandler(CArch::kTERMINATE, &interrupt, NULL);
-	m_buffer = new CSimpleEventQueueBuffer;
+	m_buffer = new CLockFreeEventQueueBuffer;
 }
 
 CEventQueue::~CEventQueue()
 {
+	LOG((CLOG_DEBUG1 "event data pool: %u hits, %u misses",
+				CEventDataPool::getHits(), CEventDataPool::getMisses()));
 	delete m_buffer;
 	ARCH->setSignalHandler(CArch::kINTERRUPT, NULL, NULL);
 	ARCH->setSignalHandler(CArch::kTERMINATE, NULL, NULL);
+	ARCH->closeMutex(m_timerMutex);
 	ARCH->closeMutex(m_mutex);
 	setInstance(NULL);
 }
@@ -124,25 +145,28 @@ CEventQueue::adoptBuffer(IEventQueueBuffer* buffer)
 
 	LOG((CLOG_DEBUG "adopting new buffer"));
 
-	if (m_events.size() != 0) {
-		// this can come as a nasty surprise to programmers expecting
-		// their events to be raised, only to have them deleted.
-		LOG((CLOG_DEBUG "discarding %d event(s)", m_events.size()));
+	// make addEvent() wait for us and wait for the calls already
+	// using the buffer to finish.  they don't block so this is quick.
+	CArchAtomic::store(&m_adopting, 1);
+	while (CArchAtomic::load(&m_adding) != 0) {
+		ARCH->sleep(0.0);
 	}
 
 	// discard old buffer and old events
 	delete m_buffer;
-	for (CEventTable::iterator i = m_events.begin(); i != m_events.end(); ++i) {
-		CEvent::deleteData(i->second);
+	UInt32 numEvents = m_events.clear();
+	if (numEvents != 0) {
+		// this can come as a nasty surprise to programmers expecting
+		// their events to be raised, only to have them deleted.
+		LOG((CLOG_DEBUG "discarding %d event(s)", numEvents));
 	}
-	m_events.clear();
-	m_oldEventIDs.clear();
 
 	// use new buffer
 	m_buffer = buffer;
 	if (m_buffer == NULL) {
-		m_buffer = new CSimpleEventQueueBuffer;
+		m_buffer = new CLockFreeEventQueueBuffer;
 	}
+	CArchAtomic::store(&m_adopting, 0);
 }
 
 bool
@@ -192,11 +216,8 @@ retry:
 		return true;
 
 	case IEventQueueBuffer::kUser:
-		{
-			CArchMutexLock lock(m_mutex);
-			event = removeEvent(dataID);
-			return true;
-		}
+		event = m_events.remove(dataID);
+		return true;
 
 	default:
 		assert(0 && "invalid event type");
@@ -238,20 +259,34 @@ CEventQueue::addEvent(const CEvent& event)
 		CEvent::deleteData(event);
 	}
 	else {
-		CArchMutexLock lock(m_mutex);
-		
-		// store the event's data locally
-		UInt32 eventID = saveEvent(event);
-		
-		// add it
-		if (!m_buffer->addEvent(eventID)) {
-			// failed to send event
-			removeEvent(eventID);
-			CEvent::deleteData(event);
+		// don't use the buffer while adoptBuffer() is replacing it
+		CArchAtomic::add(&m_adding, 1);
+		if (CArchAtomic::load(&m_adopting) != 0) {
+			CArchAtomic::add(&m_adding, -1);
+			CArchMutexLock lock(m_mutex);
+			addEventToBuffer(event);
+		}
+		else {
+			addEventToBuffer(event);
+			CArchAtomic::add(&m_adding, -1);
 		}
 	}
 }
 
+void
+CEventQueue::addEventToBuffer(const CEvent& event)
+{
+	// store the event's data locally
+	UInt32 eventID = m_events.insert(event);
+
+	// add it
+	if (!m_buffer->addEvent(eventID)) {
+		// failed to send event
+		m_events.remove(eventID);
+		CEvent::deleteData(event);
+	}
+}
+
 CEventQueueTimer*
 CEventQueue::newTimer(double duration, void* target)
 {
@@ -261,13 +296,9 @@ CEventQueue::newTimer(double duration, void* target)
 	if (target == NULL) {
 		target = timer;
 	}
-	CArchMutexLock lock(m_mutex);
-	m_timers.insert(timer);
-	// initial duration is requested duration plus whatever's on
-	// the clock currently because the latter will be subtracted
-	// the next time we check for timers.
-	m_timerQueue.push(CTimer(timer, duration,
-							duration + m_time.getTime(), target, false));
+	CArchMutexLock lock(m_timerMutex);
+	m_timers[timer] = m_timerWheel.insert(CTimer(timer, duration,
+							m_time.getTime(), target, false));
 	return timer;
 }
 
@@ -280,29 +311,19 @@ CEventQueue::newOneShotTimer(double duration, void* target)
 	if (target == NULL) {
 		target = timer;
 	}
-	CArchMutexLock lock(m_mutex);
-	m_timers.insert(timer);
-	// initial duration is requested duration plus whatever's on
-	// the clock currently because the latter will be subtracted
-	// the next time we check for timers.
-	m_timerQueue.push(CTimer(timer, duration,
-							duration + m_time.getTime(), target, true));
+	CArchMutexLock lock(m_timerMutex);
+	m_timers[timer] = m_timerWheel.insert(CTimer(timer, duration,
+							m_time.getTime(), target, true));
 	return timer;
 }
 
 void
 CEventQueue::deleteTimer(CEventQueueTimer* timer)
 {
-	CArchMutexLock lock(m_mutex);
-	for (CTimerQueue::iterator index = m_timerQueue.begin();
-							index != m_timerQueue.end(); ++index) {
-		if (index->getTimer() == timer) {
-			m_timerQueue.erase(index);
-			break;
-		}
-	}
+	CArchMutexLock lock(m_timerMutex);
 	CTimers::iterator index = m_timers.find(timer);
 	if (index != m_timers.end()) {
+		m_timerWheel.remove(index->second);
 		m_timers.erase(index);
 	}
 	m_buffer->deleteTimer(timer);
@@ -312,9 +333,7 @@ void
 CEventQueue::adoptHandler(CEvent::Type type, void* target, IEventJob* handler)
 {
 	CArchMutexLock lock(m_mutex);
-	IEventJob*& job = m_handlers[target][type];
-	delete job;
-	job = handler;
+	delete m_handlers.insert(type, target, handler);
 }
 
 void
@@ -323,15 +342,7 @@ CEventQueue::removeHandler(CEvent::Type type, void* target)
 	IEventJob* handler = NULL;
 	{
 		CArchMutexLock lock(m_mutex);
-		CHandlerTable::iterator index = m_handlers.find(target);
-		if (index != m_handlers.end()) {
-			CTypeHandlerTable& typeHandlers = index->second;
-			CTypeHandlerTable::iterator index2 = typeHandlers.find(type);
-			if (index2 != typeHandlers.end()) {
-				handler = index2->second;
-				typeHandlers.erase(index2);
-			}
-		}
+		handler = m_handlers.remove(type, target);
 	}
 	delete handler;
 }
@@ -342,16 +353,7 @@ CEventQueue::removeHandlers(void* target)
 	std::vector<IEventJob*> handlers;
 	{
 		CArchMutexLock lock(m_mutex);
-		CHandlerTable::iterator index = m_handlers.find(target);
-		if (index != m_handlers.end()) {
-			// copy to handlers array and clear table for target
-			CTypeHandlerTable& typeHandlers = index->second;
-			for (CTypeHandlerTable::iterator index2 = typeHandlers.begin();
-							index2 != typeHandlers.end(); ++index2) {
-				handlers.push_back(index2->second);
-			}
-			typeHandlers.clear();
-		}
+		m_handlers.removeAll(target, handlers);
 	}
 
 	// delete handlers
@@ -371,111 +373,46 @@ IEventJob*
 CEventQueue::getHandler(CEvent::Type type, void* target) const
 {
 	CArchMutexLock lock(m_mutex);
-	CHandlerTable::const_iterator index = m_handlers.find(target);
-	if (index != m_handlers.end()) {
-		const CTypeHandlerTable& typeHandlers = index->second;
-		CTypeHandlerTable::const_iterator index2 = typeHandlers.find(type);
-		if (index2 != typeHandlers.end()) {
-			return index2->second;
-		}
-	}
-	return NULL;
-}
-
-UInt32
-CEventQueue::saveEvent(const CEvent& event)
-{
-	// choose id
-	UInt32 id;
-	if (!m_oldEventIDs.empty()) {
-		// reuse an id
-		id = m_oldEventIDs.back();
-		m_oldEventIDs.pop_back();
-	}
-	else {
-		// make a new id
-		id = static_cast<UInt32>(m_events.size());
-	}
-
-	// save data
-	m_events[id] = event;
-	return id;
-}
-
-CEvent
-CEventQueue::removeEvent(UInt32 eventID)
-{
-	// look up id
-	CEventTable::iterator index = m_events.find(eventID);
-	if (index == m_events.end()) {
-		return CEvent();
-	}
-
-	// get data
-	CEvent event = index->second;
-	m_events.erase(index);
-
-	// save old id for reuse
-	m_oldEventIDs.push_back(eventID);
-
-	return event;
+	return m_handlers.find(type, target);
 }
 
 bool
 CEventQueue::hasTimerExpired(CEvent& event)
 {
-	// return true if there's a timer in the timer priority queue that
-	// has expired.  if returning true then fill in event appropriately
-	// and reset and reinsert the timer.
-	if (m_timerQueue.empty()) {
-		return false;
-	}
-
-	// get time elapsed since last check
+	// return true if there's a timer in the timer wheel that has
+	// expired.  if returning true then fill in event appropriately.
+	// the wheel reschedules the timer unless it's a one-shot.
 	const double time = m_time.getTime();
-	m_time.reset();
-
-	// countdown elapsed time
-	for (CTimerQueue::iterator index = m_timerQueue.begin();
-							index != m_timerQueue.end(); ++index) {
-		(*index) -= time;
-	}
-
-	// done if no timers are expired
-	if (m_timerQueue.top() > 0.0) {
+	CArchMutexLock lock(m_timerMutex);
+	CTimer timer(NULL, 1.0, 0.0, NULL, true);
+	if (!m_timerWheel.expire(time, timer)) {
 		return false;
 	}
 
-	// remove timer from queue
-	CTimer timer = m_timerQueue.top();
-	m_timerQueue.pop();
-
-	// prepare event and reset the timer's clock
-	timer.fillEvent(m_timerEvent);
+	// prepare event
+	timer.fillEvent(m_timerEvent, time);
 	event = CEvent(CEvent::kTimer, timer.getTarget(), &m_timerEvent);
-	timer.reset();
-
-	// reinsert timer into queue if it's not a one-shot
-	if (!timer.isOneShot()) {
-		m_timerQueue.push(timer);
-	}
-
 	return true;
 }
 
 double
 CEventQueue::getNextTimerTimeout() const
 {
-	// return -1 if no timers, 0 if the top timer has expired, otherwise
-	// the time until the top timer in the timer priority queue will
-	// expire.
-	if (m_timerQueue.empty()) {
+	// return -1 if no timers, 0 if the earliest timer has expired,
+	// otherwise the time until the earliest timer will expire.
+	double time;
+	{
+		CArchMutexLock lock(m_timerMutex);
+		time = m_timerWheel.getNextTime();
+	}
+	if (time < 0.0) {
 		return -1.0;
 	}
-	if (m_timerQueue.top() <= 0.0) {
+	time -= m_time.getTime();
+	if (time <= 0.0) {
 		return 0.0;
 	}
-	return m_timerQueue.top();
+	return time;
 }
 
 CEvent::Type
@@ -494,12 +431,12 @@ CEventQueue::getRegisteredType(const CString& name) const
 //
 
 CEventQueue::CTimer::CTimer(CEventQueueTimer* timer, double timeout,
-				double initialTime, void* target, bool oneShot) :
+				double time, void* target, bool oneShot) :
 	m_timer(timer),
 	m_timeout(timeout),
 	m_target(target),
 	m_oneShot(oneShot),
-	m_time(initialTime)
+	m_time(time + timeout)
 {
 	assert(m_timeout > 0.0);
 }
@@ -510,21 +447,9 @@ CEventQueue::CTimer::~CTimer()
 }
 
 void
-CEventQueue::CTimer::reset()
-{
-	m_time = m_timeout;
-}
-
-CEventQueue::CTimer&
-CEventQueue::CTimer::operator-=(double dt)
+CEventQueue::CTimer::reset(double time)
 {
-	m_time -= dt;
-	return *this;
-}
-
-CEventQueue::CTimer::operator double() const
-{
-	return m_time;
+	m_time = time + m_timeout;
 }
 
 bool
@@ -545,18 +470,518 @@ CEventQueue::CTimer::getTarget() const
 	return m_target;
 }
 
+double
+CEventQueue::CTimer::getTime() const
+{
+	return m_time;
+}
+
 void
-CEventQueue::CTimer::fillEvent(CTimerEvent& event) const
+CEventQueue::CTimer::fillEvent(CTimerEvent& event, double time) const
 {
 	event.m_timer = m_timer;
 	event.m_count = 0;
-	if (m_time <= 0.0) {
-		event.m_count = static_cast<UInt32>((m_timeout - m_time) / m_timeout);
+	if (m_time <= time) {
+		event.m_count = static_cast<UInt32>(
+							(m_timeout + time - m_time) / m_timeout);
+	}
+}
+
+
+//
+// CEventQueue::CTimerWheel
+//
+
+CEventQueue::CTimerWheel::CTimerWheel() :
+	m_slots(kNumTimerSlots, kNoIndex),
+	m_tick(0),
+	m_size(0),
+	m_first(kNoIndex),
+	m_firstValid(true)
+{
+	// do nothing
+}
+
+UInt32
+CEventQueue::CTimerWheel::insert(const CTimer& timer)
+{
+	// choose id and save timer
+	UInt32 id;
+	if (!m_freeIDs.empty()) {
+		id = m_freeIDs.back();
+		m_freeIDs.pop_back();
+		m_nodes[id] = CNode(timer);
+	}
+	else {
+		id = static_cast<UInt32>(m_nodes.size());
+		m_nodes.push_back(CNode(timer));
+	}
+	link(id);
+	return id;
+}
+
+void
+CEventQueue::CTimerWheel::remove(UInt32 id)
+{
+	assert(id < m_nodes.size());
+
+	if (m_nodes[id].m_scheduled) {
+		unlink(id);
+	}
+	m_freeIDs.push_back(id);
+}
+
+bool
+CEventQueue::CTimerWheel::expire(double time, CTimer& timer)
+{
+	UInt32 id = getFirst();
+	if (id == kNoIndex || m_nodes[id].m_timer.getTime() > time) {
+		// turn the wheel to the current tick but not past the earliest
+		// timer.  no timer is due in the ticks we pass.
+		UInt64 tick = getTick(time);
+		if (id != kNoIndex && m_nodes[id].m_tick < tick) {
+			tick = m_nodes[id].m_tick;
+		}
+		if (m_tick < tick) {
+			m_tick = tick;
+		}
+		return false;
+	}
+
+	// turn the wheel to the earliest timer and hand it out as it was
+	// before rescheduling it
+	CNode& node = m_nodes[id];
+	m_tick      = node.m_tick;
+	timer       = node.m_timer;
+	unlink(id);
+	if (!node.m_timer.isOneShot()) {
+		node.m_timer.reset(time);
+		link(id);
+	}
+	return true;
+}
+
+double
+CEventQueue::CTimerWheel::getNextTime() const
+{
+	UInt32 id = getFirst();
+	if (id == kNoIndex) {
+		return -1.0;
+	}
+	return m_nodes[id].m_timer.getTime();
+}
+
+UInt64
+CEventQueue::CTimerWheel::getTick(double time) const
+{
+	return static_cast<UInt64>(time * kTimerTickRate);
+}
+
+UInt32
+CEventQueue::CTimerWheel::getFirst() const
+{
+	if (m_firstValid) {
+		return m_first;
+	}
+
+	// the first tick with a timer has the earliest timer
+	m_first      = kNoIndex;
+	m_firstValid = true;
+	if (m_size == 0) {
+		return m_first;
+	}
+	for (UInt64 tick = m_tick; tick != m_tick + kNumTimerSlots; ++tick) {
+		m_first = findFirst(tick);
+		if (m_first != kNoIndex) {
+			return m_first;
+		}
+	}
+
+	// every timer is more than a turn of the wheel away.  this is rare
+	// so just check them all.
+	for (UInt32 id = 0; id < m_nodes.size(); ++id) {
+		const CNode& node = m_nodes[id];
+		if (node.m_scheduled && (m_first == kNoIndex ||
+				node.m_timer.getTime() < m_nodes[m_first].m_timer.getTime())) {
+			m_first = id;
+		}
+	}
+	return m_first;
+}
+
+UInt32
+CEventQueue::CTimerWheel::findFirst(UInt64 tick) const
+{
+	// find the earliest timer in tick, skipping timers that hash to
+	// the same slot on later turns of the wheel
+	UInt32 first = kNoIndex;
+	for (UInt32 id = m_slots[tick & (kNumTimerSlots - 1)];
+							id != kNoIndex; id = m_nodes[id].m_next) {
+		const CNode& node = m_nodes[id];
+		if (node.m_tick == tick && (first == kNoIndex ||
+				node.m_timer.getTime() < m_nodes[first].m_timer.getTime())) {
+			first = id;
+		}
+	}
+	return first;
+}
+
+void
+CEventQueue::CTimerWheel::link(UInt32 id)
+{
+	CNode& node = m_nodes[id];
+	assert(!node.m_scheduled);
+
+	// a timer can't expire before the wheel's current tick.  if it's
+	// already due then it goes in that tick.
+	node.m_tick = getTick(node.m_timer.getTime());
+	if (node.m_tick < m_tick) {
+		node.m_tick = m_tick;
+	}
+
+	// push onto the front of the slot's list
+	UInt32& head     = m_slots[node.m_tick & (kNumTimerSlots - 1)];
+	node.m_prev      = kNoIndex;
+	node.m_next      = head;
+	if (head != kNoIndex) {
+		m_nodes[head].m_prev = id;
+	}
+	head             = id;
+	node.m_scheduled = true;
+	++m_size;
+
+	// keep track of the earliest timer
+	if (m_firstValid && (m_first == kNoIndex ||
+			node.m_timer.getTime() < m_nodes[m_first].m_timer.getTime())) {
+		m_first = id;
+	}
+}
+
+void
+CEventQueue::CTimerWheel::unlink(UInt32 id)
+{
+	CNode& node = m_nodes[id];
+	assert(node.m_scheduled);
+
+	if (node.m_prev != kNoIndex) {
+		m_nodes[node.m_prev].m_next = node.m_next;
+	}
+	else {
+		m_slots[node.m_tick & (kNumTimerSlots - 1)] = node.m_next;
+	}
+	if (node.m_next != kNoIndex) {
+		m_nodes[node.m_next].m_prev = node.m_prev;
+	}
+	node.m_scheduled = false;
+	--m_size;
+
+	// find the earliest timer again when it's next needed
+	if (id == m_first) {
+		m_firstValid = false;
+	}
+}
+
+
+//
+// CEventQueue::CTimerWheel::CNode
+//
+
+CEventQueue::CTimerWheel::CNode::CNode(const CTimer& timer) :
+	m_timer(timer),
+	m_tick(0),
+	m_prev(kNoIndex),
+	m_next(kNoIndex),
+	m_scheduled(false)
+{
+	// do nothing
+}
+
+
+//
+// CEventQueue::CHandlerTable
+//
+
+CEventQueue::CHandlerTable::CHandlerTable() :
+	m_entries(kMinHandlerTableSize),
+	m_mask(kMinHandlerTableSize - 1),
+	m_size(0)
+{
+	// do nothing
+}
+
+IEventJob*
+CEventQueue::CHandlerTable::insert(CEvent::Type type,
+				void* target, IEventJob* handler)
+{
+	if (handler == NULL) {
+		return remove(type, target);
+	}
+
+	// replace existing handler
+	UInt32 index = findIndex(type, target);
+	if (index != kNoIndex) {
+		IEventJob* oldHandler      = m_entries[index].m_handler;
+		m_entries[index].m_handler = handler;
+		return oldHandler;
+	}
+
+	// keep the table at most half full so probe sequences stay short
+	if (2 * (m_size + 1) > m_entries.size()) {
+		grow();
+	}
+
+	// add to the first empty entry from the home entry
+	for (index = getHome(type, target); m_entries[index].m_handler != NULL;
+							index = (index + 1) & m_mask) {
+		// do nothing
+	}
+	m_entries[index].m_target  = target;
+	m_entries[index].m_type    = type;
+	m_entries[index].m_handler = handler;
+	++m_size;
+	return NULL;
+}
+
+IEventJob*
+CEventQueue::CHandlerTable::remove(CEvent::Type type, void* target)
+{
+	UInt32 index = findIndex(type, target);
+	if (index == kNoIndex) {
+		return NULL;
+	}
+	IEventJob* handler = m_entries[index].m_handler;
+	erase(index);
+	return handler;
+}
+
+void
+CEventQueue::CHandlerTable::removeAll(void* target,
+				std::vector<IEventJob*>& handlers)
+{
+	// erasing moves entries around so collect the types first
+	std::vector<CEvent::Type> types;
+	for (CEntries::const_iterator index = m_entries.begin();
+								index != m_entries.end(); ++index) {
+		if (index->m_handler != NULL && index->m_target == target) {
+			types.push_back(index->m_type);
+		}
+	}
+	for (std::vector<CEvent::Type>::const_iterator index = types.begin();
+								index != types.end(); ++index) {
+		handlers.push_back(remove(*index, target));
+	}
+}
+
+IEventJob*
+CEventQueue::CHandlerTable::find(CEvent::Type type, void* target) const
+{
+	UInt32 index = findIndex(type, target);
+	if (index == kNoIndex) {
+		return NULL;
+	}
+	return m_entries[index].m_handler;
+}
+
+UInt32
+CEventQueue::CHandlerTable::getHome(CEvent::Type type, void* target) const
+{
+	// mix the pointer and type so nearby targets and consecutive types
+	// spread across the table
+	size_t address = reinterpret_cast<size_t>(target);
+	UInt32 hash    = static_cast<UInt32>(address >> 3) ^
+					 static_cast<UInt32>((address >> 16) >> 16) ^
+					 (static_cast<UInt32>(type) * 0x9e3779b1u);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash & m_mask;
+}
+
+UInt32
+CEventQueue::CHandlerTable::findIndex(CEvent::Type type, void* target) const
+{
+	for (UInt32 index = getHome(type, target);
+							m_entries[index].m_handler != NULL;
+							index = (index + 1) & m_mask) {
+		const CEntry& entry = m_entries[index];
+		if (entry.m_target == target && entry.m_type == type) {
+			return index;
+		}
+	}
+	return kNoIndex;
+}
+
+void
+CEventQueue::CHandlerTable::erase(UInt32 index)
+{
+	// shift later entries in the probe sequence back into the hole so
+	// lookups never need to skip over deleted entries.  an entry can
+	// fill the hole unless its home lies between the hole and itself.
+	--m_size;
+	UInt32 next = index;
+	for (;;) {
+		m_entries[index].m_handler = NULL;
+		for (;;) {
+			next = (next + 1) & m_mask;
+			const CEntry& entry = m_entries[next];
+			if (entry.m_handler == NULL) {
+				return;
+			}
+			UInt32 home = getHome(entry.m_type, entry.m_target);
+			if (((next - home) & m_mask) >= ((next - index) & m_mask)) {
+				break;
+			}
+		}
+		m_entries[index] = m_entries[next];
+		index            = next;
+	}
+}
+
+void
+CEventQueue::CHandlerTable::grow()
+{
+	CEntries entries(2 * m_entries.size());
+	m_entries.swap(entries);
+	m_mask = static_cast<UInt32>(m_entries.size()) - 1;
+	m_size = 0;
+	for (CEntries::const_iterator index = entries.begin();
+								index != entries.end(); ++index) {
+		if (index->m_handler != NULL) {
+			insert(index->m_type, index->m_target, index->m_handler);
+		}
+	}
+}
+
+
+//
+// CEventQueue::CEventTable
+//
+
+CEventQueue::CEventTable::CEventTable() :
+	m_slots(new CSlot[kNumEventSlots]),
+	m_numSlots(kNumEventSlots),
+	m_writePos(0)
+{
+	for (UInt32 i = 0; i < m_numSlots; ++i) {
+		m_slots[i].m_sequence = (SInt32)i;
+	}
+	m_overflowMutex = ARCH->newMutex();
+}
+
+CEventQueue::CEventTable::~CEventTable()
+{
+	ARCH->closeMutex(m_overflowMutex);
+	delete[] m_slots;
+}
+
+UInt32
+CEventQueue::CEventTable::insert(const CEvent& event)
+{
+	// take the next slot in the ring unless it's still in use.  slots
+	// are removed in the order the buffer returns them, which needn't
+	// be the order they were taken, so the next slot can be in use
+	// even when others are free.
+	UInt32 mask = m_numSlots - 1;
+	for (;;) {
+		UInt32 pos      = (UInt32)CArchAtomic::load(&m_writePos);
+		CSlot* slot     = &m_slots[pos & mask];
+		UInt32 sequence = (UInt32)CArchAtomic::load(&slot->m_sequence);
+		SInt32 diff     = (SInt32)(sequence - pos);
+		if (diff == 0) {
+			// slot is free.  take it unless another thread beat us.
+			if (CArchAtomic::compareAndSwap(&m_writePos,
+							(SInt32)pos, (SInt32)(pos + 1))) {
+				slot->m_event = event;
+				CArchAtomic::store(&slot->m_sequence, (SInt32)(pos + 1));
+				return (pos & mask);
+			}
+		}
+		else if (diff < 0) {
+			// slot is in use
+			break;
+		}
+	}
+
+	// use the overflow list
+	CArchMutexLock lock(m_overflowMutex);
+	UInt32 index;
+	if (!m_overflowFreeIDs.empty()) {
+		// reuse an id
+		index = m_overflowFreeIDs.back();
+		m_overflowFreeIDs.pop_back();
+		m_overflow[index] = event;
+	}
+	else {
+		// make a new id
+		index = static_cast<UInt32>(m_overflow.size());
+		m_overflow.push_back(event);
+	}
+	return m_numSlots + index;
+}
+
+CEvent
+CEventQueue::CEventTable::remove(UInt32 id)
+{
+	if (id < m_numSlots) {
+		CSlot* slot     = &m_slots[id];
+		UInt32 sequence = (UInt32)CArchAtomic::load(&slot->m_sequence);
+		if (!isFull(*slot, id)) {
+			return CEvent();
+		}
+		CEvent event = slot->m_event;
+
+		// free the slot for the next turn of the ring
+		CArchAtomic::store(&slot->m_sequence,
+							(SInt32)(sequence - 1 + m_numSlots));
+		return event;
+	}
+
+	// look up id
+	CArchMutexLock lock(m_overflowMutex);
+	UInt32 index = id - m_numSlots;
+	if (index >= m_overflow.size() ||
+		m_overflow[index].getType() == CEvent::kUnknown) {
+		return CEvent();
+	}
+
+	// get data
+	CEvent event = m_overflow[index];
+	m_overflow[index] = CEvent();
+
+	// save old id for reuse
+	m_overflowFreeIDs.push_back(index);
+
+	return event;
+}
+
+UInt32
+CEventQueue::CEventTable::clear()
+{
+	UInt32 n = 0;
+	for (UInt32 id = 0; id < m_numSlots; ++id) {
+		if (isFull(m_slots[id], id)) {
+			CEvent::deleteData(remove(id));
+			++n;
+		}
+	}
+
+	CArchMutexLock lock(m_overflowMutex);
+	for (CEvents::iterator i = m_overflow.begin(); i != m_overflow.end(); ++i) {
+		if (i->getType() != CEvent::kUnknown) {
+			CEvent::deleteData(*i);
+			++n;
+		}
 	}
+	m_overflow.clear();
+	m_overflowFreeIDs.clear();
+	return n;
 }
 
 bool
-CEventQueue::CTimer::operator<(const CTimer& t) const
+CEventQueue::CEventTable::isFull(const CSlot& slot, UInt32 id) const
 {
-	return m_time < t.m_time;
+	// a full slot's sequence is one more than a position that maps to
+	// it.  a free slot's is a position that maps to it.
+	UInt32 sequence = (UInt32)CArchAtomic::load(&slot.m_sequence);
+	return (((sequence - 1) & (m_numSlots - 1)) == id);
 }
@@ -21,11 +21,10 @@
 
 #include "IEventQueue.h"
 #include "CEvent.h"
-#include "CPriorityQueue.h"
 #include "CStopwatch.h"
 #include "IArchMultithread.h"
 #include "stdmap.h"
-#include "stdset.h"
+#include "stdvector.h"
 
 //! Event queue
 /*!
@@ -63,47 +62,196 @@ public:
 						getRegisteredType(const CString& name) const;
 
 private:
-	UInt32				saveEvent(const CEvent& event);
-	CEvent				removeEvent(UInt32 eventID);
+	void				addEventToBuffer(const CEvent& event);
 	bool				hasTimerExpired(CEvent& event);
 	double				getNextTimerTimeout() const;
 
 private:
 	class CTimer {
 	public:
-		CTimer(CEventQueueTimer*, double timeout, double initialTime,
+		CTimer(CEventQueueTimer*, double timeout, double time,
 							void* target, bool oneShot);
 		~CTimer();
 
-		void			reset();
-
-		CTimer&			operator-=(double);
-
-						operator double() const;
+		// schedule the next expiration one timeout after time
+		void			reset(double time);
 
 		bool			isOneShot() const;
 		CEventQueueTimer*
 						getTimer() const;
 		void*			getTarget() const;
-		void			fillEvent(CTimerEvent&) const;
-
-		bool			operator<(const CTimer&) const;
+		double			getTime() const;
+		void			fillEvent(CTimerEvent&, double time) const;
 
 	private:
 		CEventQueueTimer*	m_timer;
 		double				m_timeout;
 		void*				m_target;
 		bool				m_oneShot;
-		double				m_time;
+		double				m_time;		// time the timer expires
 	};
-	typedef std::set<CEventQueueTimer*> CTimers;
-	typedef CPriorityQueue<CTimer> CTimerQueue;
-	typedef std::map<UInt32, CEvent> CEventTable;
-	typedef std::vector<UInt32> CEventIDList;
+
+	// a hashed timer wheel.  each slot holds a doubly linked list of
+	// the timers expiring in the ticks that hash to it so adding,
+	// removing and rescheduling a timer take constant time no matter
+	// how many timers there are.  timers more than a turn of the wheel
+	// away share a slot with nearer ones and are skipped until the
+	// wheel comes around to their tick.
+	class CTimerWheel {
+	public:
+		CTimerWheel();
+
+		// add a timer, returning its id
+		UInt32			insert(const CTimer&);
+
+		// remove a timer
+		void			remove(UInt32 id);
+
+		// if the earliest timer expires at or before time then copy it
+		// to timer, reschedule it (or unschedule it if it's a one-shot)
+		// and return true.
+		bool			expire(double time, CTimer& timer);
+
+		// get the time the earliest timer expires or -1 if no timer is
+		// scheduled.  this takes constant time unless the earliest timer
+		// was removed or expired since the last call.
+		double			getNextTime() const;
+
+	private:
+		class CNode {
+		public:
+			CNode(const CTimer&);
+
+		public:
+			CTimer		m_timer;
+			UInt64		m_tick;
+			UInt32		m_prev;
+			UInt32		m_next;
+			bool		m_scheduled;
+		};
+		typedef std::vector<CNode> CNodes;
+		typedef std::vector<UInt32> CIDList;
+
+		UInt64			getTick(double time) const;
+		UInt32			getFirst() const;
+		UInt32			findFirst(UInt64 tick) const;
+		void			link(UInt32 id);
+		void			unlink(UInt32 id);
+
+	private:
+		CNodes			m_nodes;
+		CIDList			m_freeIDs;
+		CIDList			m_slots;
+
+		// no scheduled timer expires before this tick
+		UInt64			m_tick;
+
+		// number of scheduled timers
+		UInt32			m_size;
+
+		// the earliest scheduled timer, kNoIndex if there are none.  only
+		// valid if m_firstValid;  it's found again when next needed after
+		// it's unlinked.
+		mutable UInt32	m_first;
+		mutable bool	m_firstValid;
+	};
+
+	// an open addressing hash table of handlers keyed by target and
+	// event type.  lookups don't allocate and typically touch a single
+	// cache line.
+	class CHandlerTable {
+	public:
+		CHandlerTable();
+
+		// set the handler for type and target, returning the handler
+		// it replaces or NULL.  a NULL handler removes the entry.
+		IEventJob*		insert(CEvent::Type type, void* target,
+							IEventJob* handler);
+
+		// remove the handler for type and target, returning it or NULL
+		IEventJob*		remove(CEvent::Type type, void* target);
+
+		// remove every handler for target, appending them to handlers
+		void			removeAll(void* target,
+							std::vector<IEventJob*>& handlers);
+
+		// get the handler for type and target or NULL
+		IEventJob*		find(CEvent::Type type, void* target) const;
+
+	private:
+		class CEntry {
+		public:
+			void*			m_target;
+			CEvent::Type	m_type;
+			IEventJob*		m_handler;	// NULL iff entry is empty
+		};
+		typedef std::vector<CEntry> CEntries;
+
+		UInt32			getHome(CEvent::Type type, void* target) const;
+		UInt32			findIndex(CEvent::Type type, void* target) const;
+		void			erase(UInt32 index);
+		void			grow();
+
+	private:
+		CEntries		m_entries;
+		UInt32			m_mask;
+		UInt32			m_size;
+	};
+
+	// a table of the events in the buffer, indexed by the ids passed
+	// through the buffer.  any thread can insert an event and any thread
+	// can remove an event it has the id of without taking a lock.  ids
+	// come from a ring of slots in the order they were taken.  when the
+	// next slot in the ring is still in use events go in a locked
+	// overflow list instead until the slot is removed.
+	class CEventTable {
+	public:
+		CEventTable();
+		~CEventTable();
+
+		// save an event, returning its id
+		UInt32			insert(const CEvent&);
+
+		// remove the event with id and return it or return a kUnknown
+		// event if there's no such event
+		CEvent			remove(UInt32 id);
+
+		// remove every event, deleting its data, and return how many
+		// events there were.  events must not be inserted or removed
+		// at the same time.
+		UInt32			clear();
+
+	private:
+		// a slot holds an event when its sequence is one more than its
+		// position in the ring and is free to take when it equals it
+		class CSlot {
+		public:
+			volatile SInt32	m_sequence;
+			CEvent			m_event;
+		};
+		typedef std::vector<CEvent> CEvents;
+		typedef std::vector<UInt32> CIDList;
+
+		bool			isFull(const CSlot&, UInt32 id) const;
+
+	private:
+		CSlot*			m_slots;
+		UInt32			m_numSlots;
+
+		// next position to take, shared by the inserting threads
+		volatile SInt32	m_writePos;
+
+		// overflowed events.  their ids start at m_numSlots.  unused
+		// entries hold a kUnknown event and their ids are in
+		// m_overflowFreeIDs.
+		CArchMutex		m_overflowMutex;
+		CEvents			m_overflow;
+		CIDList			m_overflowFreeIDs;
+	};
+
+	typedef std::map<CEventQueueTimer*, UInt32> CTimers;
 	typedef std::map<CEvent::Type, const char*> CTypeMap;
 	typedef std::map<CString, CEvent::Type> CNameMap;
-	typedef std::map<CEvent::Type, IEventJob*> CTypeHandlerTable;
-	typedef std::map<void*, CTypeHandlerTable> CHandlerTable;
 
 	CArchMutex			m_mutex;
 
@@ -112,17 +260,25 @@ private:
 	CTypeMap			m_typeMap;
 	CNameMap			m_nameMap;
 
-	// buffer of events
+	// buffer of events.  addEvent() doesn't lock m_mutex to use the
+	// buffer so adoptBuffer() sets m_adopting and waits for the
+	// addEvent() calls counted in m_adding to finish before replacing
+	// it.  addEvent() calls made meanwhile wait on m_mutex.
 	IEventQueueBuffer*	m_buffer;
+	volatile SInt32		m_adding;
+	volatile SInt32		m_adopting;
 
-	// saved events
+	// saved events indexed by id
 	CEventTable			m_events;
-	CEventIDList		m_oldEventIDs;
 
-	// timers
+	// timers.  m_timers maps each timer to its id in m_timerWheel.
+	// timer times are measured by m_time, which is never reset.  the
+	// timers have their own mutex since getEvent() checks them on
+	// every wakeup.
+	CArchMutex			m_timerMutex;
 	CStopwatch			m_time;
 	CTimers				m_timers;
-	CTimerQueue			m_timerQueue;
+	CTimerWheel			m_timerWheel;
 	CTimerEvent			m_timerEvent;
 
 	// event handlers
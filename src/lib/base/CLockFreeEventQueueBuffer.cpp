@@ -0,0 +1,202 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CLockFreeEventQueueBuffer.h"
+#include "CSimpleEventQueueBuffer.h"
+#include "CStopwatch.h"
+#include "CArch.h"
+#include "CArchAtomic.h"
+
+// must be a power of two
+static const UInt32		kNumSlots = 4096;
+
+//
+// CLockFreeEventQueueBuffer
+//
+
+CLockFreeEventQueueBuffer::CLockFreeEventQueueBuffer() :
+	m_slots(new CSlot[kNumSlots]),
+	m_numSlots(kNumSlots),
+	m_writePos(0),
+	m_readPos(0),
+	m_overflowing(0),
+	m_waiting(0)
+{
+	for (UInt32 i = 0; i < m_numSlots; ++i) {
+		m_slots[i].m_sequence = (SInt32)i;
+		m_slots[i].m_dataID   = 0;
+	}
+	m_overflowMutex = ARCH->newMutex();
+	m_waitMutex     = ARCH->newMutex();
+	m_waitCond      = ARCH->newCondVar();
+}
+
+CLockFreeEventQueueBuffer::~CLockFreeEventQueueBuffer()
+{
+	ARCH->closeCondVar(m_waitCond);
+	ARCH->closeMutex(m_waitMutex);
+	ARCH->closeMutex(m_overflowMutex);
+	delete[] m_slots;
+}
+
+void
+CLockFreeEventQueueBuffer::waitForEvent(double timeout)
+{
+	CStopwatch timer(true);
+	CArchMutexLock lock(m_waitMutex);
+	for (;;) {
+		// writers only wake us if they see m_waiting set so set it
+		// before checking for events, otherwise we could miss one
+		// added in between.
+		CArchAtomic::store(&m_waiting, 1);
+		if (!isEmpty()) {
+			break;
+		}
+
+		double timeLeft = timeout;
+		if (timeLeft >= 0.0) {
+			timeLeft -= timer.getTime();
+			if (timeLeft < 0.0) {
+				break;
+			}
+		}
+		ARCH->waitCondVar(m_waitCond, m_waitMutex, timeLeft);
+	}
+	CArchAtomic::store(&m_waiting, 0);
+}
+
+IEventQueueBuffer::Type
+CLockFreeEventQueueBuffer::getEvent(CEvent&, UInt32& dataID)
+{
+	// take overflowed events before anything newer in the ring
+	if (m_pending.empty()) {
+		if (tryPop(dataID)) {
+			return kUser;
+		}
+
+		// the overflowed events are newer than everything in the ring
+		// so only take them once no slot is claimed.  a claimed slot
+		// that isn't ready yet will be soon.
+		if (CArchAtomic::load(&m_overflowing) == 0 ||
+			(UInt32)CArchAtomic::load(&m_writePos) != m_readPos) {
+			return kNone;
+		}
+		CArchMutexLock lock(m_overflowMutex);
+		m_pending.swap(m_overflow);
+		CArchAtomic::store(&m_overflowing, 0);
+	}
+
+	dataID = m_pending.front();
+	m_pending.pop_front();
+	return kUser;
+}
+
+bool
+CLockFreeEventQueueBuffer::addEvent(UInt32 dataID)
+{
+	if (CArchAtomic::load(&m_overflowing) != 0 || !tryPush(dataID)) {
+		// the ring is full or other events are waiting in the overflow
+		// list.  join the overflow list unless the reader emptied it
+		// and made room in the ring in the meantime.
+		CArchMutexLock lock(m_overflowMutex);
+		if (CArchAtomic::load(&m_overflowing) != 0 || !tryPush(dataID)) {
+			m_overflow.push_back(dataID);
+			CArchAtomic::store(&m_overflowing, 1);
+		}
+	}
+	wakeReader();
+	return true;
+}
+
+bool
+CLockFreeEventQueueBuffer::isEmpty() const
+{
+	return (m_pending.empty() && !isRingReady() &&
+			CArchAtomic::load(&m_overflowing) == 0);
+}
+
+CEventQueueTimer*
+CLockFreeEventQueueBuffer::newTimer(double, bool) const
+{
+	return new CEventQueueTimer;
+}
+
+void
+CLockFreeEventQueueBuffer::deleteTimer(CEventQueueTimer* timer) const
+{
+	delete timer;
+}
+
+bool
+CLockFreeEventQueueBuffer::tryPush(UInt32 dataID)
+{
+	UInt32 mask = m_numSlots - 1;
+	for (;;) {
+		UInt32 pos      = (UInt32)CArchAtomic::load(&m_writePos);
+		CSlot* slot     = &m_slots[pos & mask];
+		UInt32 sequence = (UInt32)CArchAtomic::load(&slot->m_sequence);
+		SInt32 diff     = (SInt32)(sequence - pos);
+		if (diff == 0) {
+			// slot is free.  claim it unless another writer beat us.
+			if (CArchAtomic::compareAndSwap(&m_writePos,
+							(SInt32)pos, (SInt32)(pos + 1))) {
+				slot->m_dataID = dataID;
+
+				// hand the slot to the reader
+				CArchAtomic::store(&slot->m_sequence, (SInt32)(pos + 1));
+				return true;
+			}
+		}
+		else if (diff < 0) {
+			// ring is full
+			return false;
+		}
+	}
+}
+
+bool
+CLockFreeEventQueueBuffer::tryPop(UInt32& dataID)
+{
+	if (!isRingReady()) {
+		return false;
+	}
+	CSlot* slot = &m_slots[m_readPos & (m_numSlots - 1)];
+	dataID      = slot->m_dataID;
+
+	// hand the slot back to the writers
+	CArchAtomic::store(&slot->m_sequence, (SInt32)(m_readPos + m_numSlots));
+	++m_readPos;
+	return true;
+}
+
+bool
+CLockFreeEventQueueBuffer::isRingReady() const
+{
+	const CSlot* slot = &m_slots[m_readPos & (m_numSlots - 1)];
+	UInt32 sequence   = (UInt32)CArchAtomic::load(&slot->m_sequence);
+	return (sequence == m_readPos + 1);
+}
+
+void
+CLockFreeEventQueueBuffer::wakeReader()
+{
+	// only the first writer to see the reader waiting wakes it
+	if (CArchAtomic::compareAndSwap(&m_waiting, 1, 0)) {
+		CArchMutexLock lock(m_waitMutex);
+		ARCH->broadcastCondVar(m_waitCond);
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLOCKFREEEVENTQUEUEBUFFER_H
+#define CLOCKFREEEVENTQUEUEBUFFER_H
+
+#include "IEventQueueBuffer.h"
+#include "IArchMultithread.h"
+#include "stddeque.h"
+
+//! Lock free in-memory event queue buffer
+/*!
+An event queue buffer that any number of threads can add events to
+while a single thread gets them.  Events are passed through a fixed
+size ring without taking a lock.  If the ring fills up then events go
+on a locked overflow list until the reader catches up.  The reader
+only sleeps when the buffer is empty and only the first event added
+after it goes to sleep wakes it, so a burst of events costs a single
+wakeup.
+*/
+class CLockFreeEventQueueBuffer : public IEventQueueBuffer {
+public:
+	CLockFreeEventQueueBuffer();
+	~CLockFreeEventQueueBuffer();
+
+	// IEventQueueBuffer overrides
+	virtual void		waitForEvent(double timeout);
+	virtual Type		getEvent(CEvent& event, UInt32& dataID);
+	virtual bool		addEvent(UInt32 dataID);
+	virtual bool		isEmpty() const;
+	virtual CEventQueueTimer*
+						newTimer(double duration, bool oneShot) const;
+	virtual void		deleteTimer(CEventQueueTimer*) const;
+
+private:
+	// a slot holds an event when its sequence is one more than its
+	// position in the ring and is free to write when it equals it
+	class CSlot {
+	public:
+		volatile SInt32	m_sequence;
+		UInt32			m_dataID;
+	};
+	typedef std::deque<UInt32> CEventDeque;
+
+	bool				tryPush(UInt32 dataID);
+	bool				tryPop(UInt32& dataID);
+	bool				isRingReady() const;
+	void				wakeReader();
+
+private:
+	CSlot*				m_slots;
+	UInt32				m_numSlots;
+
+	// next position to write, shared by the writers
+	volatile SInt32		m_writePos;
+
+	// next position to read, only used by the reader
+	UInt32				m_readPos;
+
+	// events that didn't fit in the ring.  while m_overflowing is set
+	// writers add to m_overflow so each writer's events stay in order.
+	// the reader moves them to m_pending once the ring is drained.
+	CArchMutex			m_overflowMutex;
+	volatile SInt32		m_overflowing;
+	CEventDeque			m_overflow;
+	CEventDeque			m_pending;
+
+	// the reader sets m_waiting before sleeping on m_waitCond
+	CArchMutex			m_waitMutex;
+	CArchCond			m_waitCond;
+	volatile SInt32		m_waiting;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "CStringUtil.h"
 #include "LogOutputters.h"
 #include "CArch.h"
+#include "CArchAtomic.h"
 #include "Version.h"
 #include "XArch.h"
 #include <cstdio>
@@ -64,19 +65,54 @@ static const int		g_priorityPad = g_maxPriorityLength +
 										g_prioritySuffixLength;
 
 
+// length of a message in the asynchronous log, including the NUL
+static const int		kRecordLength = 1024;
+
+//
+// CLog::CRecord
+//
+
+class CLog::CRecord {
+public:
+	volatile SInt32		m_sequence;
+	ELevel				m_priority;
+	const char*			m_file;
+	int					m_line;
+	time_t				m_time;
+	char*				m_longMessage;
+	char				m_message[kRecordLength];
+};
+
 //
 // CLog
 //
 
 CLog*				 CLog::s_log = NULL;
 
-CLog::CLog()
+CLog::CLog() :
+	m_async(0),
+	m_overflow(kDropOnOverflow),
+	m_records(NULL),
+	m_numRecords(0),
+	m_writePos(0),
+	m_readPos(0),
+	m_dropped(0),
+	m_reportedDropped(0),
+	m_writerWaiting(0),
+	m_printersWaiting(0),
+	m_stopWriter(0),
+	m_writer(NULL)
 {
 	assert(s_log == NULL);
 
 	// create mutex for multithread safe operation
 	m_mutex = ARCH->newMutex();
 
+	// and a mutex and condition variable for the async writer to sleep on
+	m_asyncMutex = ARCH->newMutex();
+	m_asyncCond  = ARCH->newCondVar();
+	m_roomCond   = ARCH->newCondVar();
+
 	// other initalization
 	m_maxPriority = g_defaultMaxPriority;
 	m_maxNewlineLength = 0;
@@ -87,6 +123,16 @@ CLog::CLog()
 
 CLog::~CLog()
 {
+	// write out anything still queued
+	stopAsync();
+	if (m_records != NULL) {
+		writeRecords();
+		delete[] m_records;
+	}
+	ARCH->closeCondVar(m_roomCond);
+	ARCH->closeCondVar(m_asyncCond);
+	ARCH->closeMutex(m_asyncMutex);
+
 	// clean up
 	for (COutputterList::iterator index	= m_outputters.begin();
 									index != m_outputters.end(); ++index) {
@@ -142,6 +188,43 @@ CLog::print(const char* file, int line, const char* fmt, ...)
 		return;
 	}
 
+	// in asynchronous mode format into the next record and leave the
+	// rest to the writer thread.  an outputter logging from the writer
+	// while stopAsync() waits for it must also use the ring since the
+	// writer holds the outputter lock.
+	if (CArchAtomic::load(&m_async) || isWriterThread()) {
+		CRecord* record = beginRecord();
+		if (record != NULL) {
+			record->m_priority    = priority;
+			record->m_file        = file;
+			record->m_line        = line;
+			record->m_time        = time(NULL);
+			record->m_longMessage = NULL;
+			record->m_message[0]  = '\0';
+
+			va_list args;
+			va_start(args, fmt);
+			int n = ARCH->vsnprintf(record->m_message,
+							kRecordLength, fmt, args);
+			va_end(args);
+
+			// too long for the record so format into a buffer that's
+			// big enough.  some vsnprintf()s don't say how big that is.
+			int len = kRecordLength;
+			while (n < 0 || n >= len) {
+				delete[] record->m_longMessage;
+				len                   = (n < 0) ? 2 * len : n + 1;
+				record->m_longMessage = new char[len];
+				va_start(args, fmt);
+				n = ARCH->vsnprintf(record->m_longMessage, len, fmt, args);
+				va_end(args);
+			}
+
+			endRecord(record);
+		}
+		return;
+	}
+
 	// compute prefix padding length
 	char stack[1024];
 
@@ -174,28 +257,7 @@ CLog::print(const char* file, int line, const char* fmt, ...)
 		}
 	}
 
-	// print the prefix to the buffer.	leave space for priority label.
-	// do not prefix time and file for kPRINT (CLOG_PRINT)
-	if (priority != kPRINT) {
-
-		char message[2048];
-
-#ifndef NDEBUG
-		struct tm *tm;
-		char tmp[220];
-		time_t t;
-		time(&t);
-		tm = localtime(&t);
-		sprintf(tmp, "%04i-%02i-%02iT%02i:%02i:%02i", tm->tm_year + 1900, tm->tm_mon+1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
-		sprintf(message, "%s %s: %s\n\t%s,%d", tmp, g_priority[priority], buffer, file, line);
-#else
-		sprintf(message, "%s: %s", g_priority[priority], buffer);
-#endif
-
-		output(priority, message);
-	} else {
-		output(priority, buffer);
-	}
+	format(priority, file, line, time(NULL), buffer);
 
 	// clean up
 	if (buffer != stack) {
@@ -265,15 +327,114 @@ CLog::setFilter(const char* maxPriority)
 void
 CLog::setFilter(int maxPriority)
 {
-	CArchMutexLock lock(m_mutex);
-	m_maxPriority = maxPriority;
+	CArchAtomic::store(&m_maxPriority, maxPriority);
 }
 
 int
 CLog::getFilter() const
 {
-	CArchMutexLock lock(m_mutex);
-	return m_maxPriority;
+	return CArchAtomic::load(&m_maxPriority);
+}
+
+UInt32
+CLog::getDropped() const
+{
+	return (UInt32)CArchAtomic::load(&m_dropped);
+}
+
+void
+CLog::startAsync(UInt32 records, EOverflow overflow)
+{
+	assert(records > 0);
+
+	if (CArchAtomic::load(&m_async)) {
+		return;
+	}
+
+	// the ring's size must be a power of two.  each record's sequence
+	// number says whose turn it is:  when it's equal to the write
+	// position the record is free and when it's one more it's full.
+	if (m_records == NULL) {
+		m_numRecords = 1;
+		while (m_numRecords < records) {
+			m_numRecords <<= 1;
+		}
+		m_records = new CRecord[m_numRecords];
+		for (UInt32 i = 0; i < m_numRecords; ++i) {
+			m_records[i].m_sequence = (SInt32)i;
+		}
+	}
+
+	m_overflow = overflow;
+	CArchAtomic::store(&m_stopWriter, 0);
+	m_writer   = ARCH->newThread(&CLog::writerThreadFunc, this);
+	CArchAtomic::store(&m_async, 1);
+}
+
+void
+CLog::stopAsync()
+{
+	if (!CArchAtomic::load(&m_async)) {
+		return;
+	}
+	CArchAtomic::store(&m_async, 0);
+
+	// the writer empties the ring before it stops.  a print() waiting
+	// for room must stop waiting too since nothing will make room once
+	// the writer's gone.
+	ARCH->lockMutex(m_asyncMutex);
+	CArchAtomic::store(&m_stopWriter, 1);
+	ARCH->broadcastCondVar(m_asyncCond);
+	ARCH->broadcastCondVar(m_roomCond);
+	ARCH->unlockMutex(m_asyncMutex);
+
+	ARCH->wait(m_writer, -1.0);
+	CArchThread writer = m_writer;
+	m_writer = NULL;
+	ARCH->closeThread(writer);
+
+	// write anything print() queued after the writer's last look
+	writeRecords();
+}
+
+void
+CLog::format(ELevel priority, const char* file, int line,
+				time_t t, char* msg)
+{
+	// print the prefix to the buffer.	leave space for priority label.
+	// do not prefix time and file for kPRINT (CLOG_PRINT)
+	if (priority != kPRINT) {
+
+		// room for the message plus the prefix and location
+		char stack[2048];
+		size_t len    = strlen(msg) + 100;
+		if (file != NULL) {
+			len += strlen(file);
+		}
+		char* message = (len <= sizeof(stack)) ? stack : new char[len];
+
+#ifndef NDEBUG
+		struct tm *tm;
+		char tmp[220];
+		tm = localtime(&t);
+		sprintf(tmp, "%04i-%02i-%02iT%02i:%02i:%02i", tm->tm_year + 1900, tm->tm_mon+1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
+		if (file != NULL) {
+			sprintf(message, "%s %s: %s\n\t%s,%d", tmp, g_priority[priority], msg, file, line);
+		}
+		else {
+			sprintf(message, "%s %s: %s", tmp, g_priority[priority], msg);
+		}
+#else
+		sprintf(message, "%s: %s", g_priority[priority], msg);
+#endif
+
+		output(priority, message);
+		if (message != stack) {
+			delete[] message;
+		}
+	} else {
+		output(priority, msg);
+	}
 }
 
 void
@@ -301,3 +462,170 @@ CLog::output(ELevel priority, char* msg)
 		}
 	}
 }
+
+CLog::CRecord*
+CLog::beginRecord()
+{
+	UInt32 mask = m_numRecords - 1;
+	for (;;) {
+		UInt32 pos       = (UInt32)CArchAtomic::load(&m_writePos);
+		CRecord* record  = &m_records[pos & mask];
+		UInt32 sequence  = (UInt32)CArchAtomic::load(&record->m_sequence);
+		SInt32 diff      = (SInt32)(sequence - pos);
+		if (diff == 0) {
+			// record is free.  claim it unless another thread beat us.
+			if (CArchAtomic::compareAndSwap(&m_writePos,
+							(SInt32)pos, (SInt32)(pos + 1))) {
+				return record;
+			}
+		}
+		else if (diff < 0) {
+			// ring is full.  the writer can't wait for itself to make
+			// room and won't make any once it's been told to stop.
+			if (m_overflow == kDropOnOverflow || isWriterThread() ||
+				!waitForRoom()) {
+				CArchAtomic::add(&m_dropped, 1);
+				return NULL;
+			}
+		}
+	}
+}
+
+void
+CLog::endRecord(CRecord* record)
+{
+	// hand the record to the writer
+	CArchAtomic::store(&record->m_sequence, record->m_sequence + 1);
+	wakeWriter();
+}
+
+CLog::CRecord*
+CLog::readRecord() const
+{
+	CRecord* record = &m_records[m_readPos & (m_numRecords - 1)];
+	UInt32 sequence = (UInt32)CArchAtomic::load(&record->m_sequence);
+	return (sequence == m_readPos + 1) ? record : NULL;
+}
+
+bool
+CLog::isFull() const
+{
+	UInt32 pos      = (UInt32)CArchAtomic::load(&m_writePos);
+	CRecord* record = &m_records[pos & (m_numRecords - 1)];
+	UInt32 sequence = (UInt32)CArchAtomic::load(&record->m_sequence);
+	return ((SInt32)(sequence - pos) < 0);
+}
+
+bool
+CLog::isWriterThread() const
+{
+	if (m_writer == NULL) {
+		return false;
+	}
+	CArchThread self = ARCH->newCurrentThread();
+	bool result      = ARCH->isSameThread(self, m_writer);
+	ARCH->closeThread(self);
+	return result;
+}
+
+bool
+CLog::waitForRoom()
+{
+	wakeWriter();
+
+	// the writer only wakes us if it sees m_printersWaiting set so set
+	// it before checking for room, otherwise we could miss the wakeup.
+	// stopAsync() sets m_stopWriter with the mutex held so we can't
+	// miss that either.
+	CArchMutexLock lock(m_asyncMutex);
+	CArchAtomic::add(&m_printersWaiting, 1);
+	if (isFull() && !CArchAtomic::load(&m_stopWriter)) {
+		ARCH->waitCondVar(m_roomCond, m_asyncMutex, -1.0);
+	}
+	CArchAtomic::add(&m_printersWaiting, -1);
+	return !(isFull() && CArchAtomic::load(&m_stopWriter));
+}
+
+void
+CLog::writeRecords()
+{
+	CRecord* record;
+	bool wrote = false;
+	while ((record = readRecord()) != NULL) {
+		if (record->m_longMessage != NULL) {
+			format(record->m_priority, record->m_file, record->m_line,
+							record->m_time, record->m_longMessage);
+			delete[] record->m_longMessage;
+			record->m_longMessage = NULL;
+		}
+		else {
+			format(record->m_priority, record->m_file, record->m_line,
+							record->m_time, record->m_message);
+		}
+
+		// hand the record back to print()
+		CArchAtomic::store(&record->m_sequence,
+							(SInt32)(m_readPos + m_numRecords));
+		++m_readPos;
+		wrote = true;
+	}
+
+	// wake any print() waiting for room
+	if (wrote && CArchAtomic::load(&m_printersWaiting) != 0) {
+		CArchMutexLock lock(m_asyncMutex);
+		ARCH->broadcastCondVar(m_roomCond);
+	}
+}
+
+void
+CLog::wakeWriter()
+{
+	// only the first printer to see the writer waiting wakes it
+	if (CArchAtomic::compareAndSwap(&m_writerWaiting, 1, 0)) {
+		CArchMutexLock lock(m_asyncMutex);
+		ARCH->broadcastCondVar(m_asyncCond);
+	}
+}
+
+void
+CLog::reportDropped()
+{
+	SInt32 dropped = CArchAtomic::load(&m_dropped);
+	if (dropped != m_reportedDropped) {
+		char message[100];
+		sprintf(message, "%d log messages dropped",
+							(int)(dropped - m_reportedDropped));
+		m_reportedDropped = dropped;
+		format(kWARNING, NULL, 0, time(NULL), message);
+	}
+}
+
+void*
+CLog::writerThreadFunc(void* vlog)
+{
+	static_cast<CLog*>(vlog)->writerThread();
+	return NULL;
+}
+
+void
+CLog::writerThread()
+{
+	for (;;) {
+		writeRecords();
+		reportDropped();
+
+		// sleep until print() wakes us.  print() only does that if it
+		// sees m_writerWaiting set so set it before checking for more
+		// records.  the timeout is just in case.
+		CArchMutexLock lock(m_asyncMutex);
+		CArchAtomic::store(&m_writerWaiting, 1);
+		if (readRecord() == NULL) {
+			if (CArchAtomic::load(&m_stopWriter)) {
+				CArchAtomic::store(&m_writerWaiting, 0);
+				return;
+			}
+			ARCH->waitCondVar(m_asyncCond, m_asyncMutex, 1.0);
+		}
+		CArchAtomic::store(&m_writerWaiting, 0);
+	}
+}
@@ -20,10 +20,13 @@
 #define CLOG_H
 
 #include "common.h"
+#include "ELevel.h"
 #include "IArchMultithread.h"
 #include "stdlist.h"
 #include <stdarg.h>
+#include <time.h>
 #include "CArch.h"
+#include "CArchAtomic.h"
 
 #define CLOG (CLog::getInstance())
 
@@ -39,6 +42,12 @@ LOGC() provide convenient access.
 */
 class CLog {
 public:
+	//! What to do with a message when the asynchronous log is full
+	enum EOverflow {
+		kDropOnOverflow,			//!< Discard and count the message
+		kBlockOnOverflow			//!< Wait for room
+	};
+
 	CLog();
 	~CLog();
 
@@ -92,6 +101,34 @@ public:
 	//! Set the minimum priority filter (by ordinal).
 	void				setFilter(int);
 
+	//! Log asynchronously
+	/*!
+	Starts a writer thread that passes messages to the outputters.
+	print() formats each message into a record in a lock free ring of
+	\c records records and returns;  the time and location prefix is
+	added by the writer thread.  Messages longer than a record are
+	formatted into a heap buffer that the record points to.  When the
+	ring is full the message is dropped and counted or print() waits for
+	room, according to \c overflow.  Messages printed by the writer
+	thread itself, e.g. by an outputter, are always dropped when the
+	ring is full since it can't wait for itself.  The writer reports
+	dropped messages as a warning.
+
+	This must be called after any fork(), e.g. after daemonizing, since
+	the writer thread doesn't survive it.  Calling it again while the
+	log is asynchronous has no effect.  The ring is allocated by the
+	first call and kept, so later calls don't change its size.
+	*/
+	void				startAsync(UInt32 records, EOverflow overflow);
+
+	//! Log synchronously
+	/*!
+	Writes out any queued messages, stops the writer thread and goes
+	back to writing messages on the thread that prints them.  A print()
+	still waiting for room when the writer stops drops its message.
+	*/
+	void				stopAsync();
+
 	//@}
 	//! @name accessors
 	//@{
@@ -108,6 +145,13 @@ public:
 	//! Get the minimum priority level.
 	int					getFilter() const;
 
+	//! Test if a level is logged
+	/*!
+	Returns true iff messages with priority \c level pass the filter.
+	This is cheap enough to call before every message.
+	*/
+	static bool			isLogged(int level);
+
 	//! Get the filter name of the current filter level.
 	const char*			getFilterName() const;
 
@@ -120,11 +164,35 @@ public:
 	//! Get the console filter level (messages above this are not sent to console).
 	int					getConsoleMaxLevel() const { return kDEBUG2; }
 
+	//! Get number of dropped messages
+	/*!
+	Returns the number of messages discarded because the asynchronous
+	log was full.
+	*/
+	UInt32				getDropped() const;
+
 	//@}
 
 private:
+	class CRecord;
+
+	void				format(ELevel priority, const char* file, int line,
+							time_t time, char* msg);
 	void				output(ELevel priority, char* msg);
 
+	// asynchronous logging
+	CRecord*			beginRecord();
+	void				endRecord(CRecord*);
+	CRecord*			readRecord() const;
+	bool				isFull() const;
+	bool				isWriterThread() const;
+	bool				waitForRoom();
+	void				writeRecords();
+	void				wakeWriter();
+	void				reportDropped();
+	static void*		writerThreadFunc(void*);
+	void				writerThread();
+
 private:
 	typedef std::list<ILogOutputter*> COutputterList;
 
@@ -134,7 +202,26 @@ private:
 	COutputterList		m_outputters;
 	COutputterList		m_alwaysOutputters;
 	int					m_maxNewlineLength;
-	int					m_maxPriority;
+	volatile SInt32		m_maxPriority;
+
+	// ring of records written by print() and read by the writer.  the
+	// writer sleeps on m_asyncCond when the ring is empty.  with
+	// kBlockOnOverflow print() sleeps on m_roomCond when it's full.
+	volatile SInt32		m_async;
+	EOverflow			m_overflow;
+	CRecord*			m_records;
+	UInt32				m_numRecords;
+	volatile SInt32		m_writePos;
+	UInt32				m_readPos;
+	volatile SInt32		m_dropped;
+	SInt32				m_reportedDropped;
+	CArchMutex			m_asyncMutex;
+	CArchCond			m_asyncCond;
+	CArchCond			m_roomCond;
+	volatile SInt32		m_writerWaiting;
+	volatile SInt32		m_printersWaiting;
+	volatile SInt32		m_stopWriter;
+	CArchThread			m_writer;
 };
 
 /*!
@@ -154,6 +241,10 @@ If \c NOLOGGING is defined during the build then this macro expands to
 nothing.  If \c NDEBUG is defined during the build then it expands to a
 call to CLog::print.  Otherwise it expands to a call to CLog::printt,
 which includes the filename and line number.
+
+The arguments are only evaluated if the message will be logged.  If
+\c LOG_MAX_LEVEL is defined during the build as a level (e.g. kDEBUG2)
+then messages with lower priority are compiled out entirely.
 */
 
 /*!
@@ -176,17 +267,28 @@ to a call to CLog::print that prints the filename and line number,
 otherwise it expands to a call that doesn't.
 */
 
+#if !defined(LOG_MAX_LEVEL)
+#define LOG_MAX_LEVEL	kDEBUG5
+#endif
+
+// the CLOG_* defines start with the level.  these split it from the
+// arguments to CLog::print.
+#define CLOG_LEVEL(_level, ...)	(_level)
+#define CLOG_ARGS(_level, ...)	(__VA_ARGS__)
+#define CLOG_LOGGED(_a1) \
+	(CLOG_LEVEL _a1 <= LOG_MAX_LEVEL && CLog::isLogged(CLOG_LEVEL _a1))
+
 #if defined(NOLOGGING)
 #define LOG(_a1)
 #define LOGC(_a1, _a2)
 #define CLOG_TRACE
 #elif defined(NDEBUG)
-#define LOG(_a1)		CLOG->print _a1
-#define LOGC(_a1, _a2)	if (_a1) CLOG->print _a2
+#define LOG(_a1)		do { if (CLOG_LOGGED(_a1)) CLOG->print CLOG_ARGS _a1; } while (0)
+#define LOGC(_a1, _a2)	do { if (CLOG_LOGGED(_a2) && (_a1)) CLOG->print CLOG_ARGS _a2; } while (0)
 #define CLOG_TRACE		NULL, 0,
 #else
-#define LOG(_a1)		CLOG->print _a1
-#define LOGC(_a1, _a2)	if (_a1) CLOG->print _a2
+#define LOG(_a1)		do { if (CLOG_LOGGED(_a1)) CLOG->print CLOG_ARGS _a1; } while (0)
+#define LOGC(_a1, _a2)	do { if (CLOG_LOGGED(_a2) && (_a1)) CLOG->print CLOG_ARGS _a2; } while (0)
 #define CLOG_TRACE		__FILE__, __LINE__,
 #endif
 
@@ -195,17 +297,24 @@ otherwise it expands to a call that doesn't.
 // end, then we resort to using non-numerical chars. this still works (since 
 // to deduce the number we subtract octal \060, so '/' is -1, and ':' is 10
 
-#define CLOG_PRINT		CLOG_TRACE "%z\057" // char is '/'
-#define CLOG_CRIT		CLOG_TRACE "%z\060" // char is '0'
-#define CLOG_ERR		CLOG_TRACE "%z\061"
-#define CLOG_WARN		CLOG_TRACE "%z\062"
-#define CLOG_NOTE		CLOG_TRACE "%z\063"
-#define CLOG_INFO		CLOG_TRACE "%z\064"
-#define CLOG_DEBUG		CLOG_TRACE "%z\065"
-#define CLOG_DEBUG1		CLOG_TRACE "%z\066"
-#define CLOG_DEBUG2		CLOG_TRACE "%z\067"
-#define CLOG_DEBUG3		CLOG_TRACE "%z\070"
-#define CLOG_DEBUG4		CLOG_TRACE "%z\071" // char is '9'
-#define CLOG_DEBUG5		CLOG_TRACE "%z\072" // char is ':'
+#define CLOG_PRINT		kPRINT,   CLOG_TRACE "%z\057" // char is '/'
+#define CLOG_CRIT		kFATAL,   CLOG_TRACE "%z\060" // char is '0'
+#define CLOG_ERR		kERROR,   CLOG_TRACE "%z\061"
+#define CLOG_WARN		kWARNING, CLOG_TRACE "%z\062"
+#define CLOG_NOTE		kNOTE,    CLOG_TRACE "%z\063"
+#define CLOG_INFO		kINFO,    CLOG_TRACE "%z\064"
+#define CLOG_DEBUG		kDEBUG,   CLOG_TRACE "%z\065"
+#define CLOG_DEBUG1		kDEBUG1,  CLOG_TRACE "%z\066"
+#define CLOG_DEBUG2		kDEBUG2,  CLOG_TRACE "%z\067"
+#define CLOG_DEBUG3		kDEBUG3,  CLOG_TRACE "%z\070"
+#define CLOG_DEBUG4		kDEBUG4,  CLOG_TRACE "%z\071" // char is '9'
+#define CLOG_DEBUG5		kDEBUG5,  CLOG_TRACE "%z\072" // char is ':'
+
+inline
+bool
+CLog::isLogged(int level)
+{
+	return (level <= CArchAtomic::load(&s_log->m_maxPriority));
+}
 
 #endif
@@ -21,6 +21,8 @@
 #include "TMethodJob.h"
 
 #include <fstream>
+#include <stdio.h>
+#include <string.h>
 //
 // CStopLogOutputter
 //
@@ -232,38 +234,208 @@ CBufferedLogOutputter::write(ELevel, const char* message)
 // CFileLogOutputter
 //
 
-CFileLogOutputter::CFileLogOutputter(const char* logFile)
+static const UInt32		kDefaultMaxLogSize = 10 * 1024 * 1024;
+static const UInt32		kDefaultLogBackups = 3;
+static const double		kLogFlushInterval  = 1.0;
+
+CFileLogOutputter::CFileLogOutputter(const char* logFile) :
+	m_flusher(NULL),
+	m_stopFlusher(false),
+	m_size(0),
+	m_maxSize(kDefaultMaxLogSize),
+	m_backups(kDefaultLogBackups),
+	m_dirty(false),
+	m_dirtyTime(0.0)
 {
 	assert(logFile != NULL);
-	m_fileName = logFile;
+	m_fileName  = logFile;
+	m_mutex     = ARCH->newMutex();
+	m_flushCond = ARCH->newCondVar();
 }
 
 CFileLogOutputter::~CFileLogOutputter()
 {
+	stopFlushing();
+	close();
+	ARCH->closeCondVar(m_flushCond);
+	ARCH->closeMutex(m_mutex);
+}
+
+void
+CFileLogOutputter::setMaxSize(UInt32 maxSize)
+{
+	CArchMutexLock lock(m_mutex);
+	m_maxSize = maxSize;
+}
+
+void
+CFileLogOutputter::setBackups(UInt32 backups)
+{
+	CArchMutexLock lock(m_mutex);
+	m_backups = backups;
+}
+
+void
+CFileLogOutputter::startFlushing()
+{
+	CArchMutexLock lock(m_mutex);
+	if (m_flusher == NULL) {
+		m_stopFlusher = false;
+		m_flusher     = ARCH->newThread(&CFileLogOutputter::flusherThreadFunc,
+								this);
+	}
 }
 
 bool
 CFileLogOutputter::write(ELevel level, const char *message)
 {
-	std::ofstream m_handle;
-	m_handle.open(m_fileName.c_str(), std::fstream::app);
-	if (m_handle.is_open() && m_handle.fail() != true) {
-		m_handle << message << std::endl;
+	CArchMutexLock lock(m_mutex);
+	if (!m_handle.is_open()) {
+		openFile();
+		if (!m_handle.is_open()) {
+			return true;
+		}
+	}
+
+	size_t n = strlen(message);
+	m_handle.write(message, n);
+	m_handle.put('\n');
+	m_size += (UInt32)n + 1;
+
+	// don't sit on anything important in case we're about to die and
+	// don't let the rest go stale
+	double now = ARCH->time();
+	if (!m_dirty) {
+		m_dirty     = true;
+		m_dirtyTime = now;
+		if (m_flusher != NULL) {
+			ARCH->broadcastCondVar(m_flushCond);
+		}
+	}
+	if (level <= kWARNING || now - m_dirtyTime >= kLogFlushInterval) {
+		flushFile();
+	}
+
+	if (m_maxSize != 0 && m_size >= m_maxSize) {
+		rotateFile();
 	}
-	m_handle.close();
 
 	return true;
 }
 
 void
-CFileLogOutputter::open(const char *title) {}
+CFileLogOutputter::open(const char *title)
+{
+	CArchMutexLock lock(m_mutex);
+	if (!m_handle.is_open()) {
+		openFile();
+	}
+}
 
 void
-CFileLogOutputter::close() {}
+CFileLogOutputter::close()
+{
+	CArchMutexLock lock(m_mutex);
+	if (m_handle.is_open()) {
+		flushFile();
+		m_handle.close();
+	}
+}
 
 void
 CFileLogOutputter::show(bool showIfEmpty) {}
 
+void
+CFileLogOutputter::openFile()
+{
+	m_handle.clear();
+	m_handle.open(m_fileName.c_str(), std::fstream::app);
+	if (m_handle.is_open()) {
+		m_handle.seekp(0, std::ios::end);
+		std::streamoff size = m_handle.tellp();
+		m_size = (size > 0) ? (UInt32)size : 0;
+	}
+	m_dirty = false;
+}
+
+void
+CFileLogOutputter::flushFile()
+{
+	if (m_dirty) {
+		m_handle.flush();
+		m_dirty = false;
+	}
+}
+
+void
+CFileLogOutputter::rotateFile()
+{
+	m_handle.close();
+
+	// shift the old logs along, dropping the oldest
+	if (m_backups == 0) {
+		::remove(m_fileName.c_str());
+	}
+	else {
+		for (UInt32 i = m_backups; i > 0; --i) {
+			char suffix[16];
+			sprintf(suffix, ".%u", i);
+			std::string to   = m_fileName + suffix;
+			std::string from = m_fileName;
+			if (i > 1) {
+				sprintf(suffix, ".%u", i - 1);
+				from += suffix;
+			}
+			::remove(to.c_str());
+			::rename(from.c_str(), to.c_str());
+		}
+	}
+
+	openFile();
+}
+
+void
+CFileLogOutputter::stopFlushing()
+{
+	ARCH->lockMutex(m_mutex);
+	CArchThread flusher = m_flusher;
+	m_stopFlusher       = true;
+	ARCH->broadcastCondVar(m_flushCond);
+	ARCH->unlockMutex(m_mutex);
+
+	if (flusher != NULL) {
+		ARCH->wait(flusher, -1.0);
+		ARCH->closeThread(flusher);
+		m_flusher = NULL;
+	}
+}
+
+void*
+CFileLogOutputter::flusherThreadFunc(void* vself)
+{
+	static_cast<CFileLogOutputter*>(vself)->flusherThread();
+	return NULL;
+}
+
+void
+CFileLogOutputter::flusherThread()
+{
+	CArchMutexLock lock(m_mutex);
+	while (!m_stopFlusher) {
+		if (!m_dirty) {
+			ARCH->waitCondVar(m_flushCond, m_mutex, -1.0);
+			continue;
+		}
+		double age = ARCH->time() - m_dirtyTime;
+		if (age >= kLogFlushInterval) {
+			flushFile();
+		}
+		else {
+			ARCH->waitCondVar(m_flushCond, m_mutex, kLogFlushInterval - age);
+		}
+	}
+}
+
 //
 // CMesssageBoxLogOutputter
 //
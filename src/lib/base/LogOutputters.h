@@ -21,6 +21,7 @@
 
 #include "BasicTypes.h"
 #include "ILogOutputter.h"
+#include "IArchMultithread.h"
 #include "CString.h"
 #include "stddeque.h"
 #include "CThread.h"
@@ -66,8 +67,13 @@ public:
 
 //! Write log to file
 /*!
-This outputter writes output to the file.  The level for each
-message is ignored.
+This outputter writes output to the file.  The file is kept open and
+writes are buffered.  The buffer is flushed immediately for messages
+of level kWARNING or higher priority, otherwise by the first message
+written a second or more after the oldest unflushed message or, once
+startFlushing() has been called, by a thread a second after it.  The
+log is rotated when it grows too big.  The level for each message is
+otherwise ignored.
 */
 
 class CFileLogOutputter : public ILogOutputter {
@@ -75,13 +81,65 @@ public:
 	CFileLogOutputter(const char* logFile);
 	virtual ~CFileLogOutputter();
 
+	//! @name manipulators
+	//@{
+
+	//! Set maximum log size
+	/*!
+	Once the log reaches \c maxSize bytes it's renamed with the suffix
+	".1" and a new log is started.  Zero disables rotation.  The default
+	is 10 MB.
+	*/
+	void				setMaxSize(UInt32 maxSize);
+
+	//! Set number of old logs
+	/*!
+	Up to \c backups rotated logs are kept with the suffixes ".1"
+	(newest) to ".<backups>";  if \c backups is zero the old log is
+	deleted instead.  The default is 3.
+	*/
+	void				setBackups(UInt32 backups);
+
+	//! Flush from a thread
+	/*!
+	Starts a thread that flushes buffered messages a second after they
+	were written, even if nothing else is logged.  This must be called
+	after any fork(), e.g. after daemonizing, since the thread doesn't
+	survive it.  Calling it again has no effect.
+	*/
+	void				startFlushing();
+
+	//@}
+
 	// ILogOutputter overrides
 	virtual void		open(const char* title);
 	virtual void		close();
 	virtual void		show(bool showIfEmpty);
 	virtual bool		write(ELevel level, const char* message);
+
+private:
+	void				openFile();
+	void				flushFile();
+	void				rotateFile();
+	void				stopFlushing();
+	static void*		flusherThreadFunc(void*);
+	void				flusherThread();
+
 private:
-	std::string m_fileName;
+	// m_mutex guards everything below.  the flusher sleeps on m_flushCond
+	// until the file is dirty, then until it's been dirty long enough.
+	CArchMutex			m_mutex;
+	CArchCond			m_flushCond;
+	CArchThread			m_flusher;
+	bool				m_stopFlusher;
+
+	std::string			m_fileName;
+	std::ofstream		m_handle;
+	UInt32				m_size;
+	UInt32				m_maxSize;
+	UInt32				m_backups;
+	bool				m_dirty;
+	double				m_dirtyTime;
 };
 
 //! Write log to system log
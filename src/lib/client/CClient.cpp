@@ -436,13 +436,13 @@ CClient::sendClipboard(ClipboardID id)
 		// save new time
 		m_timeClipboard[id] = clipboard.getTime();
 
-		// marshall the data
-		CString data = clipboard.marshall();
-
-		// save and send data if different or not yet sent
-		if (!m_sentClipboard[id] || data != m_dataClipboard[id]) {
+		// send data if different or not yet sent.  compare hashes
+		// rather than data so we don't marshall an unchanged clipboard
+		// and don't keep a copy of the data.
+		UInt64 hash = clipboard.getHash();
+		if (!m_sentClipboard[id] || hash != m_hashClipboard[id]) {
 			m_sentClipboard[id] = true;
-			m_dataClipboard[id] = data;
+			m_hashClipboard[id] = hash;
 			m_server->onClipboardChanged(id, &clipboard);
 		}
 	}
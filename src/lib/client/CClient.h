@@ -216,7 +216,7 @@ private:
 	bool					m_ownClipboard[kClipboardEnd];
 	bool					m_sentClipboard[kClipboardEnd];
 	IClipboard::Time		m_timeClipboard[kClipboardEnd];
-	CString					m_dataClipboard[kClipboardEnd];
+	UInt64					m_hashClipboard[kClipboardEnd];
 	IEventQueue*			m_eventQueue;
 	CCryptoStream*			m_cryptoStream;
 	CCryptoOptions			m_crypto;
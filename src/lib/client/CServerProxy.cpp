@@ -58,6 +58,34 @@ CServerProxy::CServerProxy(CClient* client, synergy::IStream* stream, IEventQueu
 	for (KeyModifierID id = 0; id < kKeyModifierIDLast; ++id)
 		m_modifierTranslationTable[id] = id;
 
+	// initialize message table for after the handshake
+	addMessage(kMsgDMouseMove,     &CServerProxy::mouseMove);
+	addMessage(kMsgDMouseRelMove,  &CServerProxy::mouseRelativeMove);
+	addMessage(kMsgDMouseWheel,    &CServerProxy::mouseWheel);
+	addMessage(kMsgDKeyDown,       &CServerProxy::keyDown);
+	addMessage(kMsgDKeyUp,         &CServerProxy::keyUp);
+	addMessage(kMsgDMouseDown,     &CServerProxy::mouseDown);
+	addMessage(kMsgDMouseUp,       &CServerProxy::mouseUp);
+	addMessage(kMsgDKeyRepeat,     &CServerProxy::keyRepeat);
+	addMessage(kMsgCKeepAlive,     &CServerProxy::keepAlive);
+	addMessage(kMsgCNoop,          &CServerProxy::noop);
+	addMessage(kMsgCEnter,         &CServerProxy::enter);
+	addMessage(kMsgCLeave,         &CServerProxy::leave);
+	addMessage(kMsgCClipboard,     &CServerProxy::grabClipboard);
+	addMessage(kMsgCScreenSaver,   &CServerProxy::screensaver);
+	addMessage(kMsgQInfo,          &CServerProxy::queryInfo);
+	addMessage(kMsgCInfoAck,       &CServerProxy::infoAcknowledgment);
+	addMessage(kMsgDClipboard,     &CServerProxy::setClipboard);
+	addMessage(kMsgCResetOptions,  &CServerProxy::resetOptions);
+	addMessage(kMsgDSetOptions,    &CServerProxy::setOptions);
+	addMessage(kMsgDGameButtons,   &CServerProxy::gameDeviceButtons);
+	addMessage(kMsgDGameSticks,    &CServerProxy::gameDeviceSticks);
+	addMessage(kMsgDGameTriggers,  &CServerProxy::gameDeviceTriggers);
+	addMessage(kMsgCGameTimingReq, &CServerProxy::gameDeviceTimingReq);
+	addMessage(kMsgDCryptoIv,      &CServerProxy::cryptoIv);
+	addMessage(kMsgCClose,         &CServerProxy::hangup, kDisconnect);
+	addMessage(kMsgEBad,           &CServerProxy::protocolError, kDisconnect);
+
 	// handle data on stream
 	m_eventQueue->adoptHandler(m_stream->getInputReadyEvent(),
 							m_stream->getEventTarget(),
@@ -159,19 +187,15 @@ CServerProxy::parseHandshakeMessage(const UInt8* code)
 	}
 
 	else if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
-		// echo keep alives and reset alarm
-		CProtocolUtil::writef(m_stream, kMsgCKeepAlive);
-		resetKeepAliveAlarm();
+		keepAlive();
 	}
 
 	else if (memcmp(code, kMsgCNoop, 4) == 0) {
-		// accept and discard no-op
+		noop();
 	}
 
 	else if (memcmp(code, kMsgCClose, 4) == 0) {
-		// server wants us to hangup
-		LOG((CLOG_DEBUG1 "recv close"));
-		m_client->disconnect(NULL);
+		hangup();
 		return kDisconnect;
 	}
 
@@ -197,8 +221,7 @@ CServerProxy::parseHandshakeMessage(const UInt8* code)
 	}
 
 	else if (memcmp(code, kMsgEBad, 4) == 0) {
-		LOG((CLOG_ERR "server disconnected due to a protocol error"));
-		m_client->disconnect("server reported a protocol error");
+		protocolError();
 		return kDisconnect;
 	}
 	else {
@@ -211,118 +234,14 @@ CServerProxy::parseHandshakeMessage(const UInt8* code)
 CServerProxy::EResult
 CServerProxy::parseMessage(const UInt8* code)
 {
-	if (memcmp(code, kMsgDMouseMove, 4) == 0) {
-		mouseMove();
-	}
-
-	else if (memcmp(code, kMsgDMouseRelMove, 4) == 0) {
-		mouseRelativeMove();
-	}
-
-	else if (memcmp(code, kMsgDMouseWheel, 4) == 0) {
-		mouseWheel();
-	}
-
-	else if (memcmp(code, kMsgDKeyDown, 4) == 0) {
-		keyDown();
-	}
-
-	else if (memcmp(code, kMsgDKeyUp, 4) == 0) {
-		keyUp();
-	}
-
-	else if (memcmp(code, kMsgDMouseDown, 4) == 0) {
-		mouseDown();
-	}
-
-	else if (memcmp(code, kMsgDMouseUp, 4) == 0) {
-		mouseUp();
-	}
-
-	else if (memcmp(code, kMsgDKeyRepeat, 4) == 0) {
-		keyRepeat();
-	}
-
-	else if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
-		// echo keep alives and reset alarm
-		CProtocolUtil::writef(m_stream, kMsgCKeepAlive);
-		resetKeepAliveAlarm();
-	}
-
-	else if (memcmp(code, kMsgCNoop, 4) == 0) {
-		// accept and discard no-op
-	}
-
-	else if (memcmp(code, kMsgCEnter, 4) == 0) {
-		enter();
-	}
-
-	else if (memcmp(code, kMsgCLeave, 4) == 0) {
-		leave();
-	}
-
-	else if (memcmp(code, kMsgCClipboard, 4) == 0) {
-		grabClipboard();
-	}
-
-	else if (memcmp(code, kMsgCScreenSaver, 4) == 0) {
-		screensaver();
-	}
-
-	else if (memcmp(code, kMsgQInfo, 4) == 0) {
-		queryInfo();
-	}
-
-	else if (memcmp(code, kMsgCInfoAck, 4) == 0) {
-		infoAcknowledgment();
-	}
-
-	else if (memcmp(code, kMsgDClipboard, 4) == 0) {
-		setClipboard();
-	}
-
-	else if (memcmp(code, kMsgCResetOptions, 4) == 0) {
-		resetOptions();
-	}
-
-	else if (memcmp(code, kMsgDSetOptions, 4) == 0) {
-		setOptions();
-	}
-
-	else if (memcmp(code, kMsgDGameButtons, 4) == 0) {
-		gameDeviceButtons();
-	}
-
-	else if (memcmp(code, kMsgDGameSticks, 4) == 0) {
-		gameDeviceSticks();
-	}
-
-	else if (memcmp(code, kMsgDGameTriggers, 4) == 0) {
-		gameDeviceTriggers();
-	}
-
-	else if (memcmp(code, kMsgCGameTimingReq, 4) == 0) {
-		gameDeviceTimingReq();
-	}
-
-	else if (memcmp(code, kMsgDCryptoIv, 4) == 0) {
-		cryptoIv();
-	}
-
-	else if (memcmp(code, kMsgCClose, 4) == 0) {
-		// server wants us to hangup
-		LOG((CLOG_DEBUG1 "recv close"));
-		m_client->disconnect(NULL);
-		return kDisconnect;
-	}
-	else if (memcmp(code, kMsgEBad, 4) == 0) {
-		LOG((CLOG_ERR "server disconnected due to a protocol error"));
-		m_client->disconnect("server reported a protocol error");
-		return kDisconnect;
-	}
-	else {
+	const CMessage* message = m_messages.find(code);
+	if (message == NULL) {
 		return kUnknown;
 	}
+	(this->*message->m_handler)();
+	if (message->m_result != kOkay) {
+		return message->m_result;
+	}
 
 	// send a reply.  this is intended to work around a delay when
 	// running a linux server and an OS X (any BSD?) client.  the
@@ -331,11 +250,20 @@ CServerProxy::parseMessage(const UInt8* code)
 	// on a data packet.  we provide that packet here.  i don't
 	// know why a delayed ACK should cause the server to wait since
 	// TCP_NODELAY is enabled.
-	CProtocolUtil::writef(m_stream, kMsgCNoop);
+	CProtocolUtil::writeMessage(m_stream, CMsgCNoop());
 
 	return kOkay;
 }
 
+void
+CServerProxy::addMessage(const char* msg, MessageHandler handler, EResult result)
+{
+	CMessage message;
+	message.m_handler = handler;
+	message.m_result  = result;
+	m_messages.add(msg, message);
+}
+
 void
 CServerProxy::handleKeepAliveAlarm(const CEvent&, void*)
 {
@@ -533,10 +461,12 @@ void
 CServerProxy::enter()
 {
 	// parse
-	SInt16 x, y;
-	UInt16 mask;
-	UInt32 seqNum;
-	CProtocolUtil::readf(m_stream, kMsgCEnter + 4, &x, &y, &seqNum, &mask);
+	CMsgCEnter message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt16 x      = message.m_x;
+	SInt16 y      = message.m_y;
+	UInt32 seqNum = message.m_seqNum;
+	UInt16 mask   = message.m_mask;
 	LOG((CLOG_DEBUG1 "recv enter, %d,%d %d %04x", x, y, seqNum, mask));
 
 	// discard old compressed mouse motion, if any
@@ -609,8 +539,11 @@ CServerProxy::keyDown()
 	flushCompressedMouse();
 
 	// parse
-	UInt16 id, mask, button;
-	CProtocolUtil::readf(m_stream, kMsgDKeyDown + 4, &id, &mask, &button);
+	CMsgDKeyDown message;
+	CProtocolUtil::readMessage(m_stream, message);
+	UInt16 id     = message.m_id;
+	UInt16 mask   = message.m_mask;
+	UInt16 button = message.m_button;
 	LOG((CLOG_DEBUG1 "recv key down id=0x%08x, mask=0x%04x, button=0x%04x", id, mask, button));
 
 	// translate
@@ -632,9 +565,12 @@ CServerProxy::keyRepeat()
 	flushCompressedMouse();
 
 	// parse
-	UInt16 id, mask, count, button;
-	CProtocolUtil::readf(m_stream, kMsgDKeyRepeat + 4,
-								&id, &mask, &count, &button);
+	CMsgDKeyRepeat message;
+	CProtocolUtil::readMessage(m_stream, message);
+	UInt16 id     = message.m_id;
+	UInt16 mask   = message.m_mask;
+	UInt16 count  = message.m_count;
+	UInt16 button = message.m_button;
 	LOG((CLOG_DEBUG1 "recv key repeat id=0x%08x, mask=0x%04x, count=%d, button=0x%04x", id, mask, count, button));
 
 	// translate
@@ -656,8 +592,11 @@ CServerProxy::keyUp()
 	flushCompressedMouse();
 
 	// parse
-	UInt16 id, mask, button;
-	CProtocolUtil::readf(m_stream, kMsgDKeyUp + 4, &id, &mask, &button);
+	CMsgDKeyUp message;
+	CProtocolUtil::readMessage(m_stream, message);
+	UInt16 id     = message.m_id;
+	UInt16 mask   = message.m_mask;
+	UInt16 button = message.m_button;
 	LOG((CLOG_DEBUG1 "recv key up id=0x%08x, mask=0x%04x, button=0x%04x", id, mask, button));
 
 	// translate
@@ -679,8 +618,9 @@ CServerProxy::mouseDown()
 	flushCompressedMouse();
 
 	// parse
-	SInt8 id;
-	CProtocolUtil::readf(m_stream, kMsgDMouseDown + 4, &id);
+	CMsgDMouseDown message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt8 id = static_cast<SInt8>(message.m_id);
 	LOG((CLOG_DEBUG1 "recv mouse down id=%d", id));
 
 	// forward
@@ -694,8 +634,9 @@ CServerProxy::mouseUp()
 	flushCompressedMouse();
 
 	// parse
-	SInt8 id;
-	CProtocolUtil::readf(m_stream, kMsgDMouseUp + 4, &id);
+	CMsgDMouseUp message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt8 id = static_cast<SInt8>(message.m_id);
 	LOG((CLOG_DEBUG1 "recv mouse up id=%d", id));
 
 	// forward
@@ -707,8 +648,10 @@ CServerProxy::mouseMove()
 {
 	// parse
 	bool ignore;
-	SInt16 x, y;
-	CProtocolUtil::readf(m_stream, kMsgDMouseMove + 4, &x, &y);
+	CMsgDMouseMove message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt16 x = message.m_x;
+	SInt16 y = message.m_y;
 
 	// note if we should ignore the move
 	ignore = m_ignoreMouse;
@@ -740,8 +683,10 @@ CServerProxy::mouseRelativeMove()
 {
 	// parse
 	bool ignore;
-	SInt16 dx, dy;
-	CProtocolUtil::readf(m_stream, kMsgDMouseRelMove + 4, &dx, &dy);
+	CMsgDMouseRelMove message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt16 dx = message.m_x;
+	SInt16 dy = message.m_y;
 
 	// note if we should ignore the move
 	ignore = m_ignoreMouse;
@@ -772,8 +717,10 @@ CServerProxy::mouseWheel()
 	flushCompressedMouse();
 
 	// parse
-	SInt16 xDelta, yDelta;
-	CProtocolUtil::readf(m_stream, kMsgDMouseWheel + 4, &xDelta, &yDelta);
+	CMsgDMouseWheel message;
+	CProtocolUtil::readMessage(m_stream, message);
+	SInt16 xDelta = message.m_x;
+	SInt16 yDelta = message.m_y;
 	LOG((CLOG_DEBUG2 "recv mouse wheel %+d,%+d", xDelta, yDelta));
 
 	// forward
@@ -930,3 +877,32 @@ CServerProxy::infoAcknowledgment()
 	LOG((CLOG_DEBUG1 "recv info acknowledgment"));
 	m_ignoreMouse = false;
 }
+
+void
+CServerProxy::keepAlive()
+{
+	// echo keep alives and reset alarm
+	CProtocolUtil::writeMessage(m_stream, CMsgCKeepAlive());
+	resetKeepAliveAlarm();
+}
+
+void
+CServerProxy::noop()
+{
+	// accept and discard no-op
+}
+
+void
+CServerProxy::hangup()
+{
+	// server wants us to hangup
+	LOG((CLOG_DEBUG1 "recv close"));
+	m_client->disconnect(NULL);
+}
+
+void
+CServerProxy::protocolError()
+{
+	LOG((CLOG_ERR "server disconnected due to a protocol error"));
+	m_client->disconnect("server reported a protocol error");
+}
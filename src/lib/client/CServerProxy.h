@@ -23,6 +23,7 @@
 #include "KeyTypes.h"
 #include "CEvent.h"
 #include "GameDeviceTypes.h"
+#include "TMessageTable.h"
 
 class CClient;
 class CClientInfo;
@@ -105,9 +106,25 @@ private:
 	void				setOptions();
 	void				queryInfo();
 	void				infoAcknowledgment();
+	void				keepAlive();
+	void				noop();
+	void				hangup();
+	void				protocolError();
 
 private:
 	typedef EResult (CServerProxy::*MessageParser)(const UInt8*);
+	typedef void (CServerProxy::*MessageHandler)();
+
+	// a message handler and the result of parsing the message
+	class CMessage {
+	public:
+		MessageHandler	m_handler;
+		EResult			m_result;
+	};
+	typedef TMessageTable<CMessage> CMessageTable;
+
+	void				addMessage(const char* msg, MessageHandler,
+							EResult result = kOkay);
 
 	CClient*			m_client;
 	synergy::IStream*		m_stream;
@@ -127,6 +144,7 @@ private:
 	CEventQueueTimer*		m_keepAliveAlarmTimer;
 
 	MessageParser			m_parser;
+	CMessageTable			m_messages;
 	IEventQueue*			m_eventQueue;
 };
 
@@ -17,58 +17,62 @@
  */
 
 #include "CStreamBuffer.h"
+#include <algorithm>
+#include <cstring>
 
 //
 // CStreamBuffer
 //
 
-const UInt32			CStreamBuffer::kChunkSize = 4096;
+const UInt32			CStreamBuffer::kChunkSize     = 4096;
+const UInt32			CStreamBuffer::kMaxFreeChunks = 16;
+const UInt32			CStreamBuffer::kMaxSpareSize  = 65536;
 
 CStreamBuffer::CStreamBuffer() :
+	m_head(0),
+	m_count(0),
+	m_spare(NULL),
 	m_size(0),
-	m_headUsed(0)
+	m_reserved(0)
 {
-	// do nothing
+	m_free.reserve(kMaxFreeChunks);
 }
 
 CStreamBuffer::~CStreamBuffer()
 {
-	// do nothing
+	for (UInt32 i = 0; i < m_count; ++i) {
+		CChunk* chunk = getChunk(i);
+		delete[] chunk->m_data;
+		delete chunk;
+	}
+	for (CChunks::iterator i = m_free.begin(); i != m_free.end(); ++i) {
+		delete[] (*i)->m_data;
+		delete *i;
+	}
+	if (m_spare != NULL) {
+		delete[] m_spare->m_data;
+		delete m_spare;
+	}
 }
 
 const void*
 CStreamBuffer::peek(UInt32 n)
 {
 	assert(n <= m_size);
-   
+
 	// if requesting no data then return NULL so we don't try to access
-	// an empty list.
+	// an empty ring.
 	if (n == 0) {
 		return NULL;
 	}
 
-	// reserve space in first chunk
-	ChunkList::iterator head = m_chunks.begin();
-
-    // add additional kChunkSize here to prevent reallocation during chunks consolidation.
-    head->reserve(n + m_headUsed + kChunkSize);
-
-	// consolidate chunks into the first chunk until it has at least n bytes
-	ChunkList::iterator scan = head;
-	++scan;
-	while (head->size() - m_headUsed < n && scan != m_chunks.end()) {
-        if (scan->size() > 0) {
-            assert(head->capacity() - head->size() >= scan->size());
-            int size = head->size();
-            Chunk::iterator destPtr = head->end();
-
-            head->resize(head->size() + scan->size());
-            memcpy(&(*destPtr), &(*scan->begin()), scan->size());            
-        }
-        scan = m_chunks.erase(scan);
+	// usually the data is already contiguous
+	CChunk* head = getChunk(0);
+	if (head->m_end - head->m_begin < n) {
+		consolidate(n);
+		head = getChunk(0);
 	}
-
-	return reinterpret_cast<const void*>(&(head->begin()[m_headUsed]));
+	return head->m_data + head->m_begin;
 }
 
 void
@@ -76,28 +80,27 @@ CStreamBuffer::pop(UInt32 n)
 {
 	// discard all chunks if n is greater than or equal to m_size
 	if (n >= m_size) {
-		m_size     = 0;
-		m_headUsed = 0;
-		m_chunks.clear();
-        return;
+		while (m_count > 0) {
+			deleteChunk(popFrontChunk());
+		}
+		m_size = 0;
+		return;
 	}
 
 	// update size
 	m_size -= n;
 
 	// discard chunks until more than n bytes would've been discarded
-	ChunkList::iterator scan = m_chunks.begin();
-	assert(scan != m_chunks.end());
-	while (scan->size() - m_headUsed <= n) {
-		n         -= (UInt32)scan->size() - m_headUsed;
-		m_headUsed = 0;
-		scan       = m_chunks.erase(scan);
-		assert(scan != m_chunks.end());
-	}
-
-	// remove left over bytes from the head chunk
-	if (n > 0) {
-		m_headUsed += n;
+	// then remove the left over bytes from the head chunk
+	for (;;) {
+		CChunk* head = getChunk(0);
+		UInt32 size  = head->m_end - head->m_begin;
+		if (size > n) {
+			head->m_begin += n;
+			break;
+		}
+		n -= size;
+		deleteChunk(popFrontChunk());
 	}
 }
 
@@ -115,40 +118,57 @@ CStreamBuffer::write(const void* vdata, UInt32 n)
 	// cast data to bytes
 	const UInt8* data = reinterpret_cast<const UInt8*>(vdata);
 
-	// point to last chunk if it has space, otherwise append an empty chunk
-	ChunkList::iterator scan = m_chunks.end();
-	if (scan != m_chunks.begin()) {
-		--scan;
-		if (scan->size() >= kChunkSize) {
-			++scan;
+	// fill the last chunk then append chunks until all data is written
+	CChunk* tail = (m_count > 0) ? getChunk(m_count - 1) : NULL;
+	while (n > 0) {
+		if (tail == NULL || tail->m_end == tail->m_capacity) {
+			tail = newChunk(kChunkSize);
+			pushBackChunk(tail);
 		}
+		UInt32 count = tail->m_capacity - tail->m_end;
+		if (count > n) {
+			count = n;
+		}
+		memcpy(tail->m_data + tail->m_end, data, count);
+		tail->m_end += count;
+		n           -= count;
+		data        += count;
 	}
-	if (scan == m_chunks.end()) {
-		scan = m_chunks.insert(scan, Chunk());
-        // reserve space at once so that chunk internal buffer won't ever reallocate except in "peek" call.
-        // this needed for using the pointer returned by "peek" call safely.
-        scan->reserve(kChunkSize);
+}
+
+void*
+CStreamBuffer::reserve(UInt32 n)
+{
+	assert(m_reserved == 0);
+	assert(n > 0);
+
+	// use the last chunk if the space fits in it, otherwise append a
+	// chunk big enough to hold it
+	CChunk* tail = (m_count > 0) ? getChunk(m_count - 1) : NULL;
+	if (tail == NULL || tail->m_capacity - tail->m_end < n) {
+		tail = newChunk(n);
+		pushBackChunk(tail);
 	}
+	m_reserved = n;
 
-	// append data in chunks
-	while (n > 0) {
-		// choose number of bytes for next chunk
-		assert(scan->size() <= kChunkSize);
-		UInt32 count = kChunkSize - (UInt32)scan->size();
-		if (count > n)
-			count = n;
+	return tail->m_data + tail->m_end;
+}
 
-		// transfer data
-		scan->insert(scan->end(), data, data + count);
-		n    -= count;
-		data += count;
+void
+CStreamBuffer::commit(UInt32 n)
+{
+	assert(m_reserved > 0);
+	assert(n <= m_reserved);
 
-		// append another empty chunk if we're not done yet
-		if (n > 0) {
-			++scan;
-			scan = m_chunks.insert(scan, Chunk());
-		}
+	// append the used part of the reservation.  discard the chunk if
+	// it was added for the reservation and nothing was used.
+	CChunk* tail = getChunk(m_count - 1);
+	tail->m_end += n;
+	if (tail->m_begin == tail->m_end) {
+		deleteChunk(popBackChunk());
 	}
+	m_reserved = 0;
+	m_size    += n;
 }
 
 UInt32
@@ -156,3 +176,168 @@ CStreamBuffer::getSize() const
 {
 	return m_size;
 }
+
+UInt32
+CStreamBuffer::peekSegments(CSegment segments[], UInt32 num, UInt32 n) const
+{
+	assert(n <= m_size);
+	assert(segments != NULL || num == 0);
+
+	UInt32 count = 0;
+	for (UInt32 i = 0; n > 0 && count < num && i < m_count; ++i) {
+		const CChunk* chunk = getChunk(i);
+		UInt32 size = chunk->m_end - chunk->m_begin;
+		if (size > n) {
+			size = n;
+		}
+		segments[count].m_data = chunk->m_data + chunk->m_begin;
+		segments[count].m_size = size;
+		n -= size;
+		++count;
+	}
+	return count;
+}
+
+CStreamBuffer::CChunk*
+CStreamBuffer::newChunk(UInt32 n)
+{
+	CChunk* chunk;
+	if (n <= kChunkSize && !m_free.empty()) {
+		chunk = m_free.back();
+		m_free.pop_back();
+	}
+	else if (n > kChunkSize && m_spare != NULL && m_spare->m_capacity >= n) {
+		chunk   = m_spare;
+		m_spare = NULL;
+	}
+	else {
+		chunk             = new CChunk;
+		chunk->m_capacity = (n > kChunkSize) ? n : kChunkSize;
+		chunk->m_data     = new UInt8[chunk->m_capacity];
+	}
+	chunk->m_begin = 0;
+	chunk->m_end   = 0;
+	return chunk;
+}
+
+void
+CStreamBuffer::deleteChunk(CChunk* chunk)
+{
+	// keep regular chunks for reuse.  also keep one oversized chunk, up
+	// to a limit, since peek() keeps needing one of about the same size.
+	if (chunk->m_capacity == kChunkSize) {
+		if (m_free.size() < kMaxFreeChunks) {
+			m_free.push_back(chunk);
+			return;
+		}
+	}
+	else if (chunk->m_capacity <= kMaxSpareSize) {
+		std::swap(chunk, m_spare);
+		if (chunk == NULL) {
+			return;
+		}
+	}
+	delete[] chunk->m_data;
+	delete chunk;
+}
+
+CStreamBuffer::CChunk*
+CStreamBuffer::getChunk(UInt32 i) const
+{
+	assert(i < m_count);
+	return m_ring[(m_head + i) & (m_ring.size() - 1)];
+}
+
+void
+CStreamBuffer::pushFrontChunk(CChunk* chunk)
+{
+	growRing();
+	m_head = (m_head + (UInt32)m_ring.size() - 1) & (m_ring.size() - 1);
+	m_ring[m_head] = chunk;
+	++m_count;
+}
+
+void
+CStreamBuffer::pushBackChunk(CChunk* chunk)
+{
+	growRing();
+	m_ring[(m_head + m_count) & (m_ring.size() - 1)] = chunk;
+	++m_count;
+}
+
+CStreamBuffer::CChunk*
+CStreamBuffer::popFrontChunk()
+{
+	assert(m_count > 0);
+	CChunk* chunk = m_ring[m_head];
+	m_head = (m_head + 1) & (m_ring.size() - 1);
+	--m_count;
+	return chunk;
+}
+
+CStreamBuffer::CChunk*
+CStreamBuffer::popBackChunk()
+{
+	assert(m_count > 0);
+	CChunk* chunk = getChunk(m_count - 1);
+	--m_count;
+	return chunk;
+}
+
+void
+CStreamBuffer::growRing()
+{
+	if (m_count < m_ring.size()) {
+		return;
+	}
+
+	// double the ring, unwrapping the chunks to the start
+	CChunks ring(m_ring.empty() ? 8 : 2 * m_ring.size());
+	for (UInt32 i = 0; i < m_count; ++i) {
+		ring[i] = getChunk(i);
+	}
+	m_ring.swap(ring);
+	m_head = 0;
+}
+
+void
+CStreamBuffer::consolidate(UInt32 n)
+{
+	assert(n <= m_size);
+
+	// make room for n bytes in the head chunk.  slide the data down
+	// if that's enough, otherwise move it to a bigger chunk.
+	CChunk* head = popFrontChunk();
+	UInt32 size  = head->m_end - head->m_begin;
+	if (head->m_capacity - head->m_begin < n) {
+		if (head->m_capacity >= n) {
+			memmove(head->m_data, head->m_data + head->m_begin, size);
+		}
+		else {
+			CChunk* bigger = newChunk(n);
+			memcpy(bigger->m_data, head->m_data + head->m_begin, size);
+			deleteChunk(head);
+			head = bigger;
+		}
+		head->m_begin = 0;
+		head->m_end   = size;
+	}
+
+	// move data from the following chunks until the head has n bytes
+	while (size < n) {
+		CChunk* next = getChunk(0);
+		UInt32 count = next->m_end - next->m_begin;
+		if (count > n - size) {
+			count = n - size;
+		}
+		memcpy(head->m_data + head->m_end, next->m_data + next->m_begin, count);
+		head->m_end  += count;
+		next->m_begin += count;
+		size         += count;
+		if (next->m_begin == next->m_end) {
+			deleteChunk(popFrontChunk());
+		}
+	}
+
+	pushFrontChunk(head);
+}
@@ -20,15 +20,24 @@
 #define CSTREAMBUFFER_H
 
 #include "BasicTypes.h"
-#include "stdlist.h"
 #include "stdvector.h"
 
 //! FIFO of bytes
 /*!
-This class maintains a FIFO (first-in, last-out) buffer of bytes.
+This class maintains a FIFO (first-in, last-out) buffer of bytes.  The
+bytes are kept in a ring of fixed size chunks.  Chunks that empty out
+are kept on a free list for reuse so a buffer that's steadily written
+and drained doesn't touch the heap.
 */
 class CStreamBuffer {
 public:
+	//! A contiguous run of bytes in the buffer
+	class CSegment {
+	public:
+		const void*		m_data;
+		UInt32			m_size;
+	};
+
 	CStreamBuffer();
 	~CStreamBuffer();
 
@@ -39,7 +48,10 @@ public:
 	/*!
 	Return a pointer to memory with the next \c n bytes in the buffer
 	(which must be <= getSize()).  The caller must not modify the returned
-	memory nor delete it.
+	memory nor delete it.  The memory stays valid across write() but not
+	pop().  This doesn't copy if the bytes are already contiguous, which
+	is always true if \c n is no more than the first segment returned by
+	peekSegments().
 	*/
 	const void*			peek(UInt32 n);
 
@@ -56,6 +68,25 @@ public:
 	*/
 	void				write(const void* data, UInt32 n);
 
+	//! Reserve space to write data in place
+	/*!
+	Returns a pointer to \c n bytes of writable memory at the end of the
+	buffer so data can be written directly into the buffer (e.g. by a
+	socket read) instead of being copied in by write().  The data isn't
+	part of the buffer until commit() is called.  Only one reservation
+	may be outstanding and no other manipulator may be called before
+	commit().
+	*/
+	void*				reserve(UInt32 n);
+
+	//! Append reserved data
+	/*!
+	Appends the first \c n bytes of the memory returned by the last call
+	to reserve(), which must be no more than were reserved, and releases
+	the rest.  Call with \c n = 0 to cancel the reservation.
+	*/
+	void				commit(UInt32 n);
+
 	//@}
 	//! @name accessors
 	//@{
@@ -66,17 +97,70 @@ public:
 	*/
 	UInt32				getSize() const;
 
+	//! Read data in place without removing from buffer
+	/*!
+	Fills in at most \c num entries of \c segments with the contiguous
+	runs of bytes that hold the next \c n bytes in the buffer (which
+	must be <= getSize()) and returns the number of entries filled in.
+	Unlike peek() this never copies so the segments cover fewer than
+	\c n bytes if \c num is too small.  The caller must not modify the
+	memory nor delete it and it's only valid until the buffer is next
+	changed.
+	*/
+	UInt32				peekSegments(CSegment segments[],
+							UInt32 num, UInt32 n) const;
+
 	//@}
 
+private:
+	// not implemented
+	CStreamBuffer(const CStreamBuffer&);
+	CStreamBuffer&		operator=(const CStreamBuffer&);
+
+	// a block of memory.  bytes [m_begin, m_end) are in the buffer.
+	class CChunk {
+	public:
+		UInt8*			m_data;
+		UInt32			m_capacity;
+		UInt32			m_begin;
+		UInt32			m_end;
+	};
+	typedef std::vector<CChunk*> CChunks;
+
+	// get a chunk with room for at least n bytes from the free list
+	// or the heap and put it back
+	CChunk*				newChunk(UInt32 n);
+	void				deleteChunk(CChunk*);
+
+	// get the i'th chunk in the ring
+	CChunk*				getChunk(UInt32 i) const;
+
+	// add or remove a chunk at either end of the ring
+	void				pushFrontChunk(CChunk*);
+	void				pushBackChunk(CChunk*);
+	CChunk*				popFrontChunk();
+	CChunk*				popBackChunk();
+	void				growRing();
+
+	// move the next n bytes into a single chunk at the head of the ring
+	void				consolidate(UInt32 n);
+
 private:
 	static const UInt32	kChunkSize;
+	static const UInt32	kMaxFreeChunks;
+	static const UInt32	kMaxSpareSize;
+
+	// ring of chunks holding the data.  m_ring.size() is a power of two.
+	CChunks				m_ring;
+	UInt32				m_head;
+	UInt32				m_count;
 
-	typedef std::vector<UInt8> Chunk;
-	typedef std::list<Chunk> ChunkList;
+	// spare chunks of kChunkSize bytes and a spare larger chunk
+	CChunks				m_free;
+	CChunk*				m_spare;
 
-	ChunkList			m_chunks;
 	UInt32				m_size;
-	UInt32				m_headUsed;
+	UInt32				m_reserved;
 };
 
 #endif
@@ -42,7 +42,10 @@ CSocketMultiplexer::CSocketMultiplexer() :
 	m_jobListLock(new CCondVar<bool>(m_mutex, false)),
 	m_jobListLockLocked(new CCondVar<bool>(m_mutex, false)),
 	m_jobListLocker(NULL),
-	m_jobListLockLocker(NULL)
+	m_jobListLockLocker(NULL),
+	m_runningJob(NULL),
+	m_runningJobRemoved(false),
+	m_pollSet(NULL)
 {
 	assert(s_instance == NULL);
 
@@ -51,6 +54,16 @@ CSocketMultiplexer::CSocketMultiplexer() :
 	// in the jobs list.
 	m_cursorMark = reinterpret_cast<ISocketMultiplexerJob*>(this);
 
+	// use a poll set if the platform has one, otherwise poll()
+	try {
+		m_pollSet = ARCH->newPollSet();
+	}
+	catch (XArchNetwork& e) {
+		LOG((CLOG_WARN "cannot create poll set: %s", e.what().c_str()));
+		m_pollSet = NULL;
+	}
+	LOG((CLOG_DEBUG1 "socket multiplexer using %s", (m_pollSet != NULL) ? "poll set" : "poll"));
+
 	// start thread
 	m_thread = new CThread(new TMethodJob<CSocketMultiplexer>(
 								this, &CSocketMultiplexer::serviceThread));
@@ -76,6 +89,18 @@ CSocketMultiplexer::~CSocketMultiplexer()
 						i != m_socketJobMap.end(); ++i) {
 		delete *(i->second);
 	}
+	for (CSocketEntryMap::iterator i = m_socketEntryMap.begin();
+						i != m_socketEntryMap.end(); ++i) {
+		delete i->second->m_job;
+		delete i->second;
+	}
+	for (CJobEntries::iterator i = m_retiredEntries.begin();
+						i != m_retiredEntries.end(); ++i) {
+		delete *i;
+	}
+	if (m_pollSet != NULL) {
+		ARCH->closePollSet(m_pollSet);
+	}
 
 	s_instance = NULL;
 }
@@ -93,6 +118,30 @@ CSocketMultiplexer::addSocket(ISocket* socket, ISocketMultiplexerJob* job)
 	assert(socket != NULL);
 	assert(job    != NULL);
 
+	if (m_pollSet != NULL) {
+		// the poll set can be changed while the service thread waits
+		// on it so we only have to wait for a service pass to finish.
+		lockJobListLock();
+		lockJobList();
+
+		CSocketEntryMap::iterator i = m_socketEntryMap.find(socket);
+		CJobEntry* entry;
+		if (i == m_socketEntryMap.end()) {
+			entry               = new CJobEntry;
+			entry->m_socket     = socket;
+			entry->m_job        = NULL;
+			entry->m_archSocket = NULL;
+			m_socketEntryMap.insert(std::make_pair(socket, entry));
+		}
+		else {
+			entry = i->second;
+		}
+		setEntryJob(entry, job);
+
+		unlockJobList();
+		return;
+	}
+
 	// prevent other threads from locking the job list
 	lockJobListLock();
 
@@ -130,35 +179,67 @@ CSocketMultiplexer::removeSocket(ISocket* socket)
 {
 	assert(socket != NULL);
 
-	// prevent other threads from locking the job list
-	lockJobListLock();
+	// a job already has the job list locked
+	const bool isJob = isJobThread();
 
-	// break thread out of poll
-	m_thread->unblockPollSocket();
+	if (m_pollSet != NULL) {
+		if (!isJob) {
+			lockJobListLock();
+			lockJobList();
+		}
 
-	// lock the job list
-	lockJobList();
+		CSocketEntryMap::iterator i = m_socketEntryMap.find(socket);
+		if (i != m_socketEntryMap.end()) {
+			retireEntry(i->second);
+		}
+
+		if (!isJob) {
+			unlockJobList();
+		}
+		return;
+	}
+
+	if (!isJob) {
+		// prevent other threads from locking the job list
+		lockJobListLock();
+
+		// break thread out of poll
+		m_thread->unblockPollSocket();
+
+		// lock the job list
+		lockJobList();
+	}
 
 	// remove job.  rather than removing it from the map we put NULL
 	// in the list instead so the order of jobs in the list continues
-	// to match the order of jobs in pfds in serviceThread().
+	// to match the order of jobs in pfds in serviceThread().  a job
+	// removed by another job is skipped for the rest of the pass and
+	// dropped from pfds before the next poll.
 	CSocketJobMap::iterator i = m_socketJobMap.find(socket);
 	if (i != m_socketJobMap.end()) {
 		if (*(i->second) != NULL) {
-			delete *(i->second);
+			deleteJob(*(i->second));
 			*(i->second) = NULL;
 			m_update     = true;
 		}
 	}
 
-	// unlock the job list
-	unlockJobList();
+	if (!isJob) {
+		// unlock the job list
+		unlockJobList();
+	}
 }
 
 void
 CSocketMultiplexer::serviceThread(void*)
 {
+	if (m_pollSet != NULL) {
+		servicePollSet();
+		return;
+	}
+
 	std::vector<IArchNetwork::CPollEntry> pfds;
+	std::vector<CJobCursor> pfdJobs;
 	IArchNetwork::CPollEntry pfd;
 
 	// service the connections
@@ -182,6 +263,8 @@ CSocketMultiplexer::serviceThread(void*)
 			m_update = false;
 			pfds.clear();
 			pfds.reserve(m_socketJobMap.size());
+			pfdJobs.clear();
+			pfdJobs.reserve(m_socketJobMap.size());
 
 			CJobCursor cursor    = newCursor();
 			CJobCursor jobCursor = nextCursor(cursor);
@@ -197,6 +280,7 @@ CSocketMultiplexer::serviceThread(void*)
 						pfd.m_events |= IArchNetwork::kPOLLOUT;
 					}
 					pfds.push_back(pfd);
+					pfdJobs.push_back(jobCursor);
 				}				
 				jobCursor = nextCursor(cursor);
 			}
@@ -219,38 +303,35 @@ CSocketMultiplexer::serviceThread(void*)
 		}
 
 		if (status != 0) {
-			// iterate over socket jobs, invoking each and saving the
-			// new job.
-			UInt32 i             = 0;
-			CJobCursor cursor    = newCursor();
-			CJobCursor jobCursor = nextCursor(cursor);
-			while (i < pfds.size() && jobCursor != m_socketJobs.end()) {
-				if (*jobCursor != NULL) {
-					// get poll state
-					unsigned short revents = pfds[i].m_revents;
-					bool read  = ((revents & IArchNetwork::kPOLLIN) != 0);
-					bool write = ((revents & IArchNetwork::kPOLLOUT) != 0);
-					bool error = ((revents & (IArchNetwork::kPOLLERR |
-											  IArchNetwork::kPOLLNVAL)) != 0);
-
-					// run job
-					ISocketMultiplexerJob* job    = *jobCursor;
-					ISocketMultiplexerJob* newJob = job->run(read, write, error);
-
-					// save job, if different
-					if (newJob != job) {
-						CLock lock(m_mutex);
-						delete job;
-						*jobCursor = newJob;
-						m_update   = true;
-					}
-					++i;
+			// invoke the job of each polled socket and save the new
+			// job.  list items are never erased while we hold the job
+			// list so the iterators saved with pfds are still valid.
+			for (UInt32 i = 0; i < pfds.size(); ++i) {
+				CJobCursor jobCursor       = pfdJobs[i];
+				ISocketMultiplexerJob* job = *jobCursor;
+				if (job == NULL) {
+					// removed by a job earlier in this pass
+					continue;
 				}
 
-				// next job
-				jobCursor = nextCursor(cursor);
+				// get poll state
+				unsigned short revents = pfds[i].m_revents;
+				bool read  = ((revents & IArchNetwork::kPOLLIN) != 0);
+				bool write = ((revents & IArchNetwork::kPOLLOUT) != 0);
+				bool error = ((revents & (IArchNetwork::kPOLLERR |
+										  IArchNetwork::kPOLLNVAL)) != 0);
+
+				// run job
+				ISocketMultiplexerJob* newJob = runJob(job, read, write, error);
+
+				// save job, if different and not removed while running
+				if (*jobCursor != NULL && newJob != job) {
+					CLock lock(m_mutex);
+					delete job;
+					*jobCursor = newJob;
+					m_update   = true;
+				}
 			}
-			deleteCursor(cursor);
 		}
 
 		// delete any removed socket jobs
@@ -270,6 +351,131 @@ CSocketMultiplexer::serviceThread(void*)
 	}
 }
 
+void
+CSocketMultiplexer::servicePollSet()
+{
+	IArchNetwork::CPollSetEvent events[64];
+
+	// service the connections
+	for (;;) {
+		CThread::testCancel();
+
+		// wait for ready sockets.  we don't hold the job list lock
+		// while waiting so other threads can change jobs freely.
+		int n;
+		try {
+			n = ARCH->waitPollSet(m_pollSet, events,
+							sizeof(events) / sizeof(events[0]), -1);
+		}
+		catch (XArchNetwork& e) {
+			LOG((CLOG_WARN "error in socket multiplexer: %s", e.what().c_str()));
+			n = 0;
+		}
+
+		// lock the job list
+		lockJobListLock();
+		lockJobList();
+
+		// run the jobs of the ready sockets
+		for (int i = 0; i < n; ++i) {
+			CJobEntry* entry           = static_cast<CJobEntry*>(events[i].m_data);
+			ISocketMultiplexerJob* job = entry->m_job;
+			if (job == NULL) {
+				// removed since the wait returned
+				continue;
+			}
+
+			// get poll state
+			unsigned short revents = events[i].m_revents;
+			bool read  = ((revents & IArchNetwork::kPOLLIN) != 0);
+			bool write = ((revents & IArchNetwork::kPOLLOUT) != 0);
+			bool error = ((revents & (IArchNetwork::kPOLLERR |
+									  IArchNetwork::kPOLLNVAL)) != 0);
+
+			// run job
+			ISocketMultiplexerJob* newJob = runJob(job, read, write, error);
+
+			// save job, if different and not removed while running
+			if (entry->m_job == NULL) {
+				continue;
+			}
+			if (newJob == NULL) {
+				retireEntry(entry);
+			}
+			else if (newJob != job) {
+				setEntryJob(entry, newJob);
+			}
+		}
+
+		// free entries that can no longer be returned by a wait
+		for (CJobEntries::iterator i = m_retiredEntries.begin();
+							i != m_retiredEntries.end(); ++i) {
+			delete *i;
+		}
+		m_retiredEntries.clear();
+
+		// unlock the job list
+		unlockJobList();
+	}
+}
+
+void
+CSocketMultiplexer::setEntryJob(CJobEntry* entry, ISocketMultiplexerJob* job)
+{
+	assert(job != NULL);
+
+	// the old job may hold the last reference to its socket so it must
+	// outlive the poll set update
+	ISocketMultiplexerJob* oldJob = entry->m_job;
+	entry->m_job = job;
+
+	try {
+		// a job may service a different socket than the one it replaces
+		CArchSocket socket = job->getSocket();
+		if (entry->m_archSocket != NULL && entry->m_archSocket != socket) {
+			ARCH->removePollSetSocket(m_pollSet, entry->m_archSocket);
+		}
+		entry->m_archSocket = socket;
+
+		unsigned short events = 0;
+		if (job->isReadable()) {
+			events |= IArchNetwork::kPOLLIN;
+		}
+		if (job->isWritable()) {
+			events |= IArchNetwork::kPOLLOUT;
+		}
+		ARCH->setPollSetSocket(m_pollSet, socket, events, entry);
+	}
+	catch (XArchNetwork& e) {
+		LOG((CLOG_WARN "error in socket multiplexer: %s", e.what().c_str()));
+	}
+
+	if (oldJob != job) {
+		delete oldJob;
+	}
+}
+
+void
+CSocketMultiplexer::retireEntry(CJobEntry* entry)
+{
+	try {
+		if (entry->m_archSocket != NULL) {
+			ARCH->removePollSetSocket(m_pollSet, entry->m_archSocket);
+		}
+	}
+	catch (XArchNetwork& e) {
+		LOG((CLOG_WARN "error in socket multiplexer: %s", e.what().c_str()));
+	}
+
+	// the job may hold the last reference to the socket
+	deleteJob(entry->m_job);
+	entry->m_job        = NULL;
+	entry->m_archSocket = NULL;
+
+	m_socketEntryMap.erase(entry->m_socket);
+	m_retiredEntries.push_back(entry);
+}
+
 CSocketMultiplexer::CJobCursor
 CSocketMultiplexer::newCursor()
 {
@@ -362,3 +568,43 @@ CSocketMultiplexer::unlockJobList()
 		m_jobsReady->signal();
 	}
 }
+
+bool
+CSocketMultiplexer::isJobThread() const
+{
+	CLock lock(m_mutex);
+	return (m_jobListLocker != NULL &&
+			*m_jobListLocker == CThread::getCurrentThread());
+}
+
+ISocketMultiplexerJob*
+CSocketMultiplexer::runJob(ISocketMultiplexerJob* job,
+				bool readable, bool writable, bool error)
+{
+	m_runningJob        = job;
+	m_runningJobRemoved = false;
+	ISocketMultiplexerJob* newJob = job->run(readable, writable, error);
+	m_runningJob        = NULL;
+
+	if (m_runningJobRemoved) {
+		// the job removed its own socket.  it's already gone from the
+		// job list so its return value doesn't matter.
+		if (newJob != job) {
+			delete newJob;
+		}
+		delete job;
+		return NULL;
+	}
+	return newJob;
+}
+
+void
+CSocketMultiplexer::deleteJob(ISocketMultiplexerJob* job)
+{
+	if (job != NULL && job == m_runningJob) {
+		m_runningJobRemoved = true;
+	}
+	else {
+		delete job;
+	}
+}
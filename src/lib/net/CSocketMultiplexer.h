@@ -22,6 +22,7 @@
 #include "IArchNetwork.h"
 #include "stdlist.h"
 #include "stdmap.h"
+#include "stdvector.h"
 
 template <class T>
 class CCondVar;
@@ -44,6 +45,12 @@ public:
 
 	void				addSocket(ISocket*, ISocketMultiplexerJob*);
 
+	//! Remove a socket
+	/*!
+	Stops servicing \c socket.  Jobs may call this for any socket,
+	including their own.  The socket is taken out of the set of polled
+	sockets before this returns.
+	*/
 	void				removeSocket(ISocket*);
 
 	//@}
@@ -63,12 +70,40 @@ private:
 	typedef CSocketJobs::iterator CJobCursor;
 	typedef std::map<ISocket*, CJobCursor> CSocketJobMap;
 
+	// a job registered in the poll set.  the poll set hands the entry
+	// back to us when the job's socket is ready.
+	class CJobEntry {
+	public:
+		ISocket*				m_socket;
+		ISocketMultiplexerJob*	m_job;
+		CArchSocket				m_archSocket;
+	};
+	typedef std::map<ISocket*, CJobEntry*> CSocketEntryMap;
+	typedef std::vector<CJobEntry*> CJobEntries;
+
 	// service sockets.  the service thread will only access m_sockets
 	// and m_update while m_pollable and m_polling are true.  all other
 	// threads must only modify these when m_pollable and m_polling are
 	// false.  only the service thread sets m_polling.
 	void				serviceThread(void*);
 
+	// service sockets using the poll set.  sockets stay registered in
+	// the poll set so other threads may change jobs without interrupting
+	// the wait and each pass only visits the ready jobs.  used instead
+	// of the poll() loop in serviceThread() when the platform supports
+	// poll sets.
+	void				servicePollSet();
+
+	// install a job for an entry and update its poll set registration.
+	// the job list must be locked.
+	void				setEntryJob(CJobEntry*, ISocketMultiplexerJob*);
+
+	// delete an entry's job and remove it from the poll set.  a wait
+	// that has already returned may still refer to the entry so it's
+	// only freed at the end of the service pass.  the job list must be
+	// locked.
+	void				retireEntry(CJobEntry*);
+
 	// create, iterate, and destroy a cursor.  a cursor is used to
 	// safely iterate through the job list while other threads modify
 	// the list.  it works by inserting a dummy item in the list and
@@ -95,6 +130,21 @@ private:
 	// unlock the job list and the lock out on locking.
 	void				unlockJobList();
 
+	// true iff called from a job.  jobs run on the service thread
+	// with the job list locked so they mustn't try to lock it.
+	bool				isJobThread() const;
+
+	// run a job and return the job to save for its socket, which is
+	// NULL if the job removed its own socket while running.  the job
+	// list must be locked.
+	ISocketMultiplexerJob*
+						runJob(ISocketMultiplexerJob*,
+							bool readable, bool writable, bool error);
+
+	// delete a removed job unless it's running, in which case runJob()
+	// deletes it when it returns.  the job list must be locked.
+	void				deleteJob(ISocketMultiplexerJob*);
+
 private:
 	CMutex*				m_mutex;
 	CThread*			m_thread;
@@ -108,6 +158,12 @@ private:
 	CSocketJobs			m_socketJobs;
 	CSocketJobMap		m_socketJobMap;
 	ISocketMultiplexerJob*	m_cursorMark;
+	ISocketMultiplexerJob*	m_runningJob;
+	bool				m_runningJobRemoved;
+
+	CArchPollSet		m_pollSet;
+	CSocketEntryMap		m_socketEntryMap;
+	CJobEntries			m_retiredEntries;
 
 	static CSocketMultiplexer*	s_instance;
 };
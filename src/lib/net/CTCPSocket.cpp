@@ -35,6 +35,14 @@
 // CTCPSocket
 //
 
+// most output buffer chunks passed to one writevSocket() call
+static const UInt32		kMaxWriteSegments = 16;
+
+// size of a normal read and the most we'll read at once when sizing a
+// read from the data the kernel has queued
+static const UInt32		kReadSize      = 4096;
+static const UInt32		kLargeReadSize = 1024 * 1024;
+
 CTCPSocket::CTCPSocket() :
 	m_mutex(),
 	m_flushed(&m_mutex, true)
@@ -459,10 +467,17 @@ CTCPSocket::serviceConnected(ISocketMultiplexerJob* job,
 
 	if (write) {
 		try {
-			// write data
-			UInt32 n = m_outputBuffer.getSize();
-			const void* buffer = m_outputBuffer.peek(n);
-			n = (UInt32)ARCH->writeSocket(m_socket, buffer, n);
+			// write as much data as we can in one call, straight from
+			// the output buffer's chunks
+			CStreamBuffer::CSegment segments[kMaxWriteSegments];
+			IArchNetwork::CSocketBuffer buffers[kMaxWriteSegments];
+			UInt32 count = m_outputBuffer.peekSegments(segments,
+							kMaxWriteSegments, m_outputBuffer.getSize());
+			for (UInt32 i = 0; i < count; ++i) {
+				buffers[i].m_data = segments[i].m_data;
+				buffers[i].m_size = segments[i].m_size;
+			}
+			UInt32 n = (UInt32)ARCH->writevSocket(m_socket, buffers, (int)count);
 
 			// discard written data
 			if (n > 0) {
@@ -504,15 +519,23 @@ CTCPSocket::serviceConnected(ISocketMultiplexerJob* job,
 
 	if (read && m_readable) {
 		try {
-			UInt8 buffer[4096];
-			size_t n = ARCH->readSocket(m_socket, buffer, sizeof(buffer));
+			bool wasEmpty = (m_inputBuffer.getSize() == 0);
+			UInt32 size   = kReadSize;
+			UInt32 n      = readInput(size);
 			if (n > 0) {
-				bool wasEmpty = (m_inputBuffer.getSize() == 0);
-
-				// slurp up as much as possible
+				// slurp up as much as possible.  a read that fills its
+				// space means more is waiting so switch to reads sized
+				// from what the kernel has queued.  that way a large
+				// transfer (e.g. a clipboard) takes a few big reads.
 				do {
-					m_inputBuffer.write(buffer, (UInt32)n);
-					n = ARCH->readSocket(m_socket, buffer, sizeof(buffer));
+					if (n == size) {
+						size_t avail = ARCH->getReadableSizeOnSocket(m_socket);
+						if (avail > kLargeReadSize) {
+							avail = kLargeReadSize;
+						}
+						size = (avail > kReadSize) ? (UInt32)avail : kReadSize;
+					}
+					n = readInput(size);
 				} while (n > 0);
 
 				// send input ready if input buffer was empty
@@ -547,3 +570,22 @@ CTCPSocket::serviceConnected(ISocketMultiplexerJob* job,
 
 	return needNewJob ? newJob() : job;
 }
+
+UInt32
+CTCPSocket::readInput(UInt32 size)
+{
+	// note -- must have m_mutex locked on entry
+
+	// read straight into the input buffer's free space
+	void* buffer = m_inputBuffer.reserve(size);
+	size_t n;
+	try {
+		n = ARCH->readSocket(m_socket, buffer, size);
+	}
+	catch (...) {
+		m_inputBuffer.commit(0);
+		throw;
+	}
+	m_inputBuffer.commit((UInt32)n);
+	return (UInt32)n;
+}
@@ -69,6 +69,9 @@ private:
 	void				onOutputShutdown();
 	void				onDisconnected();
 
+	// read up to size bytes from the socket into the input buffer
+	UInt32				readInput(UInt32 size);
+
 	ISocketMultiplexerJob*
 						serviceConnecting(ISocketMultiplexerJob*,
 							bool, bool, bool);
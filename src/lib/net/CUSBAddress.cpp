@@ -72,10 +72,10 @@ bool UsbDeviceType::isCompatible() const {
 bool CUSBAddress::resolve() {
 	bool result = false;
 	USBDeviceEnumerator* devices;
-	size_t count = ARCH->usbGetDeviceList(&devices);
+	size_t count = ARCH->usb().usbGetDeviceList(&devices);
 	USBDeviceInfo info;
 	for(; !result && count--; ) {
-		ARCH->usbGetDeviceInfo(devices[count], info);
+		ARCH->usb().usbGetDeviceInfo(devices[count], info);
 		result = info.idVendor == vendorId && info.idProduct==productId && info.validEndpointInfo &&
 			(fullPathSpecified ? info.busNumber == busNumber && info.deviceAddress == deviceAddress : true);
 		if( result ){
@@ -85,7 +85,7 @@ bool CUSBAddress::resolve() {
 
 	if(fullPathSpecified && !result) {
 		fullPathSpecified = false;
-		ARCH->usbFreeDeviceList(devices);
+		ARCH->usb().usbFreeDeviceList(devices);
 		return resolve();
 	}
 
@@ -97,19 +97,19 @@ bool CUSBAddress::resolve() {
 		outputEndpoint = info.outputEndpoint;
 	}
 
-	ARCH->usbFreeDeviceList(devices);
+	ARCH->usb().usbFreeDeviceList(devices);
 	return result;
 }
 
 CString CUSBAddress::getConnectedCompatibleDeviceNames() {
 
 	USBDeviceEnumerator* devices;
-	size_t count = ARCH->usbGetDeviceList(&devices);
+	size_t count = ARCH->usb().usbGetDeviceList(&devices);
 
 	unsigned compatibleDevicesCount = 0;
 	for( size_t i = 0; i < count; i++ ) {
 		USBDeviceInfo info;
-		ARCH->usbGetDeviceInfo(devices[i], info);
+		ARCH->usb().usbGetDeviceInfo(devices[i], info);
 		UsbDeviceType deviceTypeConnected(info.idVendor, info.idProduct);
 		if(deviceTypeConnected.isCompatible())
 			++compatibleDevicesCount;
@@ -119,7 +119,7 @@ CString CUSBAddress::getConnectedCompatibleDeviceNames() {
 	std::stringstream ss;
 	for( size_t i = 0; i < count; i++ ) {
 		USBDeviceInfo info;
-		ARCH->usbGetDeviceInfo(devices[i], info);
+		ARCH->usb().usbGetDeviceInfo(devices[i], info);
 		UsbDeviceType deviceTypeConnected(info.idVendor, info.idProduct);
 		if(deviceTypeConnected.isCompatible()) {
 			if(showShortName) {
@@ -131,7 +131,7 @@ CString CUSBAddress::getConnectedCompatibleDeviceNames() {
 		}
 	}
 
-	ARCH->usbFreeDeviceList(devices);
+	ARCH->usb().usbFreeDeviceList(devices);
 
 	return ss.str();
 }
@@ -0,0 +1,169 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CUSBBufferPool.h"
+#include "CLock.h"
+#include "CMutex.h"
+#include "CArch.h"
+#include "CArchAtomic.h"
+#include <assert.h>
+
+// number of packets in a transfer buffer
+static const UInt32		kPacketsPerTransfer = 64;
+
+// packet size to assume when the endpoint descriptor wasn't read
+static const UInt32		kDefaultPacketSize = 512;
+
+// most bytes of free buffers to keep.  enough for the writes of a few
+// busy links with default size packets.
+static const UInt32		kMaxFreeBytes = 16 * kPacketsPerTransfer *
+											kDefaultPacketSize;
+
+//
+// CUSBBufferPool
+//
+
+volatile SInt32			CUSBBufferPool::s_instanceLock = 0;
+CUSBBufferPool*			CUSBBufferPool::s_instance = NULL;
+UInt32					CUSBBufferPool::s_refCount = 0;
+
+CUSBBufferPool::CUSBBufferPool() :
+	m_mutex(new CMutex),
+	m_freeBytes(0),
+	m_borrowed(0)
+{
+	// do nothing
+}
+
+CUSBBufferPool::~CUSBBufferPool()
+{
+	assert(m_borrowed == 0);
+
+	for (CBufferMap::iterator i = m_freeBuffers.begin();
+							i != m_freeBuffers.end(); ++i) {
+		CBufferList& buffers = i->second;
+		for (CBufferList::iterator j = buffers.begin();
+							j != buffers.end(); ++j) {
+			delete[] *j;
+		}
+	}
+	delete m_mutex;
+}
+
+CUSBBufferPool*
+CUSBBufferPool::getInstance()
+{
+	lockInstance();
+	if (s_instance == NULL) {
+		assert(s_refCount == 0);
+		try {
+			s_instance = new CUSBBufferPool;
+		}
+		catch (...) {
+			unlockInstance();
+			throw;
+		}
+	}
+	++s_refCount;
+	CUSBBufferPool* pool = s_instance;
+	unlockInstance();
+	return pool;
+}
+
+void
+CUSBBufferPool::release()
+{
+	CUSBBufferPool* pool = NULL;
+
+	lockInstance();
+	assert(s_instance != NULL);
+	assert(s_refCount > 0);
+	if (--s_refCount == 0) {
+		pool       = s_instance;
+		s_instance = NULL;
+	}
+	unlockInstance();
+
+	// nobody else can reach the pool now
+	delete pool;
+}
+
+unsigned char*
+CUSBBufferPool::acquireBuffer(UInt32 size)
+{
+	assert(size > 0);
+
+	CLock lock(m_mutex);
+	++m_borrowed;
+
+	CBufferList& buffers = m_freeBuffers[size];
+	if (buffers.empty()) {
+		return new unsigned char[size];
+	}
+
+	unsigned char* buffer = buffers.back();
+	buffers.pop_back();
+	m_freeBytes -= size;
+	return buffer;
+}
+
+void
+CUSBBufferPool::releaseBuffer(unsigned char* buffer, UInt32 size)
+{
+	assert(buffer != NULL);
+
+	CLock lock(m_mutex);
+	assert(m_borrowed > 0);
+	--m_borrowed;
+
+	if (m_freeBytes + size > kMaxFreeBytes) {
+		delete[] buffer;
+		return;
+	}
+	m_freeBuffers[size].push_back(buffer);
+	m_freeBytes += size;
+}
+
+UInt32
+CUSBBufferPool::getTransferSize(int maxPacketSize)
+{
+	UInt32 packetSize = kDefaultPacketSize;
+	if (maxPacketSize > 0) {
+		packetSize = static_cast<UInt32>(maxPacketSize);
+	}
+	return packetSize * kPacketsPerTransfer;
+}
+
+UInt32
+CUSBBufferPool::getMaxFreeBytes()
+{
+	return kMaxFreeBytes;
+}
+
+void
+CUSBBufferPool::lockInstance()
+{
+	while (!CArchAtomic::compareAndSwap(&s_instanceLock, 0, 1)) {
+		ARCH->sleep(0.0);
+	}
+}
+
+void
+CUSBBufferPool::unlockInstance()
+{
+	CArchAtomic::store(&s_instanceLock, 0);
+}
@@ -0,0 +1,115 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUSBBUFFERPOOL_H
+#define CUSBBUFFERPOOL_H
+
+#include "BasicTypes.h"
+#include "stdmap.h"
+#include "stdvector.h"
+
+class CMutex;
+
+//! USB transfer buffer pool
+/*!
+Buffers for bulk transfers are shared by every USB data link in the
+process.  A link borrows a buffer for each transfer it submits and
+returns it when the transfer completes.  Write buffers are therefore
+only held while there's data to send but every queued read holds one
+for as long as the link is open.  The pool grows on demand and keeps
+up to getMaxFreeBytes() of returned buffers for reuse;  the rest are
+freed.  Everything is freed when the last link lets go of the pool.
+*/
+class CUSBBufferPool {
+public:
+	//! @name manipulators
+	//@{
+
+	//! Get the shared pool
+	/*!
+	Returns the pool, creating it if necessary.  Each call must be
+	balanced by a call to release().  Safe to call from any thread.
+	*/
+	static CUSBBufferPool*
+						getInstance();
+
+	//! Release the shared pool
+	/*!
+	Releases a reference taken by getInstance().  The pool and every
+	buffer it holds are freed when the last reference goes away.  All
+	borrowed buffers must have been returned by then.  Safe to call
+	from any thread.
+	*/
+	static void			release();
+
+	//! Borrow a buffer
+	/*!
+	Returns a buffer of \c size bytes, allocating one if none is free.
+	*/
+	unsigned char*		acquireBuffer(UInt32 size);
+
+	//! Return a buffer
+	/*!
+	Returns a buffer obtained from acquireBuffer() with the same \c size.
+	The buffer is kept for reuse unless the pool already holds
+	getMaxFreeBytes() of free buffers, in which case it's freed.
+	*/
+	void				releaseBuffer(unsigned char* buffer, UInt32 size);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Get transfer size for an endpoint
+	/*!
+	Returns the size of a transfer buffer for a bulk endpoint with the
+	given maximum packet size.  The result is always a whole number of
+	packets so a read can never end mid-packet and overflow.
+	*/
+	static UInt32		getTransferSize(int maxPacketSize);
+
+	//! Get free buffer limit
+	/*!
+	Returns the most bytes of free buffers the pool keeps for reuse.
+	*/
+	static UInt32		getMaxFreeBytes();
+
+	//@}
+
+private:
+	CUSBBufferPool();
+	~CUSBBufferPool();
+
+	typedef std::vector<unsigned char*> CBufferList;
+	typedef std::map<UInt32, CBufferList> CBufferMap;
+
+	// lock s_instance and s_refCount.  there's nowhere to create a
+	// mutex for them before the first link is created so this spins.
+	static void			lockInstance();
+	static void			unlockInstance();
+
+	static volatile SInt32	s_instanceLock;
+	static CUSBBufferPool*	s_instance;
+	static UInt32		s_refCount;
+
+	CMutex*				m_mutex;
+	CBufferMap			m_freeBuffers;
+	UInt32				m_freeBytes;
+	UInt32				m_borrowed;
+};
+
+#endif
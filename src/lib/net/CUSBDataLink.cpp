@@ -25,24 +25,15 @@
 #include "CStopwatch.h"
 #include "CUSBDataLink.h"
 #include "CUSBAddress.h"
+#include "CUSBBufferPool.h"
 
 const char*		kUsbConnect	= "USB_CONNECT";
 const char*		kUsbAccept	= "USB_ACCEPT";
 const char*		kUsbReject	= "USB_REJECT";
 
 const unsigned int	TRANSFER_TIMEOUT = 2*1000;
-
-enum message_id {
-	MSGID_HANDSHAKE		= 0,
-	MSGID_NORMAL		= 1,
-	MSGID_DISCONNECT	= 2,
-	MSGID_LAST			= MSGID_DISCONNECT
-};
-
-struct message_hdr {
-	message_id		id;
-	unsigned int	data_size;
-};
+const UInt32		TRANSFER_QUEUE_DEPTH = 4;
+const double		COALESCE_DEADLINE = 0.002;
 
 CEvent::Type CUSBDataLink::s_deletingEvent = CEvent::kUnknown;
 
@@ -53,8 +44,10 @@ CEvent::Type CUSBDataLink::s_deletingEvent = CEvent::kUnknown;
 CUSBDataLink::CUSBDataLink() :
 	m_listener(NULL),
 	m_device(NULL),
-	m_transferRead(NULL),
-	m_transferWrite(NULL),
+	m_queueDepth(TRANSFER_QUEUE_DEPTH),
+	m_bufferPool(CUSBBufferPool::getInstance()),
+	m_readSize(0),
+	m_writeSize(0),
 	m_mutex(),
 	m_flushed(&m_mutex, true),
 	m_connected(false),
@@ -62,11 +55,11 @@ CUSBDataLink::CUSBDataLink() :
 	m_writable(false),
 	m_acceptedFlag(&m_mutex, false),
 	m_activeTransfers(&m_mutex, 0),
-    m_writeBuffer(NULL),
-    m_writeBufferSize(0),
-    m_writeBufferSent(0),
 	m_leftToWrite(0),
-	m_leftToRead(0)
+	m_leftToRead(0),
+	m_readHeaderSize(0),
+	m_coalesceSize(0),
+	m_coalesceDeadline(COALESCE_DEADLINE)
 {
 	memset(&m_config, 0, sizeof(m_config));
 }
@@ -87,6 +80,27 @@ CUSBDataLink::~CUSBDataLink()
 		EVENTQUEUE->addEvent(CEvent(getDeletingEvent(), m_listener, this, CEvent::kDontFreeData));
 		m_listener = NULL;
 	}
+
+	CUSBBufferPool::release();
+}
+
+void
+CUSBDataLink::setTransferQueueDepth(UInt32 depth)
+{
+	assert(depth > 0);
+
+	CLock lock(&m_mutex);
+	m_queueDepth = depth;
+}
+
+void
+CUSBDataLink::setCoalescing(UInt32 size, double deadline)
+{
+	assert(deadline >= 0.0);
+
+	CLock lock(&m_mutex);
+	m_coalesceSize     = size;
+	m_coalesceDeadline = deadline;
 }
 
 
@@ -111,17 +125,15 @@ CUSBDataLink::connect(const CBaseAddress& addr)
 		CLock lock(&m_mutex);
 
 		CStopwatch stopwatch(false);
-		bool bCancelled = false;
 
 		LOG((CLOG_DEBUG "USB datalink: wait for connection to be accepted..."));
 		while (m_acceptedFlag == false) {
 			m_acceptedFlag.wait(2.0);
 
-			if (!bCancelled && !m_acceptedFlag && (stopwatch.getTime() > 2.0))
+			if (!m_acceptedFlag && (stopwatch.getTime() > 2.0))
 			{
 				LOG((CLOG_DEBUG "USB datalink: connection accepting timeout"));
-				libusb_cancel_transfer(m_transferRead);
-				bCancelled = true;
+				cancelTransfers(m_readQueue);
 				break;
 			}
 		}
@@ -187,16 +199,16 @@ CUSBDataLink::close()
 		onDisconnect();
 	}
 
-	// Cancel active transfers.
-	// If there was no transfer yet, than dev_handle == 0 and we should not call libusb_cancel_transfer because it causes AV in this case.
-	if (m_transferRead && m_transferRead->dev_handle) {
+	// cancel active transfers.  only transfers that are still in flight
+	// may be cancelled.
+	if (!m_readSlots.empty()) {
 		onInputShutdown();
-		libusb_cancel_transfer(m_transferRead);
+		cancelTransfers(m_readQueue);
 	}
 
-	if (m_transferWrite && m_transferWrite->dev_handle) {
+	if (!m_writeSlots.empty()) {
 		onOutputShutdown();
-		libusb_cancel_transfer(m_transferWrite);
+		cancelTransfers(m_writeQueue);
 	}
 	
 	// wait for transfers to finish
@@ -204,19 +216,11 @@ CUSBDataLink::close()
 		m_activeTransfers.wait();
 	}
 	
-	if (m_transferRead)	{
-		libusb_free_transfer(m_transferRead);
-		m_transferRead = NULL;
-	}
-
-	if (m_transferWrite) {
-		libusb_free_transfer(m_transferWrite);
-		m_transferWrite = NULL;
-	}
+	freeTransferSlots();
 
 	// close the usb device
 	if (m_device) {
-		ARCH->usbCloseDevice(m_device, m_config.ifid);
+		ARCH->usb().usbCloseDevice(m_device, m_config.ifid);
 		m_device = NULL;
 	}
 }
@@ -359,7 +363,7 @@ CUSBDataLink::initConnection(const CBaseAddress& addr)
 
 	try 
 	{
-		m_device = ARCH->usbOpenDevice(m_config, m_config.ifid);	
+		m_device = ARCH->usb().usbOpenDevice(m_config, m_config.ifid);	
 		if (!m_device) {
 			usbAddress.resolve();
 
@@ -371,38 +375,30 @@ CUSBDataLink::initConnection(const CBaseAddress& addr)
 			m_config.bulkin = usbAddress.GetIDBulkIN();
 			m_config.bulkout = usbAddress.GetIDBulkOut();
 
-			m_device = ARCH->usbOpenDevice(m_config, m_config.ifid);	
+			m_device = ARCH->usb().usbOpenDevice(m_config, m_config.ifid);	
 			if (!m_device) 
 				throw XSocketConnect("Open device failed");
 		}
 
-		m_transferRead = libusb_alloc_transfer(0);
-		if (!m_transferRead) {
-			throw XSocketConnect("alloc read transfer failed");
+		// size transfers in whole packets of the endpoints we talk to
+		m_readSize  = CUSBBufferPool::getTransferSize(
+								m_config.inputEndpointMaxPacketSize);
+		m_writeSize = CUSBBufferPool::getTransferSize(
+								m_config.outputEndpointMaxPacketSize);
+
+		for (UInt32 i = 0; i < m_queueDepth; ++i) {
+			newTransferSlot(m_readSlots);
+			newTransferSlot(m_writeSlots);
 		}
-		m_transferRead->dev_handle = 0;
-		
-		m_transferWrite = libusb_alloc_transfer(0);
-		if (!m_transferWrite) {
-			throw XSocketConnect("alloc write transfer failed");
-		}		
-		m_transferWrite->dev_handle = 0;
+		m_freeWriteSlots = m_writeSlots;
 	} 
 	catch (...) 
 	{
-		if (m_transferRead)	{
-			libusb_free_transfer(m_transferRead);
-			m_transferRead = NULL;
-		}
-
-		if (m_transferWrite) {
-			libusb_free_transfer(m_transferWrite);
-			m_transferWrite = NULL;
-		}
+		freeTransferSlots();
 
 		// close the usb device
 		if (m_device) {
-			ARCH->usbCloseDevice(m_device, m_config.ifid);
+			ARCH->usb().usbCloseDevice(m_device, m_config.ifid);
 			m_device = NULL;
 		}
 
@@ -411,252 +407,455 @@ CUSBDataLink::initConnection(const CBaseAddress& addr)
 
 	m_readable = true;
 	m_writable = true;
+	m_leftToRead = 0;
+	m_leftToWrite = 0;
+	m_readHeaderSize = 0;
+	m_outputFrames.clear();
+
+	// start polling input endpoint.  keep every read transfer queued so
+	// the host controller always has a buffer to fill.
+	for (CTransferSlots::iterator i = m_readSlots.begin();
+							i != m_readSlots.end(); ++i) {
+		if (!submitRead(*i)) {
+			onDisconnect();
+			break;
+		}
+	}
+}
 
-	// Start pooling input endpoint.
-	m_activeTransfers = m_activeTransfers + 1;
-	m_transferRead->status = LIBUSB_TRANSFER_COMPLETED;
-	m_transferRead->actual_length = 0;
-	m_transferRead->user_data = this;
-	readCallback(m_transferRead);
+CUSBDataLink::CTransferSlot*
+CUSBDataLink::newTransferSlot(CTransferSlots& slots)
+{
+	CTransferSlot* slot = new CTransferSlot;
+	slot->m_link       = this;
+	slot->m_transfer   = NULL;
+	slot->m_buffer     = NULL;
+	slot->m_bufferSize = 0;
+	slot->m_active     = false;
+	slots.push_back(slot);
+
+	try {
+		slot->m_transfer = ARCH->usb().usbAllocTransfer();
+	}
+	catch (XArchNetwork&) {
+		throw XSocketConnect("alloc transfer failed");
+	}
+	slot->m_transfer->m_userData = slot;
+
+	return slot;
 }
 
-void CUSBDataLink::scheduleWrite()
+void
+CUSBDataLink::freeTransferSlots()
 {
-	// No active write transfers at this moment. Call writeCallback to start new write transfer.
-	assert(m_activeTransfers < 2);
+	assert(m_activeTransfers == 0);
+
+	for (CTransferSlots::iterator i = m_readSlots.begin();
+							i != m_readSlots.end(); ++i) {
+		m_writeSlots.push_back(*i);
+	}
+	for (CTransferSlots::iterator i = m_writeSlots.begin();
+							i != m_writeSlots.end(); ++i) {
+		if ((*i)->m_buffer != NULL) {
+			releaseBuffer(*i);
+		}
+		if ((*i)->m_transfer) {
+			ARCH->usb().usbFreeTransfer((*i)->m_transfer);
+		}
+		delete *i;
+	}
+
+	m_readSlots.clear();
+	m_writeSlots.clear();
+	m_freeWriteSlots.clear();
+	m_readQueue.clear();
+	m_writeQueue.clear();
+}
+
+void
+CUSBDataLink::cancelTransfers(const CTransferQueue& queue)
+{
+	for (CTransferQueue::const_iterator i = queue.begin();
+							i != queue.end(); ++i) {
+		if ((*i)->m_active) {
+			ARCH->usb().usbCancelTransfer((*i)->m_transfer);
+		}
+	}
+}
+
+void
+CUSBDataLink::acquireBuffer(CTransferSlot* slot, UInt32 size)
+{
+	assert(slot->m_buffer == NULL);
+
+	slot->m_buffer     = m_bufferPool->acquireBuffer(size);
+	slot->m_bufferSize = size;
+}
+
+void
+CUSBDataLink::releaseBuffer(CTransferSlot* slot)
+{
+	m_bufferPool->releaseBuffer(slot->m_buffer, slot->m_bufferSize);
+	slot->m_buffer     = NULL;
+	slot->m_bufferSize = 0;
+}
+
+bool
+CUSBDataLink::submitRead(CTransferSlot* slot)
+{
+	acquireBuffer(slot, m_readSize);
+
+	USBTransfer* transfer = slot->m_transfer;
+	transfer->m_device     = m_device;
+	transfer->m_endpoint   = m_config.bulkin;
+	transfer->m_buffer     = slot->m_buffer;
+	transfer->m_length     = m_readSize;
+	transfer->m_timeout    = 0;
+	transfer->m_zeroPacket = false;
+	transfer->m_callback   = &CUSBDataLink::readCallback;
+
+	if (!ARCH->usb().usbSubmitTransfer(transfer)) {
+		releaseBuffer(slot);
+		return false;
+	}
+
+	slot->m_active = true;
+	m_readQueue.push_back(slot);
 	m_activeTransfers = m_activeTransfers + 1;
+	return true;
+}
 
-	m_transferWrite->status = LIBUSB_TRANSFER_COMPLETED;
-	m_transferWrite->actual_length = 0;
-	m_transferWrite->user_data = this;
-	writeCallback(m_transferWrite);
+UInt32
+CUSBDataLink::packFrames()
+{
+	assert(!m_outputFrames.empty());
+
+	UInt32 limit = m_coalesceSize;
+	if (limit > m_writeSize) {
+		limit = m_writeSize;
+	}
+
+	// send messages one per transfer when not coalescing or when the
+	// next message can't be coalesced anyway
+	UInt32 size = m_outputFrames.front().m_size;
+	if (size >= limit) {
+		m_outputFrames.pop_front();
+		return size;
+	}
+
+	// take as many whole messages as fit
+	size = 0;
+	COutputFrames::iterator i = m_outputFrames.begin();
+	while (i != m_outputFrames.end() && size + i->m_size <= limit) {
+		size += i->m_size;
+		++i;
+	}
+
+	// if the transfer isn't full and another transfer is in flight then
+	// wait for more messages, up to the deadline.  the completion of the
+	// transfer in flight will try again.
+	if (i == m_outputFrames.end() && size < limit && !m_writeQueue.empty() &&
+		ARCH->time() - m_outputFrames.front().m_time < m_coalesceDeadline) {
+		return 0;
+	}
+
+	m_outputFrames.erase(m_outputFrames.begin(), i);
+	return size;
 }
 
-void CUSBDataLink::readCallback(libusb_transfer *transfer)
+bool
+CUSBDataLink::scheduleWrites()
 {
-	CUSBDataLink* this_ = reinterpret_cast<CUSBDataLink*>(transfer->user_data);
+	// hand the output buffer to every idle write transfer.  a message
+	// too big to coalesce starts a new transfer and is split into pieces
+	// of whole packets.  otherwise whole messages are packed together.
+	while (!m_freeWriteSlots.empty() && m_outputBuffer.getSize() > 0) {
+		if (m_leftToWrite == 0) {
+			m_leftToWrite = packFrames();
+			if (m_leftToWrite == 0) {
+				// hold the frames for a later transfer
+				break;
+			}
+		}
+
+		UInt32 n = m_leftToWrite;
+		if (n > m_writeSize) {
+			n = m_writeSize;
+		}
+
+		CTransferSlot* slot = m_freeWriteSlots.back();
+		acquireBuffer(slot, m_writeSize);
+		memcpy(slot->m_buffer, m_outputBuffer.peek(n), n);
+
+		// bulk reads only end early on a short packet so end a write of
+		// whole packets with an empty one
+		USBTransfer* transfer = slot->m_transfer;
+		transfer->m_device     = m_device;
+		transfer->m_endpoint   = m_config.bulkout;
+		transfer->m_buffer     = slot->m_buffer;
+		transfer->m_length     = n;
+		transfer->m_timeout    = TRANSFER_TIMEOUT;
+		transfer->m_zeroPacket = (m_config.outputEndpointMaxPacketSize > 0 &&
+			n % m_config.outputEndpointMaxPacketSize == 0);
+		transfer->m_callback   = &CUSBDataLink::writeCallback;
+
+		if (!ARCH->usb().usbSubmitTransfer(transfer)) {
+			LOG((CLOG_DEBUG "USB datalink: failed to write packet"));
+			releaseBuffer(slot);
+			return false;
+		}
+
+		m_outputBuffer.pop(n);
+		m_leftToWrite -= n;
+
+		m_freeWriteSlots.pop_back();
+		slot->m_active = true;
+		m_writeQueue.push_back(slot);
+		m_activeTransfers = m_activeTransfers + 1;
+	}
+
+	return true;
+}
+
+void CUSBDataLink::readCallback(USBTransfer* transfer)
+{
+	CTransferSlot* slot = reinterpret_cast<CTransferSlot*>(transfer->m_userData);
+	CUSBDataLink* this_ = slot->m_link;
 
 	CLock lock(&this_->m_mutex);
 
 	this_->m_activeTransfers = this_->m_activeTransfers - 1;
+	slot->m_active = false;
 	if (!this_->m_readable)
 	{
 		this_->m_activeTransfers.signal();
 		return;
 	}
 
-	switch (transfer->status)
+	// transfers can complete out of order.  consume them strictly in
+	// submission order so the byte stream is reassembled correctly and
+	// resubmit each one as soon as its data is taken.
+	while (!this_->m_readQueue.empty() && !this_->m_readQueue.front()->m_active)
 	{
-	case LIBUSB_TRANSFER_COMPLETED:
+		slot = this_->m_readQueue.front();
+		this_->m_readQueue.pop_front();
+
+		bool readable = this_->readTransfer(slot->m_transfer);
+		this_->releaseBuffer(slot);
+		if (!readable) {
+			return;
+		}
+
+		if (!this_->submitRead(slot)) {
+			this_->onDisconnect();
+			return;
+		}
+	}
+}
+
+bool
+CUSBDataLink::readTransfer(USBTransfer* transfer)
+{
+	switch (transfer->m_status)
+	{
+	case USBTransfer::kCompleted:
 		break;
 	
-	case LIBUSB_TRANSFER_CANCELLED:
-		if (!this_->m_acceptedFlag)
+	case USBTransfer::kCancelled:
+		if (!m_connected && m_listener == NULL)
 		{
-			LOG((CLOG_DEBUG "USB datalink: accept waiting cancelled"));
-			this_->m_acceptedFlag = true;
-			this_->m_acceptedFlag.broadcast();
+			// connect() gave up waiting for the accept message
+			if (!m_acceptedFlag)
+			{
+				LOG((CLOG_DEBUG "USB datalink: accept waiting cancelled"));
+				m_acceptedFlag = true;
+				m_acceptedFlag.broadcast();
+			}
 			break;
 		}
 		// go to default here
 
 	default:
-		this_->onDisconnect();
-		return;
+		onDisconnect();
+		return false;
 	}
 
 
-	size_t n = transfer->actual_length;
-	if (n > 0) 
-	{	
-		bool checkHeader = false;
+	// a transfer may carry any number of frames and may begin or end
+	// part way through a frame, or even part way through its header.
+	size_t n = transfer->m_actualLength;
+	char* data_ptr = reinterpret_cast<char*>(transfer->m_buffer);
+	bool frameDone = false;
 
-		message_hdr hdr;
-		char* data_ptr = this_->m_readBuffer;
-
-		while (n > 0) 
+	while (n > 0) 
+	{
+		if (m_readHeaderSize < sizeof(message_hdr))
 		{
-			if (!this_->m_leftToRead)
+			size_t count = sizeof(message_hdr) - m_readHeaderSize;
+			if (count > n)
 			{
-				assert(n >= sizeof(hdr));
-			
-				memcpy(&hdr, data_ptr, sizeof(hdr));
-				n -= sizeof(hdr);
-				data_ptr += sizeof(hdr);
-				this_->m_leftToRead = hdr.data_size;
-
-				if (static_cast<unsigned>(hdr.id) > MSGID_LAST)
-				{
-					LOG((CLOG_ERR "USB datalink: invalid data packet. Unknown MSGID"));
-					this_->onDisconnect();
-					return;
-				}
+				count = n;
+			}
 
-				checkHeader = hdr.id != MSGID_NORMAL;
+			memcpy(reinterpret_cast<char*>(&m_readHeader) + m_readHeaderSize, data_ptr, count);
+			m_readHeaderSize += count;
+			n -= count;
+			data_ptr += count;
 
-				// if we check header after collecting data, than all the buffer must be sent within this transfer
-				assert(!checkHeader || hdr.data_size <= n);
-                if (checkHeader && hdr.data_size > n)
-                {
-					LOG((CLOG_ERR "USB datalink: invalid data packet. Data size is too big."));
-					this_->onDisconnect();
-					return;
-                }
+			if (m_readHeaderSize < sizeof(message_hdr))
+			{
+				break;
 			}
 
-			size_t chunkSize = this_->m_leftToRead;
-			if (chunkSize > n)
+			if (static_cast<unsigned>(m_readHeader.id) > MSGID_LAST)
 			{
-				chunkSize = n;
+				LOG((CLOG_ERR "USB datalink: invalid data packet. Unknown MSGID"));
+				onDisconnect();
+				return false;
 			}
 
-			this_->m_inputBuffer.write(data_ptr, chunkSize);
+			m_leftToRead = m_readHeader.data_size;
+		}
+
+		size_t chunkSize = m_leftToRead;
+		if (chunkSize > n)
+		{
+			chunkSize = n;
+		}
+
+		m_inputBuffer.write(data_ptr, chunkSize);
 
-			assert(this_->m_leftToRead >= chunkSize);
-			this_->m_leftToRead -= chunkSize;
-			n -= chunkSize;
-			data_ptr += chunkSize;
+		assert(m_leftToRead >= chunkSize);
+		m_leftToRead -= chunkSize;
+		n -= chunkSize;
+		data_ptr += chunkSize;
 
-			if (!this_->m_leftToRead && checkHeader) 
+		if (m_leftToRead > 0)
+		{
+			continue;
+		}
+
+		// frame is complete.  control frames are checked only once all
+		// of their data has arrived.
+		m_readHeaderSize = 0;
+		frameDone = true;
+
+		switch (m_readHeader.id)
+		{
+		case MSGID_HANDSHAKE:
+			if (m_connected)
 			{
-				switch (hdr.id)
+				LOG((CLOG_ERR "USB datalink: unexpected handshake packet"));
+				onDisconnect();
+				return false;
+			}
+			else if (m_acceptedFlag)
+			{
+				// server got handshake request. remove any previously read data.
+				LOG((CLOG_DEBUG "USB datalink: server got handshake packet"));
+				m_inputBuffer.pop(m_inputBuffer.getSize() - m_readHeader.data_size);
+			}
+			else
+			{
+				// take the reply straight from the buffer.  read() would
+				// lock the mutex we already hold.
+				UInt32 size = m_inputBuffer.getSize();
+				std::string buf(reinterpret_cast<const char*>(
+									m_inputBuffer.peek(size)), size);
+				m_inputBuffer.pop(size);
+
+				if (buf == kUsbAccept)
+				{
+					LOG((CLOG_DEBUG "USB datalink: connection accept detected"));
+					m_connected = true;	
+				}
+				else
 				{
-				case MSGID_HANDSHAKE:
-					if (this_->m_connected)
-					{
-						LOG((CLOG_ERR "USB datalink: unexpected handshake packet"));
-						this_->onDisconnect();
-						return;
-					}
-					else if (this_->m_acceptedFlag)
-					{
-						// server got handshake request. remove any previously read data.
-						LOG((CLOG_DEBUG "USB datalink: server got handshake packet"));
-						this_->m_inputBuffer.pop(this_->m_inputBuffer.getSize() - hdr.data_size);
-					}
-					else
-					{
-						std::string buf("");
-						buf.resize(this_->m_inputBuffer.getSize(), 0);
-						this_->read((void*)buf.c_str(), buf.size());
-
-						if (buf == kUsbAccept)
-						{
-							LOG((CLOG_DEBUG "USB datalink: connection accept detected"));
-							this_->m_connected = true;	
-						}
-						else
-						{
-							LOG((CLOG_ERR "USB datalink: unexpected data during handshake, connection is not accepted"));	
-							// Just skip setting m_connected in this case. "Connect" funcion detects this and drops exception
-						}
-
-						this_->m_acceptedFlag = true;
-						this_->m_acceptedFlag.broadcast();
-
-						if (!this_->m_connected)
-							return;
-					}
-					break;
-			
-				case MSGID_NORMAL: 
-					break;
-				case MSGID_DISCONNECT:
-					assert(n == 0);
-					LOG((CLOG_DEBUG "USB datalink: disconnect"));
-					this_->onDisconnect();
-					break;
-				default:
-					LOG((CLOG_ERR "USB datalink: invalid data packet"));
-					this_->onDisconnect();
-					return;
+					LOG((CLOG_ERR "USB datalink: unexpected data during handshake, connection is not accepted"));	
+					// Just skip setting m_connected in this case. "Connect" funcion detects this and drops exception
 				}
+
+				m_acceptedFlag = true;
+				m_acceptedFlag.broadcast();
+
+				if (!m_connected)
+					return false;
 			}
+			break;
+	
+		case MSGID_NORMAL: 
+			break;
 
-		}
+		case MSGID_DISCONNECT:
+			LOG((CLOG_DEBUG "USB datalink: disconnect"));
+			onDisconnect();
+			return false;
 
-		if ((this_->m_inputBuffer.getSize() > 0) && !this_->m_leftToRead) {
-			this_->sendEvent(this_->getInputReadyEvent());
+		default:
+			LOG((CLOG_ERR "USB datalink: invalid data packet"));
+			onDisconnect();
+			return false;
 		}
-
 	}
 
-	libusb_fill_bulk_transfer(
-		this_->m_transferRead, 
-		this_->m_device, 
-		this_->m_config.bulkin, 
-		(unsigned char*)this_->m_readBuffer, 
-		sizeof(this_->m_readBuffer), 
-		CUSBDataLink::readCallback, 
-		this_, 
-		-1);
-	
-	if (libusb_submit_transfer(this_->m_transferRead) != 0)
-	{
-		this_->onDisconnect();
-		return;
+	if (frameDone && m_inputBuffer.getSize() > 0) {
+		sendEvent(getInputReadyEvent());
 	}
 
-	this_->m_activeTransfers = this_->m_activeTransfers + 1;
+	return m_readable;
 }
 
-void CUSBDataLink::writeCallback(libusb_transfer *transfer)
+void CUSBDataLink::writeCallback(USBTransfer* transfer)
 {
-	CUSBDataLink* this_ = reinterpret_cast<CUSBDataLink*>(transfer->user_data);
+	CTransferSlot* slot = reinterpret_cast<CTransferSlot*>(transfer->m_userData);
+	CUSBDataLink* this_ = slot->m_link;
 
 	CLock lock(&this_->m_mutex);
 
 	this_->m_activeTransfers = this_->m_activeTransfers - 1;
+	slot->m_active = false;
 	if (!this_->m_writable)
 	{
 		this_->m_activeTransfers.signal();
 		return;
 	}
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+	// retire finished transfers in submission order.  a transfer that
+	// failed or came up short leaves a hole in the stream that the
+	// transfers queued behind it cannot fill, so drop the link.
+	while (!this_->m_writeQueue.empty() && !this_->m_writeQueue.front()->m_active)
 	{
-		if (!this_->m_acceptedFlag)
+		slot = this_->m_writeQueue.front();
+		this_->m_writeQueue.pop_front();
+		this_->releaseBuffer(slot);
+
+		if (slot->m_transfer->m_status != USBTransfer::kCompleted ||
+			slot->m_transfer->m_actualLength != slot->m_transfer->m_length)
 		{
-			this_->m_acceptedFlag = true;
-			this_->m_acceptedFlag.broadcast();
+			if (!this_->m_acceptedFlag)
+			{
+				this_->m_acceptedFlag = true;
+				this_->m_acceptedFlag.broadcast();
+			}
+
+			this_->onDisconnect();
+			return;
 		}
 
-		this_->onDisconnect();
-		return;
+		this_->m_freeWriteSlots.push_back(slot);
 	}
 
-	// discard written data
-	UInt32 n = transfer->actual_length;
-	if (n > 0) 
+	// keep the write ring full
+	if (!this_->scheduleWrites())
 	{
-		assert(this_->m_leftToWrite >= n);
-        assert(this_->m_writeBufferSent + n <= this_->m_writeBufferSize);
-
-		this_->m_leftToWrite -= n;
-        this_->m_writeBufferSent += n;
+		this_->onDisconnect();
+		return;
 	}
 
-    // check if we have finished to transfer the message
-    if (this_->m_leftToWrite == 0)
-    {
-        // if all the write buffer was sent then get next buffer 
-        if (this_->m_writeBufferSent >= this_->m_writeBufferSize)
-        {
-		    this_->m_outputBuffer.pop(this_->m_writeBufferSent);
-
-            this_->m_writeBufferSent = 0;            
-            this_->m_writeBufferSize = this_->m_outputBuffer.getSize();
-            this_->m_writeBuffer = (char*)this_->m_outputBuffer.peek(this_->m_writeBufferSize);
-        }
-
-        if (this_->m_writeBufferSize > 0)
-            this_->m_leftToWrite = sizeof(message_hdr) + ((message_hdr*)(this_->m_writeBuffer + this_->m_writeBufferSent))->data_size;
-    }
-
-    if (this_->m_leftToWrite == 0) 
+	if (this_->m_writeQueue.empty()) 
 	{
-        // no data to transfer. notify that write buffer flushed
-        assert(this_->m_outputBuffer.getSize() == 0);
+		// no data to transfer. notify that write buffer flushed
+		assert(this_->m_outputBuffer.getSize() == 0);
 
 		if (!this_->m_flushed)
 		{
@@ -665,34 +864,6 @@ void CUSBDataLink::writeCallback(libusb_transfer *transfer)
 			this_->m_flushed.broadcast();
 		}
 	}
-	else
-	{
-        // schedule the transfer of the next message
-        n = this_->m_leftToWrite;
-		
-        // the size of the data sent must not exceed read buffer size.
-		if (n > sizeof(this_->m_readBuffer))
-			n = sizeof(this_->m_readBuffer);
-
-		libusb_fill_bulk_transfer(
-			this_->m_transferWrite, 
-			this_->m_device, 
-			this_->m_config.bulkout, 
-			(unsigned char*)(this_->m_writeBuffer + this_->m_writeBufferSent), 
-			n, 
-			CUSBDataLink::writeCallback, 
-			this_, 
-			TRANSFER_TIMEOUT);
-		
-		if (libusb_submit_transfer(this_->m_transferWrite) != 0)
-		{
-			LOG((CLOG_DEBUG "USB datalink: failed to write packet"));
-			this_->onDisconnect();
-			return;
-		}
-
-		this_->m_activeTransfers = this_->m_activeTransfers + 1;
-	}
 }
 
 void
@@ -703,20 +874,21 @@ CUSBDataLink::sendEvent(CEvent::Type type)
 
 void CUSBDataLink::doWrite(const message_hdr* hdr, const void* buffer)
 {
-	bool wasEmpty = (m_outputBuffer.getSize() == 0);
-
 	m_outputBuffer.write(hdr, sizeof(message_hdr));
 
 	if (hdr->data_size > 0)
 		m_outputBuffer.write(buffer, hdr->data_size);
 
-	//assert(m_outputBuffer.getSize() <= sizeof(m_writeBuffer));
+	COutputFrame frame;
+	frame.m_size = sizeof(message_hdr) + hdr->data_size;
+	frame.m_time = (m_coalesceSize > 0) ? ARCH->time() : 0.0;
+	m_outputFrames.push_back(frame);
 
 	// there's data to write
 	m_flushed = false;
 
-	if (wasEmpty)
-		scheduleWrite();
+	if (!scheduleWrites())
+		onDisconnect();
 }
 
 void CUSBDataLink::onDisconnect()
@@ -748,6 +920,8 @@ void
 CUSBDataLink::onOutputShutdown()
 {
 	m_outputBuffer.pop(m_outputBuffer.getSize());
+	m_outputFrames.clear();
+	m_leftToWrite = 0;
 	m_writable = false;
 
 	// we're now flushed
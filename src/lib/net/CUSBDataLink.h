@@ -24,7 +24,8 @@
 #include "CCondVar.h"
 #include "CMutex.h"
 #include "IArchUsbDataLink.h"
-#include <libusb.h>
+#include <deque>
+#include <vector>
 
 //
 // handshake messages
@@ -34,13 +35,52 @@ extern const char*		kUsbConnect;
 extern const char*		kUsbAccept;
 extern const char*		kUsbReject;
 
-struct message_hdr;
+//
+// framing.  every write goes over the link as a header followed by
+// its data.
+//
+
+enum message_id {
+	MSGID_HANDSHAKE		= 0,
+	MSGID_NORMAL		= 1,
+	MSGID_DISCONNECT	= 2,
+	MSGID_LAST			= MSGID_DISCONNECT
+};
+
+struct message_hdr {
+	message_id		id;
+	unsigned int	data_size;
+};
+
+class CUSBBufferPool;
 
 class CUSBDataLink : public IDataTransfer {
 public:
 	CUSBDataLink();
 	virtual ~CUSBDataLink();
 
+	//! @name manipulators
+	//@{
+
+	//! Set transfer queue depth
+	/*!
+	Sets the number of bulk transfers kept in flight in each direction.
+	Takes effect on the next connect() or bind().
+	*/
+	void				setTransferQueueDepth(UInt32 depth);
+
+	//! Set write coalescing
+	/*!
+	When \c size is non-zero, whole messages are packed together into
+	bulk transfers of up to \c size bytes.  While a transfer is in flight
+	a transfer that isn't full is held back for up to \c deadline seconds
+	waiting for more messages.  When \c size is zero (the default) each
+	message gets its own transfer.
+	*/
+	void				setCoalescing(UInt32 size, double deadline);
+
+	//@}
+
 	// IDataTransfer overrides
 	virtual void		connect(const CBaseAddress&);
 
@@ -62,11 +102,38 @@ public:
 	static CEvent::Type	getDeletingEvent();
 
 private:
-	void				initConnection(const CBaseAddress&);
-	void				scheduleWrite();
+	class CTransferSlot {
+	public:
+		CUSBDataLink*		m_link;
+		USBTransfer*		m_transfer;
+		unsigned char*		m_buffer;
+		UInt32				m_bufferSize;
+		bool				m_active;
+	};
+	typedef std::vector<CTransferSlot*> CTransferSlots;
+	typedef std::deque<CTransferSlot*> CTransferQueue;
+
+	// a message waiting in the output buffer
+	class COutputFrame {
+	public:
+		UInt32			m_size;
+		double			m_time;
+	};
+	typedef std::deque<COutputFrame> COutputFrames;
 
-	static void LIBUSB_CALL	readCallback(libusb_transfer *transfer);
-	static void	LIBUSB_CALL writeCallback(libusb_transfer *transfer);
+	void				initConnection(const CBaseAddress&);
+	CTransferSlot*		newTransferSlot(CTransferSlots&);
+	void				freeTransferSlots();
+	void				cancelTransfers(const CTransferQueue&);
+	void				acquireBuffer(CTransferSlot*, UInt32 size);
+	void				releaseBuffer(CTransferSlot*);
+	bool				submitRead(CTransferSlot*);
+	UInt32				packFrames();
+	bool				scheduleWrites();
+	bool				readTransfer(USBTransfer*);
+
+	static void			readCallback(USBTransfer* transfer);
+	static void			writeCallback(USBTransfer* transfer);
 
 	void				sendEvent(CEvent::Type);
 
@@ -84,14 +151,23 @@ private:
 	USBDeviceHandle		m_device;
 	USBDataLinkConfig	m_config;
 
-	libusb_transfer*	m_transferRead;
-	libusb_transfer*	m_transferWrite;
+	// transfers in submission order.  read transfers are always in
+	// flight;  write transfers cycle through m_freeWriteSlots.
+	UInt32				m_queueDepth;
+	CUSBBufferPool*		m_bufferPool;
+	UInt32				m_readSize;
+	UInt32				m_writeSize;
+	CTransferSlots		m_readSlots;
+	CTransferSlots		m_writeSlots;
+	CTransferSlots		m_freeWriteSlots;
+	CTransferQueue		m_readQueue;
+	CTransferQueue		m_writeQueue;
 
 	CMutex				m_mutex;
-	char				m_readBuffer[1024*1024];
 
 	CStreamBuffer		m_inputBuffer;
 	CStreamBuffer		m_outputBuffer;
+	COutputFrames		m_outputFrames;
 	CCondVar<bool>		m_flushed;
 	bool				m_connected;
 	bool				m_readable;
@@ -100,11 +176,13 @@ private:
 	CCondVar<bool>		m_acceptedFlag;
 	CCondVar<int>		m_activeTransfers;
 
-    char*               m_writeBuffer;
-    unsigned int        m_writeBufferSize;
-    unsigned int        m_writeBufferSent;
 	unsigned int		m_leftToWrite;
 	unsigned int		m_leftToRead;
+	message_hdr			m_readHeader;
+	size_t				m_readHeaderSize;
+
+	UInt32				m_coalesceSize;
+	double				m_coalesceDeadline;
 };
 
 #endif
@@ -0,0 +1,213 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CUSBEventHandler.h"
+#include "CSocketMultiplexer.h"
+#include "TSocketMultiplexerMethodJob.h"
+#include "CLock.h"
+#include "CThread.h"
+#include "CLog.h"
+#include "CArch.h"
+#include "XArch.h"
+
+//
+// CUSBEventHandler
+//
+
+CUSBEventHandler::CUSBEventHandler(CSocketMultiplexer* multiplexer) :
+	m_multiplexer(multiplexer),
+	m_enabled(false),
+	m_mutex(),
+	m_serviceThread(NULL)
+{
+	assert(m_multiplexer != NULL);
+
+	m_enabled = ARCH->usb().usbSetPollfdNotifiers(
+							&CUSBEventHandler::pollfdAdded,
+							&CUSBEventHandler::pollfdRemoved, this);
+	if (m_enabled) {
+		LOG((CLOG_DEBUG1 "servicing usb events from the socket multiplexer"));
+	}
+}
+
+CUSBEventHandler::~CUSBEventHandler()
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	// hand libusb back to its own thread.  no more descriptors will be
+	// reported after this.
+	ARCH->usb().usbSetPollfdNotifiers(NULL, NULL, NULL);
+
+	// take our descriptors out of the multiplexer.  a job may still be
+	// running so don't hold the lock while we wait for it.
+	CPollfdList pollfds;
+	{
+		CLock lock(&m_mutex);
+		for (CPollfdMap::iterator i = m_pollfds.begin();
+							i != m_pollfds.end(); ++i) {
+			pollfds.push_back(i->second);
+		}
+		m_pollfds.clear();
+	}
+	for (CPollfdList::iterator i = pollfds.begin(); i != pollfds.end(); ++i) {
+		m_multiplexer->removeSocket(*i);
+		delete *i;
+	}
+
+	delete m_serviceThread;
+}
+
+bool
+CUSBEventHandler::isEnabled() const
+{
+	return m_enabled;
+}
+
+bool
+CUSBEventHandler::isServiceThread() const
+{
+	CLock lock(&m_mutex);
+	return (m_serviceThread != NULL &&
+			*m_serviceThread == CThread::getCurrentThread());
+}
+
+void
+CUSBEventHandler::addPollfd(int fd, bool readable, bool writable)
+{
+	// jobs can't add sockets to the multiplexer.  libusb only adds
+	// descriptors when opening a device, which never happens while
+	// handling events.
+	if (isServiceThread()) {
+		LOG((CLOG_WARN "usb descriptor %d added while handling usb events", fd));
+		return;
+	}
+
+	CPollfd* pollfd;
+	{
+		CLock lock(&m_mutex);
+
+		// we can be told about a descriptor twice
+		if (m_pollfds.count(fd) > 0) {
+			return;
+		}
+
+		try {
+			pollfd = new CPollfd(fd);
+		}
+		catch (XArchNetwork& e) {
+			LOG((CLOG_WARN "cannot wait on usb descriptor %d: %s", fd, e.what().c_str()));
+			return;
+		}
+		m_pollfds.insert(std::make_pair(fd, pollfd));
+	}
+
+	m_multiplexer->addSocket(pollfd,
+		new TSocketMultiplexerMethodJob<CUSBEventHandler>(
+							this, &CUSBEventHandler::serviceUSB,
+							pollfd->m_socket, readable, writable));
+}
+
+void
+CUSBEventHandler::removePollfd(int fd)
+{
+	CPollfd* pollfd;
+	{
+		CLock lock(&m_mutex);
+
+		CPollfdMap::iterator i = m_pollfds.find(fd);
+		if (i == m_pollfds.end()) {
+			return;
+		}
+		pollfd = i->second;
+		m_pollfds.erase(i);
+	}
+
+	// stop polling the descriptor now.  libusb may close it as soon as
+	// we return and a duplicate left in the poll set would keep the file
+	// open.  this works from our own jobs too, even for the descriptor
+	// whose job is running.
+	m_multiplexer->removeSocket(pollfd);
+	delete pollfd;
+}
+
+void
+CUSBEventHandler::pollfdAdded(int fd, bool readable, bool writable, void* vself)
+{
+	CUSBEventHandler* self = reinterpret_cast<CUSBEventHandler*>(vself);
+	self->addPollfd(fd, readable, writable);
+}
+
+void
+CUSBEventHandler::pollfdRemoved(int fd, void* vself)
+{
+	CUSBEventHandler* self = reinterpret_cast<CUSBEventHandler*>(vself);
+	self->removePollfd(fd);
+}
+
+ISocketMultiplexerJob*
+CUSBEventHandler::serviceUSB(ISocketMultiplexerJob* job, bool, bool, bool)
+{
+	{
+		CLock lock(&m_mutex);
+		if (m_serviceThread == NULL) {
+			m_serviceThread = new CThread(CThread::getCurrentThread());
+		}
+	}
+
+	// libusb works out which of its descriptors are ready by itself.
+	// descriptors it drops meanwhile are removed by removePollfd().
+	ARCH->usb().usbHandleEvents();
+	return job;
+}
+
+
+//
+// CUSBEventHandler::CPollfd
+//
+
+CUSBEventHandler::CPollfd::CPollfd(int fd) :
+	m_fd(fd),
+	m_socket(ARCH->newSocketFromDescriptor(fd))
+{
+	// do nothing
+}
+
+CUSBEventHandler::CPollfd::~CPollfd()
+{
+	ARCH->closeSocket(m_socket);
+}
+
+void
+CUSBEventHandler::CPollfd::bind(const CBaseAddress&)
+{
+	// descriptors are never bound
+	assert(!"bind on usb descriptor");
+}
+
+void
+CUSBEventHandler::CPollfd::close()
+{
+	// the descriptor belongs to libusb
+}
+
+void*
+CUSBEventHandler::CPollfd::getEventTarget() const
+{
+	return const_cast<void*>(reinterpret_cast<const void*>(this));
+}
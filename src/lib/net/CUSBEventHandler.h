@@ -0,0 +1,92 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUSBEVENTHANDLER_H
+#define CUSBEVENTHANDLER_H
+
+#include "ISocket.h"
+#include "IArchNetwork.h"
+#include "CMutex.h"
+#include "stdmap.h"
+#include "stdvector.h"
+
+class CSocketMultiplexer;
+class CThread;
+class ISocketMultiplexerJob;
+
+//! USB event handler
+/*!
+Services libusb from a socket multiplexer.  Each file descriptor libusb
+waits on is added to the multiplexer and libusb handles its events,
+without blocking, whenever one becomes ready.  USB transfers therefore
+complete on the multiplexer thread just like TCP sockets do, without a
+thread polling libusb on a timeout.  Where libusb can't be driven this
+way it keeps using its own event thread.
+*/
+class CUSBEventHandler {
+public:
+	CUSBEventHandler(CSocketMultiplexer*);
+	~CUSBEventHandler();
+
+	//! @name accessors
+	//@{
+
+	//! Check if libusb is serviced by the multiplexer
+	bool				isEnabled() const;
+
+	//@}
+
+private:
+	// the multiplexer keys jobs by socket, so each descriptor gets a
+	// socket object of its own
+	class CPollfd : public ISocket {
+	public:
+		CPollfd(int fd);
+		virtual ~CPollfd();
+
+		// ISocket overrides
+		virtual void		bind(const CBaseAddress&);
+		virtual void		close();
+		virtual void*		getEventTarget() const;
+
+	public:
+		int					m_fd;
+		CArchSocket			m_socket;
+	};
+	typedef std::map<int, CPollfd*> CPollfdMap;
+	typedef std::vector<CPollfd*> CPollfdList;
+
+	bool				isServiceThread() const;
+	void				addPollfd(int fd, bool readable, bool writable);
+	void				removePollfd(int fd);
+
+	static void			pollfdAdded(int fd, bool, bool, void*);
+	static void			pollfdRemoved(int fd, void*);
+
+	ISocketMultiplexerJob*
+						serviceUSB(ISocketMultiplexerJob*, bool, bool, bool);
+
+private:
+	CSocketMultiplexer*	m_multiplexer;
+	bool				m_enabled;
+
+	CMutex				m_mutex;
+	CPollfdMap			m_pollfds;
+	CThread*			m_serviceThread;
+};
+
+#endif
@@ -42,9 +42,10 @@ public:
 	true.
 
 	This call must not attempt to directly change the job for this
-	socket by calling \c addSocket() or \c removeSocket() on the
-	multiplexer.  It must instead return the new job.  It can,
-	however, add or remove jobs for other sockets.
+	socket by calling \c addSocket() on the multiplexer.  It must
+	instead return the new job.  It can, however, remove jobs for any
+	socket, including its own, by calling \c removeSocket().  If it
+	removes its own job then its return value is ignored.
 	*/
 	virtual ISocketMultiplexerJob*
 						run(bool readable, bool writable, bool error) = 0;
@@ -1263,6 +1263,10 @@ CXWindowsScreen::handleSystemEvent(const CEvent& event, void*)
 				cookie->type == GenericEvent &&
 				cookie->extension == xi_opcode) {
 			if (cookie->evtype == XI_RawMotion) {
+				// the pointer's position is queried so later raw
+				// motions already queued have nothing to add
+				coalesceRawMotion();
+
 				// Get current pointer's position
 				Window root, child;
 				XMotionEvent xmotion;
@@ -1393,7 +1397,9 @@ CXWindowsScreen::handleSystemEvent(const CEvent& event, void*)
 
 	case MotionNotify:
 		if (m_isPrimary) {
-			onMouseMove(xevent->xmotion);
+			XMotionEvent xmotion = xevent->xmotion;
+			coalesceMotion(xmotion);
+			onMouseMove(xmotion);
 		}
 		return;
 
@@ -1648,6 +1654,54 @@ CXWindowsScreen::onMouseMove(const XMotionEvent& xmotion)
 	}
 }
 
+void
+CXWindowsScreen::coalesceMotion(XMotionEvent& xmotion)
+{
+	// the events we send around a warp must be seen by onMouseMove()
+	if (xmotion.send_event) {
+		return;
+	}
+
+	// only take motion events from the front of the queue so motion
+	// is never reordered with respect to buttons, keys or the events
+	// we send around a warp.  onMouseMove() computes the delta from
+	// the last position it saw so skipping motions doesn't lose any
+	// relative motion either.
+	int discarded = 0;
+	XEvent xevent;
+	while (XEventsQueued(m_display, QueuedAfterReading) > 0) {
+		XPeekEvent(m_display, &xevent);
+		if (xevent.type != MotionNotify || xevent.xmotion.send_event) {
+			break;
+		}
+		XNextEvent(m_display, &xevent);
+		xmotion = xevent.xmotion;
+		++discarded;
+	}
+	if (discarded > 0) {
+		LOG((CLOG_DEBUG2 "coalesced %d motion events", discarded));
+	}
+}
+
+#ifdef HAVE_XI2
+void
+CXWindowsScreen::coalesceRawMotion()
+{
+	// the event data of the discarded events is never claimed so
+	// xlib frees it
+	XEvent xevent;
+	while (XEventsQueued(m_display, QueuedAfterReading) > 0) {
+		XPeekEvent(m_display, &xevent);
+		if (xevent.xcookie.type      != GenericEvent ||
+			xevent.xcookie.extension != xi_opcode ||
+			xevent.xcookie.evtype    != XI_RawMotion) {
+			break;
+		}
+		XNextEvent(m_display, &xevent);
+	}
+}
+#endif
+
 Cursor
 CXWindowsScreen::createBlankCursor() const
 {
@@ -140,6 +140,13 @@ private:
 	void				onMouseRelease(const XButtonEvent&);
 	void				onMouseMove(const XMotionEvent&);
 
+	// discard the motion events queued right behind a motion event so
+	// only the newest position is handled
+	void				coalesceMotion(XMotionEvent&);
+#ifdef HAVE_XI2
+	void				coalesceRawMotion();
+#endif
+
 	bool				detectXI2();
 #ifdef HAVE_XI2
 	void				selectXIRawMotion();
@@ -17,6 +17,7 @@
  */
 
 #include "CBaseClientProxy.h"
+#include "CClipboard.h"
 
 //
 // CBaseClientProxy
@@ -25,7 +26,8 @@
 CBaseClientProxy::CBaseClientProxy(const CString& name) :
 	m_name(name),
 	m_x(0),
-	m_y(0)
+	m_y(0),
+	m_screenID(CScreenGraph::kNoScreen)
 {
 	// do nothing
 }
@@ -49,6 +51,26 @@ CBaseClientProxy::getJumpCursorPos(SInt32& x, SInt32& y) const
 	y = m_y;
 }
 
+void
+CBaseClientProxy::setScreenID(CScreenGraph::ScreenID id)
+{
+	m_screenID = id;
+}
+
+CScreenGraph::ScreenID
+CBaseClientProxy::getScreenID() const
+{
+	return m_screenID;
+}
+
+CClipboardSnapshot
+CBaseClientProxy::getClipboardSnapshot(ClipboardID id) const
+{
+	CClipboard clipboard;
+	getClipboard(id, &clipboard);
+	return CClipboardSnapshot(&clipboard);
+}
+
 CString
 CBaseClientProxy::getName() const
 {
@@ -21,6 +21,8 @@
 
 #include "IClient.h"
 #include "CString.h"
+#include "CScreenGraph.h"
+#include "CClipboardSnapshot.h"
 
 //! Generic proxy for client or primary
 class CBaseClientProxy : public IClient {
@@ -40,6 +42,13 @@ public:
 	*/
 	void				setJumpCursorPos(SInt32 x, SInt32 y);
 
+	//! Set screen id
+	/*!
+	Set the id of the screen the client is connected as in the server's
+	screen graph.
+	*/
+	void				setScreenID(CScreenGraph::ScreenID id);
+
 	//@}
 	//! @name accessors
 	//@{
@@ -50,6 +59,23 @@ public:
 	*/
 	void				getJumpCursorPos(SInt32& x, SInt32& y) const;
 
+	//! Get screen id
+	/*!
+	Get the id set by setScreenID().  Returns \c CScreenGraph::kNoScreen
+	if it hasn't been set.
+	*/
+	CScreenGraph::ScreenID
+						getScreenID() const;
+
+	//! Get clipboard snapshot
+	/*!
+	Returns a snapshot of clipboard \c id.  The default snapshots the
+	data from getClipboard().  Proxies that already hold the data as a
+	snapshot return it without copying.
+	*/
+	virtual CClipboardSnapshot
+						getClipboardSnapshot(ClipboardID id) const;
+
 	//@}
 
 	// IScreen
@@ -88,6 +114,7 @@ public:
 private:
 	CString				m_name;
 	SInt32				m_x, m_y;
+	CScreenGraph::ScreenID	m_screenID;
 };
 
 #endif
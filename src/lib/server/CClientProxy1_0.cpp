@@ -18,11 +18,13 @@
 
 #include "CClientProxy1_0.h"
 #include "CProtocolUtil.h"
+#include "CClipboard.h"
 #include "XSynergy.h"
 #include "IStream.h"
 #include "CLog.h"
 #include "IEventQueue.h"
 #include "TMethodEventJob.h"
+#include "CArch.h"
 #include <cstring>
 
 //
@@ -32,6 +34,13 @@
 CClientProxy1_0::CClientProxy1_0(const CString& name, synergy::IStream* stream, IEventQueue* eventQueue) :
 	CClientProxy(name, stream),
 	m_heartbeatTimer(NULL),
+	m_motionInterval(0.0),
+	m_motionTime(0.0),
+	m_motionTimer(NULL),
+	m_motionPending(false),
+	m_motionRelative(false),
+	m_motionX(0),
+	m_motionY(0),
 	m_parser(&CClientProxy1_0::parseHandshakeMessage),
 	m_eventQueue(eventQueue)
 {
@@ -56,6 +65,12 @@ CClientProxy1_0::CClientProxy1_0(const CString& name, synergy::IStream* stream,
 							new TMethodEventJob<CClientProxy1_0>(this,
 								&CClientProxy1_0::handleFlatline, NULL));
 
+	// messages after the handshake
+	addMessage(kMsgDInfo,      &CClientProxy1_0::recvInfoChanged);
+	addMessage(kMsgCNoop,      &CClientProxy1_0::recvNoop);
+	addMessage(kMsgCClipboard, &CClientProxy1_0::recvGrabClipboard);
+	addMessage(kMsgDClipboard, &CClientProxy1_0::recvClipboard);
+
 	setHeartbeatRate(kHeartRate, kHeartRate * kHeartBeatsUntilDeath);
 
 	LOG((CLOG_DEBUG1 "querying client \"%s\" info", getName().c_str()));
@@ -89,8 +104,9 @@ CClientProxy1_0::removeHandlers()
 							getStream()->getEventTarget());
 	m_eventQueue->removeHandler(CEvent::kTimer, this);
 
-	// remove timer
+	// remove timers
 	removeHeartbeatTimer();
+	removeMotionTimer();
 }
 
 void
@@ -130,6 +146,56 @@ CClientProxy1_0::setHeartbeatRate(double, double alarm)
 	m_heartbeatAlarm = alarm;
 }
 
+void
+CClientProxy1_0::flushMotion()
+{
+	removeMotionTimer();
+	if (!m_motionPending) {
+		return;
+	}
+
+	m_motionPending = false;
+	m_motionTime    = ARCH->time();
+	if (m_motionRelative) {
+		sendMouseRelativeMove(m_motionX, m_motionY);
+	}
+	else {
+		sendMouseMove(m_motionX, m_motionY);
+	}
+}
+
+void
+CClientProxy1_0::paceMotion()
+{
+	// nothing to do if the motion is already scheduled
+	if (m_motionTimer != NULL) {
+		return;
+	}
+
+	// send now unless we sent motion less than an interval ago.  the
+	// first motion after a pause is never delayed.
+	double delay = m_motionTime + m_motionInterval - ARCH->time();
+	if (m_motionInterval <= 0.0 || delay <= 0.0) {
+		flushMotion();
+	}
+	else {
+		m_motionTimer = m_eventQueue->newOneShotTimer(delay, NULL);
+		m_eventQueue->adoptHandler(CEvent::kTimer, m_motionTimer,
+							new TMethodEventJob<CClientProxy1_0>(this,
+								&CClientProxy1_0::handleMotionTimer, NULL));
+	}
+}
+
+void
+CClientProxy1_0::removeMotionTimer()
+{
+	if (m_motionTimer != NULL) {
+		m_eventQueue->removeHandler(CEvent::kTimer, m_motionTimer);
+		m_eventQueue->deleteTimer(m_motionTimer);
+		m_motionTimer = NULL;
+	}
+}
+
 void
 CClientProxy1_0::handleData(const CEvent&, void*)
 {
@@ -183,26 +249,17 @@ CClientProxy1_0::parseHandshakeMessage(const UInt8* code)
 bool
 CClientProxy1_0::parseMessage(const UInt8* code)
 {
-	if (memcmp(code, kMsgDInfo, 4) == 0) {
-		if (recvInfo()) {
-			m_eventQueue->addEvent(
-							CEvent(getShapeChangedEvent(), getEventTarget()));
-			return true;
-		}
+	const MessageHandler* handler = m_messages.find(code);
+	if (handler == NULL) {
 		return false;
 	}
-	else if (memcmp(code, kMsgCNoop, 4) == 0) {
-		// discard no-ops
-		LOG((CLOG_DEBUG2 "no-op from", getName().c_str()));
-		return true;
-	}
-	else if (memcmp(code, kMsgCClipboard, 4) == 0) {
-		return recvGrabClipboard();
-	}
-	else if (memcmp(code, kMsgDClipboard, 4) == 0) {
-		return recvClipboard();
-	}
-	return false;
+	return (this->**handler)();
+}
+
+void
+CClientProxy1_0::addMessage(const char* msg, MessageHandler handler)
+{
+	m_messages.add(msg, handler);
 }
 
 void
@@ -227,10 +284,22 @@ CClientProxy1_0::handleFlatline(const CEvent&, void*)
 	disconnect();
 }
 
+void
+CClientProxy1_0::handleMotionTimer(const CEvent&, void*)
+{
+	flushMotion();
+}
+
+CClipboardSnapshot
+CClientProxy1_0::getClipboardSnapshot(ClipboardID id) const
+{
+	return m_clipboard[id].m_clipboard;
+}
+
 bool
 CClientProxy1_0::getClipboard(ClipboardID id, IClipboard* clipboard) const
 {
-	CClipboard::copy(clipboard, &m_clipboard[id].m_clipboard);
+	IClipboard::copy(clipboard, &m_clipboard[id].m_clipboard);
 	return true;
 }
 
@@ -255,16 +324,22 @@ void
 CClientProxy1_0::enter(SInt32 xAbs, SInt32 yAbs,
 				UInt32 seqNum, KeyModifierMask mask, bool)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send enter to \"%s\", %d,%d %d %04x", getName().c_str(), xAbs, yAbs, seqNum, mask));
-	CProtocolUtil::writef(getStream(), kMsgCEnter,
-								xAbs, yAbs, seqNum, mask);
+	CMsgCEnter message;
+	message.m_x      = static_cast<SInt16>(xAbs);
+	message.m_y      = static_cast<SInt16>(yAbs);
+	message.m_seqNum = seqNum;
+	message.m_mask   = static_cast<UInt16>(mask);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 bool
 CClientProxy1_0::leave()
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send leave to \"%s\"", getName().c_str()));
-	CProtocolUtil::writef(getStream(), kMsgCLeave);
+	CProtocolUtil::writeMessage(getStream(), CMsgCLeave());
 
 	// we can never prevent the user from leaving
 	return true;
@@ -277,9 +352,19 @@ CClientProxy1_0::setClipboard(ClipboardID id, const IClipboard* clipboard)
 	if (m_clipboard[id].m_dirty) {
 		// this clipboard is now clean
 		m_clipboard[id].m_dirty = false;
-		CClipboard::copy(&m_clipboard[id].m_clipboard, clipboard);
 
-		CString data = m_clipboard[id].m_clipboard.marshall();
+		// share the server's snapshot rather than copying its data
+		const CClipboardSnapshot* snapshot =
+			dynamic_cast<const CClipboardSnapshot*>(clipboard);
+		if (snapshot != NULL) {
+			m_clipboard[id].m_clipboard = *snapshot;
+		}
+		else {
+			m_clipboard[id].m_clipboard = CClipboardSnapshot(clipboard);
+		}
+
+		flushMotion();
+		const CString& data = m_clipboard[id].m_clipboard.getData();
 		LOG((CLOG_DEBUG "send clipboard %d to \"%s\" size=%d", id, getName().c_str(), data.size()));
 		CProtocolUtil::writef(getStream(), kMsgDClipboard, id, 0, &data);
 	}
@@ -288,6 +373,7 @@ CClientProxy1_0::setClipboard(ClipboardID id, const IClipboard* clipboard)
 void
 CClientProxy1_0::grabClipboard(ClipboardID id)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG "send grab clipboard %d to \"%s\"", id, getName().c_str()));
 	CProtocolUtil::writef(getStream(), kMsgCClipboard, id, 0);
 
@@ -304,48 +390,104 @@ CClientProxy1_0::setClipboardDirty(ClipboardID id, bool dirty)
 void
 CClientProxy1_0::keyDown(KeyID key, KeyModifierMask mask, KeyButton)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key down to \"%s\" id=%d, mask=0x%04x", getName().c_str(), key, mask));
-	CProtocolUtil::writef(getStream(), kMsgDKeyDown1_0, key, mask);
+	CMsgDKeyDown1_0 message;
+	message.m_id   = static_cast<UInt16>(key);
+	message.m_mask = static_cast<UInt16>(mask);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_0::keyRepeat(KeyID key, KeyModifierMask mask,
 				SInt32 count, KeyButton)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key repeat to \"%s\" id=%d, mask=0x%04x, count=%d", getName().c_str(), key, mask, count));
-	CProtocolUtil::writef(getStream(), kMsgDKeyRepeat1_0, key, mask, count);
+	CMsgDKeyRepeat1_0 message;
+	message.m_id    = static_cast<UInt16>(key);
+	message.m_mask  = static_cast<UInt16>(mask);
+	message.m_count = static_cast<UInt16>(count);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_0::keyUp(KeyID key, KeyModifierMask mask, KeyButton)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key up to \"%s\" id=%d, mask=0x%04x", getName().c_str(), key, mask));
-	CProtocolUtil::writef(getStream(), kMsgDKeyUp1_0, key, mask);
+	CMsgDKeyUp1_0 message;
+	message.m_id   = static_cast<UInt16>(key);
+	message.m_mask = static_cast<UInt16>(mask);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_0::mouseDown(ButtonID button)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send mouse down to \"%s\" id=%d", getName().c_str(), button));
-	CProtocolUtil::writef(getStream(), kMsgDMouseDown, button);
+	CMsgDMouseDown message;
+	message.m_id = button;
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_0::mouseUp(ButtonID button)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send mouse up to \"%s\" id=%d", getName().c_str(), button));
-	CProtocolUtil::writef(getStream(), kMsgDMouseUp, button);
+	CMsgDMouseUp message;
+	message.m_id = button;
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_0::mouseMove(SInt32 xAbs, SInt32 yAbs)
+{
+	// absolute motion replaces held back absolute motion but relative
+	// motion must be sent first
+	if (m_motionPending && m_motionRelative) {
+		flushMotion();
+	}
+	m_motionPending  = true;
+	m_motionRelative = false;
+	m_motionX        = xAbs;
+	m_motionY        = yAbs;
+	paceMotion();
+}
+
+void
+CClientProxy1_0::mouseRelativeMove(SInt32 xRel, SInt32 yRel)
+{
+	// relative motion adds to held back relative motion but absolute
+	// motion must be sent first
+	if (m_motionPending && !m_motionRelative) {
+		flushMotion();
+	}
+	if (!m_motionPending) {
+		m_motionPending  = true;
+		m_motionRelative = true;
+		m_motionX        = 0;
+		m_motionY        = 0;
+	}
+	m_motionX += xRel;
+	m_motionY += yRel;
+	paceMotion();
+}
+
+void
+CClientProxy1_0::sendMouseMove(SInt32 xAbs, SInt32 yAbs)
 {
 	LOG((CLOG_DEBUG2 "send mouse move to \"%s\" %d,%d", getName().c_str(), xAbs, yAbs));
-	CProtocolUtil::writef(getStream(), kMsgDMouseMove, xAbs, yAbs);
+	CMsgDMouseMove message;
+	message.m_x = static_cast<SInt16>(xAbs);
+	message.m_y = static_cast<SInt16>(yAbs);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
-CClientProxy1_0::mouseRelativeMove(SInt32, SInt32)
+CClientProxy1_0::sendMouseRelativeMove(SInt32, SInt32)
 {
 	// ignore -- not supported in protocol 1.0
 }
@@ -353,9 +495,12 @@ CClientProxy1_0::mouseRelativeMove(SInt32, SInt32)
 void
 CClientProxy1_0::mouseWheel(SInt32, SInt32 yDelta)
 {
+	flushMotion();
 	// clients prior to 1.3 only support the y axis
 	LOG((CLOG_DEBUG2 "send mouse wheel to \"%s\" %+d", getName().c_str(), yDelta));
-	CProtocolUtil::writef(getStream(), kMsgDMouseWheel1_0, yDelta);
+	CMsgDMouseWheel1_0 message;
+	message.m_y = static_cast<SInt16>(yDelta);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
@@ -396,6 +541,7 @@ CClientProxy1_0::cryptoIv(const UInt8* iv)
 void
 CClientProxy1_0::screensaver(bool on)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send screen saver to \"%s\" on=%d", getName().c_str(), on ? 1 : 0));
 	CProtocolUtil::writef(getStream(), kMsgCScreenSaver, on ? 1 : 0);
 }
@@ -403,6 +549,7 @@ CClientProxy1_0::screensaver(bool on)
 void
 CClientProxy1_0::resetOptions()
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send reset options to \"%s\"", getName().c_str()));
 	CProtocolUtil::writef(getStream(), kMsgCResetOptions);
 
@@ -410,11 +557,15 @@ CClientProxy1_0::resetOptions()
 	resetHeartbeatRate();
 	removeHeartbeatTimer();
 	addHeartbeatTimer();
+
+	// stop pacing motion
+	m_motionInterval = 0.0;
 }
 
 void
 CClientProxy1_0::setOptions(const COptionsList& options)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send set options to \"%s\" size=%d", getName().c_str(), options.size()));
 	CProtocolUtil::writef(getStream(), kMsgDSetOptions, &options);
 
@@ -429,6 +580,11 @@ CClientProxy1_0::setOptions(const COptionsList& options)
 			removeHeartbeatTimer();
 			addHeartbeatTimer();
 		}
+		else if (options[i] == kOptionMouseMoveRate) {
+			SInt32 rate = static_cast<SInt32>(options[i + 1]);
+			m_motionInterval = (rate > 0) ? 1.0 / rate : 0.0;
+			LOG((CLOG_DEBUG1 "mouse moves to \"%s\" limited to %d per second", getName().c_str(), rate));
+		}
 	}
 }
 
@@ -466,6 +622,25 @@ CClientProxy1_0::recvInfo()
 	return true;
 }
 
+bool
+CClientProxy1_0::recvInfoChanged()
+{
+	if (recvInfo()) {
+		m_eventQueue->addEvent(
+						CEvent(getShapeChangedEvent(), getEventTarget()));
+		return true;
+	}
+	return false;
+}
+
+bool
+CClientProxy1_0::recvNoop()
+{
+	// discard no-ops
+	LOG((CLOG_DEBUG2 "no-op from", getName().c_str()));
+	return true;
+}
+
 bool
 CClientProxy1_0::recvClipboard()
 {
@@ -484,8 +659,12 @@ CClientProxy1_0::recvClipboard()
 		return false;
 	}
 
-	// save clipboard
-	m_clipboard[id].m_clipboard.unmarshall(data, 0);
+	// save clipboard.  the snapshot is relayed to other clients as is
+	// so parse the client's data and keep what we understood rather
+	// than trusting its bytes.
+	CClipboard clipboard;
+	clipboard.unmarshall(data, 0);
+	m_clipboard[id].m_clipboard = CClipboardSnapshot(&clipboard);
 	m_clipboard[id].m_sequenceNumber = seqNum;
 
 	// notify
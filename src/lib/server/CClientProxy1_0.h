@@ -20,8 +20,9 @@
 #define CCLIENTPROXY1_0_H
 
 #include "CClientProxy.h"
-#include "CClipboard.h"
+#include "CClipboardSnapshot.h"
 #include "ProtocolTypes.h"
+#include "TMessageTable.h"
 
 class CEvent;
 class CEventQueueTimer;
@@ -33,6 +34,10 @@ public:
 	CClientProxy1_0(const CString& name, synergy::IStream* adoptedStream, IEventQueue* eventQueue);
 	~CClientProxy1_0();
 
+	// CBaseClientProxy overrides
+	virtual CClipboardSnapshot
+						getClipboardSnapshot(ClipboardID id) const;
+
 	// IScreen
 	virtual bool		getClipboard(ClipboardID id, IClipboard*) const;
 	virtual void		getShape(SInt32& x, SInt32& y,
@@ -66,6 +71,11 @@ public:
 	virtual void		cryptoIv(const UInt8* iv);
 
 protected:
+	typedef bool (CClientProxy1_0::*MessageHandler)();
+
+	//! Handle messages with code \p msg using \p handler after the handshake
+	void				addMessage(const char* msg, MessageHandler handler);
+
 	virtual bool		parseHandshakeMessage(const UInt8* code);
 	virtual bool		parseMessage(const UInt8* code);
 
@@ -75,16 +85,39 @@ protected:
 	virtual void		addHeartbeatTimer();
 	virtual void		removeHeartbeatTimer();
 
+	//! Send mouse motion
+	/*!
+	mouseMove() and mouseRelativeMove() hold motion back so at most one
+	motion is sent per motion interval.  These send the motion.
+	*/
+	virtual void		sendMouseMove(SInt32 xAbs, SInt32 yAbs);
+	virtual void		sendMouseRelativeMove(SInt32 xRel, SInt32 yRel);
+
+	//! Send held back motion
+	/*!
+	Sends any motion held back by mouseMove() or mouseRelativeMove().
+	This must be called before sending any other message so the client
+	gets the motion first.
+	*/
+	void				flushMotion();
+
 private:
 	void				disconnect();
 	void				removeHandlers();
 
+	// send held back motion now or schedule sending it
+	void				paceMotion();
+	void				removeMotionTimer();
+
 	void				handleData(const CEvent&, void*);
 	void				handleDisconnect(const CEvent&, void*);
 	void				handleWriteError(const CEvent&, void*);
 	void				handleFlatline(const CEvent&, void*);
+	void				handleMotionTimer(const CEvent&, void*);
 
 	bool				recvInfo();
+	bool				recvInfoChanged();
+	bool				recvNoop();
 	bool				recvClipboard();
 	bool				recvGrabClipboard();
 
@@ -95,7 +128,7 @@ private:
 		CClientClipboard();
 
 	public:
-		CClipboard		m_clipboard;
+		CClipboardSnapshot	m_clipboard;
 		UInt32			m_sequenceNumber;
 		bool			m_dirty;
 	};
@@ -104,7 +137,20 @@ private:
 	CClientClipboard	m_clipboard[kClipboardEnd];
 	double				m_heartbeatAlarm;
 	CEventQueueTimer*	m_heartbeatTimer;
+
+	// motion held back to send at most once every m_motionInterval
+	// seconds.  relative motion is accumulated while absolute motion
+	// replaces earlier motion.
+	double				m_motionInterval;
+	double				m_motionTime;
+	CEventQueueTimer*	m_motionTimer;
+	bool				m_motionPending;
+	bool				m_motionRelative;
+	SInt32				m_motionX;
+	SInt32				m_motionY;
 	MessageParser		m_parser;
+	TMessageTable<MessageHandler>
+						m_messages;
 	IEventQueue*		m_eventQueue;
 };
 
@@ -39,21 +39,37 @@ CClientProxy1_1::~CClientProxy1_1()
 void
 CClientProxy1_1::keyDown(KeyID key, KeyModifierMask mask, KeyButton button)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key down to \"%s\" id=%d, mask=0x%04x, button=0x%04x", getName().c_str(), key, mask, button));
-	CProtocolUtil::writef(getStream(), kMsgDKeyDown, key, mask, button);
+	CMsgDKeyDown message;
+	message.m_id     = static_cast<UInt16>(key);
+	message.m_mask   = static_cast<UInt16>(mask);
+	message.m_button = button;
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_1::keyRepeat(KeyID key, KeyModifierMask mask,
 				SInt32 count, KeyButton button)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key repeat to \"%s\" id=%d, mask=0x%04x, count=%d, button=0x%04x", getName().c_str(), key, mask, count, button));
-	CProtocolUtil::writef(getStream(), kMsgDKeyRepeat, key, mask, count, button);
+	CMsgDKeyRepeat message;
+	message.m_id     = static_cast<UInt16>(key);
+	message.m_mask   = static_cast<UInt16>(mask);
+	message.m_count  = static_cast<UInt16>(count);
+	message.m_button = button;
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 void
 CClientProxy1_1::keyUp(KeyID key, KeyModifierMask mask, KeyButton button)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG1 "send key up to \"%s\" id=%d, mask=0x%04x, button=0x%04x", getName().c_str(), key, mask, button));
-	CProtocolUtil::writef(getStream(), kMsgDKeyUp, key, mask, button);
+	CMsgDKeyUp message;
+	message.m_id     = static_cast<UInt16>(key);
+	message.m_mask   = static_cast<UInt16>(mask);
+	message.m_button = button;
+	CProtocolUtil::writeMessage(getStream(), message);
 }
@@ -36,8 +36,11 @@ CClientProxy1_2::~CClientProxy1_2()
 }
 
 void
-CClientProxy1_2::mouseRelativeMove(SInt32 xRel, SInt32 yRel)
+CClientProxy1_2::sendMouseRelativeMove(SInt32 xRel, SInt32 yRel)
 {
 	LOG((CLOG_DEBUG2 "send mouse relative move to \"%s\" %d,%d", getName().c_str(), xRel, yRel));
-	CProtocolUtil::writef(getStream(), kMsgDMouseRelMove, xRel, yRel);
+	CMsgDMouseRelMove message;
+	message.m_x = static_cast<SInt16>(xRel);
+	message.m_y = static_cast<SInt16>(yRel);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
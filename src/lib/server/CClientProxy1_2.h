@@ -29,8 +29,9 @@ public:
 	CClientProxy1_2(const CString& name, synergy::IStream* adoptedStream, IEventQueue* eventQueue);
 	~CClientProxy1_2();
 
-	// IClient overrides
-	virtual void		mouseRelativeMove(SInt32 xRel, SInt32 yRel);
+protected:
+	// CClientProxy1_0 overrides
+	virtual void		sendMouseRelativeMove(SInt32 xRel, SInt32 yRel);
 };
 
 #endif
@@ -33,6 +33,9 @@ CClientProxy1_3::CClientProxy1_3(const CString& name, synergy::IStream* stream,
 	m_keepAliveRate(kKeepAliveRate),
 	m_keepAliveTimer(NULL)
 {
+	addMessage(kMsgCKeepAlive,
+		static_cast<MessageHandler>(&CClientProxy1_3::recvKeepAlive));
+
 	setHeartbeatRate(kKeepAliveRate, kKeepAliveRate * kKeepAlivesUntilDeath);
 }
 
@@ -45,22 +48,20 @@ CClientProxy1_3::~CClientProxy1_3()
 void
 CClientProxy1_3::mouseWheel(SInt32 xDelta, SInt32 yDelta)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG2 "send mouse wheel to \"%s\" %+d,%+d", getName().c_str(), xDelta, yDelta));
-	CProtocolUtil::writef(getStream(), kMsgDMouseWheel, xDelta, yDelta);
+	CMsgDMouseWheel message;
+	message.m_x = static_cast<SInt16>(xDelta);
+	message.m_y = static_cast<SInt16>(yDelta);
+	CProtocolUtil::writeMessage(getStream(), message);
 }
 
 bool
-CClientProxy1_3::parseMessage(const UInt8* code)
+CClientProxy1_3::recvKeepAlive()
 {
-	// process message
-	if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
-		// reset alarm
-		resetHeartbeatTimer();
-		return true;
-	}
-	else {
-		return CClientProxy1_2::parseMessage(code);
-	}
+	// reset alarm
+	resetHeartbeatTimer();
+	return true;
 }
 
 void
@@ -116,5 +117,5 @@ CClientProxy1_3::removeHeartbeatTimer()
 void
 CClientProxy1_3::handleKeepAlive(const CEvent&, void*)
 {
-	CProtocolUtil::writef(getStream(), kMsgCKeepAlive);
+	CProtocolUtil::writeMessage(getStream(), CMsgCKeepAlive());
 }
@@ -32,7 +32,6 @@ public:
 
 protected:
 	// CClientProxy overrides
-	virtual bool		parseMessage(const UInt8* code);
 	virtual void		resetHeartbeatRate();
 	virtual void		setHeartbeatRate(double rate, double alarm);
 	virtual void		resetHeartbeatTimer();
@@ -42,6 +41,9 @@ protected:
 private:
 	void				handleKeepAlive(const CEvent&, void*);
 
+	// message handlers
+	bool				recvKeepAlive();
+
 
 private:
 	double				m_keepAliveRate;
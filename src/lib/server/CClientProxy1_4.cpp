@@ -34,6 +34,11 @@ CClientProxy1_4::CClientProxy1_4(const CString& name, synergy::IStream* stream,
 	CClientProxy1_3(name, stream, eventQueue), m_server(server)
 {
 	assert(m_server != NULL);
+
+	addMessage(kMsgCGameTimingResp,
+		static_cast<MessageHandler>(&CClientProxy1_4::gameDeviceTimingResp));
+	addMessage(kMsgDGameFeedback,
+		static_cast<MessageHandler>(&CClientProxy1_4::gameDeviceFeedback));
 }
 
 CClientProxy1_4::~CClientProxy1_4()
@@ -43,6 +48,7 @@ CClientProxy1_4::~CClientProxy1_4()
 void
 CClientProxy1_4::gameDeviceButtons(GameDeviceID id, GameDeviceButton buttons)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG2 "send game device buttons to \"%s\" id=%d buttons=%d", getName().c_str(), id, buttons));
 	CProtocolUtil::writef(getStream(), kMsgDGameButtons, id, buttons);
 }
@@ -50,6 +56,7 @@ CClientProxy1_4::gameDeviceButtons(GameDeviceID id, GameDeviceButton buttons)
 void
 CClientProxy1_4::gameDeviceSticks(GameDeviceID id, SInt16 x1, SInt16 y1, SInt16 x2, SInt16 y2)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG2 "send game device sticks to \"%s\" id=%d s1=%+d,%+d s2=%+d,%+d", getName().c_str(), id, x1, y1, x2, y2));
 	CProtocolUtil::writef(getStream(), kMsgDGameSticks, id, x1, y1, x2, y2);
 }
@@ -57,6 +64,7 @@ CClientProxy1_4::gameDeviceSticks(GameDeviceID id, SInt16 x1, SInt16 y1, SInt16
 void
 CClientProxy1_4::gameDeviceTriggers(GameDeviceID id, UInt8 t1, UInt8 t2)
 {
+	flushMotion();
 	LOG((CLOG_DEBUG2 "send game device triggers to \"%s\" id=%d t1=%d t2=%d", getName().c_str(), id, t1, t2));
 	CProtocolUtil::writef(getStream(), kMsgDGameTriggers, id, t1, t2);
 }
@@ -64,6 +72,7 @@ CClientProxy1_4::gameDeviceTriggers(GameDeviceID id, UInt8 t1, UInt8 t2)
 void
 CClientProxy1_4::gameDeviceTimingReq()
 {
+	flushMotion();
 	LOG((CLOG_DEBUG2 "send game device timing request to \"%s\"", getName().c_str()));
 	CProtocolUtil::writef(getStream(), kMsgCGameTimingReq);
 }
@@ -92,6 +101,9 @@ CClientProxy1_4::keyUp(KeyID key, KeyModifierMask mask, KeyButton button)
 void
 CClientProxy1_4::cryptoIv()
 {
+	// motion held back was meant to go before the key
+	flushMotion();
+
 	CCryptoStream* cryptoStream = dynamic_cast<CCryptoStream*>(getStream());
 	if (cryptoStream == NULL) {
 		return;
@@ -110,25 +122,6 @@ CClientProxy1_4::cryptoIv()
 }
 
 bool
-CClientProxy1_4::parseMessage(const UInt8* code)
-{
-	// process message
-	if (memcmp(code, kMsgCGameTimingResp, 4) == 0) {
-		gameDeviceTimingResp();
-	}
-	
-	else if (memcmp(code, kMsgDGameFeedback, 4) == 0) {
-		gameDeviceFeedback();
-	}
-
-	else {
-		return CClientProxy1_3::parseMessage(code);
-	}
-
-	return true;
-}
-
-void
 CClientProxy1_4::gameDeviceFeedback()
 {
 	// parse
@@ -139,9 +132,10 @@ CClientProxy1_4::gameDeviceFeedback()
 
 	// forward
 	m_server->gameDeviceFeedback(id, m1, m2);
+	return true;
 }
 
-void
+bool
 CClientProxy1_4::gameDeviceTimingResp()
 {
 	// parse
@@ -151,4 +145,5 @@ CClientProxy1_4::gameDeviceTimingResp()
 
 	// forward
 	m_server->gameDeviceTimingResp(freq);
+	return true;
 }
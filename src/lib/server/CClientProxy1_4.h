@@ -41,14 +41,10 @@ public:
 	//! Send IV to make 
 	void				cryptoIv();
 
-protected:
-	// CClientProxy overrides
-	virtual bool		parseMessage(const UInt8* code);
-
 private:
 	// message handlers
-	void				gameDeviceTimingResp();
-	void				gameDeviceFeedback();
+	bool				gameDeviceTimingResp();
+	bool				gameDeviceFeedback();
 
 	CServer*			m_server;
 };
@@ -951,6 +951,10 @@ CConfig::readSectionScreens(CConfigReadContext& s)
 				addOption(screen, kOptionScreenPreserveFocus,
 					s.parseBoolean(value));
 			}
+			else if (name == "mouseMoveRate") {
+				addOption(screen, kOptionMouseMoveRate,
+					s.parseInt(value));
+			}
 			else {
 				// unknown argument
 				throw XConfigRead(s, "unknown argument \"%{1}\"", name);
@@ -1407,6 +1411,9 @@ CConfig::getOptionName(OptionID id)
 	if (id == kOptionScreenPreserveFocus) {
 		return "preserveFocus";
 	}
+	if (id == kOptionMouseMoveRate) {
+		return "mouseMoveRate";
+	}
 	return NULL;
 }
 
@@ -1475,7 +1482,8 @@ CConfig::getOptionValue(OptionID id, OptionValue value)
 	if (id == kOptionHeartbeat ||
 		id == kOptionScreenSwitchCornerSize ||
 		id == kOptionScreenSwitchDelay ||
-		id == kOptionScreenSwitchTwoTap) {
+		id == kOptionScreenSwitchTwoTap ||
+		id == kOptionMouseMoveRate) {
 		return CStringUtil::print("%d", value);
 	}
 	if (id == kOptionScreenSwitchCorners) {
@@ -21,14 +21,50 @@
 #include "CPrimaryClient.h"
 #include "CKeyMap.h"
 #include "CEventQueue.h"
+#include "CEventDataPool.h"
 #include "CLog.h"
 #include "TMethodEventJob.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
+// modifiers that cannot be combined with a mouse button
+static const KeyModifierMask s_buttonIgnoreMask =
+	KeyModifierAltGr | KeyModifierCapsLock |
+	KeyModifierNumLock | KeyModifierScrollLock;
+
 // -----------------------------------------------------------------------------
 // Input Filter Condition Classes
 // -----------------------------------------------------------------------------
+CInputFilter::CEventKey::CEventKey() :
+	m_kind(kAnyEvent),
+	m_id(0),
+	m_mask(0)
+{
+	// do nothing
+}
+
+CInputFilter::CEventKey::CEventKey(EKind kind,
+				UInt32 id, KeyModifierMask mask) :
+	m_kind(kind),
+	m_id(id),
+	m_mask(mask)
+{
+	// do nothing
+}
+
+bool
+CInputFilter::CEventKey::operator<(const CEventKey& x) const
+{
+	if (m_kind != x.m_kind) {
+		return (m_kind < x.m_kind);
+	}
+	if (m_id != x.m_id) {
+		return (m_id < x.m_id);
+	}
+	return (m_mask < x.m_mask);
+}
+
 CInputFilter::CCondition::CCondition()
 {
 	// do nothing
@@ -39,6 +75,12 @@ CInputFilter::CCondition::~CCondition()
 	// do nothing
 }
 
+CInputFilter::CEventKey
+CInputFilter::CCondition::getEventKey() const
+{
+	return CEventKey();
+}
+
 void
 CInputFilter::CCondition::enablePrimary(CPrimaryClient*)
 {
@@ -57,7 +99,7 @@ CInputFilter::CKeystrokeCondition::CKeystrokeCondition(
 	m_key(info->m_key),
 	m_mask(info->m_mask)
 {
-	free(info);
+	CEventDataPool::release(info);
 }
 
 CInputFilter::CKeystrokeCondition::CKeystrokeCondition(
@@ -126,6 +168,12 @@ CInputFilter::CKeystrokeCondition::match(const CEvent& event)
 	return status;
 }
 
+CInputFilter::CEventKey
+CInputFilter::CKeystrokeCondition::getEventKey() const
+{
+	return CEventKey(CEventKey::kHotKey, m_id, 0);
+}
+
 void
 CInputFilter::CKeystrokeCondition::enablePrimary(CPrimaryClient* primary)
 {
@@ -144,7 +192,7 @@ CInputFilter::CMouseButtonCondition::CMouseButtonCondition(
 	m_button(info->m_button),
 	m_mask(info->m_mask)
 {
-	free(info);
+	CEventDataPool::release(info);
 }
 
 CInputFilter::CMouseButtonCondition::CMouseButtonCondition(
@@ -191,10 +239,6 @@ CInputFilter::CMouseButtonCondition::format() const
 CInputFilter::EFilterStatus		
 CInputFilter::CMouseButtonCondition::match(const CEvent& event)
 {
-	static const KeyModifierMask s_ignoreMask =
-		KeyModifierAltGr | KeyModifierCapsLock |
-		KeyModifierNumLock | KeyModifierScrollLock;
-
 	EFilterStatus status;
 
 	// check for hotkey events
@@ -214,13 +258,19 @@ CInputFilter::CMouseButtonCondition::match(const CEvent& event)
 	IPlatformScreen::CButtonInfo* minfo =
 		reinterpret_cast<IPlatformScreen::CButtonInfo*>(event.getData());
 	if (minfo->m_button != m_button ||
-		(minfo->m_mask & ~s_ignoreMask) != m_mask) {
+		(minfo->m_mask & ~s_buttonIgnoreMask) != m_mask) {
 		return kNoMatch;
 	}
 
 	return status;
 }
 
+CInputFilter::CEventKey
+CInputFilter::CMouseButtonCondition::getEventKey() const
+{
+	return CEventKey(CEventKey::kButton, m_button, m_mask);
+}
+
 CInputFilter::CScreenConnectedCondition::CScreenConnectedCondition(
 				const CString& screen) :
 	m_screen(screen)
@@ -481,13 +531,13 @@ CInputFilter::CKeystrokeAction::CKeystrokeAction(
 
 CInputFilter::CKeystrokeAction::~CKeystrokeAction()
 {
-	free(m_keyInfo);
+	CEventDataPool::release(m_keyInfo);
 }
 
 void
 CInputFilter::CKeystrokeAction::adoptInfo(IPlatformScreen::CKeyInfo* info)
 {
-	free(m_keyInfo);
+	CEventDataPool::release(m_keyInfo);
 	m_keyInfo = info;
 }
 
@@ -566,7 +616,7 @@ CInputFilter::CMouseButtonAction::CMouseButtonAction(
 
 CInputFilter::CMouseButtonAction::~CMouseButtonAction()
 {
-	free(m_buttonInfo);
+	CEventDataPool::release(m_buttonInfo);
 }
 
 const IPlatformScreen::CButtonInfo*
@@ -634,19 +684,22 @@ CInputFilter::CMouseButtonAction::formatName() const
 //
 
 CInputFilter::CRule::CRule() :
-	m_condition(NULL)
+	m_condition(NULL),
+	m_hits(0)
 {
 	// do nothing
 }
 
 CInputFilter::CRule::CRule(CCondition* adoptedCondition) :
-	m_condition(adoptedCondition)
+	m_condition(adoptedCondition),
+	m_hits(0)
 {
 	// do nothing
 }
 
 CInputFilter::CRule::CRule(const CRule& rule) :
-	m_condition(NULL)
+	m_condition(NULL),
+	m_hits(0)
 {
 	copy(rule);
 }
@@ -698,6 +751,7 @@ CInputFilter::CRule::copy(const CRule& rule)
 								i != rule.m_deactivateActions.end(); ++i) {
 		m_deactivateActions.push_back((*i)->clone());
 	}
+	m_hits = rule.m_hits;
 }
 
 void
@@ -791,6 +845,7 @@ CInputFilter::CRule::handleEvent(const CEvent& event)
 		LOG((CLOG_DEBUG1 "deactivate actions"));
 		break;
 	}
+	++m_hits;
 
 	// perform actions
 	for (CActionList::const_iterator i = actions->begin();
@@ -865,19 +920,27 @@ CInputFilter::CRule::getAction(bool onActivation, UInt32 index) const
 	}
 }
 
+UInt32
+CInputFilter::CRule::getHits() const
+{
+	return m_hits;
+}
+
 
 // -----------------------------------------------------------------------------
 // Input Filter Class
 // -----------------------------------------------------------------------------
 CInputFilter::CInputFilter() :
-	m_primaryClient(NULL)
+	m_primaryClient(NULL),
+	m_indexDirty(true)
 {
 	// do nothing
 }
 
 CInputFilter::CInputFilter(const CInputFilter& x) :
 	m_ruleList(x.m_ruleList),
-	m_primaryClient(NULL)
+	m_primaryClient(NULL),
+	m_indexDirty(true)
 {
 	setPrimaryClient(x.m_primaryClient);
 }
@@ -894,7 +957,8 @@ CInputFilter::operator=(const CInputFilter& x)
 		CPrimaryClient* oldClient = m_primaryClient;
 		setPrimaryClient(NULL);
 
-		m_ruleList = x.m_ruleList;
+		m_ruleList   = x.m_ruleList;
+		m_indexDirty = true;
 
 		setPrimaryClient(oldClient);
 	}
@@ -908,6 +972,7 @@ CInputFilter::addFilterRule(const CRule& rule)
 	if (m_primaryClient != NULL) {
 		m_ruleList.back().enable(m_primaryClient);
 	}
+	m_indexDirty = true;
 }
 
 void
@@ -917,10 +982,19 @@ CInputFilter::removeFilterRule(UInt32 index)
 		m_ruleList[index].disable(m_primaryClient);
 	}
 	m_ruleList.erase(m_ruleList.begin() + index);
+	m_indexDirty = true;
 }
 
 CInputFilter::CRule&
 CInputFilter::getRule(UInt32 index)
+{
+	// the caller may change the rule's condition
+	m_indexDirty = true;
+	return m_ruleList[index];
+}
+
+const CInputFilter::CRule&
+CInputFilter::getRule(UInt32 index) const
 {
 	return m_ruleList[index];
 }
@@ -957,6 +1031,7 @@ CInputFilter::setPrimaryClient(CPrimaryClient* client)
 	}
 
 	m_primaryClient = client;
+	m_indexDirty    = true;
 
 	if (m_primaryClient != NULL) {
 		EVENTQUEUE->adoptHandler(IPlatformScreen::getKeyDownEvent(*EVENTQUEUE),
@@ -1048,6 +1123,50 @@ CInputFilter::operator!=(const CInputFilter& x) const
 	return !operator==(x);
 }
 
+void
+CInputFilter::buildIndex()
+{
+	m_ruleIndex.clear();
+	m_anyEventRules.clear();
+	for (UInt32 i = 0; i < m_ruleList.size(); ++i) {
+		const CCondition* condition = m_ruleList[i].getCondition();
+		if (condition == NULL) {
+			// NULL condition never matches
+			continue;
+		}
+		CEventKey key = condition->getEventKey();
+		if (key.m_kind == CEventKey::kAnyEvent) {
+			m_anyEventRules.push_back(i);
+		}
+		else {
+			m_ruleIndex[key].push_back(i);
+		}
+	}
+	m_indexDirty = false;
+}
+
+CInputFilter::CEventKey
+CInputFilter::getEventKey(const CEvent& event)
+{
+	CEvent::Type type = event.getType();
+	if (type == IPrimaryScreen::getHotKeyDownEvent() ||
+		type == IPrimaryScreen::getHotKeyUpEvent()) {
+		IPrimaryScreen::CHotKeyInfo* kinfo =
+			reinterpret_cast<IPlatformScreen::CHotKeyInfo*>(event.getData());
+		return CEventKey(CEventKey::kHotKey, kinfo->m_id, 0);
+	}
+	else if (type == IPrimaryScreen::getButtonDownEvent() ||
+			 type == IPrimaryScreen::getButtonUpEvent()) {
+		IPlatformScreen::CButtonInfo* minfo =
+			reinterpret_cast<IPlatformScreen::CButtonInfo*>(event.getData());
+		return CEventKey(CEventKey::kButton, minfo->m_button,
+							minfo->m_mask & ~s_buttonIgnoreMask);
+	}
+	else {
+		return CEventKey();
+	}
+}
+
 void
 CInputFilter::handleEvent(const CEvent& event, void*)
 {
@@ -1056,11 +1175,36 @@ CInputFilter::handleEvent(const CEvent& event, void*)
 								event.getFlags() | CEvent::kDontFreeData |
 								CEvent::kDeliverImmediately);
 
-	// let each rule try to match the event until one does
-	for (CRuleList::iterator rule  = m_ruleList.begin();
-							 rule != m_ruleList.end(); ++rule) {
-		if (rule->handleEvent(myEvent)) {
+	// find the rules that could match the event
+	if (m_indexDirty) {
+		buildIndex();
+	}
+	static const CRuleIndices s_noRules;
+	const CRuleIndices* keyRules = &s_noRules;
+	CEventKey key = getEventKey(event);
+	if (key.m_kind != CEventKey::kAnyEvent) {
+		CRuleIndex::const_iterator index = m_ruleIndex.find(key);
+		if (index != m_ruleIndex.end()) {
+			keyRules = &index->second;
+		}
+	}
+
+	// let each of those rules try to match the event, in the order
+	// the rules were added, until one does
+	CRuleIndices::const_iterator i = keyRules->begin();
+	CRuleIndices::const_iterator j = m_anyEventRules.begin();
+	while (i != keyRules->end() || j != m_anyEventRules.end()) {
+		UInt32 rule;
+		if (j == m_anyEventRules.end() ||
+			(i != keyRules->end() && *i < *j)) {
+			rule = *i++;
+		}
+		else {
+			rule = *j++;
+		}
+		if (m_ruleList[rule].handleEvent(myEvent)) {
 			// handled
+			LOG((CLOG_DEBUG2 "rule %d matched %d times", rule, m_ruleList[rule].getHits()));
 			return;
 		}
 	}
@@ -26,6 +26,7 @@
 #include "CString.h"
 #include "stdmap.h"
 #include "stdset.h"
+#include "stdvector.h"
 
 class CPrimaryClient;
 class CEvent;
@@ -41,6 +42,27 @@ public:
 		kDeactivate
 	};
 
+	// the events a condition can match.  rules are indexed by this so
+	// an event is only matched against rules that could match it.
+	class CEventKey {
+	public:
+		enum EKind {
+			kAnyEvent,		// may match any event
+			kHotKey,		// hot key events with hot key id m_id
+			kButton			// button events with button m_id and m_mask
+		};
+
+		CEventKey();
+		CEventKey(EKind, UInt32 id, KeyModifierMask mask);
+
+		bool					operator<(const CEventKey&) const;
+
+	public:
+		EKind					m_kind;
+		UInt32					m_id;
+		KeyModifierMask			m_mask;
+	};
+
 	class CCondition {
 	public:
 		CCondition();
@@ -51,6 +73,9 @@ public:
 
 		virtual EFilterStatus	match(const CEvent&) = 0;
 
+		// get the events match() can return other than kNoMatch for
+		virtual CEventKey		getEventKey() const;
+
 		virtual void			enablePrimary(CPrimaryClient*);
 		virtual void			disablePrimary(CPrimaryClient*);
 	};
@@ -69,6 +94,7 @@ public:
 		virtual CCondition*		clone() const;
 		virtual CString			format() const;
 		virtual EFilterStatus	match(const CEvent&);
+		virtual CEventKey		getEventKey() const;
 		virtual void			enablePrimary(CPrimaryClient*);
 		virtual void			disablePrimary(CPrimaryClient*);
 
@@ -92,6 +118,7 @@ public:
 		virtual CCondition*		clone() const;
 		virtual CString			format() const;
 		virtual EFilterStatus	match(const CEvent&);
+		virtual CEventKey		getEventKey() const;
 
 	private:
 		ButtonID				m_button;
@@ -289,6 +316,9 @@ public:
 		// get action by index
 		const CAction&	getAction(bool onActivation, UInt32 index) const;
 
+		// get number of events that have matched the rule
+		UInt32			getHits() const;
+
 	private:
 		void			clear();
 		void			copy(const CRule&);
@@ -299,6 +329,7 @@ public:
 		CCondition*		m_condition;
 		CActionList		m_activateActions;
 		CActionList		m_deactivateActions;
+		UInt32			m_hits;
 	};
 
 	// -------------------------------------------------------------------------
@@ -320,6 +351,7 @@ public:
 
 	// get rule by index
 	CRule&				getRule(UInt32 index);
+	const CRule&		getRule(UInt32 index) const;
 
 	// enable event filtering using the given primary client.  disable
 	// if client is NULL.
@@ -336,13 +368,34 @@ public:
 	//! Compare filters
 	bool				operator!=(const CInputFilter&) const;
 
+#ifdef TEST_ENV
+	void				handleEventForTest(const CEvent& event) { handleEvent(event, NULL); }
+#endif
+
 private:
+	typedef std::vector<UInt32> CRuleIndices;
+	typedef std::map<CEventKey, CRuleIndices> CRuleIndex;
+
+	// rebuild m_ruleIndex and m_anyEventRules from m_ruleList
+	void				buildIndex();
+
+	// get the key conditions use for the events they can match
+	static CEventKey	getEventKey(const CEvent&);
+
 	// event handling
 	void				handleEvent(const CEvent&, void*);
 
 private:
 	CRuleList			m_ruleList;
 	CPrimaryClient*		m_primaryClient;
+
+	// indices into m_ruleList, in order, of the rules that can match
+	// events with each key and of the rules that can match any event.
+	// hot key ids are only known while rules are enabled so the index
+	// is rebuilt lazily whenever the rules may have changed.
+	CRuleIndex			m_ruleIndex;
+	CRuleIndices		m_anyEventRules;
+	bool				m_indexDirty;
 };
 
 #endif
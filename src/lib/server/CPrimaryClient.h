@@ -38,6 +38,10 @@ public:
 	CPrimaryClient(const CString& name, CScreen* screen);
 	~CPrimaryClient();
 
+#ifdef TEST_ENV
+	CPrimaryClient() : CBaseClientProxy("primary"), m_screen(NULL) { }
+#endif
+
 	//! @name manipulators
 	//@{
 
@@ -52,13 +56,13 @@ public:
 	Registers a system-wide hotkey for key \p key with modifiers \p mask.
 	Returns an id used to unregister the hotkey.
 	*/
-	UInt32				registerHotKey(KeyID key, KeyModifierMask mask);
+	virtual UInt32		registerHotKey(KeyID key, KeyModifierMask mask);
 
 	//! Unregister a system hotkey
 	/*!
 	Unregisters a previously registered hot key.
 	*/
-	void				unregisterHotKey(UInt32 id);
+	virtual void		unregisterHotKey(UInt32 id);
 
 	//! Prepare to synthesize input on primary screen
 	/*!
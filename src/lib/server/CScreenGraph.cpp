@@ -0,0 +1,187 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CScreenGraph.h"
+#include "CConfig.h"
+#include <algorithm>
+#include <cassert>
+
+//
+// CScreenGraph
+//
+
+CScreenGraph::CScreenGraph()
+{
+	m_edges.push_back(0);
+}
+
+CScreenGraph::~CScreenGraph()
+{
+	// do nothing
+}
+
+void
+CScreenGraph::build(const CConfig& config)
+{
+	m_links.clear();
+	m_edges.clear();
+	m_names.clear();
+	m_clients.clear();
+	m_ids.clear();
+
+	// number the screens
+	for (CConfig::const_iterator index = config.begin();
+								index != config.end(); ++index) {
+		m_ids[*index] = static_cast<ScreenID>(m_names.size());
+		m_names.push_back(*index);
+	}
+	for (CConfig::all_const_iterator index = config.beginAll();
+								index != config.endAll(); ++index) {
+		CIDMap::const_iterator id = m_ids.find(index->second);
+		if (id != m_ids.end()) {
+			m_ids[index->first] = id->second;
+		}
+	}
+	m_clients.resize(m_names.size(), NULL);
+
+	// compile the links of each side of each screen.  the config keeps
+	// a screen's links ordered by side then start so each side's links
+	// come out sorted.
+	m_edges.push_back(0);
+	for (CNames::const_iterator name = m_names.begin();
+								name != m_names.end(); ++name) {
+		CConfig::link_const_iterator index = config.beginNeighbor(*name);
+		CConfig::link_const_iterator end   = config.endNeighbor(*name);
+		for (int side = kFirstDirection; side <= kLastDirection; ++side) {
+			for (; index != end &&
+					index->first.getSide() == static_cast<EDirection>(side);
+					++index) {
+				ScreenID dst = getID(index->second.getName());
+				if (dst == kNoScreen) {
+					continue;
+				}
+
+				CLink link;
+				link.m_start    = index->first.getInterval().first;
+				link.m_end      = index->first.getInterval().second;
+				link.m_dst      = dst;
+				link.m_dstStart = index->second.getInterval().first;
+				link.m_dstEnd   = index->second.getInterval().second;
+				m_links.push_back(link);
+			}
+			m_edges.push_back(static_cast<UInt32>(m_links.size()));
+		}
+		assert(index == end);
+	}
+}
+
+void
+CScreenGraph::setClient(ScreenID id, CBaseClientProxy* client)
+{
+	assert(id < m_clients.size());
+
+	m_clients[id] = client;
+}
+
+CScreenGraph::ScreenID
+CScreenGraph::getID(const CString& name) const
+{
+	CIDMap::const_iterator index = m_ids.find(name);
+	if (index == m_ids.end()) {
+		return kNoScreen;
+	}
+	return index->second;
+}
+
+const CString&
+CScreenGraph::getName(ScreenID id) const
+{
+	assert(id < m_names.size());
+
+	return m_names[id];
+}
+
+CBaseClientProxy*
+CScreenGraph::getClient(ScreenID id) const
+{
+	if (id >= m_clients.size()) {
+		return NULL;
+	}
+	return m_clients[id];
+}
+
+CScreenGraph::ScreenID
+CScreenGraph::getNeighbor(ScreenID id, EDirection side,
+				float position, float* positionOut) const
+{
+	assert(side >= kFirstDirection && side <= kLastDirection);
+
+	if (id >= m_names.size()) {
+		return kNoScreen;
+	}
+
+	// find the last link starting at or before position
+	UInt32 edge = getEdge(id, side);
+	if (m_edges[edge] == m_edges[edge + 1]) {
+		return kNoScreen;
+	}
+	const CLink* begin = &m_links[0] + m_edges[edge];
+	const CLink* end   = &m_links[0] + m_edges[edge + 1];
+	CLink key;
+	key.m_start = position;
+	const CLink* link = std::upper_bound(begin, end, key);
+	if (link == begin) {
+		return kNoScreen;
+	}
+	--link;
+	if (position < link->m_start || position >= link->m_end) {
+		return kNoScreen;
+	}
+
+	// compute position on neighbor.  this must match the arithmetic
+	// in CConfig::CCellEdge.
+	if (positionOut != NULL) {
+		float t      = (position - link->m_start) /
+							(link->m_end - link->m_start);
+		*positionOut = t * (link->m_dstEnd - link->m_dstStart) +
+							link->m_dstStart;
+	}
+	return link->m_dst;
+}
+
+UInt32
+CScreenGraph::getNumScreens() const
+{
+	return static_cast<UInt32>(m_names.size());
+}
+
+UInt32
+CScreenGraph::getEdge(ScreenID id, EDirection side) const
+{
+	return id * kNumDirections + (side - kFirstDirection);
+}
+
+
+//
+// CScreenGraph::CLink
+//
+
+bool
+CScreenGraph::CLink::operator<(const CLink& x) const
+{
+	return (m_start < x.m_start);
+}
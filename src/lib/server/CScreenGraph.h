@@ -0,0 +1,139 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSCREENGRAPH_H
+#define CSCREENGRAPH_H
+
+#include "ProtocolTypes.h"
+#include "CString.h"
+#include "CStringUtil.h"
+#include "stdmap.h"
+#include "stdvector.h"
+
+class CBaseClientProxy;
+class CConfig;
+
+//! Screen neighbor graph
+/*!
+A compiled form of the screen links in a CConfig for use while the
+mouse is moving.  Each screen gets a dense integer id and each side of
+each screen gets an array of links sorted by position, so finding the
+neighbor at a position on a side is a binary search with no string
+compares and no allocation.  The graph also tracks which client, if
+any, is connected as each screen.
+*/
+class CScreenGraph {
+public:
+	typedef UInt32 ScreenID;
+	enum { kNoScreen = 0xffffffffu };
+
+	CScreenGraph();
+	~CScreenGraph();
+
+	//! @name manipulators
+	//@{
+
+	//! Compile configuration
+	/*!
+	Replaces the graph with the screens and links in \c config.  All
+	screens are initially unconnected.
+	*/
+	void				build(const CConfig& config);
+
+	//! Set connected client
+	/*!
+	Sets the client connected as screen \c id, or \c NULL if it's not
+	connected.
+	*/
+	void				setClient(ScreenID id, CBaseClientProxy* client);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Get screen id
+	/*!
+	Returns the id of the screen named \c name, which may be an alias,
+	or \c kNoScreen if there's no such screen.
+	*/
+	ScreenID			getID(const CString& name) const;
+
+	//! Get screen name
+	/*!
+	Returns the canonical name of screen \c id.
+	*/
+	const CString&		getName(ScreenID id) const;
+
+	//! Get connected client
+	/*!
+	Returns the client connected as screen \c id or \c NULL if it's
+	not connected.
+	*/
+	CBaseClientProxy*	getClient(ScreenID id) const;
+
+	//! Get neighbor
+	/*!
+	Returns the id of the neighbor of screen \c id on side \c side at
+	\c position, whether or not it's connected, or \c kNoScreen if
+	there's no neighbor there.  If there's a neighbor and \c positionOut
+	isn't \c NULL then it's set to the position on the neighbor.  This
+	gives the same results as CConfig::getNeighbor().
+	*/
+	ScreenID			getNeighbor(ScreenID id, EDirection side,
+							float position, float* positionOut) const;
+
+	//! Get number of screens
+	UInt32				getNumScreens() const;
+
+	//@}
+
+private:
+	// a link from an interval on one side of a screen to an interval
+	// on the opposite side of another
+	class CLink {
+	public:
+		float			m_start;
+		float			m_end;
+		ScreenID		m_dst;
+		float			m_dstStart;
+		float			m_dstEnd;
+
+		bool			operator<(const CLink&) const;
+	};
+	typedef std::vector<CLink> CLinks;
+	typedef std::vector<UInt32> CEdges;
+	typedef std::vector<CString> CNames;
+	typedef std::vector<CBaseClientProxy*> CClients;
+	typedef std::map<CString, ScreenID, CStringUtil::CaselessCmp> CIDMap;
+
+	UInt32				getEdge(ScreenID id, EDirection side) const;
+
+private:
+	// the links of side s of screen i are m_links[m_edges[j]] up to
+	// m_links[m_edges[j + 1]] where j = i * kNumDirections + s - 1
+	CLinks				m_links;
+	CEdges				m_edges;
+
+	// indexed by screen id
+	CNames				m_names;
+	CClients			m_clients;
+
+	// screen and alias names to screen id
+	CIDMap				m_ids;
+};
+
+#endif
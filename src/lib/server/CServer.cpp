@@ -91,11 +91,7 @@ CServer::CServer(const CConfig& config, CPrimaryClient* primaryClient, CScreen*
 		CClipboardInfo& clipboard   = m_clipboards[id];
 		clipboard.m_clipboardOwner  = primaryName;
 		clipboard.m_clipboardSeqNum = m_seqNum;
-		if (clipboard.m_clipboard.open(0)) {
-			clipboard.m_clipboard.empty();
-			clipboard.m_clipboard.close();
-		}
-		clipboard.m_clipboardData   = clipboard.m_clipboard.marshall();
+		clipboard.m_clipboardHash   = clipboard.m_clipboard.getHash();
 	}
 
 	// install event handlers
@@ -275,6 +271,15 @@ CServer::setConfig(const CConfig& config)
 
 	// cut over
 	m_config = config;
+	m_screens.build(m_config);
+	for (CClientList::const_iterator index = m_clients.begin();
+								index != m_clients.end(); ++index) {
+		CScreenGraph::ScreenID id = m_screens.getID(index->first);
+		index->second->setScreenID(id);
+		if (id != CScreenGraph::kNoScreen) {
+			m_screens.setClient(id, index->second);
+		}
+	}
 	processOptions();
 
 	// add ScrollLock as a hotkey to lock to the screen.  this was a
@@ -661,44 +666,50 @@ CServer::getNeighbor(CBaseClientProxy* src,
 
 	assert(src != NULL);
 
-	// get source screen name
-	CString srcName = getName(src);
-	assert(!srcName.empty());
-	LOG((CLOG_DEBUG2 "find neighbor on %s of \"%s\"", CConfig::dirName(dir), srcName.c_str()));
+	// get source screen
+	CScreenGraph::ScreenID srcID = src->getScreenID();
+	if (srcID == CScreenGraph::kNoScreen) {
+		return NULL;
+	}
+	LOG((CLOG_DEBUG2 "find neighbor on %s of \"%s\"", CConfig::dirName(dir), m_screens.getName(srcID).c_str()));
 
 	// convert position to fraction
 	float t = mapToFraction(src, dir, x, y);
 
-	// search for the closest neighbor that exists in direction dir
+	// search for the closest neighbor that exists in direction dir.
+	// we can't visit more screens than there are without going in a
+	// loop through unconnected screens.
 	float tTmp;
-	for (;;) {
-		CString dstName(m_config.getNeighbor(srcName, dir, t, &tTmp));
+	for (UInt32 n = m_screens.getNumScreens(); n > 0; --n) {
+		CScreenGraph::ScreenID dstID =
+			m_screens.getNeighbor(srcID, dir, t, &tTmp);
 
 		// if nothing in that direction then return NULL. if the
 		// destination is the source then we can make no more
 		// progress in this direction.  since we haven't found a
 		// connected neighbor we return NULL.
-		if (dstName.empty()) {
-			LOG((CLOG_DEBUG2 "no neighbor on %s of \"%s\"", CConfig::dirName(dir), srcName.c_str()));
+		if (dstID == CScreenGraph::kNoScreen) {
+			LOG((CLOG_DEBUG2 "no neighbor on %s of \"%s\"", CConfig::dirName(dir), m_screens.getName(srcID).c_str()));
 			return NULL;
 		}
 
 		// look up neighbor cell.  if the screen is connected and
 		// ready then we can stop.
-		CClientList::const_iterator index = m_clients.find(dstName);
-		if (index != m_clients.end()) {
-			LOG((CLOG_DEBUG2 "\"%s\" is on %s of \"%s\" at %f", dstName.c_str(), CConfig::dirName(dir), srcName.c_str(), t));
-			mapToPixel(index->second, dir, tTmp, x, y);
-			return index->second;
+		CBaseClientProxy* dst = m_screens.getClient(dstID);
+		if (dst != NULL) {
+			LOG((CLOG_DEBUG2 "\"%s\" is on %s of \"%s\" at %f", m_screens.getName(dstID).c_str(), CConfig::dirName(dir), m_screens.getName(srcID).c_str(), t));
+			mapToPixel(dst, dir, tTmp, x, y);
+			return dst;
 		}
 
 		// skip over unconnected screen
-		LOG((CLOG_DEBUG2 "ignored \"%s\" on %s of \"%s\"", dstName.c_str(), CConfig::dirName(dir), srcName.c_str()));
-		srcName = dstName;
+		LOG((CLOG_DEBUG2 "ignored \"%s\" on %s of \"%s\"", m_screens.getName(dstID).c_str(), CConfig::dirName(dir), m_screens.getName(srcID).c_str()));
+		srcID = dstID;
 
 		// use position on skipped screen
 		t = tTmp;
 	}
+	return NULL;
 }
 
 CBaseClientProxy*
@@ -817,7 +828,7 @@ CServer::avoidJumpZone(CBaseClientProxy* dst,
 		return;
 	}
 
-	const CString dstName(getName(dst));
+	CScreenGraph::ScreenID dstID = dst->getScreenID();
 	SInt32 dx, dy, dw, dh;
 	dst->getShape(dx, dy, dw, dh);
 	float t = mapToFraction(dst, dir, x, y);
@@ -828,25 +839,29 @@ CServer::avoidJumpZone(CBaseClientProxy* dst,
 	// don't need to move inwards because that side can't provoke a jump.
 	switch (dir) {
 	case kLeft:
-		if (!m_config.getNeighbor(dstName, kRight, t, NULL).empty() &&
+		if (m_screens.getNeighbor(dstID, kRight, t, NULL) !=
+				CScreenGraph::kNoScreen &&
 			x > dx + dw - 1 - z)
 			x = dx + dw - 1 - z;
 		break;
 
 	case kRight:
-		if (!m_config.getNeighbor(dstName, kLeft, t, NULL).empty() &&
+		if (m_screens.getNeighbor(dstID, kLeft, t, NULL) !=
+				CScreenGraph::kNoScreen &&
 			x < dx + z)
 			x = dx + z;
 		break;
 
 	case kTop:
-		if (!m_config.getNeighbor(dstName, kBottom, t, NULL).empty() &&
+		if (m_screens.getNeighbor(dstID, kBottom, t, NULL) !=
+				CScreenGraph::kNoScreen &&
 			y > dy + dh - 1 - z)
 			y = dy + dh - 1 - z;
 		break;
 
 	case kBottom:
-		if (!m_config.getNeighbor(dstName, kTop, t, NULL).empty() &&
+		if (m_screens.getNeighbor(dstID, kTop, t, NULL) !=
+				CScreenGraph::kNoScreen &&
 			y < dy + z)
 			y = dy + z;
 		break;
@@ -1297,11 +1312,8 @@ CServer::handleClipboardGrabbed(const CEvent& event, void* vclient)
 	clipboard.m_clipboardSeqNum = info->m_sequenceNumber;
 
 	// clear the clipboard data (since it's not known at this point)
-	if (clipboard.m_clipboard.open(0)) {
-		clipboard.m_clipboard.empty();
-		clipboard.m_clipboard.close();
-	}
-	clipboard.m_clipboardData = clipboard.m_clipboard.marshall();
+	clipboard.m_clipboard     = CClipboardSnapshot();
+	clipboard.m_clipboardHash = clipboard.m_clipboard.getHash();
 
 	// tell all other screens to take ownership of clipboard.  tell the
 	// grabber that it's clipboard isn't dirty.
@@ -1597,19 +1609,23 @@ CServer::onClipboardChanged(CBaseClientProxy* sender,
 	// should be the expected client
 	assert(sender == m_clients.find(clipboard.m_clipboardOwner)->second);
 
-	// get data
-	sender->getClipboard(id, &clipboard.m_clipboard);
+	// get data.  a client proxy hands back the snapshot it received so
+	// only the primary screen's clipboard is copied and marshalled.
+	CClipboardSnapshot data = sender->getClipboardSnapshot(id);
 
 	// ignore if data hasn't changed
-	CString data = clipboard.m_clipboard.marshall();
-	if (data == clipboard.m_clipboardData) {
+	UInt64 hash = data.getHash();
+	if (hash == clipboard.m_clipboardHash) {
 		LOG((CLOG_DEBUG "ignored screen \"%s\" update of clipboard %d (unchanged)", clipboard.m_clipboardOwner.c_str(), id));
 		return;
 	}
 
 	// got new data
 	LOG((CLOG_INFO "screen \"%s\" updated clipboard %d", clipboard.m_clipboardOwner.c_str(), id));
-	clipboard.m_clipboardData = data;
+	clipboard.m_clipboardHash = hash;
+
+	// every client shares the snapshot
+	clipboard.m_clipboard     = data;
 
 	// tell all clients except the sender that the clipboard is dirty
 	for (CClientList::const_iterator index = m_clients.begin();
@@ -2067,6 +2083,10 @@ CServer::addClient(CBaseClientProxy* client)
 	// add to list
 	m_clientSet.insert(client);
 	m_clients.insert(std::make_pair(name, client));
+	client->setScreenID(m_screens.getID(name));
+	if (client->getScreenID() != CScreenGraph::kNoScreen) {
+		m_screens.setClient(client->getScreenID(), client);
+	}
 
 	// initialize client data
 	SInt32 x, y;
@@ -2097,6 +2117,10 @@ CServer::removeClient(CBaseClientProxy* client)
 							client->getEventTarget());
 
 	// remove from list
+	if (client->getScreenID() != CScreenGraph::kNoScreen) {
+		m_screens.setClient(client->getScreenID(), NULL);
+		client->setScreenID(CScreenGraph::kNoScreen);
+	}
 	m_clients.erase(getName(client));
 	m_clientSet.erase(i);
 
@@ -2238,7 +2262,7 @@ CServer::forceLeaveClient(CBaseClientProxy* client)
 
 CServer::CClipboardInfo::CClipboardInfo() :
 	m_clipboard(),
-	m_clipboardData(),
+	m_clipboardHash(0),
 	m_clipboardOwner(),
 	m_clipboardSeqNum(0)
 {
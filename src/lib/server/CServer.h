@@ -20,7 +20,8 @@
 #define CSERVER_H
 
 #include "CConfig.h"
-#include "CClipboard.h"
+#include "CScreenGraph.h"
+#include "CClipboardSnapshot.h"
 #include "ClipboardTypes.h"
 #include "KeyTypes.h"
 #include "MouseTypes.h"
@@ -412,8 +413,8 @@ private:
 		CClipboardInfo();
 
 	public:
-		CClipboard		m_clipboard;
-		CString			m_clipboardData;
+		CClipboardSnapshot	m_clipboard;
+		UInt64			m_clipboardHash;
 		CString			m_clipboardOwner;
 		UInt32			m_clipboardSeqNum;
 	};
@@ -451,6 +452,9 @@ private:
 	// current configuration
 	CConfig				m_config;
 
+	// screen links compiled from m_config and the connected clients
+	CScreenGraph		m_screens;
+
 	// input filter (from m_config);
 	CInputFilter*		m_inputFilter;
 
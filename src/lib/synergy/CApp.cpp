@@ -40,7 +40,9 @@
 #endif
 
 #include <iostream>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #if WINAPI_CARBON
 #include <ApplicationServices/ApplicationServices.h>
@@ -48,6 +50,16 @@
 
 CApp* CApp::s_instance = nullptr;
 
+// number of messages the asynchronous log can hold
+static const UInt32 kAsyncLogRecords = 1024;
+
+// largest --log-max-size, in megabytes.  the size in bytes must fit in
+// 32 bits.
+static const int kMaxLogMaxSize = 4095;
+
+// largest --log-backups
+static const int kMaxLogBackups = 100;
+
 CApp::CApp(CreateTaskBarReceiverFunc createTaskBarReceiver, CArgsBase* args) :
 m_createTaskBarReceiver(createTaskBarReceiver),
 m_args(args),
@@ -63,6 +75,7 @@ m_ipcClient(nullptr)
 CApp::~CApp()
 {
 	delete m_args;
+	s_instance = nullptr;
 }
 
 bool
@@ -86,6 +99,21 @@ CApp::isArg(
 	return false;
 }
 
+int
+CApp::parseIntArg(const char* name, const char* value, int max)
+{
+	char* end;
+	errno = 0;
+	long n = strtol(value, &end, 10);
+	if (end == value || *end != '\0' || errno != 0 || n < 0 || n > max) {
+		LOG((CLOG_PRINT "%s: invalid value `%s' for `%s', expected 0 to %d" BYE,
+			argsBase().m_pname, value, name, max, argsBase().m_pname));
+		m_bye(kExitArgs);
+		return -1;
+	}
+	return static_cast<int>(n);
+}
+
 bool
 CApp::parseArg(const int& argc, const char* const* argv, int& i)
 {
@@ -103,6 +131,23 @@ CApp::parseArg(const int& argc, const char* const* argv, int& i)
 		argsBase().m_logFile = argv[++i];
 	}
 
+	else if (isArg(i, argc, argv, NULL, "--log-max-size", 1)) {
+		// rotate the log file at this many megabytes
+		const char* name = argv[i];
+		argsBase().m_logMaxSize = parseIntArg(name, argv[++i], kMaxLogMaxSize);
+	}
+
+	else if (isArg(i, argc, argv, NULL, "--log-backups", 1)) {
+		// number of rotated log files to keep
+		const char* name = argv[i];
+		argsBase().m_logBackups = parseIntArg(name, argv[++i], kMaxLogBackups);
+	}
+
+	else if (isArg(i, argc, argv, NULL, "--async-log")) {
+		// write log messages from a separate thread
+		argsBase().m_asyncLog = true;
+	}
+
 	else if (isArg(i, argc, argv, "-f", "--no-daemon")) {
 		// not a daemon
 		argsBase().m_daemon = false;
@@ -324,11 +369,33 @@ CApp::setupFileLogging()
 {
 	if (argsBase().m_logFile != NULL) {
 		m_fileLog = new CFileLogOutputter(argsBase().m_logFile);
+		if (argsBase().m_logMaxSize >= 0) {
+			UInt64 maxSize = (UInt64)argsBase().m_logMaxSize * 1024 * 1024;
+			if (maxSize > 0xffffffffu) {
+				maxSize = 0xffffffffu;
+			}
+			m_fileLog->setMaxSize((UInt32)maxSize);
+		}
+		if (argsBase().m_logBackups >= 0) {
+			m_fileLog->setBackups((UInt32)argsBase().m_logBackups);
+		}
 		CLOG->insert(m_fileLog);
 		LOG((CLOG_DEBUG1 "logging to file (%s) enabled", argsBase().m_logFile));
 	}
 }
 
+void
+CApp::startLogThreads()
+{
+	if (m_fileLog != NULL) {
+		m_fileLog->startFlushing();
+	}
+	if (argsBase().m_asyncLog) {
+		CLOG->startAsync(kAsyncLogRecords, CLog::kDropOnOverflow);
+		LOG((CLOG_DEBUG1 "asynchronous logging enabled"));
+	}
+}
+
 void 
 CApp::loggingFilterWarning()
 {
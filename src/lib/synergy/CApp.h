@@ -78,6 +78,11 @@ public:
 	// If --log was specified in args, then add a file logger.
 	void setupFileLogging();
 
+	// Start flushing the log file from a separate thread and, if
+	// --async-log was specified in args, writing log messages from
+	// another.  Must be called after daemonization.
+	void startLogThreads();
+
 	// If messages will be hidden (to improve performance), warn user.
 	void loggingFilterWarning();
 
@@ -100,6 +105,11 @@ private:
 protected:
 	virtual void parseArgs(int argc, const char* const* argv, int &i);
 	virtual bool parseArg(const int& argc, const char* const* argv, int& i);
+
+	// Returns value as a whole number from 0 to max.  Exits with a usage
+	// error for option name and returns -1 if it isn't one.
+	int					parseIntArg(const char* name, const char* value, int max);
+
 	void				initIpcClient();
 	void				cleanupIpcClient();
 
@@ -132,6 +142,11 @@ private:
 	"  -1, --no-restart         do not try to restart on failure.\n" \
 	"*     --restart            restart the server automatically if it fails.\n" \
 	"  -l  --log <file>         write log messages to file.\n" \
+	"      --log-max-size <mb>  start a new log file when it reaches this size,\n" \
+	"                             up to 4095.  0 never starts a new one.\n" \
+	"                             default is 10.\n" \
+	"      --log-backups <n>    keep n old log files, up to 100.  default is 3.\n" \
+	"      --async-log          write log messages from a separate thread.\n" \
 	"      --no-tray            disable the system tray icon.\n"
 
 #define HELP_COMMON_INFO_2 \
@@ -37,6 +37,9 @@ m_disableTray(false),
 m_pname(NULL),
 m_logFilter(NULL),
 m_logFile(NULL),
+m_asyncLog(false),
+m_logMaxSize(-1),
+m_logBackups(-1),
 m_display(NULL),
 m_enableVnc(false),
 m_enableIpc(false)
@@ -33,6 +33,9 @@ public:
 	const char* m_pname;
 	const char* m_logFilter;
 	const char*	m_logFile;
+	bool m_asyncLog;
+	int m_logMaxSize;
+	int m_logBackups;
 	const char*	m_display;
 	CString m_name;
 	bool m_disableTray;
@@ -34,6 +34,7 @@
 #include "XScreen.h"
 #include "LogOutputters.h"
 #include "CSocketMultiplexer.h"
+#include "CUSBEventHandler.h"
 #include "CEventQueue.h"
 #include "CThread.h"
 #include "TMethodJob.h"
@@ -545,6 +546,13 @@ CClientApp::mainLoop()
 	// on unix because threads evaporate across a fork().
 	CSocketMultiplexer multiplexer;
 
+	// service libusb from the multiplexer rather than a polling thread
+	CUSBEventHandler usbEventHandler(&multiplexer);
+
+	// like the multiplexer, the log's threads must be started after
+	// daemonization
+	startLogThreads();
+
 	// start client, etc
 	appUtil().startNode();
 	
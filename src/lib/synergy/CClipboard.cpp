@@ -17,6 +17,11 @@
  */
 
 #include "CClipboard.h"
+#include <cstring>
+
+// multipliers for hashing.  these are odd with well mixed bits.
+static const UInt64		kHashMultiplier1 = 0x9e3779b97f4a7c15ULL;
+static const UInt64		kHashMultiplier2 = 0xff51afd7ed558ccdULL;
 
 //
 // CClipboard
@@ -24,7 +29,8 @@
 
 CClipboard::CClipboard() :
 	m_open(false),
-	m_owner(false)
+	m_owner(false),
+	m_marshalled(false)
 {
 	open(0);
 	empty();
@@ -45,7 +51,10 @@ CClipboard::empty()
 	for (SInt32 index = 0; index < kNumFormats; ++index) {
 		m_data[index]  = "";
 		m_added[index] = false;
+		m_hash[index]  = 0;
 	}
+	m_marshalled = false;
+	m_marshalledData.clear();
 
 	// save time
 	m_timeOwned = m_time;
@@ -64,6 +73,9 @@ CClipboard::add(EFormat format, const CString& data)
 
 	m_data[format]  = data;
 	m_added[format] = true;
+	m_hash[format]  = hash(data);
+	m_marshalled    = false;
+	m_marshalledData.clear();
 }
 
 bool
@@ -114,5 +126,52 @@ CClipboard::unmarshall(const CString& data, Time time)
 CString
 CClipboard::marshall() const
 {
-	return IClipboard::marshall(this);
+	if (!m_marshalled) {
+		m_marshalledData = IClipboard::marshall(this);
+		m_marshalled     = true;
+	}
+	return m_marshalledData;
+}
+
+UInt64
+CClipboard::getHash() const
+{
+	// combine the hash of each format with the format and its size
+	UInt64 result = kHashMultiplier1;
+	for (SInt32 index = 0; index < kNumFormats; ++index) {
+		if (m_added[index]) {
+			result ^= static_cast<UInt64>(index);
+			result *= kHashMultiplier2;
+			result ^= static_cast<UInt64>(m_data[index].size());
+			result *= kHashMultiplier2;
+			result ^= m_hash[index];
+			result *= kHashMultiplier2;
+			result ^= (result >> 32);
+		}
+	}
+	return result;
+}
+
+UInt64
+CClipboard::hash(const CString& data)
+{
+	// hash 8 bytes at a time.  clipboard data can be many megabytes.
+	const char* src = data.data();
+	size_t n        = data.size();
+	UInt64 result   = kHashMultiplier1 ^ static_cast<UInt64>(n);
+	for (; n >= 8; src += 8, n -= 8) {
+		UInt64 word;
+		memcpy(&word, src, 8);
+		word   *= kHashMultiplier1;
+		word   ^= (word >> 32);
+		result  = (result ^ word) * kHashMultiplier2;
+	}
+	if (n > 0) {
+		UInt64 word = 0;
+		memcpy(&word, src, n);
+		word   *= kHashMultiplier1;
+		word   ^= (word >> 32);
+		result  = (result ^ word) * kHashMultiplier2;
+	}
+	return result ^ (result >> 29);
 }
@@ -51,6 +51,21 @@ public:
 	*/
 	CString				marshall() const;
 
+	//! Get content hash
+	/*!
+	Returns a hash of the formats and data in the clipboard.  Clipboards
+	with the same content have the same hash so comparing hashes is a
+	cheap way to tell if a clipboard has changed.  The data of each
+	format is hashed once, when it's added.
+	*/
+	UInt64				getHash() const;
+
+	//! Hash data
+	/*!
+	Returns the hash getHash() combines for the data of each format.
+	*/
+	static UInt64		hash(const CString& data);
+
 	//@}
 
 	// IClipboard overrides
@@ -69,6 +84,11 @@ private:
 	Time				m_timeOwned;
 	bool				m_added[kNumFormats];
 	CString				m_data[kNumFormats];
+	UInt64				m_hash[kNumFormats];
+
+	// marshall() saves its result until the clipboard changes
+	mutable bool		m_marshalled;
+	mutable CString		m_marshalledData;
 };
 
 #endif
@@ -0,0 +1,186 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CClipboardSnapshot.h"
+#include "CClipboard.h"
+#include "CArchAtomic.h"
+#include <assert.h>
+
+//
+// CClipboardSnapshot
+//
+
+CClipboardSnapshot::CClipboardSnapshot() :
+	m_data(new CData(CString(4, '\0'), 0))
+{
+	// do nothing
+}
+
+CClipboardSnapshot::CClipboardSnapshot(const IClipboard* clipboard) :
+	m_data(new CData(IClipboard::marshall(clipboard), clipboard->getTime()))
+{
+	// do nothing
+}
+
+CClipboardSnapshot::CClipboardSnapshot(const CString& data, Time time) :
+	m_data(new CData(data, time))
+{
+	// do nothing
+}
+
+CClipboardSnapshot::CClipboardSnapshot(const CClipboardSnapshot& other) :
+	IClipboard(),
+	m_data(other.m_data)
+{
+	CArchAtomic::add(&m_data->m_refCount, 1);
+}
+
+CClipboardSnapshot::~CClipboardSnapshot()
+{
+	release();
+}
+
+CClipboardSnapshot&
+CClipboardSnapshot::operator=(const CClipboardSnapshot& other)
+{
+	// add our reference first in case other shares our data
+	CArchAtomic::add(&other.m_data->m_refCount, 1);
+	release();
+	m_data = other.m_data;
+	return *this;
+}
+
+const CString&
+CClipboardSnapshot::getData() const
+{
+	return m_data->m_data;
+}
+
+bool
+CClipboardSnapshot::isSame(const CClipboardSnapshot& other) const
+{
+	return (m_data == other.m_data);
+}
+
+UInt64
+CClipboardSnapshot::getHash() const
+{
+	return m_data->m_hash;
+}
+
+bool
+CClipboardSnapshot::empty()
+{
+	// snapshots can't be changed
+	return false;
+}
+
+void
+CClipboardSnapshot::add(EFormat, const CString&)
+{
+	assert(0 && "snapshots can't be changed");
+}
+
+bool
+CClipboardSnapshot::open(Time) const
+{
+	return true;
+}
+
+void
+CClipboardSnapshot::close() const
+{
+	// do nothing
+}
+
+IClipboard::Time
+CClipboardSnapshot::getTime() const
+{
+	return m_data->m_time;
+}
+
+bool
+CClipboardSnapshot::has(EFormat format) const
+{
+	assert(format >= 0 && format < kNumFormats);
+	return m_data->m_added[format];
+}
+
+CString
+CClipboardSnapshot::get(EFormat format) const
+{
+	assert(format >= 0 && format < kNumFormats);
+	if (!m_data->m_added[format]) {
+		return CString();
+	}
+	return m_data->m_data.substr(m_data->m_offset[format],
+								m_data->m_size[format]);
+}
+
+void
+CClipboardSnapshot::release()
+{
+	if (CArchAtomic::add(&m_data->m_refCount, -1) == 0) {
+		delete m_data;
+	}
+}
+
+
+//
+// CClipboardSnapshot::CData
+//
+
+CClipboardSnapshot::CData::CData(const CString& data, Time time) :
+	m_refCount(1),
+	m_data(data),
+	m_hash(CClipboard::hash(data)),
+	m_time(time)
+{
+	for (SInt32 format = 0; format != kNumFormats; ++format) {
+		m_added[format]  = false;
+		m_offset[format] = 0;
+		m_size[format]   = 0;
+	}
+
+	// find each format's data.  like unmarshall() we skip formats we
+	// don't know but, since the data may have come from a client, we
+	// also stop at the first format that doesn't fit.
+	const size_t end = m_data.size();
+	const char* buffer = m_data.data();
+	if (end < 4) {
+		return;
+	}
+	const UInt32 numFormats = readUInt32(buffer);
+	size_t index = 4;
+	for (UInt32 i = 0; i < numFormats; ++i) {
+		if (end - index < 8) {
+			break;
+		}
+		UInt32 format = readUInt32(buffer + index);
+		UInt32 size   = readUInt32(buffer + index + 4);
+		index += 8;
+		if (end - index < size) {
+			break;
+		}
+		if (format < kNumFormats) {
+			m_added[format]  = true;
+			m_offset[format] = static_cast<UInt32>(index);
+			m_size[format]   = size;
+		}
+		index += size;
+	}
+}
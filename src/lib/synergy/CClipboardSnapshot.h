@@ -0,0 +1,111 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CCLIPBOARDSNAPSHOT_H
+#define CCLIPBOARDSNAPSHOT_H
+
+#include "IClipboard.h"
+
+//! Shared read only clipboard
+/*!
+This class holds an immutable copy of a clipboard's data in marshalled
+form.  Copying a snapshot only adds a reference to the same data so
+the server can hand one snapshot to every client without copying the
+data for each.  The data is read through the IClipboard interface and
+can't be changed:  empty() fails and add() is ignored.
+*/
+class CClipboardSnapshot : public IClipboard {
+public:
+	//! Create an empty snapshot
+	CClipboardSnapshot();
+
+	//! Snapshot a clipboard
+	/*!
+	Marshalls the data in \p clipboard, which must not be open.
+	*/
+	explicit CClipboardSnapshot(const IClipboard* clipboard);
+
+	//! Snapshot marshalled data
+	/*!
+	Takes data marshalled by IClipboard::marshall() and sets the
+	snapshot's time to \p time.  Formats that don't fit in \p data
+	are dropped.
+	*/
+	CClipboardSnapshot(const CString& data, Time time);
+
+	CClipboardSnapshot(const CClipboardSnapshot&);
+	virtual ~CClipboardSnapshot();
+
+	CClipboardSnapshot&	operator=(const CClipboardSnapshot&);
+
+	//! @name accessors
+	//@{
+
+	//! Get marshalled data
+	/*!
+	Returns the clipboard data as IClipboard::marshall() would.
+	*/
+	const CString&		getData() const;
+
+	//! Test for shared data
+	/*!
+	Returns true iff this snapshot and \p other refer to the same data.
+	*/
+	bool				isSame(const CClipboardSnapshot& other) const;
+
+	//! Get content hash
+	/*!
+	Returns a hash of the marshalled data.  Snapshots of the same data
+	have the same hash.  The data is hashed once, when it's snapshot.
+	*/
+	UInt64				getHash() const;
+
+	//@}
+
+	// IClipboard overrides
+	virtual bool		empty();
+	virtual void		add(EFormat, const CString& data);
+	virtual bool		open(Time) const;
+	virtual void		close() const;
+	virtual Time		getTime() const;
+	virtual bool		has(EFormat) const;
+	virtual CString		get(EFormat) const;
+
+private:
+	// the data shared by snapshots.  it's deleted along with the last
+	// snapshot referring to it.
+	class CData {
+	public:
+		CData(const CString& data, Time time);
+
+	public:
+		volatile SInt32	m_refCount;
+		CString			m_data;
+		UInt64			m_hash;
+		Time			m_time;
+		bool			m_added[kNumFormats];
+		UInt32			m_offset[kNumFormats];
+		UInt32			m_size[kNumFormats];
+	};
+
+	void				release();
+
+private:
+	CData*				m_data;
+};
+
+#endif
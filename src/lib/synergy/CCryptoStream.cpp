@@ -59,8 +59,10 @@ CCryptoStream::read(void* out, UInt32 n)
 	assert(m_key != NULL);
 	LOG((CLOG_DEBUG4 "crypto: read %i (decrypt)", n));
 
-	byte* cypher = new byte[n];
-	int result = getStream()->read(cypher, n);
+	// decrypt in place.  the modes we use are stream modes so the
+	// plaintext is the same size as the cyphertext.
+	byte* buffer = static_cast<byte*>(out);
+	int result = getStream()->read(buffer, n);
 	if (result == 0) {
 		// nothing to read.
 		return 0;
@@ -71,10 +73,14 @@ CCryptoStream::read(void* out, UInt32 n)
 		return 0;
 	}
 
-	logBuffer("cypher", cypher, n);
-	m_decryption.processData(static_cast<byte*>(out), cypher, n);
-	logBuffer("plaintext", static_cast<byte*>(out), n);
-	delete[] cypher;
+	bool logging = isLoggingBuffers();
+	if (logging) {
+		logBuffer("cypher", buffer, n);
+	}
+	m_decryption.processData(buffer, buffer, n);
+	if (logging) {
+		logBuffer("plaintext", buffer, n);
+	}
 	return result;
 }
 
@@ -84,12 +90,27 @@ CCryptoStream::write(const void* in, UInt32 n)
 	assert(m_key != NULL);
 	LOG((CLOG_DEBUG4 "crypto: write %i (encrypt)", n));
 
-	logBuffer("plaintext", static_cast<byte*>(const_cast<void*>(in)), n);
-	byte* cypher = new byte[n];
+	// ignore empty writes
+	if (n == 0) {
+		return;
+	}
+
+	// the caller's buffer is const so encrypt into our own, which only
+	// grows and is reused by every write
+	if (m_writeBuffer.size() < n) {
+		m_writeBuffer.resize(n);
+	}
+	byte* cypher = &m_writeBuffer[0];
+
+	bool logging = isLoggingBuffers();
+	if (logging) {
+		logBuffer("plaintext", static_cast<const byte*>(in), n);
+	}
 	m_encryption.processData(cypher, static_cast<const byte*>(in), n);
-	logBuffer("cypher", cypher, n);
+	if (logging) {
+		logBuffer("cypher", cypher, n);
+	}
 	getStream()->write(cypher, n);
-	delete[] cypher;
 }
 
 void
@@ -133,10 +154,16 @@ CCryptoStream::newIv(byte* out)
 	m_autoSeedRandomPool.GenerateBlock(out, CRYPTO_IV_SIZE);
 }
 
+bool
+CCryptoStream::isLoggingBuffers() const
+{
+	return (CLOG->getFilter() >= kDEBUG4);
+}
+
 void
 CCryptoStream::logBuffer(const char* name, const byte* buf, int length)
 {
-	if (CLOG->getFilter() < kDEBUG4) {
+	if (!isLoggingBuffers()) {
 		return;
 	}
 
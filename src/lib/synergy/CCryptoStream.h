@@ -22,6 +22,7 @@
 #include "CCryptoMode.h"
 #include <cryptopp562/osrng.h>
 #include <cryptopp562/sha.h>
+#include <vector>
 
 class CCryptoOptions;
 
@@ -69,9 +70,11 @@ public:
 	static void			createKey(byte* out, const CString& password, UInt8 keyLength, UInt8 hashCount);
 
 private:
+	bool				isLoggingBuffers() const;
 	void				logBuffer(const char* name, const byte* buf, int length);
 	
 	byte*				m_key;
+	std::vector<byte>	m_writeBuffer;
 	CCryptoMode			m_encryption;
 	CCryptoMode			m_decryption;
 	CryptoPP::AutoSeededRandomPool m_autoSeedRandomPool;
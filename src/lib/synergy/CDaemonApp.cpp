@@ -193,8 +193,11 @@ CDaemonApp::mainLoop(bool logToFile)
 		{
 		}*/
 
-		if (logToFile)
-			CLOG->insert(new CFileLogOutputter(logPath().c_str()));
+		if (logToFile) {
+			CFileLogOutputter* fileLog = new CFileLogOutputter(logPath().c_str());
+			fileLog->startFlushing();
+			CLOG->insert(fileLog);
+		}
 
 		// create socket multiplexer.  this must happen after daemonization
 		// on unix because threads evaporate across a fork().
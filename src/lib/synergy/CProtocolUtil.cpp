@@ -64,6 +64,16 @@ CProtocolUtil::readf(synergy::IStream* stream, const char* fmt, ...)
 	return result;
 }
 
+void
+CProtocolUtil::writeBuffer(synergy::IStream* stream,
+				const UInt8* buffer, UInt32 size)
+{
+	assert(stream != NULL);
+
+	stream->write(buffer, size);
+	LOG((CLOG_DEBUG2 "wrote %d bytes", size));
+}
+
 void
 CProtocolUtil::vwritef(synergy::IStream* stream,
 				const char* fmt, UInt32 size, va_list args)
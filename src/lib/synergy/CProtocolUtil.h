@@ -22,6 +22,7 @@
 #include "BasicTypes.h"
 #include "XIO.h"
 #include <stdarg.h>
+#include <cstring>
 
 namespace synergy { class IStream; }
 
@@ -72,7 +73,28 @@ public:
 	static bool			readf(synergy::IStream*,
 							const char* fmt, ...);
 
+	//! Write typed message
+	/*!
+	Write a fixed size message, one of the typed messages in
+	ProtocolTypes.h.  This is the same as writef() with the message's
+	format and parameters but doesn't parse the format or allocate.
+	*/
+	template <class T>
+	static void			writeMessage(synergy::IStream*, const T& message);
+
+	//! Read typed message
+	/*!
+	Read the parameters of a fixed size message, one of the typed
+	messages in ProtocolTypes.h, whose code has already been read.
+	This is the same as readf() with the message's format less its
+	code.  Returns true if the whole message was read, false otherwise.
+	*/
+	template <class T>
+	static bool			readMessage(synergy::IStream*, T& message);
+
 private:
+	static void			writeBuffer(synergy::IStream*,
+							const UInt8* buffer, UInt32 size);
 	static void			vwritef(synergy::IStream*,
 							const char* fmt, UInt32 size, va_list);
 	static void			vreadf(synergy::IStream*,
@@ -84,6 +106,31 @@ private:
 	static void			read(synergy::IStream*, void*, UInt32);
 };
 
+template <class T>
+void
+CProtocolUtil::writeMessage(synergy::IStream* stream, const T& message)
+{
+	UInt8 buffer[4 + T::kSize];
+	memcpy(buffer, T::getCode(), 4);
+	message.encode(buffer + 4);
+	writeBuffer(stream, buffer, sizeof(buffer));
+}
+
+template <class T>
+bool
+CProtocolUtil::readMessage(synergy::IStream* stream, T& message)
+{
+	UInt8 buffer[T::kSize > 0 ? T::kSize : 1];
+	try {
+		read(stream, buffer, T::kSize);
+	}
+	catch (XIO&) {
+		return false;
+	}
+	message.decode(buffer);
+	return true;
+}
+
 //! Mismatched read exception
 /*!
 Thrown by CProtocolUtil::readf() when the data being read does not
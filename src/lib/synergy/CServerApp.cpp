@@ -30,6 +30,7 @@
 #include "CPrimaryClient.h"
 #include "CScreen.h"
 #include "CSocketMultiplexer.h"
+#include "CUSBEventHandler.h"
 #include "CEventQueue.h"
 #include "LogOutputters.h"
 #include "CFunctionEventJob.h"
@@ -49,6 +50,7 @@
 #include "COSXScreen.h"
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <stdio.h>
@@ -778,6 +780,13 @@ CServerApp::mainLoop()
 	// on unix because threads evaporate across a fork().
 	CSocketMultiplexer multiplexer;
 
+	// service libusb from the multiplexer rather than a polling thread
+	CUSBEventHandler usbEventHandler(&multiplexer);
+
+	// like the multiplexer, the log's threads must be started after
+	// daemonization
+	startLogThreads();
+
 	// if configuration has no screens then add this system
 	// as the default
 	if (args().m_config->begin() == args().m_config->end()) {
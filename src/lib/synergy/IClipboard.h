@@ -164,7 +164,7 @@ public:
 
 	//@}
 
-private:
+protected:
 	static UInt32		readUInt32(const char*);
 	static void			writeUInt32(CString*, UInt32);
 };
@@ -18,6 +18,7 @@
 
 #include "IKeyState.h"
 #include "CEventQueue.h"
+#include "CEventDataPool.h"
 #include <cstring>
 #include <cstdlib>
 
@@ -68,7 +69,8 @@ IKeyState::CKeyInfo*
 IKeyState::CKeyInfo::alloc(KeyID id,
 				KeyModifierMask mask, KeyButton button, SInt32 count)
 {
-	CKeyInfo* info           = (CKeyInfo*)malloc(sizeof(CKeyInfo));
+	CKeyInfo* info           =
+		(CKeyInfo*)CEventDataPool::alloc(sizeof(CKeyInfo));
 	info->m_key              = id;
 	info->m_mask             = mask;
 	info->m_button           = button;
@@ -86,7 +88,8 @@ IKeyState::CKeyInfo::alloc(KeyID id,
 	CString screens = join(destinations);
 
 	// build structure
-	CKeyInfo* info  = (CKeyInfo*)malloc(sizeof(CKeyInfo) + screens.size());
+	CKeyInfo* info  =
+		(CKeyInfo*)CEventDataPool::alloc(sizeof(CKeyInfo) + screens.size());
 	info->m_key     = id;
 	info->m_mask    = mask;
 	info->m_button  = button;
@@ -99,8 +102,8 @@ IKeyState::CKeyInfo::alloc(KeyID id,
 IKeyState::CKeyInfo*
 IKeyState::CKeyInfo::alloc(const CKeyInfo& x)
 {
-	CKeyInfo* info  = (CKeyInfo*)malloc(sizeof(CKeyInfo) +
-										strlen(x.m_screensBuffer));
+	CKeyInfo* info  = (CKeyInfo*)CEventDataPool::alloc(sizeof(CKeyInfo) +
+												strlen(x.m_screensBuffer));
 	info->m_key     = x.m_key;
 	info->m_mask    = x.m_mask;
 	info->m_button  = x.m_button;
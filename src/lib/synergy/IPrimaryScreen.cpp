@@ -18,6 +18,7 @@
 
 #include "IPrimaryScreen.h"
 #include "CEventQueue.h"
+#include "CEventDataPool.h"
 #include <cstdlib>
 
 //
@@ -152,7 +153,8 @@ IPrimaryScreen::getGameDeviceTimingReqEvent()
 IPrimaryScreen::CButtonInfo*
 IPrimaryScreen::CButtonInfo::alloc(ButtonID id, KeyModifierMask mask)
 {
-	CButtonInfo* info = (CButtonInfo*)malloc(sizeof(CButtonInfo));
+	CButtonInfo* info =
+		(CButtonInfo*)CEventDataPool::alloc(sizeof(CButtonInfo));
 	info->m_button = id;
 	info->m_mask   = mask;
 	return info;
@@ -161,7 +163,8 @@ IPrimaryScreen::CButtonInfo::alloc(ButtonID id, KeyModifierMask mask)
 IPrimaryScreen::CButtonInfo*
 IPrimaryScreen::CButtonInfo::alloc(const CButtonInfo& x)
 {
-	CButtonInfo* info = (CButtonInfo*)malloc(sizeof(CButtonInfo));
+	CButtonInfo* info =
+		(CButtonInfo*)CEventDataPool::alloc(sizeof(CButtonInfo));
 	info->m_button = x.m_button;
 	info->m_mask   = x.m_mask;
 	return info;
@@ -181,7 +184,8 @@ IPrimaryScreen::CButtonInfo::equal(const CButtonInfo* a, const CButtonInfo* b)
 IPrimaryScreen::CMotionInfo*
 IPrimaryScreen::CMotionInfo::alloc(SInt32 x, SInt32 y)
 {
-	CMotionInfo* info = (CMotionInfo*)malloc(sizeof(CMotionInfo));
+	CMotionInfo* info =
+		(CMotionInfo*)CEventDataPool::alloc(sizeof(CMotionInfo));
 	info->m_x = x;
 	info->m_y = y;
 	return info;
@@ -195,7 +199,7 @@ IPrimaryScreen::CMotionInfo::alloc(SInt32 x, SInt32 y)
 IPrimaryScreen::CWheelInfo*
 IPrimaryScreen::CWheelInfo::alloc(SInt32 xDelta, SInt32 yDelta)
 {
-	CWheelInfo* info = (CWheelInfo*)malloc(sizeof(CWheelInfo));
+	CWheelInfo* info = (CWheelInfo*)CEventDataPool::alloc(sizeof(CWheelInfo));
 	info->m_xDelta = xDelta;
 	info->m_yDelta = yDelta;
 	return info;
@@ -209,7 +213,8 @@ IPrimaryScreen::CWheelInfo::alloc(SInt32 xDelta, SInt32 yDelta)
 IPrimaryScreen::CHotKeyInfo*
 IPrimaryScreen::CHotKeyInfo::alloc(UInt32 id)
 {
-	CHotKeyInfo* info = (CHotKeyInfo*)malloc(sizeof(CHotKeyInfo));
+	CHotKeyInfo* info =
+		(CHotKeyInfo*)CEventDataPool::alloc(sizeof(CHotKeyInfo));
 	info->m_id = id;
 	return info;
 }
@@ -351,5 +351,338 @@ public:
 	SInt32				m_mx, m_my;
 };
 
+//
+// typed messages
+//
+// the messages sent for every input event have a fixed size and a typed
+// form that CProtocolUtil::writeMessage() and readMessage() encode and
+// decode without parsing a format or allocating.  each has exactly the
+// layout of the format it's named after:  getCode() is that format,
+// whose first 4 bytes are the message code, kSize is the number of
+// bytes following the code, encode() writes them to \c dst in network
+// byte order and returns the end, and decode() reads them back.
+//
+
+namespace synergy {
+namespace protocol {
+
+inline UInt8*
+put1(UInt8* dst, UInt32 v)
+{
+	*dst++ = static_cast<UInt8>(v & 0xff);
+	return dst;
+}
+
+inline UInt8*
+put2(UInt8* dst, UInt32 v)
+{
+	*dst++ = static_cast<UInt8>((v >> 8) & 0xff);
+	*dst++ = static_cast<UInt8>( v       & 0xff);
+	return dst;
+}
+
+inline UInt8*
+put4(UInt8* dst, UInt32 v)
+{
+	*dst++ = static_cast<UInt8>((v >> 24) & 0xff);
+	*dst++ = static_cast<UInt8>((v >> 16) & 0xff);
+	*dst++ = static_cast<UInt8>((v >>  8) & 0xff);
+	*dst++ = static_cast<UInt8>( v        & 0xff);
+	return dst;
+}
+
+inline UInt8
+get1(const UInt8* src)
+{
+	return src[0];
+}
+
+inline UInt16
+get2(const UInt8* src)
+{
+	return static_cast<UInt16>((static_cast<UInt16>(src[0]) << 8) |
+								static_cast<UInt16>(src[1]));
+}
+
+inline UInt32
+get4(const UInt8* src)
+{
+	return (static_cast<UInt32>(src[0]) << 24) |
+		   (static_cast<UInt32>(src[1]) << 16) |
+		   (static_cast<UInt32>(src[2]) <<  8) |
+			static_cast<UInt32>(src[3]);
+}
+
+}
+}
+
+//! Message without parameters
+/*!
+Used for kMsgCNoop, kMsgCLeave and kMsgCKeepAlive.  \c TCode returns
+the message's format.
+*/
+template <const char* (*TCode)()>
+class TMsgEmpty {
+public:
+	enum { kSize = 0 };
+	static const char*	getCode() { return TCode(); }
+	UInt8*				encode(UInt8* dst) const { return dst; }
+	void				decode(const UInt8*) { }
+};
+
+inline const char*		getMsgCNoop() { return kMsgCNoop; }
+inline const char*		getMsgCLeave() { return kMsgCLeave; }
+inline const char*		getMsgCKeepAlive() { return kMsgCKeepAlive; }
+
+typedef TMsgEmpty<&getMsgCNoop>			CMsgCNoop;
+typedef TMsgEmpty<&getMsgCLeave>		CMsgCLeave;
+typedef TMsgEmpty<&getMsgCKeepAlive>	CMsgCKeepAlive;
+
+//! kMsgCEnter
+class CMsgCEnter {
+public:
+	enum { kSize = 10 };
+	static const char*	getCode() { return kMsgCEnter; }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_x);
+		dst = put2(dst, m_y);
+		dst = put4(dst, m_seqNum);
+		return put2(dst, m_mask);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_x      = static_cast<SInt16>(get2(src + 0));
+		m_y      = static_cast<SInt16>(get2(src + 2));
+		m_seqNum = get4(src + 4);
+		m_mask   = get2(src + 8);
+	}
+
+public:
+	SInt16				m_x, m_y;
+	UInt32				m_seqNum;
+	UInt16				m_mask;
+};
+
+//! kMsgDKeyDown and kMsgDKeyUp
+/*!
+\c TCode returns the message's format.
+*/
+template <const char* (*TCode)()>
+class TMsgDKey {
+public:
+	enum { kSize = 6 };
+	static const char*	getCode() { return TCode(); }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_id);
+		dst = put2(dst, m_mask);
+		return put2(dst, m_button);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_id     = get2(src + 0);
+		m_mask   = get2(src + 2);
+		m_button = get2(src + 4);
+	}
+
+public:
+	UInt16				m_id;
+	UInt16				m_mask;
+	UInt16				m_button;
+};
+
+//! kMsgDKeyDown1_0 and kMsgDKeyUp1_0
+/*!
+\c TCode returns the message's format.
+*/
+template <const char* (*TCode)()>
+class TMsgDKey1_0 {
+public:
+	enum { kSize = 4 };
+	static const char*	getCode() { return TCode(); }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_id);
+		return put2(dst, m_mask);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_id   = get2(src + 0);
+		m_mask = get2(src + 2);
+	}
+
+public:
+	UInt16				m_id;
+	UInt16				m_mask;
+};
+
+inline const char*		getMsgDKeyDown() { return kMsgDKeyDown; }
+inline const char*		getMsgDKeyDown1_0() { return kMsgDKeyDown1_0; }
+inline const char*		getMsgDKeyUp() { return kMsgDKeyUp; }
+inline const char*		getMsgDKeyUp1_0() { return kMsgDKeyUp1_0; }
+
+typedef TMsgDKey<&getMsgDKeyDown>		CMsgDKeyDown;
+typedef TMsgDKey1_0<&getMsgDKeyDown1_0>	CMsgDKeyDown1_0;
+typedef TMsgDKey<&getMsgDKeyUp>			CMsgDKeyUp;
+typedef TMsgDKey1_0<&getMsgDKeyUp1_0>	CMsgDKeyUp1_0;
+
+//! kMsgDKeyRepeat
+class CMsgDKeyRepeat {
+public:
+	enum { kSize = 8 };
+	static const char*	getCode() { return kMsgDKeyRepeat; }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_id);
+		dst = put2(dst, m_mask);
+		dst = put2(dst, m_count);
+		return put2(dst, m_button);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_id     = get2(src + 0);
+		m_mask   = get2(src + 2);
+		m_count  = get2(src + 4);
+		m_button = get2(src + 6);
+	}
+
+public:
+	UInt16				m_id;
+	UInt16				m_mask;
+	UInt16				m_count;
+	UInt16				m_button;
+};
+
+//! kMsgDKeyRepeat1_0
+class CMsgDKeyRepeat1_0 {
+public:
+	enum { kSize = 6 };
+	static const char*	getCode() { return kMsgDKeyRepeat1_0; }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_id);
+		dst = put2(dst, m_mask);
+		return put2(dst, m_count);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_id    = get2(src + 0);
+		m_mask  = get2(src + 2);
+		m_count = get2(src + 4);
+	}
+
+public:
+	UInt16				m_id;
+	UInt16				m_mask;
+	UInt16				m_count;
+};
+
+//! kMsgDMouseDown and kMsgDMouseUp
+/*!
+\c TCode returns the message's format.
+*/
+template <const char* (*TCode)()>
+class TMsgDMouseButton {
+public:
+	enum { kSize = 1 };
+	static const char*	getCode() { return TCode(); }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		return synergy::protocol::put1(dst, m_id);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		m_id = synergy::protocol::get1(src);
+	}
+
+public:
+	UInt8				m_id;
+};
+
+inline const char*		getMsgDMouseDown() { return kMsgDMouseDown; }
+inline const char*		getMsgDMouseUp() { return kMsgDMouseUp; }
+
+typedef TMsgDMouseButton<&getMsgDMouseDown>	CMsgDMouseDown;
+typedef TMsgDMouseButton<&getMsgDMouseUp>	CMsgDMouseUp;
+
+//! kMsgDMouseMove, kMsgDMouseRelMove and kMsgDMouseWheel
+/*!
+\c TCode returns the message's format.
+*/
+template <const char* (*TCode)()>
+class TMsgDMousePair {
+public:
+	enum { kSize = 4 };
+	static const char*	getCode() { return TCode(); }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		using namespace synergy::protocol;
+		dst = put2(dst, m_x);
+		return put2(dst, m_y);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		using namespace synergy::protocol;
+		m_x = static_cast<SInt16>(get2(src + 0));
+		m_y = static_cast<SInt16>(get2(src + 2));
+	}
+
+public:
+	SInt16				m_x, m_y;
+};
+
+inline const char*		getMsgDMouseMove() { return kMsgDMouseMove; }
+inline const char*		getMsgDMouseRelMove() { return kMsgDMouseRelMove; }
+inline const char*		getMsgDMouseWheel() { return kMsgDMouseWheel; }
+
+typedef TMsgDMousePair<&getMsgDMouseMove>		CMsgDMouseMove;
+typedef TMsgDMousePair<&getMsgDMouseRelMove>	CMsgDMouseRelMove;
+typedef TMsgDMousePair<&getMsgDMouseWheel>		CMsgDMouseWheel;
+
+//! kMsgDMouseWheel1_0
+class CMsgDMouseWheel1_0 {
+public:
+	enum { kSize = 2 };
+	static const char*	getCode() { return kMsgDMouseWheel1_0; }
+
+	UInt8*				encode(UInt8* dst) const
+	{
+		return synergy::protocol::put2(dst, m_y);
+	}
+
+	void				decode(const UInt8* src)
+	{
+		m_y = static_cast<SInt16>(synergy::protocol::get2(src));
+	}
+
+public:
+	SInt16				m_y;
+};
+
 #endif
 
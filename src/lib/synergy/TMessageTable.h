@@ -0,0 +1,189 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMESSAGETABLE_H
+#define TMESSAGETABLE_H
+
+#include "BasicTypes.h"
+#include "stdvector.h"
+#include <cassert>
+
+//! Protocol message table
+/*!
+Maps the 4 byte code of each protocol message to a value of type
+\c T, typically the handler for the message.  Codes are hashed as
+32-bit integers with a multiplier chosen so that no two messages
+collide, so finding a message is a multiply and a single comparison
+rather than comparing the code against each message in turn.
+*/
+template <class T>
+class TMessageTable {
+public:
+	TMessageTable();
+
+	//! @name manipulators
+	//@{
+
+	//! Add a message
+	/*!
+	Map the message with the code at the start of \p msg (one of the
+	\c kMsg constants) to \p value, replacing any existing value.
+	*/
+	void				add(const char* msg, const T& value);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Find a message
+	/*!
+	Returns the value for the message with the 4 byte \p code or NULL
+	if there's no such message.
+	*/
+	const T*			find(const UInt8* code) const;
+
+	//! Get message code as an integer
+	static UInt32		getCode(const UInt8* code);
+
+	//@}
+
+private:
+	class CEntry {
+	public:
+		CEntry() : m_code(0) { }
+
+	public:
+		UInt32			m_code;		// 0 iff entry is empty
+		T				m_value;
+	};
+	typedef std::vector<CEntry> CEntries;
+
+	UInt32				getSlot(UInt32 code) const;
+	void				rehash();
+
+private:
+	// the messages in the order they were added
+	CEntries			m_entries;
+
+	// the messages indexed by the hash of their code
+	CEntries			m_slots;
+	UInt32				m_multiplier;
+	UInt32				m_shift;
+};
+
+template <class T>
+inline
+TMessageTable<T>::TMessageTable() :
+	m_slots(1),
+	m_multiplier(0),
+	m_shift(31)
+{
+	// do nothing
+}
+
+template <class T>
+inline
+void
+TMessageTable<T>::add(const char* msg, const T& value)
+{
+	CEntry entry;
+	entry.m_code  = getCode(reinterpret_cast<const UInt8*>(msg));
+	entry.m_value = value;
+	assert(entry.m_code != 0);
+
+	for (typename CEntries::iterator index = m_entries.begin();
+							index != m_entries.end(); ++index) {
+		if (index->m_code == entry.m_code) {
+			index->m_value = value;
+			m_slots[getSlot(entry.m_code)].m_value = value;
+			return;
+		}
+	}
+	m_entries.push_back(entry);
+	rehash();
+}
+
+template <class T>
+inline
+const T*
+TMessageTable<T>::find(const UInt8* code) const
+{
+	UInt32 key          = getCode(code);
+	const CEntry& entry = m_slots[getSlot(key)];
+	if (entry.m_code == key && key != 0) {
+		return &entry.m_value;
+	}
+	return NULL;
+}
+
+template <class T>
+inline
+UInt32
+TMessageTable<T>::getCode(const UInt8* code)
+{
+	return (static_cast<UInt32>(code[0]) << 24) |
+			(static_cast<UInt32>(code[1]) << 16) |
+			(static_cast<UInt32>(code[2]) <<  8) |
+			 static_cast<UInt32>(code[3]);
+}
+
+template <class T>
+inline
+UInt32
+TMessageTable<T>::getSlot(UInt32 code) const
+{
+	// multiplicative hashing.  the high bits of the 32-bit product
+	// are the best mixed.
+	return ((code * m_multiplier) & 0xffffffffu) >> m_shift;
+}
+
+template <class T>
+void
+TMessageTable<T>::rehash()
+{
+	// start with at least four slots per message so a collision free
+	// multiplier is quick to find, then grow if we can't find one
+	UInt32 bits = 1;
+	while ((1u << bits) < 4 * m_entries.size()) {
+		++bits;
+	}
+	for (;; ++bits) {
+		m_shift            = 32 - bits;
+		UInt32 multiplier  = 0x9e3779b1u;
+		for (UInt32 tries = 0; tries < 1000; ++tries) {
+			m_multiplier = multiplier;
+			m_slots.assign(1u << bits, CEntry());
+			typename CEntries::const_iterator index = m_entries.begin();
+			for (; index != m_entries.end(); ++index) {
+				CEntry& slot = m_slots[getSlot(index->m_code)];
+				if (slot.m_code != 0) {
+					break;
+				}
+				slot = *index;
+			}
+			if (index == m_entries.end()) {
+				return;
+			}
+
+			// next odd multiplier
+			multiplier = multiplier * 1664525u + 1013904223u;
+			multiplier |= 1;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+//
+// benchmark entry points.  each takes the arguments following its name
+// on the command line and returns the process exit code.
+//
+
+int						usbDataLinkBenchmark(int argc, char** argv);
+int						streamBufferBenchmark(int argc, char** argv);
+int						eventQueueBenchmark(int argc, char** argv);
+int						protocolBenchmark(int argc, char** argv);
+
+#endif
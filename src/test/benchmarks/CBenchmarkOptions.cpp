@@ -0,0 +1,118 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CBenchmarkOptions.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// CBenchmarkOptions
+//
+
+void
+CBenchmarkOptions::addUInt(const char* name, UInt32* value)
+{
+	add(name, kUInt, value, 1.0);
+}
+
+void
+CBenchmarkOptions::addDouble(const char* name, double* value, double scale)
+{
+	add(name, kDouble, value, scale);
+}
+
+void
+CBenchmarkOptions::addString(const char* name, const char** value)
+{
+	add(name, kString, value, 1.0);
+}
+
+bool
+CBenchmarkOptions::parse(int argc, char** argv) const
+{
+	for (int i = 0; i < argc; ++i) {
+		const char* arg = argv[i];
+		const COption* option = find(arg);
+		if (option == NULL) {
+			fprintf(stderr, "unknown option %s\n", arg);
+			return false;
+		}
+		if (i + 1 == argc) {
+			fprintf(stderr, "missing value for %s\n", arg);
+			return false;
+		}
+		const char* value = argv[++i];
+
+		char* end;
+		errno = 0;
+		switch (option->m_type) {
+		case kUInt: {
+			// strtoul() quietly negates a leading minus sign
+			unsigned long n = strtoul(value, &end, 0);
+			if (value[0] == '-' || end == value || *end != '\0' ||
+				errno != 0 || n > 0xfffffffful) {
+				fprintf(stderr, "invalid value for %s: %s\n", arg, value);
+				return false;
+			}
+			*static_cast<UInt32*>(option->m_value) = (UInt32)n;
+			break;
+		}
+
+		case kDouble: {
+			double x = strtod(value, &end);
+			if (end == value || *end != '\0' || errno != 0) {
+				fprintf(stderr, "invalid value for %s: %s\n", arg, value);
+				return false;
+			}
+			*static_cast<double*>(option->m_value) = x * option->m_scale;
+			break;
+		}
+
+		case kString:
+			*static_cast<const char**>(option->m_value) = value;
+			break;
+		}
+	}
+	return true;
+}
+
+void
+CBenchmarkOptions::add(const char* name, EType type, void* value, double scale)
+{
+	assert(find(name) == NULL);
+
+	COption option;
+	option.m_name  = name;
+	option.m_type  = type;
+	option.m_value = value;
+	option.m_scale = scale;
+	m_options.push_back(option);
+}
+
+const CBenchmarkOptions::COption*
+CBenchmarkOptions::find(const char* name) const
+{
+	for (COptions::const_iterator i = m_options.begin();
+							i != m_options.end(); ++i) {
+		if (strcmp(i->m_name, name) == 0) {
+			return &*i;
+		}
+	}
+	return NULL;
+}
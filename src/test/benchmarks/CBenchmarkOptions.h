@@ -0,0 +1,90 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CBENCHMARKOPTIONS_H
+#define CBENCHMARKOPTIONS_H
+
+#include "BasicTypes.h"
+#include <vector>
+
+//! Benchmark command line options
+/*!
+Parses the options following a benchmark's name on the command line.
+Each option is a name followed by a value and is stored straight into
+the variable it was added with.  Options that aren't given leave their
+variable alone, so variables should hold their defaults beforehand.
+*/
+class CBenchmarkOptions {
+public:
+	//! @name manipulators
+	//@{
+
+	//! Add unsigned integer option
+	void				addUInt(const char* name, UInt32* value);
+
+	//! Add real option
+	/*!
+	The value given is multiplied by \c scale, e.g. 0.001 to take
+	milliseconds for a variable in seconds.
+	*/
+	void				addDouble(const char* name, double* value,
+							double scale = 1.0);
+
+	//! Add string option
+	/*!
+	\c *value is set to point into the command line.
+	*/
+	void				addString(const char* name, const char** value);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Parse options
+	/*!
+	Stores the value of each option in \c argv.  Prints a message and
+	returns false if an option is unknown, has no value or has a value
+	that isn't a number when it should be.
+	*/
+	bool				parse(int argc, char** argv) const;
+
+	//@}
+
+private:
+	enum EType {
+		kUInt,
+		kDouble,
+		kString
+	};
+
+	class COption {
+	public:
+		const char*		m_name;
+		EType			m_type;
+		void*			m_value;
+		double			m_scale;
+	};
+	typedef std::vector<COption> COptions;
+
+	void				add(const char* name, EType, void* value, double scale);
+	const COption*		find(const char* name) const;
+
+private:
+	COptions			m_options;
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Benchmarks.h"
+#include "CBenchmarkOptions.h"
+#include "CEventQueue.h"
+#include "TMethodEventJob.h"
+#include "CArch.h"
+#include "CArchAtomic.h"
+#include <new>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// allocation counting
+//
+// replaces the global allocator so the benchmark can report how many
+// allocations each event costs.  a replacement allocator is global to
+// the program but it only counts while measure() runs a pattern.  the
+// other benchmarks just get malloc() and an extra load.
+//
+
+static volatile SInt32	s_countAllocations = 0;
+static volatile SInt32	s_allocations      = 0;
+
+void*
+operator new(size_t size)
+{
+	if (CArchAtomic::load(&s_countAllocations) != 0) {
+		CArchAtomic::add(&s_allocations, 1);
+	}
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void*
+operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void
+operator delete(void* p) throw()
+{
+	free(p);
+}
+
+void
+operator delete[](void* p) throw()
+{
+	free(p);
+}
+
+//
+// CEventQueueBenchmark
+//
+// sends events to handlers through the event queue the way input is
+// forwarded to clients and reports the events per second and the heap
+// allocations per event.  there are several targets each with handlers
+// for several event types, like the screens and streams in the server.
+//
+
+class CEventQueueBenchmark {
+public:
+	CEventQueueBenchmark();
+	~CEventQueueBenchmark();
+
+	bool				parse(int argc, char** argv);
+	int					run();
+
+private:
+	typedef void (CEventQueueBenchmark::*Pattern)();
+
+	void				measure(const char* name, Pattern);
+
+	// dispatch events directly, which is just the handler lookup
+	void				dispatch();
+
+	// add bursts of events then get and dispatch them, like the main
+	// loop does
+	void				queue();
+
+	void				handleEvent(const CEvent&, void*);
+
+	CEvent::Type		getType(UInt32 i) const;
+	void*				getTarget(UInt32 i);
+
+private:
+	// options
+	UInt32				m_events;
+	UInt32				m_targets;
+	UInt32				m_burst;
+	const char*			m_pattern;
+
+	std::vector<char>	m_targetData;
+	std::vector<CEvent::Type>
+						m_types;
+	UInt32				m_handled;
+};
+
+static const UInt32		kNumTypes = 4;
+
+CEventQueueBenchmark::CEventQueueBenchmark() :
+	m_events(1000000),
+	m_targets(64),
+	m_burst(8),
+	m_pattern(NULL),
+	m_handled(0)
+{
+	// do nothing
+}
+
+CEventQueueBenchmark::~CEventQueueBenchmark()
+{
+	for (UInt32 i = 0; i < m_targets && !m_targetData.empty(); ++i) {
+		EVENTQUEUE->removeHandlers(getTarget(i));
+	}
+}
+
+bool
+CEventQueueBenchmark::parse(int argc, char** argv)
+{
+	CBenchmarkOptions options;
+	options.addUInt("--events", &m_events);
+	options.addUInt("--targets", &m_targets);
+	options.addUInt("--burst", &m_burst);
+	options.addString("--pattern", &m_pattern);
+	if (!options.parse(argc, argv)) {
+		return false;
+	}
+
+	if (m_events == 0 || m_targets == 0 || m_burst == 0) {
+		fprintf(stderr, "invalid options\n");
+		return false;
+	}
+	return true;
+}
+
+int
+CEventQueueBenchmark::run()
+{
+	// targets are just distinct addresses
+	m_targetData.resize(m_targets * 64);
+	for (UInt32 i = 0; i < kNumTypes; ++i) {
+		m_types.push_back(EVENTQUEUE->registerType("benchmark"));
+	}
+	for (UInt32 i = 0; i < m_targets; ++i) {
+		for (UInt32 j = 0; j < kNumTypes; ++j) {
+			EVENTQUEUE->adoptHandler(m_types[j], getTarget(i),
+							new TMethodEventJob<CEventQueueBenchmark>(this,
+								&CEventQueueBenchmark::handleEvent));
+		}
+	}
+
+	printf("event queue: %u events, %u targets, %u handlers, burst %u\n",
+			m_events, m_targets, m_targets * kNumTypes, m_burst);
+
+	measure("dispatch", &CEventQueueBenchmark::dispatch);
+	measure("queue",    &CEventQueueBenchmark::queue);
+	return 0;
+}
+
+void
+CEventQueueBenchmark::measure(const char* name, Pattern pattern)
+{
+	if (m_pattern != NULL && strcmp(m_pattern, name) != 0) {
+		return;
+	}
+
+	// warm up so the queue's tables are already grown
+	UInt32 events = m_events;
+	m_events      = m_burst;
+	(this->*pattern)();
+	m_events      = events;
+
+	m_handled = 0;
+	CArchAtomic::store(&s_allocations, 0);
+	CArchAtomic::store(&s_countAllocations, 1);
+	double start   = ARCH->time();
+	(this->*pattern)();
+	double elapsed = ARCH->time() - start;
+	CArchAtomic::store(&s_countAllocations, 0);
+	SInt32 allocations = CArchAtomic::load(&s_allocations);
+
+	if (m_handled != m_events) {
+		fprintf(stderr, "%s: handled %u of %u events\n",
+							name, m_handled, m_events);
+	}
+	printf("  %-10s %12.0f events/s %8.1f ns/event %6.3f allocations/event\n",
+			name, m_events / elapsed, elapsed * 1.0e9 / m_events,
+			(double)allocations / m_events);
+}
+
+void
+CEventQueueBenchmark::dispatch()
+{
+	for (UInt32 i = 0; i < m_events; ++i) {
+		EVENTQUEUE->dispatchEvent(CEvent(getType(i), getTarget(i)));
+	}
+}
+
+void
+CEventQueueBenchmark::queue()
+{
+	CEvent event;
+	for (UInt32 i = 0; i < m_events; ) {
+		UInt32 n = m_events - i;
+		if (n > m_burst) {
+			n = m_burst;
+		}
+		for (UInt32 j = 0; j < n; ++j) {
+			EVENTQUEUE->addEvent(CEvent(getType(i + j), getTarget(i + j)));
+		}
+		for (UInt32 j = 0; j < n; ++j) {
+			EVENTQUEUE->getEvent(event);
+			EVENTQUEUE->dispatchEvent(event);
+			CEvent::deleteData(event);
+		}
+		i += n;
+	}
+}
+
+void
+CEventQueueBenchmark::handleEvent(const CEvent&, void*)
+{
+	++m_handled;
+}
+
+CEvent::Type
+CEventQueueBenchmark::getType(UInt32 i) const
+{
+	return m_types[(i / m_targets) % kNumTypes];
+}
+
+void*
+CEventQueueBenchmark::getTarget(UInt32 i)
+{
+	// spread targets like separately allocated objects
+	return &m_targetData[(i % m_targets) * 64];
+}
+
+int
+eventQueueBenchmark(int argc, char** argv)
+{
+	CEventQueueBenchmark benchmark;
+	if (!benchmark.parse(argc, argv)) {
+		fprintf(stderr, "usage: eventqueue [--events n] [--targets n] "
+						"[--burst n] [--pattern dispatch|queue]\n");
+		return 2;
+	}
+	return benchmark.run();
+}
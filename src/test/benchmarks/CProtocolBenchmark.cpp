@@ -0,0 +1,366 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Benchmarks.h"
+#include "CBenchmarkOptions.h"
+#include "TMessageTable.h"
+#include "ProtocolTypes.h"
+#include "CArch.h"
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// CProtocolBenchmark
+//
+// identifies each message in a stream of messages from the server the
+// way the client does after the handshake and reports the time per
+// message.  messages are identified either by comparing the code
+// against each message in turn, as the client used to, or with a
+// message table.  the stream is either recorded from a typical input
+// heavy session or read from a file holding the bytes a client
+// received after the handshake.  the stream is split into messages
+// before measuring so only identifying the messages is timed.
+//
+
+class CProtocolBenchmark {
+public:
+	CProtocolBenchmark();
+
+	bool				parse(int argc, char** argv);
+	int					run();
+
+private:
+	typedef const char* (CProtocolBenchmark::*Identify)(const UInt8*) const;
+
+	void				measure(const char* name, Identify);
+
+	// identify a message, returning its format or NULL if unknown
+	const char*			identifyChain(const UInt8* code) const;
+	const char*			identifyTable(const UInt8* code) const;
+
+	// append a message with format to the stream
+	void				record(const char* format, UInt32 value);
+
+	// get the offset of the message after the one with format at offset,
+	// which is past the code.  returns 0 if the message is truncated.
+	size_t				skip(const char* format, size_t offset) const;
+
+	bool				load(const char* filename);
+
+	// find where each message in the stream starts
+	bool				split();
+
+private:
+	// options
+	UInt32				m_messages;
+	const char*			m_filename;
+	const char*			m_method;
+
+	std::vector<UInt8>	m_stream;
+	std::vector<const UInt8*>
+						m_codes;
+	TMessageTable<const char*>
+						m_table;
+};
+
+// the messages the client accepts after the handshake in the order it
+// used to check for them
+static const char* const*	s_messages[] = {
+	&kMsgDMouseMove, &kMsgDMouseRelMove, &kMsgDMouseWheel,
+	&kMsgDKeyDown, &kMsgDKeyUp, &kMsgDMouseDown, &kMsgDMouseUp,
+	&kMsgDKeyRepeat, &kMsgCKeepAlive, &kMsgCNoop, &kMsgCEnter,
+	&kMsgCLeave, &kMsgCClipboard, &kMsgCScreenSaver, &kMsgQInfo,
+	&kMsgCInfoAck, &kMsgDClipboard, &kMsgCResetOptions,
+	&kMsgDSetOptions, &kMsgDGameButtons, &kMsgDGameSticks,
+	&kMsgDGameTriggers, &kMsgCGameTimingReq, &kMsgDCryptoIv,
+	&kMsgCClose, &kMsgEBad
+};
+static const size_t			kNumMessages =
+								sizeof(s_messages) / sizeof(s_messages[0]);
+
+// the mix of messages in the recorded session.  mostly motion with
+// some typing and clicking and the odd screen switch.
+struct CMessageMix {
+	const char* const*	m_msg;
+	UInt32				m_weight;
+};
+
+static const CMessageMix	s_mix[] = {
+	{ &kMsgDMouseMove,		700 },
+	{ &kMsgDMouseRelMove,	20 },
+	{ &kMsgDMouseWheel,		40 },
+	{ &kMsgDKeyDown,		40 },
+	{ &kMsgDKeyUp,			40 },
+	{ &kMsgDKeyRepeat,		10 },
+	{ &kMsgDMouseDown,		20 },
+	{ &kMsgDMouseUp,		20 },
+	{ &kMsgCKeepAlive,		5 },
+	{ &kMsgCEnter,			2 },
+	{ &kMsgCLeave,			2 },
+	{ &kMsgCClipboard,		1 },
+	{ &kMsgDClipboard,		1 }
+};
+
+CProtocolBenchmark::CProtocolBenchmark() :
+	m_messages(1000000),
+	m_filename(NULL),
+	m_method(NULL)
+{
+	for (size_t i = 0; i < kNumMessages; ++i) {
+		m_table.add(*s_messages[i], *s_messages[i]);
+	}
+}
+
+bool
+CProtocolBenchmark::parse(int argc, char** argv)
+{
+	CBenchmarkOptions options;
+	options.addUInt("--messages", &m_messages);
+	options.addString("--file", &m_filename);
+	options.addString("--method", &m_method);
+	if (!options.parse(argc, argv)) {
+		return false;
+	}
+
+	if (m_messages == 0) {
+		fprintf(stderr, "invalid options\n");
+		return false;
+	}
+	return true;
+}
+
+int
+CProtocolBenchmark::run()
+{
+	if (m_filename != NULL) {
+		if (!load(m_filename)) {
+			return 1;
+		}
+	}
+	else {
+		UInt32 total = 0;
+		for (size_t i = 0; i < sizeof(s_mix) / sizeof(s_mix[0]); ++i) {
+			total += s_mix[i].m_weight;
+		}
+		srand(1);
+		for (UInt32 i = 0; i < m_messages; ++i) {
+			UInt32 pick = static_cast<UInt32>(rand()) % total;
+			size_t j    = 0;
+			while (pick >= s_mix[j].m_weight) {
+				pick -= s_mix[j].m_weight;
+				++j;
+			}
+			record(*s_mix[j].m_msg, i);
+		}
+	}
+
+	if (!split()) {
+		return 1;
+	}
+
+	printf("protocol: %u messages, %u byte stream of %u messages\n",
+				m_messages, static_cast<UInt32>(m_stream.size()),
+				static_cast<UInt32>(m_codes.size()));
+
+	measure("chain", &CProtocolBenchmark::identifyChain);
+	measure("table", &CProtocolBenchmark::identifyTable);
+	return 0;
+}
+
+void
+CProtocolBenchmark::measure(const char* name, Identify identify)
+{
+	if (m_method != NULL && strcmp(m_method, name) != 0) {
+		return;
+	}
+
+	// replay the stream until we've identified enough messages
+	UInt32 messages = 0;
+	UInt32 unknown  = 0;
+	double start    = ARCH->time();
+	while (messages < m_messages) {
+		for (size_t i = 0; i < m_codes.size() && messages < m_messages; ++i) {
+			if ((this->*identify)(m_codes[i]) == NULL) {
+				++unknown;
+			}
+			++messages;
+		}
+	}
+	double elapsed = ARCH->time() - start;
+
+	if (unknown != 0) {
+		fprintf(stderr, "%s: %u unknown messages\n", name, unknown);
+	}
+
+	printf("  %-10s %12.0f messages/s %8.1f ns/message\n",
+				name, messages / elapsed, elapsed * 1.0e9 / messages);
+}
+
+const char*
+CProtocolBenchmark::identifyChain(const UInt8* code) const
+{
+	for (size_t i = 0; i < kNumMessages; ++i) {
+		if (memcmp(code, *s_messages[i], 4) == 0) {
+			return *s_messages[i];
+		}
+	}
+	return NULL;
+}
+
+const char*
+CProtocolBenchmark::identifyTable(const UInt8* code) const
+{
+	const char* const* format = m_table.find(code);
+	return (format == NULL) ? NULL : *format;
+}
+
+void
+CProtocolBenchmark::record(const char* format, UInt32 value)
+{
+	static const char s_data[] = "synergy";
+
+	// code then arguments in network byte order
+	m_stream.insert(m_stream.end(), format, format + 4);
+	for (format += 4; *format != '\0'; ++format) {
+		if (*format != '%') {
+			continue;
+		}
+		if (format[1] == 's') {
+			UInt32 n = sizeof(s_data) - 1;
+			m_stream.push_back(0);
+			m_stream.push_back(0);
+			m_stream.push_back(0);
+			m_stream.push_back(static_cast<UInt8>(n));
+			m_stream.insert(m_stream.end(), s_data, s_data + n);
+			format += 1;
+		}
+		else if (format[2] == 'I') {
+			// empty list
+			m_stream.insert(m_stream.end(), 4, 0);
+			format += 2;
+		}
+		else {
+			for (UInt32 i = format[1] - '0'; i > 0; --i) {
+				m_stream.push_back(static_cast<UInt8>(value >> (8 * (i - 1))));
+			}
+			format += 2;
+		}
+	}
+}
+
+size_t
+CProtocolBenchmark::skip(const char* format, size_t offset) const
+{
+	const size_t end = m_stream.size();
+	for (; *format != '\0'; ++format) {
+		if (*format != '%') {
+			continue;
+		}
+		size_t size = 0;
+		if (format[1] == 's') {
+			if (offset + 4 > end) {
+				return 0;
+			}
+			size    = (m_stream[offset + 0] << 24) |
+					  (m_stream[offset + 1] << 16) |
+					  (m_stream[offset + 2] <<  8) |
+					   m_stream[offset + 3];
+			offset += 4;
+			format += 1;
+		}
+		else if (format[2] == 'I') {
+			if (offset + 4 > end) {
+				return 0;
+			}
+			size    = (m_stream[offset + 0] << 24) |
+					  (m_stream[offset + 1] << 16) |
+					  (m_stream[offset + 2] <<  8) |
+					   m_stream[offset + 3];
+			size   *= format[1] - '0';
+			offset += 4;
+			format += 2;
+		}
+		else {
+			size    = format[1] - '0';
+			format += 2;
+		}
+		offset += size;
+		if (offset > end) {
+			return 0;
+		}
+	}
+	return offset;
+}
+
+bool
+CProtocolBenchmark::split()
+{
+	size_t offset = 0;
+	while (offset < m_stream.size()) {
+		const UInt8* code  = &m_stream[offset];
+		const char* format = identifyTable(code);
+		if (format == NULL) {
+			fprintf(stderr, "unknown message %.4s at %u\n",
+							reinterpret_cast<const char*>(code),
+							static_cast<UInt32>(offset));
+			return false;
+		}
+		offset = skip(format + 4, offset + 4);
+		if (offset == 0) {
+			fprintf(stderr, "truncated %.4s message\n", format);
+			return false;
+		}
+		m_codes.push_back(code);
+	}
+	return true;
+}
+
+bool
+CProtocolBenchmark::load(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "cannot open %s\n", filename);
+		return false;
+	}
+	UInt8 buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		m_stream.insert(m_stream.end(), buffer, buffer + n);
+	}
+	fclose(file);
+
+	if (m_stream.empty()) {
+		fprintf(stderr, "%s is empty\n", filename);
+		return false;
+	}
+	return true;
+}
+
+int
+protocolBenchmark(int argc, char** argv)
+{
+	CProtocolBenchmark benchmark;
+	if (!benchmark.parse(argc, argv)) {
+		fprintf(stderr, "usage: protocol [--messages n] [--file stream] "
+						"[--method chain|table]\n");
+		return 2;
+	}
+	return benchmark.run();
+}
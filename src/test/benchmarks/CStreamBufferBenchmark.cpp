@@ -0,0 +1,282 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Benchmarks.h"
+#include "CBenchmarkOptions.h"
+#include "CStreamBuffer.h"
+#include "CArch.h"
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+//
+// CStreamBufferBenchmark
+//
+// runs the write/peek/pop patterns the TCP and USB transports use on a
+// CStreamBuffer and reports the time per message.  each pattern moves
+// the same number of bytes through a single buffer.
+//
+
+class CStreamBufferBenchmark {
+public:
+	CStreamBufferBenchmark();
+
+	bool				parse(int argc, char** argv);
+	int					run();
+
+private:
+	typedef UInt32 (CStreamBufferBenchmark::*Pattern)(CStreamBuffer&);
+
+	void				measure(const char* name, Pattern);
+
+	// socket reads land in reserved space and the packet stream filter
+	// takes each message's length then its payload
+	UInt32				tcpInput(CStreamBuffer&);
+
+	// messages are written then flushed with a gather write that may
+	// send only part of the buffer
+	UInt32				tcpOutput(CStreamBuffer&);
+
+	// frames are written then copied out a transfer at a time
+	UInt32				usbOutput(CStreamBuffer&);
+
+	// a clipboard sized message is written in one go then copied out a
+	// transfer at a time
+	UInt32				usbLarge(CStreamBuffer&);
+
+private:
+	// options
+	UInt32				m_messages;
+	UInt32				m_size;
+	UInt32				m_large;
+	const char*			m_pattern;
+
+	std::vector<UInt8>	m_message;
+	std::vector<UInt8>	m_scratch;
+};
+
+static const UInt32		kReadSize      = 4096;
+static const UInt32		kTransferSize  = 16384;
+static const UInt32		kMaxSegments   = 16;
+static const UInt32		kMaxWrite      = 65536;
+
+CStreamBufferBenchmark::CStreamBufferBenchmark() :
+	m_messages(1000000),
+	m_size(64),
+	m_large(4 * 1024 * 1024),
+	m_pattern(NULL)
+{
+	// do nothing
+}
+
+bool
+CStreamBufferBenchmark::parse(int argc, char** argv)
+{
+	CBenchmarkOptions options;
+	options.addUInt("--messages", &m_messages);
+	options.addUInt("--size", &m_size);
+	options.addUInt("--large", &m_large);
+	options.addString("--pattern", &m_pattern);
+	if (!options.parse(argc, argv)) {
+		return false;
+	}
+
+	if (m_messages == 0 || m_size < 4 || m_large == 0) {
+		fprintf(stderr, "invalid options.  messages must be at least "
+						"4 bytes.\n");
+		return false;
+	}
+	return true;
+}
+
+int
+CStreamBufferBenchmark::run()
+{
+	// a length prefixed message like CPacketStreamFilter expects
+	m_message.resize(m_size);
+	UInt32 payload = m_size - 4;
+	m_message[0] = (UInt8)((payload >> 24) & 0xff);
+	m_message[1] = (UInt8)((payload >> 16) & 0xff);
+	m_message[2] = (UInt8)((payload >>  8) & 0xff);
+	m_message[3] = (UInt8)( payload        & 0xff);
+	for (UInt32 i = 4; i < m_size; ++i) {
+		m_message[i] = (UInt8)i;
+	}
+	m_scratch.resize(m_large > kMaxWrite ? m_large : kMaxWrite);
+
+	printf("stream buffer: %u messages of %u bytes, large message %u bytes\n",
+			m_messages, m_size, m_large);
+
+	measure("tcp-input",  &CStreamBufferBenchmark::tcpInput);
+	measure("tcp-output", &CStreamBufferBenchmark::tcpOutput);
+	measure("usb-output", &CStreamBufferBenchmark::usbOutput);
+	measure("usb-large",  &CStreamBufferBenchmark::usbLarge);
+	return 0;
+}
+
+void
+CStreamBufferBenchmark::measure(const char* name, Pattern pattern)
+{
+	if (m_pattern != NULL && strcmp(m_pattern, name) != 0) {
+		return;
+	}
+
+	CStreamBuffer buffer;
+	double start   = ARCH->time();
+	UInt32 count   = (this->*pattern)(buffer);
+	double elapsed = ARCH->time() - start;
+
+	double bytes = (double)count * m_size;
+	if (pattern == &CStreamBufferBenchmark::usbLarge) {
+		bytes = (double)count * m_large;
+	}
+	printf("  %-10s %8.1f ns/message %10.1f MB/s\n", name,
+			elapsed * 1.0e9 / count, bytes / elapsed / (1024.0 * 1024.0));
+}
+
+UInt32
+CStreamBufferBenchmark::tcpInput(CStreamBuffer& buffer)
+{
+	// the wire carries back to back messages.  each read takes whatever
+	// the kernel has, which rarely lines up with message boundaries.
+	const UInt8* message = &m_message[0];
+	UInt32 offset   = 0;
+	UInt32 received = 0;
+	UInt32 sent     = 0;
+	UInt32 readSize = kReadSize / 2;
+	while (received < m_messages) {
+		// socket read
+		UInt8* space = static_cast<UInt8*>(buffer.reserve(kReadSize));
+		UInt32 n     = 0;
+		while (n < readSize && sent < m_messages) {
+			UInt32 count = m_size - offset;
+			if (count > readSize - n) {
+				count = readSize - n;
+			}
+			memcpy(space + n, message + offset, count);
+			n      += count;
+			offset += count;
+			if (offset == m_size) {
+				offset = 0;
+				++sent;
+			}
+		}
+		buffer.commit(n);
+		readSize = (readSize == kReadSize) ? kReadSize / 2 + 7 : kReadSize;
+
+		// packet stream filter
+		while (buffer.getSize() >= 4) {
+			const UInt8* length = static_cast<const UInt8*>(buffer.peek(4));
+			UInt32 size = ((UInt32)length[0] << 24) |
+						  ((UInt32)length[1] << 16) |
+						  ((UInt32)length[2] <<  8) |
+						   (UInt32)length[3];
+			if (buffer.getSize() < 4 + size) {
+				break;
+			}
+			buffer.pop(4);
+			memcpy(&m_scratch[0], buffer.peek(size), size);
+			buffer.pop(size);
+			++received;
+		}
+	}
+	return received;
+}
+
+UInt32
+CStreamBufferBenchmark::tcpOutput(CStreamBuffer& buffer)
+{
+	// a burst of messages per flush and the socket takes at most
+	// kMaxWrite bytes per write
+	CStreamBuffer::CSegment segments[kMaxSegments];
+	UInt32 sent = 0;
+	while (sent < m_messages) {
+		for (UInt32 i = 0; i < 16 && sent < m_messages; ++i, ++sent) {
+			buffer.write(&m_message[0], m_size);
+		}
+
+		while (buffer.getSize() > 0) {
+			UInt32 size = buffer.getSize();
+			if (size > kMaxWrite) {
+				size = kMaxWrite;
+			}
+			UInt32 count = buffer.peekSegments(segments, kMaxSegments, size);
+			UInt32 n     = 0;
+			for (UInt32 i = 0; i < count; ++i) {
+				memcpy(&m_scratch[n], segments[i].m_data, segments[i].m_size);
+				n += segments[i].m_size;
+			}
+			buffer.pop(n);
+		}
+	}
+	return sent;
+}
+
+UInt32
+CStreamBufferBenchmark::usbOutput(CStreamBuffer& buffer)
+{
+	// a few frames are written between transfer completions and each
+	// completion copies the next transfer's worth out
+	UInt32 sent = 0;
+	while (sent < m_messages || buffer.getSize() > 0) {
+		for (UInt32 i = 0; i < 4 && sent < m_messages; ++i, ++sent) {
+			buffer.write(&m_message[0], m_size);
+		}
+
+		UInt32 n = buffer.getSize();
+		if (n > kTransferSize) {
+			n = kTransferSize;
+		}
+		memcpy(&m_scratch[0], buffer.peek(n), n);
+		buffer.pop(n);
+	}
+	return sent;
+}
+
+UInt32
+CStreamBufferBenchmark::usbLarge(CStreamBuffer& buffer)
+{
+	UInt32 messages = m_messages / 10000;
+	if (messages == 0) {
+		messages = 1;
+	}
+	for (UInt32 i = 0; i < messages; ++i) {
+		buffer.write(&m_scratch[0], m_large);
+		while (buffer.getSize() > 0) {
+			UInt32 n = buffer.getSize();
+			if (n > kTransferSize) {
+				n = kTransferSize;
+			}
+			memcpy(&m_scratch[0], buffer.peek(n), n);
+			buffer.pop(n);
+		}
+	}
+	return messages;
+}
+
+int
+streamBufferBenchmark(int argc, char** argv)
+{
+	CStreamBufferBenchmark benchmark;
+	if (!benchmark.parse(argc, argv)) {
+		fprintf(stderr, "usage: streambuffer [--messages n] [--size bytes] "
+						"[--large bytes] [--pattern tcp-input|tcp-output|"
+						"usb-output|usb-large]\n");
+		return 2;
+	}
+	return benchmark.run();
+}
@@ -0,0 +1,399 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Benchmarks.h"
+#include "CBenchmarkOptions.h"
+#include "CUSBLoopback.h"
+#include "CUSBDataLink.h"
+#include "CUSBDataLinkListener.h"
+#include "CUSBAddress.h"
+#include "CArch.h"
+#include "CCondVar.h"
+#include "CLock.h"
+#include "CMutex.h"
+#include "CThread.h"
+#include "IEventQueue.h"
+#include "TMethodEventJob.h"
+#include "TMethodJob.h"
+#include "XSocket.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+//
+// CUSBDataLinkBenchmark
+//
+// sends fixed size messages from a server data link to a client data
+// link over the software loopback.  each message starts with the time
+// it was written so the client can measure the time to its input ready
+// event.
+//
+
+class CUSBDataLinkBenchmark {
+public:
+	CUSBDataLinkBenchmark();
+
+	bool				parse(int argc, char** argv);
+	int					run();
+
+private:
+	bool				connect(CUSBDataLinkListener&);
+	void				measure();
+	void				report(double elapsed, UInt32 failures) const;
+
+	void				connectThread(void*);
+	void				writeThread(void*);
+
+	void				handleConnecting(const CEvent&, void*);
+	void				handleInput(const CEvent&, void*);
+	void				handleDisconnected(const CEvent&, void*);
+
+private:
+	// options
+	UInt32				m_messages;
+	UInt32				m_size;
+	UInt32				m_window;
+	UInt32				m_depth;
+	UInt32				m_coalesce;
+	UInt32				m_packetSize;
+	double				m_latency;
+	double				m_failureRate;
+
+	CUSBDataLink*		m_client;
+	IDataTransfer*		m_server;
+	CUSBDataLinkListener* m_listener;
+	bool				m_connected;
+
+	CMutex				m_mutex;
+	CCondVar<UInt32>	m_received;
+	bool				m_failed;
+	std::string			m_pending;
+	std::vector<double>	m_latencies;
+	double				m_lastReceived;
+};
+
+static const UInt16		kVendorID   = 0x0402;
+static const UInt16		kProductID  = 0x5632;
+static const UInt8		kInEndpoint = 0x81;
+static const UInt8		kOutEndpoint = 0x02;
+static const UInt8		kBusNumber  = 1;
+static const double		kConnectTimeout = 5.0;
+static const double		kStallTimeout   = 5.0;
+
+CUSBDataLinkBenchmark::CUSBDataLinkBenchmark() :
+	m_messages(100000),
+	m_size(64),
+	m_window(64),
+	m_depth(4),
+	m_coalesce(0),
+	m_packetSize(512),
+	m_latency(0.0),
+	m_failureRate(0.0),
+	m_client(NULL),
+	m_server(NULL),
+	m_listener(NULL),
+	m_connected(false),
+	m_received(&m_mutex, 0),
+	m_failed(false),
+	m_lastReceived(0.0)
+{
+	// do nothing
+}
+
+bool
+CUSBDataLinkBenchmark::parse(int argc, char** argv)
+{
+	CBenchmarkOptions options;
+	options.addUInt("--messages", &m_messages);
+	options.addUInt("--size", &m_size);
+	options.addUInt("--window", &m_window);
+	options.addUInt("--queue-depth", &m_depth);
+	options.addUInt("--coalesce", &m_coalesce);
+	options.addUInt("--packet-size", &m_packetSize);
+	options.addDouble("--latency", &m_latency, 0.001);	// milliseconds
+	options.addDouble("--failure-rate", &m_failureRate);
+	if (!options.parse(argc, argv)) {
+		return false;
+	}
+
+	if (m_messages == 0 || m_window == 0 || m_depth == 0 ||
+		m_packetSize == 0 || m_size < sizeof(double)) {
+		fprintf(stderr, "invalid options.  messages must be at least "
+						"%d bytes.\n", (int)sizeof(double));
+		return false;
+	}
+	return true;
+}
+
+int
+CUSBDataLinkBenchmark::run()
+{
+	CUSBLoopback loopback((int)m_packetSize);
+	loopback.setLatency(m_latency);
+	loopback.setFailureRate(m_failureRate, 1);
+	ARCH->setUsb(&loopback);
+
+	printf("usb data link: %u messages of %u bytes, window %u, "
+			"queue depth %u, coalesce %u, packet size %u, latency %.3f ms, "
+			"failure rate %g\n",
+			m_messages, m_size, m_window, m_depth, m_coalesce,
+			m_packetSize, m_latency * 1000.0, m_failureRate);
+
+	int result = 1;
+	{
+		CUSBDataLinkListener listener;
+		m_listener = &listener;
+		m_client   = new CUSBDataLink;
+		m_client->setTransferQueueDepth(m_depth);
+
+		if (connect(listener)) {
+			CUSBDataLink* server = dynamic_cast<CUSBDataLink*>(m_server);
+			if (server != NULL) {
+				server->setCoalescing(m_coalesce, 0.002);
+			}
+
+			double start = ARCH->time();
+			measure();
+			report(m_lastReceived - start, loopback.getFailures());
+			result = m_failed ? 1 : 0;
+		}
+
+		delete m_client;
+		delete m_server;
+		m_client   = NULL;
+		m_server   = NULL;
+		m_listener = NULL;
+	}
+
+	ARCH->setUsb(NULL);
+	return result;
+}
+
+bool
+CUSBDataLinkBenchmark::connect(CUSBDataLinkListener& listener)
+{
+	try {
+		listener.bind(CUSBAddress(kVendorID, kProductID, kInEndpoint,
+							kOutEndpoint, kBusNumber,
+							CUSBLoopback::getDeviceAddress(0)));
+	}
+	catch (XSocket& e) {
+		fprintf(stderr, "cannot bind: %s\n", e.what());
+		return false;
+	}
+
+	EVENTQUEUE->adoptHandler(listener.getConnectingEvent(),
+							listener.getEventTarget(),
+							new TMethodEventJob<CUSBDataLinkBenchmark>(
+								this, &CUSBDataLinkBenchmark::handleConnecting));
+
+	// connect() waits for the listener to accept so it needs a thread
+	// of its own while this one dispatches events
+	CThread thread(new TMethodJob<CUSBDataLinkBenchmark>(
+							this, &CUSBDataLinkBenchmark::connectThread));
+
+	double start = ARCH->time();
+	while (!thread.wait(0.0) && ARCH->time() - start < kConnectTimeout) {
+		CEvent event;
+		if (EVENTQUEUE->getEvent(event, 0.01)) {
+			EVENTQUEUE->dispatchEvent(event);
+			CEvent::deleteData(event);
+		}
+	}
+	thread.wait();
+
+	EVENTQUEUE->removeHandler(listener.getConnectingEvent(),
+							listener.getEventTarget());
+
+	if (!m_connected || m_server == NULL) {
+		fprintf(stderr, "cannot connect over the loopback\n");
+		return false;
+	}
+	return true;
+}
+
+void
+CUSBDataLinkBenchmark::measure()
+{
+	EVENTQUEUE->adoptHandler(m_client->getInputReadyEvent(),
+							m_client->getEventTarget(),
+							new TMethodEventJob<CUSBDataLinkBenchmark>(
+								this, &CUSBDataLinkBenchmark::handleInput));
+	EVENTQUEUE->adoptHandler(m_client->getDisconnectedEvent(),
+							m_client->getEventTarget(),
+							new TMethodEventJob<CUSBDataLinkBenchmark>(
+								this, &CUSBDataLinkBenchmark::handleDisconnected));
+	EVENTQUEUE->adoptHandler(m_server->getDisconnectedEvent(),
+							m_server->getEventTarget(),
+							new TMethodEventJob<CUSBDataLinkBenchmark>(
+								this, &CUSBDataLinkBenchmark::handleDisconnected));
+
+	m_latencies.reserve(m_messages);
+	m_lastReceived = ARCH->time();
+
+	CThread thread(new TMethodJob<CUSBDataLinkBenchmark>(
+							this, &CUSBDataLinkBenchmark::writeThread));
+
+	// dispatch until everything arrives or the link stalls
+	for (;;) {
+		{
+			CLock lock(&m_mutex);
+			if (m_failed || m_received == m_messages) {
+				break;
+			}
+			if (ARCH->time() - m_lastReceived > kStallTimeout) {
+				fprintf(stderr, "link stalled\n");
+				m_failed = true;
+				m_received.broadcast();
+				break;
+			}
+		}
+
+		CEvent event;
+		if (EVENTQUEUE->getEvent(event, 0.1)) {
+			EVENTQUEUE->dispatchEvent(event);
+			CEvent::deleteData(event);
+		}
+	}
+	thread.wait();
+
+	EVENTQUEUE->removeHandler(m_client->getInputReadyEvent(),
+							m_client->getEventTarget());
+	EVENTQUEUE->removeHandler(m_client->getDisconnectedEvent(),
+							m_client->getEventTarget());
+	EVENTQUEUE->removeHandler(m_server->getDisconnectedEvent(),
+							m_server->getEventTarget());
+}
+
+void
+CUSBDataLinkBenchmark::report(double elapsed, UInt32 failures) const
+{
+	std::vector<double> latencies(m_latencies);
+	std::sort(latencies.begin(), latencies.end());
+
+	size_t count = latencies.size();
+	if (count == 0 || elapsed <= 0.0) {
+		printf("no messages received, %u transfers failed\n", failures);
+		return;
+	}
+
+	double p50 = latencies[(count - 1) * 50 / 100];
+	double p99 = latencies[(count - 1) * 99 / 100];
+
+	printf("received %u of %u messages in %.3f s%s\n",
+			(UInt32)count, m_messages, elapsed,
+			m_failed ? " (link dropped)" : "");
+	printf("  %.0f messages/s\n", count / elapsed);
+	printf("  %.0f bytes/s\n", count * m_size / elapsed);
+	printf("  latency p50 %.3f ms, p99 %.3f ms\n", p50 * 1000.0, p99 * 1000.0);
+	printf("  %u transfers failed\n", failures);
+}
+
+void
+CUSBDataLinkBenchmark::connectThread(void*)
+{
+	try {
+		m_client->connect(CUSBAddress(kVendorID, kProductID, kInEndpoint,
+							kOutEndpoint, kBusNumber,
+							CUSBLoopback::getDeviceAddress(1)));
+		m_connected = true;
+	}
+	catch (XSocket& e) {
+		fprintf(stderr, "connect failed: %s\n", e.what());
+	}
+}
+
+void
+CUSBDataLinkBenchmark::writeThread(void*)
+{
+	std::vector<char> message(m_size, 0);
+
+	for (UInt32 sent = 0; sent < m_messages; ++sent) {
+		{
+			// keep at most a window of messages in flight
+			CLock lock(&m_mutex);
+			while (!m_failed && sent - m_received >= m_window) {
+				m_received.wait();
+			}
+			if (m_failed) {
+				return;
+			}
+		}
+
+		double now = ARCH->time();
+		memcpy(&message[0], &now, sizeof(now));
+		m_server->write(&message[0], m_size);
+	}
+}
+
+void
+CUSBDataLinkBenchmark::handleConnecting(const CEvent&, void*)
+{
+	m_server = m_listener->accept();
+}
+
+void
+CUSBDataLinkBenchmark::handleInput(const CEvent&, void*)
+{
+	double now = ARCH->time();
+
+	UInt32 n = m_client->getSize();
+	size_t offset = m_pending.size();
+	m_pending.resize(offset + n);
+	m_client->read(&m_pending[offset], n);
+
+	UInt32 messages = 0;
+	size_t i = 0;
+	for (; i + m_size <= m_pending.size(); i += m_size) {
+		double sent;
+		memcpy(&sent, m_pending.data() + i, sizeof(sent));
+		m_latencies.push_back(now - sent);
+		++messages;
+	}
+	m_pending.erase(0, i);
+
+	if (messages > 0) {
+		CLock lock(&m_mutex);
+		m_lastReceived = now;
+		m_received     = m_received + messages;
+		m_received.broadcast();
+	}
+}
+
+void
+CUSBDataLinkBenchmark::handleDisconnected(const CEvent&, void*)
+{
+	CLock lock(&m_mutex);
+	m_failed = true;
+	m_received.broadcast();
+}
+
+int
+usbDataLinkBenchmark(int argc, char** argv)
+{
+	CUSBDataLinkBenchmark benchmark;
+	if (!benchmark.parse(argc, argv)) {
+		fprintf(stderr, "usage: usbdatalink [--messages n] [--size bytes] "
+						"[--window n] [--queue-depth n] [--coalesce bytes] "
+						"[--packet-size bytes] [--latency ms] "
+						"[--failure-rate 0..1]\n");
+		return 2;
+	}
+	return benchmark.run();
+}
@@ -0,0 +1,456 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CUSBLoopback.h"
+#include "CArch.h"
+#include "XArch.h"
+#include "CLock.h"
+#include "CThread.h"
+#include "TMethodJob.h"
+#include <string.h>
+
+//
+// CUSBLoopback
+//
+
+static const unsigned short	kVendorID     = 0x0402;
+static const unsigned short	kProductID    = 0x5632;
+static const unsigned char	kBusNumber    = 1;
+static const unsigned char	kInEndpoint   = 0x81;
+static const unsigned char	kOutEndpoint  = 0x02;
+
+CUSBLoopback::CUSBLoopback(int maxPacketSize) :
+	m_maxPacketSize(maxPacketSize),
+	m_latency(0.0),
+	m_failureRate(0.0),
+	m_random(1),
+	m_failures(0),
+	m_wake(&m_mutex, false),
+	m_stop(false),
+	m_thread(NULL)
+{
+	assert(maxPacketSize > 0);
+
+	for (int i = 0; i < 2; ++i) {
+		USBDeviceInfo& info = m_devices[i].m_info;
+		info.idVendor                    = kVendorID;
+		info.idProduct                   = kProductID;
+		info.busNumber                   = kBusNumber;
+		info.deviceAddress               = getDeviceAddress(i);
+		info.validEndpointInfo           = true;
+		info.inputEndpoint               = kInEndpoint;
+		info.outputEndpoint              = kOutEndpoint;
+		info.interfaceNumber             = 0;
+		info.inputEndpointMaxPacketSize  = maxPacketSize;
+		info.outputEndpointMaxPacketSize = maxPacketSize;
+
+		m_devices[i].m_open = false;
+		m_devices[i].m_peer = &m_devices[1 - i];
+	}
+
+	m_thread = new CThread(new TMethodJob<CUSBLoopback>(
+								this, &CUSBLoopback::workerThread));
+}
+
+CUSBLoopback::~CUSBLoopback()
+{
+	{
+		CLock lock(&m_mutex);
+		m_stop = true;
+		m_wake.broadcast();
+	}
+	m_thread->wait();
+	delete m_thread;
+}
+
+void
+CUSBLoopback::setLatency(double seconds)
+{
+	CLock lock(&m_mutex);
+	m_latency = seconds;
+}
+
+void
+CUSBLoopback::setFailureRate(double rate, UInt32 seed)
+{
+	CLock lock(&m_mutex);
+	m_failureRate = rate;
+	m_random      = (seed != 0) ? seed : 1;
+}
+
+unsigned char
+CUSBLoopback::getDeviceAddress(int index)
+{
+	assert(index == 0 || index == 1);
+	return static_cast<unsigned char>(index + 1);
+}
+
+UInt32
+CUSBLoopback::getFailures() const
+{
+	CLock lock(&m_mutex);
+	return m_failures;
+}
+
+void
+CUSBLoopback::init()
+{
+	// do nothing
+}
+
+void
+CUSBLoopback::usbInit()
+{
+	// do nothing
+}
+
+void
+CUSBLoopback::usbShut()
+{
+	// do nothing
+}
+
+USBContextHandle
+CUSBLoopback::usbGetContext()
+{
+	return NULL;
+}
+
+size_t
+CUSBLoopback::usbGetDeviceList(USBDeviceEnumerator** list)
+{
+	*list = new USBDeviceEnumerator[3];
+	(*list)[0] = reinterpret_cast<USBDeviceEnumerator>(&m_devices[0]);
+	(*list)[1] = reinterpret_cast<USBDeviceEnumerator>(&m_devices[1]);
+	(*list)[2] = NULL;
+	return 2;
+}
+
+void
+CUSBLoopback::usbFreeDeviceList(USBDeviceEnumerator* list)
+{
+	delete[] list;
+}
+
+void
+CUSBLoopback::usbGetDeviceInfo(USBDeviceEnumerator devEnum, USBDeviceInfo& info)
+{
+	info = reinterpret_cast<CDevice*>(devEnum)->m_info;
+}
+
+USBDeviceHandle
+CUSBLoopback::usbOpenDevice(USBDeviceEnumerator devEnum, int)
+{
+	CLock lock(&m_mutex);
+
+	CDevice* device = reinterpret_cast<CDevice*>(devEnum);
+	if (device->m_open) {
+		throw XArchNetwork("interface already claimed");
+	}
+
+	// anything sent while the device was closed is lost
+	device->m_open = true;
+	device->m_packets.clear();
+	return reinterpret_cast<USBDeviceHandle>(device);
+}
+
+USBDeviceHandle
+CUSBLoopback::usbOpenDevice(USBDeviceInfo& devInfo, int ifid)
+{
+	for (int i = 0; i < 2; ++i) {
+		const USBDeviceInfo& info = m_devices[i].m_info;
+		if (info.idVendor == devInfo.idVendor &&
+			info.idProduct == devInfo.idProduct &&
+			(info.busNumber == devInfo.busNumber ||
+				devInfo.busNumber == (unsigned char)-1) &&
+			(info.deviceAddress == devInfo.deviceAddress ||
+				devInfo.deviceAddress == (unsigned char)-1)) {
+			USBDeviceHandle handle = usbOpenDevice(
+				reinterpret_cast<USBDeviceEnumerator>(&m_devices[i]), ifid);
+
+			devInfo.validEndpointInfo           = true;
+			devInfo.inputEndpoint               = info.inputEndpoint;
+			devInfo.outputEndpoint              = info.outputEndpoint;
+			devInfo.interfaceNumber             = info.interfaceNumber;
+			devInfo.inputEndpointMaxPacketSize  = info.inputEndpointMaxPacketSize;
+			devInfo.outputEndpointMaxPacketSize = info.outputEndpointMaxPacketSize;
+			return handle;
+		}
+	}
+	return NULL;
+}
+
+void
+CUSBLoopback::usbCloseDevice(USBDeviceHandle dev, int)
+{
+	CLock lock(&m_mutex);
+
+	CDevice* device = findDevice(dev);
+	if (device == NULL) {
+		return;
+	}
+
+	// reads still waiting are cancelled
+	double now = ARCH->time();
+	while (!device->m_reads.empty()) {
+		complete(device->m_reads.front(), USBTransfer::kCancelled, now);
+		device->m_reads.pop_front();
+	}
+	device->m_packets.clear();
+	device->m_open = false;
+	m_wake.broadcast();
+}
+
+int
+CUSBLoopback::usbBulkTransfer(USBDeviceHandle, bool, unsigned char,
+				char*, unsigned int, unsigned int)
+{
+	throw XArchUsbTransferFailure("synchronous transfers are not emulated");
+}
+
+int
+CUSBLoopback::usbTryBulkTransfer(USBDeviceHandle, bool, unsigned char,
+				char*, unsigned int, unsigned int)
+{
+	return 0;
+}
+
+USBTransfer*
+CUSBLoopback::usbAllocTransfer()
+{
+	USBTransfer* transfer = new USBTransfer;
+	memset(transfer, 0, sizeof(USBTransfer));
+	return transfer;
+}
+
+void
+CUSBLoopback::usbFreeTransfer(USBTransfer* transfer)
+{
+	delete transfer;
+}
+
+bool
+CUSBLoopback::usbSubmitTransfer(USBTransfer* transfer)
+{
+	CLock lock(&m_mutex);
+
+	CDevice* device = findDevice(transfer->m_device);
+	if (device == NULL || !device->m_open) {
+		return false;
+	}
+
+	double now = ARCH->time();
+	transfer->m_actualLength = 0;
+
+	if (shouldFail()) {
+		complete(transfer, USBTransfer::kFailed, now + m_latency);
+	}
+	else if ((transfer->m_endpoint & 0x80) != 0) {
+		// wait for packets from the peer
+		device->m_reads.push_back(transfer);
+	}
+	else {
+		// split into packets for the peer.  the write is done once the
+		// last packet is on the wire.
+		CPacket packet;
+		packet.m_time = now + m_latency;
+
+		const char* data = reinterpret_cast<const char*>(transfer->m_buffer);
+		int n = transfer->m_length;
+		do {
+			int size = (n < m_maxPacketSize) ? n : m_maxPacketSize;
+			packet.m_data.assign(data, size);
+			device->m_peer->m_packets.push_back(packet);
+			data += size;
+			n    -= size;
+		} while (n > 0);
+
+		if (transfer->m_zeroPacket && transfer->m_length > 0 &&
+			transfer->m_length % m_maxPacketSize == 0) {
+			packet.m_data.clear();
+			device->m_peer->m_packets.push_back(packet);
+		}
+
+		transfer->m_actualLength = transfer->m_length;
+		complete(transfer, USBTransfer::kCompleted, packet.m_time);
+	}
+
+	m_wake.broadcast();
+	return true;
+}
+
+void
+CUSBLoopback::usbCancelTransfer(USBTransfer* transfer)
+{
+	CLock lock(&m_mutex);
+
+	// only reads can be waiting.  writes are already on the wire.
+	CDevice* device = findDevice(transfer->m_device);
+	if (device == NULL) {
+		return;
+	}
+	for (CTransfers::iterator i = device->m_reads.begin();
+							i != device->m_reads.end(); ++i) {
+		if (*i == transfer) {
+			device->m_reads.erase(i);
+			complete(transfer, USBTransfer::kCancelled, ARCH->time());
+			m_wake.broadcast();
+			break;
+		}
+	}
+}
+
+bool
+CUSBLoopback::usbSetPollfdNotifiers(USBPollfdAddedFunc, USBPollfdRemovedFunc, void*)
+{
+	// callbacks always come from our own thread
+	return false;
+}
+
+void
+CUSBLoopback::usbHandleEvents()
+{
+	// do nothing
+}
+
+CUSBLoopback::CDevice*
+CUSBLoopback::findDevice(USBDeviceHandle handle) const
+{
+	for (int i = 0; i < 2; ++i) {
+		if (handle == reinterpret_cast<USBDeviceHandle>(
+							const_cast<CDevice*>(&m_devices[i]))) {
+			return const_cast<CDevice*>(&m_devices[i]);
+		}
+	}
+	return NULL;
+}
+
+bool
+CUSBLoopback::shouldFail()
+{
+	if (m_failureRate <= 0.0) {
+		return false;
+	}
+
+	// linear congruential generator.  the high bits are the random ones.
+	m_random = (m_random * 1664525 + 1013904223) & 0xffffffff;
+	if ((m_random >> 8) / 16777216.0 >= m_failureRate) {
+		return false;
+	}
+
+	++m_failures;
+	return true;
+}
+
+void
+CUSBLoopback::complete(USBTransfer* transfer,
+				USBTransfer::EStatus status, double time)
+{
+	transfer->m_status = status;
+
+	// keep completions in time order
+	CCompletion completion;
+	completion.m_transfer = transfer;
+	completion.m_time     = time;
+	CCompletions::iterator i = m_completions.end();
+	while (i != m_completions.begin() && (i - 1)->m_time > time) {
+		--i;
+	}
+	m_completions.insert(i, completion);
+}
+
+void
+CUSBLoopback::deliver(CDevice* device, double now)
+{
+	while (!device->m_reads.empty() && !device->m_packets.empty() &&
+			device->m_packets.front().m_time <= now) {
+		USBTransfer* transfer = device->m_reads.front();
+		const std::string& data = device->m_packets.front().m_data;
+		int size = static_cast<int>(data.size());
+
+		if (size > transfer->m_length - transfer->m_actualLength) {
+			// babble.  the packet doesn't fit what's left of the buffer.
+			device->m_packets.pop_front();
+			device->m_reads.pop_front();
+			complete(transfer, USBTransfer::kFailed, now);
+			continue;
+		}
+
+		memcpy(transfer->m_buffer + transfer->m_actualLength, data.data(), size);
+		transfer->m_actualLength += size;
+		device->m_packets.pop_front();
+
+		// a short packet or a full buffer ends the read
+		if (size < m_maxPacketSize ||
+			transfer->m_actualLength == transfer->m_length) {
+			device->m_reads.pop_front();
+			complete(transfer, USBTransfer::kCompleted, now);
+		}
+	}
+}
+
+double
+CUSBLoopback::pump(CCompletions& ready)
+{
+	double now  = ARCH->time();
+	double next = -1.0;
+
+	for (int i = 0; i < 2; ++i) {
+		CDevice* device = &m_devices[i];
+		deliver(device, now);
+		if (!device->m_reads.empty() && !device->m_packets.empty() &&
+			(next < 0.0 || device->m_packets.front().m_time < next)) {
+			next = device->m_packets.front().m_time;
+		}
+	}
+
+	while (!m_completions.empty() && m_completions.front().m_time <= now) {
+		ready.push_back(m_completions.front());
+		m_completions.pop_front();
+	}
+	if (!m_completions.empty() &&
+		(next < 0.0 || m_completions.front().m_time < next)) {
+		next = m_completions.front().m_time;
+	}
+
+	return (next < 0.0) ? -1.0 : next - now;
+}
+
+void
+CUSBLoopback::workerThread(void*)
+{
+	for (;;) {
+		CCompletions ready;
+		{
+			CLock lock(&m_mutex);
+			if (m_stop) {
+				break;
+			}
+
+			double timeout = pump(ready);
+			if (ready.empty()) {
+				m_wake.wait(timeout);
+				continue;
+			}
+		}
+
+		// callbacks may submit transfers so call them unlocked
+		for (CCompletions::iterator i = ready.begin(); i != ready.end(); ++i) {
+			i->m_transfer->m_callback(i->m_transfer);
+		}
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUSBLOOPBACK_H
+#define CUSBLOOPBACK_H
+
+#include "IArchUsbDataLink.h"
+#include "CCondVar.h"
+#include "CMutex.h"
+#include "BasicTypes.h"
+#include <deque>
+#include <string>
+
+class CThread;
+
+//! Software USB backend
+/*!
+Emulates a pair of USB bridge cable ends in memory.  Bytes written to
+the bulk out endpoint of one end arrive at the bulk in endpoint of the
+other, split into packets of the configured size.  A read completes when
+its buffer is full or a short packet arrives.  Each packet is delivered
+after the configured latency and transfers fail at the configured rate.
+Callbacks are made on a worker thread.
+
+Install with CArch::setUsb().  Both ends use the default synergy vendor
+and product IDs on bus 1;  the first is at device address 1 and the
+second at device address 2.
+*/
+class CUSBLoopback : public IArchUsbDataLink {
+public:
+	CUSBLoopback(int maxPacketSize = 512);
+	virtual ~CUSBLoopback();
+
+	//! @name manipulators
+	//@{
+
+	//! Set delivery latency
+	/*!
+	Delays every packet and every write completion by \c seconds.
+	*/
+	void				setLatency(double seconds);
+
+	//! Set failure rate
+	/*!
+	Fails each submitted transfer with probability \c rate.  Failures
+	are picked by a generator seeded with \c seed so runs repeat.
+	*/
+	void				setFailureRate(double rate, UInt32 seed);
+
+	//@}
+	//! @name accessors
+	//@{
+
+	//! Get device address of an end
+	/*!
+	Returns the device address of end \c index (0 or 1) on bus 1.
+	*/
+	static unsigned char getDeviceAddress(int index);
+
+	//! Get number of transfers failed
+	UInt32				getFailures() const;
+
+	//@}
+
+	// IArchUsbDataLink overrides
+	virtual void		init();
+	virtual void		usbInit();
+	virtual void		usbShut();
+	virtual USBContextHandle usbGetContext();
+	virtual size_t		usbGetDeviceList(USBDeviceEnumerator** list);
+	virtual void		usbFreeDeviceList(USBDeviceEnumerator* list);
+	virtual void		usbGetDeviceInfo(USBDeviceEnumerator devEnum, USBDeviceInfo& info);
+	virtual USBDeviceHandle usbOpenDevice(USBDeviceEnumerator devEnum, int ifid);
+	virtual USBDeviceHandle usbOpenDevice(USBDeviceInfo& devInfo, int ifid);
+	virtual void		usbCloseDevice(USBDeviceHandle dev, int ifid);
+	virtual int			usbBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout);
+	virtual int			usbTryBulkTransfer(USBDeviceHandle dev, bool write, unsigned char port, char* buf, unsigned int len, unsigned int timeout);
+	virtual USBTransfer* usbAllocTransfer();
+	virtual void		usbFreeTransfer(USBTransfer* transfer);
+	virtual bool		usbSubmitTransfer(USBTransfer* transfer);
+	virtual void		usbCancelTransfer(USBTransfer* transfer);
+	virtual bool		usbSetPollfdNotifiers(USBPollfdAddedFunc added, USBPollfdRemovedFunc removed, void* userData);
+	virtual void		usbHandleEvents();
+
+private:
+	class CPacket {
+	public:
+		std::string		m_data;
+		double			m_time;
+	};
+	typedef std::deque<CPacket> CPackets;
+
+	class CCompletion {
+	public:
+		USBTransfer*	m_transfer;
+		double			m_time;
+	};
+	typedef std::deque<CCompletion> CCompletions;
+	typedef std::deque<USBTransfer*> CTransfers;
+
+	class CDevice {
+	public:
+		USBDeviceInfo	m_info;
+		bool			m_open;
+		CDevice*		m_peer;
+
+		// packets on their way to the in endpoint and reads waiting
+		// for them
+		CPackets		m_packets;
+		CTransfers		m_reads;
+	};
+
+	CDevice*			findDevice(USBDeviceHandle) const;
+	bool				shouldFail();
+	void				complete(USBTransfer*, USBTransfer::EStatus, double time);
+	void				deliver(CDevice*, double now);
+	double				pump(CCompletions& ready);
+	void				workerThread(void*);
+
+private:
+	CDevice				m_devices[2];
+	int					m_maxPacketSize;
+	double				m_latency;
+	double				m_failureRate;
+	UInt32				m_random;
+	UInt32				m_failures;
+
+	CMutex				m_mutex;
+	CCondVar<bool>		m_wake;
+	bool				m_stop;
+	CCompletions		m_completions;
+	CThread*			m_thread;
+};
+
+#endif
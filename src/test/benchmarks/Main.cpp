@@ -0,0 +1,81 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Benchmarks.h"
+#include "CArch.h"
+#include "CLog.h"
+#include "CEventQueue.h"
+#include <stdio.h>
+#include <string.h>
+
+#if SYSAPI_WIN32
+#include "CArchMiscWindows.h"
+#endif
+
+struct CBenchmark {
+	const char*			m_name;
+	int					(*m_run)(int argc, char** argv);
+};
+
+static const CBenchmark	s_benchmarks[] = {
+	{ "usbdatalink",	&usbDataLinkBenchmark },
+	{ "streambuffer",	&streamBufferBenchmark },
+	{ "eventqueue",		&eventQueueBenchmark },
+	{ "protocol",		&protocolBenchmark }
+};
+
+static void
+usage(const char* arg0)
+{
+	printf("usage: %s <benchmark> [options]\n\nbenchmarks:\n", arg0);
+	for (size_t i = 0; i < sizeof(s_benchmarks) / sizeof(s_benchmarks[0]); ++i) {
+		printf("  %s\n", s_benchmarks[i].m_name);
+	}
+}
+
+int
+main(int argc, char** argv)
+{
+#if SYSAPI_WIN32
+	// record window instance for tray icon, etc
+	CArchMiscWindows::setInstanceWin32(GetModuleHandle(NULL));
+#endif
+
+	CArch arch;
+	arch.init();
+
+	// keep logging out of the measurements
+	CLog log;
+	log.setFilter(kWARNING);
+
+	CEventQueue events;
+
+	if (argc < 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (size_t i = 0; i < sizeof(s_benchmarks) / sizeof(s_benchmarks[0]); ++i) {
+		if (strcmp(argv[1], s_benchmarks[i].m_name) == 0) {
+			return s_benchmarks[i].m_run(argc - 2, argv + 2);
+		}
+	}
+
+	fprintf(stderr, "unknown benchmark: %s\n", argv[1]);
+	usage(argv[0]);
+	return 1;
+}
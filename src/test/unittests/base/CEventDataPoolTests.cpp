@@ -0,0 +1,126 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CEventDataPool.h"
+#include "CThread.h"
+#include "TMethodJob.h"
+#include "CArchAtomic.h"
+#include "stdvector.h"
+
+// more allocations than the pool has blocks
+static const int		kMaxBlocks = 100000;
+
+// allocates and frees blocks while other threads do the same and
+// counts blocks that were changed while it held them
+class CPoolUser {
+public:
+	CPoolUser() : m_corrupt(0) { }
+
+	void				run(void* vid)
+	{
+		const UInt64 id = (UInt64)(size_t)vid;
+		UInt64* data[8];
+		for (int i = 0; i < 20000; ++i) {
+			for (int j = 0; j < 8; ++j) {
+				data[j] = static_cast<UInt64*>(
+							CEventDataPool::alloc(4 * sizeof(UInt64)));
+				for (int k = 0; k < 4; ++k) {
+					data[j][k] = id;
+				}
+			}
+			for (int j = 0; j < 8; ++j) {
+				for (int k = 0; k < 4; ++k) {
+					if (data[j][k] != id) {
+						CArchAtomic::add(&m_corrupt, 1);
+					}
+				}
+				CEventDataPool::release(data[j]);
+			}
+		}
+	}
+
+	volatile SInt32		m_corrupt;
+};
+
+TEST(CEventDataPoolTests, alloc_small_comesFromPool)
+{
+	UInt32 hits = CEventDataPool::getHits();
+	void* data  = CEventDataPool::alloc(16);
+	EXPECT_TRUE(CEventDataPool::isPooled(data));
+	EXPECT_EQ(hits + 1, CEventDataPool::getHits());
+
+	// a released block is reused first
+	CEventDataPool::release(data);
+	EXPECT_EQ(data, CEventDataPool::alloc(16));
+	CEventDataPool::release(data);
+}
+
+TEST(CEventDataPoolTests, alloc_large_fallsBackToMalloc)
+{
+	UInt32 misses = CEventDataPool::getMisses();
+	void* data    = CEventDataPool::alloc(4096);
+	ASSERT_TRUE(data != NULL);
+	EXPECT_FALSE(CEventDataPool::isPooled(data));
+	EXPECT_EQ(misses + 1, CEventDataPool::getMisses());
+	CEventDataPool::release(data);
+}
+
+TEST(CEventDataPoolTests, alloc_poolExhausted_fallsBackToMalloc)
+{
+	std::vector<void*> blocks;
+	void* data;
+	while ((data = CEventDataPool::alloc(16)) != NULL &&
+			CEventDataPool::isPooled(data)) {
+		blocks.push_back(data);
+		ASSERT_LT((int)blocks.size(), kMaxBlocks);
+	}
+	ASSERT_TRUE(data != NULL);
+	EXPECT_FALSE(blocks.empty());
+
+	// still fine to release while the pool is empty
+	UInt32 misses = CEventDataPool::getMisses();
+	void* more    = CEventDataPool::alloc(16);
+	EXPECT_FALSE(CEventDataPool::isPooled(more));
+	EXPECT_EQ(misses + 1, CEventDataPool::getMisses());
+	CEventDataPool::release(more);
+	CEventDataPool::release(data);
+
+	// every block comes back
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		CEventDataPool::release(blocks[i]);
+	}
+	data = CEventDataPool::alloc(16);
+	EXPECT_TRUE(CEventDataPool::isPooled(data));
+	CEventDataPool::release(data);
+}
+
+TEST(CEventDataPoolTests, alloc_manyThreads_blocksNotShared)
+{
+	CPoolUser user;
+	std::vector<CThread*> threads;
+	for (size_t i = 0; i < 4; ++i) {
+		threads.push_back(new CThread(new TMethodJob<CPoolUser>(
+							&user, &CPoolUser::run, (void*)(i + 1))));
+	}
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i]->wait();
+		delete threads[i];
+	}
+
+	EXPECT_EQ(0, (int)user.m_corrupt);
+}
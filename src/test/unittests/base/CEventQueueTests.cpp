@@ -0,0 +1,138 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CEventQueue.h"
+#include "CArch.h"
+
+static const UInt32		kNumWriters = 6;
+
+// a thread adding numbered events to a queue.  each event's target is
+// the writer and its data is its number.
+class CWriter {
+public:
+	CEventQueue*		m_queue;
+	CEvent::Type		m_type;
+	UInt32				m_numEvents;
+};
+
+static void*
+writerThread(void* vwriter)
+{
+	CWriter* writer = static_cast<CWriter*>(vwriter);
+	for (UInt32 i = 0; i < writer->m_numEvents; ++i) {
+		writer->m_queue->addEvent(CEvent(writer->m_type, writer,
+							reinterpret_cast<void*>(i), CEvent::kDontFreeData));
+	}
+	return NULL;
+}
+
+static void
+startWriters(CEventQueue& queue, CWriter* writers, CArchThread* threads,
+							UInt32 numEvents)
+{
+	CEvent::Type type = queue.registerType("CEventQueueTests");
+	for (UInt32 i = 0; i < kNumWriters; ++i) {
+		writers[i].m_queue     = &queue;
+		writers[i].m_type      = type;
+		writers[i].m_numEvents = numEvents;
+		threads[i] = ARCH->newThread(&writerThread, &writers[i]);
+	}
+}
+
+static void
+stopWriters(CArchThread* threads)
+{
+	for (UInt32 i = 0; i < kNumWriters; ++i) {
+		ARCH->wait(threads[i], -1.0);
+		ARCH->closeThread(threads[i]);
+	}
+}
+
+// get events until there are none for timeout seconds, checking each
+// writer's events arrive in order.  returns the number of events.
+static UInt32
+readEvents(CEventQueue& queue, CWriter* writers, UInt32 total,
+							double timeout)
+{
+	UInt32 next[kNumWriters] = { 0 };
+	UInt32 n = 0;
+	CEvent event;
+	while (n < total && queue.getEvent(event, timeout)) {
+		UInt32 writer = static_cast<UInt32>(
+							static_cast<CWriter*>(event.getTarget()) - writers);
+		EXPECT_GT(kNumWriters, writer);
+		if (writer >= kNumWriters) {
+			break;
+		}
+		EXPECT_EQ(next[writer], reinterpret_cast<size_t>(event.getData()));
+		next[writer] = static_cast<UInt32>(
+							reinterpret_cast<size_t>(event.getData())) + 1;
+		++n;
+	}
+	return n;
+}
+
+TEST(CEventQueueTests, addEvent_sixWriters_eachWritersEventsInOrder)
+{
+	CEventQueue queue;
+	CWriter writers[kNumWriters];
+	CArchThread threads[kNumWriters];
+	startWriters(queue, writers, threads, 20000);
+
+	EXPECT_EQ(kNumWriters * 20000,
+				readEvents(queue, writers, kNumWriters * 20000, 5.0));
+
+	stopWriters(threads);
+}
+
+TEST(CEventQueueTests, addEvent_moreEventsThanFit_overflowedEventsInOrder)
+{
+	// nothing reads until every writer is done so most events don't
+	// fit in the event table's or the buffer's ring
+	CEventQueue queue;
+	CWriter writers[kNumWriters];
+	CArchThread threads[kNumWriters];
+	startWriters(queue, writers, threads, 5000);
+	stopWriters(threads);
+
+	EXPECT_EQ(kNumWriters * 5000,
+				readEvents(queue, writers, kNumWriters * 5000, 0.0));
+	CEvent event;
+	EXPECT_FALSE(queue.getEvent(event, 0.0));
+}
+
+TEST(CEventQueueTests, adoptBuffer_whileWritersAdd_keepsLaterEventsInOrder)
+{
+	CEventQueue queue;
+	CWriter writers[kNumWriters];
+	CArchThread threads[kNumWriters];
+	startWriters(queue, writers, threads, 20000);
+
+	// events in the old buffer are discarded so only check the ones
+	// added once the new buffer is in place
+	queue.adoptBuffer(NULL);
+	stopWriters(threads);
+	queue.adoptBuffer(NULL);
+
+	CEvent::Type type = writers[0].m_type;
+	for (UInt32 i = 0; i < kNumWriters; ++i) {
+		writers[i].m_queue->addEvent(CEvent(type, &writers[i],
+							NULL, CEvent::kDontFreeData));
+	}
+	EXPECT_EQ(kNumWriters, readEvents(queue, writers, kNumWriters, 0.0));
+}
@@ -0,0 +1,269 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CString.h"
+#include "stdvector.h"
+
+#define TEST_ENV
+#include "Global.h"
+#include "CLog.h"
+#include "CThread.h"
+#include "TMethodJob.h"
+#include "CMutex.h"
+#include "CLock.h"
+#include "CCondVar.h"
+#include "CStopwatch.h"
+#include "CArch.h"
+#include "CArchAtomic.h"
+#include "ILogOutputter.h"
+
+// every test uses the same size since the ring is kept once allocated
+static const UInt32		kRecords = 4;
+
+// how long to wait for another thread before giving up
+static const double		kTimeout = 5.0;
+
+// keeps messages printed with CLOG_PRINT.  while closed, the gate holds
+// the writer in write().
+class CCaptureOutputter : public ILogOutputter {
+public:
+	CCaptureOutputter() :
+		m_gateOpen(&m_mutex, true),
+		m_inWrite(&m_mutex, false) { }
+
+	// ILogOutputter overrides
+	virtual void		open(const char*) { }
+	virtual void		close() { }
+	virtual void		show(bool) { }
+	virtual bool		write(ELevel level, const char* message)
+	{
+		if (level == kPRINT) {
+			CLock lock(&m_mutex);
+			m_messages.push_back(message);
+			m_inWrite = true;
+			m_inWrite.broadcast();
+			while (!m_gateOpen) {
+				m_gateOpen.wait();
+			}
+			m_inWrite = false;
+		}
+		return false;
+	}
+
+	void				closeGate()
+	{
+		CLock lock(&m_mutex);
+		m_gateOpen = false;
+	}
+
+	void				openGate()
+	{
+		CLock lock(&m_mutex);
+		m_gateOpen = true;
+		m_gateOpen.broadcast();
+	}
+
+	bool				waitForWriter()
+	{
+		CLock lock(&m_mutex);
+		CStopwatch timer(true);
+		while (!m_inWrite) {
+			if (!m_inWrite.wait(timer, kTimeout)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<CString> getMessages()
+	{
+		CLock lock(&m_mutex);
+		return m_messages;
+	}
+
+private:
+	CMutex				m_mutex;
+	CCondVar<bool>		m_gateOpen;
+	CCondVar<bool>		m_inWrite;
+	std::vector<CString> m_messages;
+};
+
+class CLogTests : public ::testing::Test {
+public:
+	virtual void		SetUp()
+	{
+		// keep thread entry and exit messages out of the ring
+		m_filter    = CLOG->getFilter();
+		CLOG->setFilter(kINFO);
+
+		m_outputter = new CCaptureOutputter;
+		CLOG->insert(m_outputter);
+		m_dropped   = CLOG->getDropped();
+	}
+
+	virtual void		TearDown()
+	{
+		m_outputter->openGate();
+		CLOG->stopAsync();
+		CLOG->remove(m_outputter);
+		delete m_outputter;
+		CLOG->setFilter(m_filter);
+	}
+
+	// prints messages 1 to kRecords on another thread
+	void				printThread(void*)
+	{
+		for (UInt32 i = 1; i <= kRecords; ++i) {
+			LOG((CLOG_PRINT "message %d", i));
+		}
+	}
+
+	void				stopThread(void*)
+	{
+		CLOG->stopAsync();
+	}
+
+	static bool			waitFor(volatile SInt32* flag)
+	{
+		CStopwatch timer(true);
+		while (CArchAtomic::load(flag) == 0) {
+			if (timer.getTime() > kTimeout) {
+				return false;
+			}
+			ARCH->sleep(0.001);
+		}
+		return true;
+	}
+
+	UInt32				newDropped() const
+	{
+		return CLOG->getDropped() - m_dropped;
+	}
+
+	CCaptureOutputter*	m_outputter;
+	UInt32				m_dropped;
+	int					m_filter;
+};
+
+TEST_F(CLogTests, startAsync_manyMessages_writtenInOrder)
+{
+	CLOG->startAsync(kRecords, CLog::kBlockOnOverflow);
+	for (int i = 0; i < 200; ++i) {
+		LOG((CLOG_PRINT "message %d", i));
+	}
+	CLOG->stopAsync();
+
+	std::vector<CString> messages = m_outputter->getMessages();
+	ASSERT_EQ(200u, messages.size());
+	for (int i = 0; i < 200; ++i) {
+		char expected[20];
+		sprintf(expected, "message %d", i);
+		EXPECT_EQ(expected, messages[i]);
+	}
+	EXPECT_EQ(0u, newDropped());
+}
+
+TEST_F(CLogTests, startAsync_longMessage_writtenWhole)
+{
+	CString message(5000, 'x');
+	message += "end";
+
+	CLOG->startAsync(kRecords, CLog::kBlockOnOverflow);
+	LOG((CLOG_PRINT "short"));
+	LOG((CLOG_PRINT "%s", message.c_str()));
+	LOG((CLOG_PRINT "short"));
+	CLOG->stopAsync();
+
+	std::vector<CString> messages = m_outputter->getMessages();
+	ASSERT_EQ(3u, messages.size());
+	EXPECT_EQ("short", messages[0]);
+	EXPECT_EQ(message, messages[1]);
+	EXPECT_EQ("short", messages[2]);
+}
+
+TEST_F(CLogTests, startAsync_dropOnOverflow_fullRingDropsMessages)
+{
+	CLOG->startAsync(kRecords, CLog::kDropOnOverflow);
+	m_outputter->closeGate();
+	LOG((CLOG_PRINT "message 0"));
+	ASSERT_TRUE(m_outputter->waitForWriter());
+
+	// the writer holds the first record until write() returns
+	for (UInt32 i = 1; i <= 2 * kRecords; ++i) {
+		LOG((CLOG_PRINT "message %d", i));
+	}
+	EXPECT_EQ(kRecords + 1, newDropped());
+
+	m_outputter->openGate();
+	CLOG->stopAsync();
+
+	std::vector<CString> messages = m_outputter->getMessages();
+	ASSERT_EQ(kRecords, messages.size());
+	EXPECT_EQ("message 0", messages[0]);
+	EXPECT_EQ("message 3", messages[kRecords - 1]);
+}
+
+TEST_F(CLogTests, startAsync_blockOnOverflow_printWaitsForRoom)
+{
+	CLOG->startAsync(kRecords, CLog::kBlockOnOverflow);
+	m_outputter->closeGate();
+	LOG((CLOG_PRINT "message 0"));
+	ASSERT_TRUE(m_outputter->waitForWriter());
+
+	// the last message doesn't fit until the writer moves on
+	CThread printer(new TMethodJob<CLogTests>(
+							this, &CLogTests::printThread));
+	ASSERT_TRUE(waitFor(&CLOG->m_printersWaiting));
+	EXPECT_FALSE(printer.wait(0.05));
+
+	m_outputter->openGate();
+	EXPECT_TRUE(printer.wait(kTimeout));
+	CLOG->stopAsync();
+
+	std::vector<CString> messages = m_outputter->getMessages();
+	ASSERT_EQ(kRecords + 1, messages.size());
+	EXPECT_EQ("message 4", messages[kRecords]);
+	EXPECT_EQ(0u, newDropped());
+}
+
+TEST_F(CLogTests, stopAsync_printWaitingForRoom_printDropsMessage)
+{
+	CLOG->startAsync(kRecords, CLog::kBlockOnOverflow);
+	m_outputter->closeGate();
+	LOG((CLOG_PRINT "message 0"));
+	ASSERT_TRUE(m_outputter->waitForWriter());
+
+	CThread printer(new TMethodJob<CLogTests>(
+							this, &CLogTests::printThread));
+	ASSERT_TRUE(waitFor(&CLOG->m_printersWaiting));
+
+	// the printer must give up as soon as the writer is told to stop,
+	// not when the writer gets around to making room
+	CThread stopper(new TMethodJob<CLogTests>(
+							this, &CLogTests::stopThread));
+	ASSERT_TRUE(waitFor(&CLOG->m_stopWriter));
+	EXPECT_TRUE(printer.wait(kTimeout));
+	EXPECT_EQ(1u, newDropped());
+
+	m_outputter->openGate();
+	EXPECT_TRUE(stopper.wait(kTimeout));
+
+	std::vector<CString> messages = m_outputter->getMessages();
+	ASSERT_EQ(kRecords, messages.size());
+	EXPECT_EQ("message 3", messages[kRecords - 1]);
+}
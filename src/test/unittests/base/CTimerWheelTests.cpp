@@ -0,0 +1,163 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CArch.h"
+#include "CFunctionEventJob.h"
+#include "stdvector.h"
+
+#define TEST_ENV
+#include "Global.h"
+#include "CEventQueue.h"
+
+typedef CEventQueue::CTimer CTimer;
+typedef CEventQueue::CTimerWheel CTimerWheel;
+
+// the wheel turns once every 32 seconds
+static const double		kWheelTurn = 32.0;
+
+static CTimer
+makeTimer(double timeout, double time, bool oneShot)
+{
+	return CTimer(NULL, timeout, time, NULL, oneShot);
+}
+
+TEST(CTimerWheelTests, getNextTime_empty_isNegative)
+{
+	CTimerWheel wheel;
+	CTimer timer = makeTimer(1.0, 0.0, true);
+
+	EXPECT_EQ(-1.0, wheel.getNextTime());
+	EXPECT_FALSE(wheel.expire(100.0, timer));
+	EXPECT_EQ(-1.0, wheel.getNextTime());
+}
+
+TEST(CTimerWheelTests, remove_linkedTimers_earliestRemainingIsNext)
+{
+	CTimerWheel wheel;
+	UInt32 a = wheel.insert(makeTimer(3.0, 0.0, true));
+	UInt32 b = wheel.insert(makeTimer(1.0, 0.0, true));
+	UInt32 c = wheel.insert(makeTimer(2.0, 0.0, true));
+	EXPECT_EQ(1.0, wheel.getNextTime());
+
+	// from the middle of the wheel, then the earliest
+	wheel.remove(c);
+	EXPECT_EQ(1.0, wheel.getNextTime());
+	wheel.remove(b);
+	EXPECT_EQ(3.0, wheel.getNextTime());
+
+	// ids are reused and relinked
+	UInt32 d = wheel.insert(makeTimer(0.5, 0.0, true));
+	EXPECT_TRUE(d == b || d == c);
+	EXPECT_EQ(0.5, wheel.getNextTime());
+	wheel.remove(d);
+	wheel.remove(a);
+	EXPECT_EQ(-1.0, wheel.getNextTime());
+}
+
+TEST(CTimerWheelTests, expire_timersInSameSlot_expireInTimeOrder)
+{
+	// 1.0 and 1.0 + kWheelTurn hash to the same slot
+	CTimerWheel wheel;
+	wheel.insert(makeTimer(1.0 + kWheelTurn, 0.0, true));
+	wheel.insert(makeTimer(1.01, 0.0, true));
+	wheel.insert(makeTimer(1.0, 0.0, true));
+
+	CTimer timer = makeTimer(1.0, 0.0, true);
+	EXPECT_TRUE(wheel.expire(2.0, timer));
+	EXPECT_EQ(1.0, timer.getTime());
+	EXPECT_TRUE(wheel.expire(2.0, timer));
+	EXPECT_EQ(1.01, timer.getTime());
+	EXPECT_FALSE(wheel.expire(2.0, timer));
+	EXPECT_EQ(1.0 + kWheelTurn, wheel.getNextTime());
+}
+
+TEST(CTimerWheelTests, expire_farFutureTimers_expireOnTime)
+{
+	CTimerWheel wheel;
+	wheel.insert(makeTimer(10.0 * kWheelTurn, 0.0, true));
+	wheel.insert(makeTimer(3.0 * kWheelTurn, 0.0, true));
+	EXPECT_EQ(3.0 * kWheelTurn, wheel.getNextTime());
+
+	CTimer timer = makeTimer(1.0, 0.0, true);
+	EXPECT_FALSE(wheel.expire(2.0 * kWheelTurn, timer));
+	EXPECT_FALSE(wheel.expire(3.0 * kWheelTurn - 0.5, timer));
+	EXPECT_TRUE(wheel.expire(3.0 * kWheelTurn, timer));
+	EXPECT_EQ(3.0 * kWheelTurn, timer.getTime());
+
+	EXPECT_EQ(10.0 * kWheelTurn, wheel.getNextTime());
+	EXPECT_FALSE(wheel.expire(9.0 * kWheelTurn, timer));
+	EXPECT_TRUE(wheel.expire(20.0 * kWheelTurn, timer));
+	EXPECT_EQ(10.0 * kWheelTurn, timer.getTime());
+	EXPECT_EQ(-1.0, wheel.getNextTime());
+}
+
+TEST(CTimerWheelTests, expire_missedPeriods_countedAndRescheduled)
+{
+	CTimerWheel wheel;
+	wheel.insert(makeTimer(1.0, 0.0, false));
+
+	// 3.5 seconds in, three periods have passed
+	CTimer timer = makeTimer(1.0, 0.0, true);
+	ASSERT_TRUE(wheel.expire(3.5, timer));
+	IEventQueue::CTimerEvent event;
+	timer.fillEvent(event, 3.5);
+	EXPECT_EQ(3, event.m_count);
+
+	// the timer's next period starts now
+	EXPECT_EQ(4.5, wheel.getNextTime());
+	EXPECT_FALSE(wheel.expire(4.0, timer));
+	ASSERT_TRUE(wheel.expire(4.5, timer));
+	timer.fillEvent(event, 4.5);
+	EXPECT_EQ(1, event.m_count);
+}
+
+// handler for a timer that deletes the timers in the vector it's given
+static void
+deleteTimers(const CEvent&, void* vtimers)
+{
+	std::vector<CEventQueueTimer*>* timers =
+		static_cast<std::vector<CEventQueueTimer*>*>(vtimers);
+	for (size_t i = 0; i < timers->size(); ++i) {
+		EVENTQUEUE->deleteTimer((*timers)[i]);
+	}
+	timers->clear();
+}
+
+TEST(CTimerWheelTests, deleteTimer_inHandler_timersDontFireAgain)
+{
+	CEventQueue queue;
+	CEventQueueTimer* first  = queue.newTimer(0.01, NULL);
+	CEventQueueTimer* second = queue.newTimer(0.02, NULL);
+
+	// the first timer's handler deletes both timers
+	std::vector<CEventQueueTimer*> timers;
+	timers.push_back(first);
+	timers.push_back(second);
+	queue.adoptHandler(CEvent::kTimer, first,
+							new CFunctionEventJob(&deleteTimers, &timers));
+
+	CEvent event;
+	ASSERT_TRUE(queue.getEvent(event, 1.0));
+	EXPECT_EQ(CEvent::kTimer, event.getType());
+	EXPECT_EQ(first, event.getTarget());
+	queue.dispatchEvent(event);
+	EXPECT_TRUE(timers.empty());
+
+	EXPECT_FALSE(queue.getEvent(event, 0.1));
+	queue.removeHandler(CEvent::kTimer, first);
+}
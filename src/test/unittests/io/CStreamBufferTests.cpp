@@ -0,0 +1,126 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CStreamBuffer.h"
+#include <string.h>
+
+TEST(CStreamBufferTests, peekSegments_emptyBuffer_returnsZero)
+{
+	CStreamBuffer buffer;
+	CStreamBuffer::CSegment segments[4];
+
+	UInt32 count = buffer.peekSegments(segments, 4, 0);
+
+	EXPECT_EQ(0, count);
+}
+
+TEST(CStreamBufferTests, peekSegments_severalChunks_coversAllData)
+{
+	CStreamBuffer buffer;
+	UInt8 data[10000];
+	for (UInt32 i = 0; i < sizeof(data); ++i) {
+		data[i] = (UInt8)i;
+	}
+	buffer.write(data, sizeof(data));
+	buffer.pop(100);
+
+	CStreamBuffer::CSegment segments[16];
+	UInt32 count = buffer.peekSegments(segments, 16, buffer.getSize());
+
+	UInt32 offset = 100;
+	for (UInt32 i = 0; i < count; ++i) {
+		EXPECT_EQ(0, memcmp(data + offset, segments[i].m_data, segments[i].m_size));
+		offset += segments[i].m_size;
+	}
+	EXPECT_EQ(sizeof(data), offset);
+	EXPECT_LT(1, count);
+}
+
+TEST(CStreamBufferTests, peekSegments_tooFewSegments_coversPrefix)
+{
+	CStreamBuffer buffer;
+	UInt8 data[10000];
+	memset(data, 1, sizeof(data));
+	buffer.write(data, sizeof(data));
+
+	CStreamBuffer::CSegment segments[1];
+	UInt32 count = buffer.peekSegments(segments, 1, buffer.getSize());
+
+	EXPECT_EQ(1, count);
+	EXPECT_GT(sizeof(data), segments[0].m_size);
+}
+
+TEST(CStreamBufferTests, commit_partOfReservation_appendsOnlyCommitted)
+{
+	CStreamBuffer buffer;
+	buffer.write("abc", 3);
+
+	char* space = static_cast<char*>(buffer.reserve(100));
+	memcpy(space, "defg", 4);
+	buffer.commit(4);
+
+	EXPECT_EQ(7, buffer.getSize());
+	EXPECT_EQ(0, memcmp("abcdefg", buffer.peek(7), 7));
+}
+
+TEST(CStreamBufferTests, commit_zero_leavesBufferUnchanged)
+{
+	CStreamBuffer buffer;
+	buffer.write("abc", 3);
+
+	buffer.reserve(10000);
+	buffer.commit(0);
+	buffer.write("d", 1);
+
+	EXPECT_EQ(4, buffer.getSize());
+	EXPECT_EQ(0, memcmp("abcd", buffer.peek(4), 4));
+}
+
+TEST(CStreamBufferTests, reserve_largerThanChunk_returnsContiguousSpace)
+{
+	CStreamBuffer buffer;
+	buffer.write("a", 1);
+
+	UInt8* space = static_cast<UInt8*>(buffer.reserve(100000));
+	memset(space, 2, 100000);
+	buffer.commit(100000);
+	buffer.pop(1);
+
+	CStreamBuffer::CSegment segments[4];
+	UInt32 count = buffer.peekSegments(segments, 4, buffer.getSize());
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(100000, segments[0].m_size);
+}
+
+TEST(CStreamBufferTests, peek_acrossChunks_returnsContiguousData)
+{
+	CStreamBuffer buffer;
+	UInt8 data[10000];
+	for (UInt32 i = 0; i < sizeof(data); ++i) {
+		data[i] = (UInt8)(i * 7);
+	}
+	buffer.write(data, 3000);
+	buffer.pop(1000);
+	buffer.write(data + 3000, 7000);
+
+	const void* peeked = buffer.peek(buffer.getSize());
+
+	EXPECT_EQ(0, memcmp(data + 1000, peeked, 9000));
+	CStreamBuffer::CSegment segments[4];
+	EXPECT_EQ(1, buffer.peekSegments(segments, 4, buffer.getSize()));
+}
@@ -0,0 +1,44 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gmock/gmock.h>
+#include "IArchUsbDataLink.h"
+
+class CMockArchUsbDataLink : public IArchUsbDataLink
+{
+public:
+	MOCK_METHOD0(init, void());
+	MOCK_METHOD0(usbInit, void());
+	MOCK_METHOD0(usbShut, void());
+	MOCK_METHOD0(usbGetContext, USBContextHandle());
+	MOCK_METHOD1(usbGetDeviceList, size_t(USBDeviceEnumerator**));
+	MOCK_METHOD1(usbFreeDeviceList, void(USBDeviceEnumerator*));
+	MOCK_METHOD2(usbGetDeviceInfo, void(USBDeviceEnumerator, USBDeviceInfo&));
+	MOCK_METHOD2(usbOpenDevice, USBDeviceHandle(USBDeviceEnumerator, int));
+	MOCK_METHOD2(usbOpenDevice, USBDeviceHandle(USBDeviceInfo&, int));
+	MOCK_METHOD2(usbCloseDevice, void(USBDeviceHandle, int));
+	MOCK_METHOD6(usbBulkTransfer, int(USBDeviceHandle, bool, unsigned char, char*, unsigned int, unsigned int));
+	MOCK_METHOD6(usbTryBulkTransfer, int(USBDeviceHandle, bool, unsigned char, char*, unsigned int, unsigned int));
+	MOCK_METHOD0(usbAllocTransfer, USBTransfer*());
+	MOCK_METHOD1(usbFreeTransfer, void(USBTransfer*));
+	MOCK_METHOD1(usbSubmitTransfer, bool(USBTransfer*));
+	MOCK_METHOD1(usbCancelTransfer, void(USBTransfer*));
+	MOCK_METHOD3(usbSetPollfdNotifiers, bool(USBPollfdAddedFunc, USBPollfdRemovedFunc, void*));
+	MOCK_METHOD0(usbHandleEvents, void());
+};
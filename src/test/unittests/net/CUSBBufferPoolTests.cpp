@@ -0,0 +1,133 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CThread.h"
+#include "TMethodJob.h"
+#include "CArch.h"
+#include "stdmap.h"
+#include "stdvector.h"
+
+#define TEST_ENV
+#include "Global.h"
+#include "CUSBBufferPool.h"
+
+static const UInt32		kSize = 512 * 64;
+
+TEST(CUSBBufferPoolTests, getInstance_sharedUntilLastRelease)
+{
+	CUSBBufferPool* pool = CUSBBufferPool::getInstance();
+	EXPECT_EQ(pool, CUSBBufferPool::getInstance());
+	EXPECT_EQ(2, (int)CUSBBufferPool::s_refCount);
+
+	CUSBBufferPool::release();
+	EXPECT_EQ(pool, CUSBBufferPool::s_instance);
+
+	CUSBBufferPool::release();
+	EXPECT_TRUE(CUSBBufferPool::s_instance == NULL);
+	EXPECT_EQ(0, (int)CUSBBufferPool::s_refCount);
+}
+
+TEST(CUSBBufferPoolTests, acquireBuffer_noneFree_grows)
+{
+	CUSBBufferPool* pool = CUSBBufferPool::getInstance();
+
+	unsigned char* a = pool->acquireBuffer(kSize);
+	unsigned char* b = pool->acquireBuffer(kSize);
+	EXPECT_NE(a, b);
+	EXPECT_EQ(2, (int)pool->m_borrowed);
+
+	// buffers are usable over their whole length
+	a[0] = a[kSize - 1] = 1;
+	b[0] = b[kSize - 1] = 2;
+
+	pool->releaseBuffer(a, kSize);
+	pool->releaseBuffer(b, kSize);
+	EXPECT_EQ(0, (int)pool->m_borrowed);
+	EXPECT_EQ(2 * kSize, pool->m_freeBytes);
+
+	CUSBBufferPool::release();
+}
+
+TEST(CUSBBufferPoolTests, acquireBuffer_returnedBuffer_reused)
+{
+	CUSBBufferPool* pool = CUSBBufferPool::getInstance();
+
+	unsigned char* a = pool->acquireBuffer(kSize);
+	pool->releaseBuffer(a, kSize);
+	EXPECT_EQ(a, pool->acquireBuffer(kSize));
+	EXPECT_EQ(0u, pool->m_freeBytes);
+
+	// buffers are only reused for the same size
+	unsigned char* b = pool->acquireBuffer(kSize / 2);
+	EXPECT_NE(a, b);
+
+	pool->releaseBuffer(a, kSize);
+	pool->releaseBuffer(b, kSize / 2);
+	CUSBBufferPool::release();
+}
+
+TEST(CUSBBufferPoolTests, releaseBuffer_overFreeLimit_freed)
+{
+	CUSBBufferPool* pool = CUSBBufferPool::getInstance();
+
+	const UInt32 n = CUSBBufferPool::getMaxFreeBytes() / kSize + 4;
+	std::vector<unsigned char*> buffers;
+	for (UInt32 i = 0; i < n; ++i) {
+		buffers.push_back(pool->acquireBuffer(kSize));
+	}
+	for (UInt32 i = 0; i < n; ++i) {
+		pool->releaseBuffer(buffers[i], kSize);
+	}
+
+	EXPECT_EQ(0, (int)pool->m_borrowed);
+	EXPECT_LE(pool->m_freeBytes, CUSBBufferPool::getMaxFreeBytes());
+	EXPECT_EQ(pool->m_freeBytes,
+				pool->m_freeBuffers[kSize].size() * kSize);
+
+	CUSBBufferPool::release();
+}
+
+// takes and drops the pool while other threads do the same
+class CPoolUser {
+public:
+	void				run(void*)
+	{
+		for (int i = 0; i < 2000; ++i) {
+			CUSBBufferPool* pool = CUSBBufferPool::getInstance();
+			pool->releaseBuffer(pool->acquireBuffer(kSize), kSize);
+			CUSBBufferPool::release();
+		}
+	}
+};
+
+TEST(CUSBBufferPoolTests, getInstance_manyThreads_poolFreedAfterLastRelease)
+{
+	CPoolUser user;
+	std::vector<CThread*> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.push_back(new CThread(
+							new TMethodJob<CPoolUser>(&user, &CPoolUser::run)));
+	}
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i]->wait();
+		delete threads[i];
+	}
+
+	EXPECT_TRUE(CUSBBufferPool::s_instance == NULL);
+	EXPECT_EQ(0, (int)CUSBBufferPool::s_refCount);
+}
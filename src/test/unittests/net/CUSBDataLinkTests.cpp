@@ -0,0 +1,336 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CMockArchUsbDataLink.h"
+#include "CUSBDataLink.h"
+#include "CUSBAddress.h"
+#include "CEventQueue.h"
+#include "CThread.h"
+#include "TMethodJob.h"
+#include "CLock.h"
+#include "CCondVar.h"
+#include "CArch.h"
+#include <string.h>
+#include <vector>
+
+using ::testing::_;
+using ::testing::An;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+const UInt8				kBulkIn  = 0x81;
+const UInt8				kBulkOut = 0x02;
+
+// the transfer size CUSBBufferPool picks when the endpoint descriptor
+// wasn't read
+const int				kReadSize = 512 * 64;
+
+class CUSBDataLinkTests : public ::testing::Test {
+protected:
+	typedef std::vector<USBTransfer*> CTransfers;
+
+	CUSBDataLinkTests() :
+		m_cancelling(&m_mutex, false),
+		m_stop(false),
+		m_completer(NULL) { }
+
+	virtual void		SetUp()
+	{
+		// like libusb, cancelled transfers complete on another thread
+		m_completer = new CThread(new TMethodJob<CUSBDataLinkTests>(
+							this, &CUSBDataLinkTests::completerThread));
+
+		ON_CALL(m_usb, usbOpenDevice(An<USBDeviceInfo&>(), _))
+			.WillByDefault(Return(reinterpret_cast<USBDeviceHandle>(&m_device)));
+		ON_CALL(m_usb, usbAllocTransfer())
+			.WillByDefault(Invoke(this, &CUSBDataLinkTests::allocTransfer));
+		ON_CALL(m_usb, usbFreeTransfer(_))
+			.WillByDefault(Invoke(this, &CUSBDataLinkTests::freeTransfer));
+		ON_CALL(m_usb, usbSubmitTransfer(_))
+			.WillByDefault(Invoke(this, &CUSBDataLinkTests::submitTransfer));
+		ON_CALL(m_usb, usbCancelTransfer(_))
+			.WillByDefault(Invoke(this, &CUSBDataLinkTests::cancelTransfer));
+		ARCH->setUsb(&m_usb);
+	}
+
+	virtual void		TearDown()
+	{
+		{
+			CLock lock(&m_mutex);
+			m_stop = true;
+			m_cancelling.broadcast();
+		}
+		m_completer->wait();
+		delete m_completer;
+
+		ARCH->setUsb(NULL);
+	}
+
+	CUSBAddress			getAddress() const
+	{
+		return CUSBAddress(0x0402, 0x5632, kBulkIn, kBulkOut, 1, 1);
+	}
+
+	USBTransfer*		allocTransfer()
+	{
+		USBTransfer* transfer = new USBTransfer;
+		memset(transfer, 0, sizeof(*transfer));
+		return transfer;
+	}
+
+	void				freeTransfer(USBTransfer* transfer)
+	{
+		delete transfer;
+	}
+
+	bool				submitTransfer(USBTransfer* transfer)
+	{
+		CLock lock(&m_mutex);
+		if (transfer->m_endpoint == kBulkIn) {
+			m_reads.push_back(transfer);
+		}
+		else {
+			m_writes.push_back(transfer);
+		}
+		return true;
+	}
+
+	void				cancelTransfer(USBTransfer* transfer)
+	{
+		CLock lock(&m_mutex);
+		m_cancelled.push_back(transfer);
+		m_pending.push_back(transfer);
+		m_cancelling = true;
+		m_cancelling.broadcast();
+	}
+
+	// finish a read carrying one data frame
+	void				completeRead(USBTransfer* transfer, const char* data)
+	{
+		message_hdr hdr;
+		hdr.id        = MSGID_NORMAL;
+		hdr.data_size = (unsigned int)strlen(data);
+		ASSERT_GE(transfer->m_length, (int)(sizeof(hdr) + hdr.data_size));
+
+		memcpy(transfer->m_buffer, &hdr, sizeof(hdr));
+		memcpy(transfer->m_buffer + sizeof(hdr), data, hdr.data_size);
+		complete(transfer, USBTransfer::kCompleted,
+							(int)(sizeof(hdr) + hdr.data_size));
+	}
+
+	void				complete(USBTransfer* transfer,
+							USBTransfer::EStatus status, int length)
+	{
+		transfer->m_status       = status;
+		transfer->m_actualLength = length;
+		transfer->m_callback(transfer);
+	}
+
+public:
+	void				completerThread(void*)
+	{
+		CLock lock(&m_mutex);
+		for (;;) {
+			while (!m_cancelling && !m_stop) {
+				m_cancelling.wait();
+			}
+			if (m_stop) {
+				return;
+			}
+
+			CTransfers transfers;
+			transfers.swap(m_pending);
+			m_cancelling = false;
+
+			m_mutex.unlock();
+			for (CTransfers::iterator i = transfers.begin();
+							i != transfers.end(); ++i) {
+				complete(*i, USBTransfer::kCancelled, 0);
+			}
+			m_mutex.lock();
+		}
+	}
+
+protected:
+	NiceMock<CMockArchUsbDataLink>	m_usb;
+	CEventQueue			m_events;
+	CMutex				m_mutex;
+	CTransfers			m_reads;
+	CTransfers			m_writes;
+	CTransfers			m_cancelled;
+	CTransfers			m_pending;
+	CCondVar<bool>		m_cancelling;
+	bool				m_stop;
+	CThread*			m_completer;
+	char				m_device;
+};
+
+TEST_F(CUSBDataLinkTests, bind_submitsOneReadPerQueueSlot)
+{
+	EXPECT_CALL(m_usb, usbSubmitTransfer(_)).Times(3);
+
+	CUSBDataLink link;
+	link.setTransferQueueDepth(3);
+	link.bind(getAddress());
+
+	ASSERT_EQ(3, (int)m_reads.size());
+	EXPECT_EQ(0, (int)m_writes.size());
+	for (CTransfers::iterator i = m_reads.begin(); i != m_reads.end(); ++i) {
+		EXPECT_EQ(kBulkIn, (*i)->m_endpoint);
+		EXPECT_EQ(kReadSize, (*i)->m_length);
+		EXPECT_TRUE((*i)->m_buffer != NULL);
+		EXPECT_TRUE((*i)->m_callback != NULL);
+	}
+
+	// every slot gets its own buffer
+	EXPECT_NE(m_reads[0]->m_buffer, m_reads[1]->m_buffer);
+	EXPECT_NE(m_reads[1]->m_buffer, m_reads[2]->m_buffer);
+}
+
+TEST_F(CUSBDataLinkTests, readCallback_outOfOrderCompletion_consumedInSubmissionOrder)
+{
+	CUSBDataLink link;
+	link.setTransferQueueDepth(2);
+	link.bind(getAddress());
+	ASSERT_EQ(2, (int)m_reads.size());
+	USBTransfer* first  = m_reads[0];
+	USBTransfer* second = m_reads[1];
+
+	// the later transfer is held back until the earlier one completes
+	completeRead(second, "world");
+	EXPECT_EQ(0, (int)link.getSize());
+	EXPECT_EQ(2, (int)m_reads.size());
+
+	completeRead(first, "hello");
+	ASSERT_EQ(10, (int)link.getSize());
+
+	char buffer[10];
+	EXPECT_EQ(10, (int)link.read(buffer, sizeof(buffer)));
+	EXPECT_EQ(0, memcmp(buffer, "helloworld", 10));
+
+	// both transfers went straight back to the device in order
+	ASSERT_EQ(4, (int)m_reads.size());
+	EXPECT_EQ(first, m_reads[2]);
+	EXPECT_EQ(second, m_reads[3]);
+}
+
+TEST_F(CUSBDataLinkTests, readCallback_failedTransfer_disconnects)
+{
+	CUSBDataLink link;
+	link.setTransferQueueDepth(1);
+	link.bind(getAddress());
+	ASSERT_EQ(1, (int)m_reads.size());
+
+	complete(m_reads[0], USBTransfer::kFailed, 0);
+
+	// the link stops reading and refuses writes
+	EXPECT_EQ(1, (int)m_reads.size());
+	link.write("x", 1);
+	EXPECT_EQ(0, (int)m_writes.size());
+}
+
+TEST_F(CUSBDataLinkTests, write_submitsFrameAndFlushesOnCompletion)
+{
+	CUSBDataLink link;
+	link.setTransferQueueDepth(1);
+	link.bind(getAddress());
+
+	link.write("abc", 3);
+	ASSERT_EQ(1, (int)m_writes.size());
+
+	USBTransfer* transfer = m_writes[0];
+	EXPECT_EQ(kBulkOut, transfer->m_endpoint);
+	ASSERT_EQ((int)(sizeof(message_hdr) + 3), transfer->m_length);
+
+	message_hdr hdr;
+	memcpy(&hdr, transfer->m_buffer, sizeof(hdr));
+	EXPECT_EQ(3, (int)hdr.data_size);
+	EXPECT_EQ(0, memcmp(transfer->m_buffer + sizeof(hdr), "abc", 3));
+
+	// a second write waits for the only write slot
+	link.write("de", 2);
+	EXPECT_EQ(1, (int)m_writes.size());
+
+	complete(transfer, USBTransfer::kCompleted, transfer->m_length);
+	ASSERT_EQ(2, (int)m_writes.size());
+	EXPECT_EQ((int)(sizeof(message_hdr) + 2), m_writes[1]->m_length);
+
+	complete(m_writes[1], USBTransfer::kCompleted, m_writes[1]->m_length);
+
+	// nothing left in flight so this returns at once
+	link.flush();
+}
+
+TEST_F(CUSBDataLinkTests, close_cancelsTransfersInFlightAndFreesThem)
+{
+	CUSBDataLink link;
+	link.setTransferQueueDepth(2);
+	link.bind(getAddress());
+	link.write("abc", 3);
+	ASSERT_EQ(2, (int)m_reads.size());
+	ASSERT_EQ(1, (int)m_writes.size());
+
+	EXPECT_CALL(m_usb, usbCancelTransfer(_)).Times(3);
+	EXPECT_CALL(m_usb, usbFreeTransfer(_)).Times(4);
+	EXPECT_CALL(m_usb, usbCloseDevice(_, _)).Times(1);
+
+	// returns once the cancelled transfers have finished
+	link.close();
+	EXPECT_EQ(3, (int)m_cancelled.size());
+
+	// nothing left to cancel the second time
+	link.close();
+	EXPECT_EQ(3, (int)m_cancelled.size());
+}
+
+TEST_F(CUSBDataLinkTests, write_coalescing_packsMessagesHeldBehindTransferInFlight)
+{
+	CUSBDataLink link;
+	link.setTransferQueueDepth(2);
+	link.setCoalescing(1024, 60.0);
+	link.bind(getAddress());
+
+	// nothing in flight so the first message goes at once
+	link.write("a", 1);
+	ASSERT_EQ(1, (int)m_writes.size());
+
+	// these wait for the transfer in flight even though a slot is free
+	link.write("bb", 2);
+	link.write("ccc", 3);
+	EXPECT_EQ(1, (int)m_writes.size());
+
+	complete(m_writes[0], USBTransfer::kCompleted, m_writes[0]->m_length);
+	ASSERT_EQ(2, (int)m_writes.size());
+
+	USBTransfer* transfer = m_writes[1];
+	ASSERT_EQ((int)(2 * sizeof(message_hdr) + 5), transfer->m_length);
+
+	message_hdr hdr;
+	memcpy(&hdr, transfer->m_buffer, sizeof(hdr));
+	EXPECT_EQ(2, (int)hdr.data_size);
+	EXPECT_EQ(0, memcmp(transfer->m_buffer + sizeof(hdr), "bb", 2));
+
+	const unsigned char* next = transfer->m_buffer + sizeof(hdr) + 2;
+	memcpy(&hdr, next, sizeof(hdr));
+	EXPECT_EQ(3, (int)hdr.data_size);
+	EXPECT_EQ(0, memcmp(next + sizeof(hdr), "ccc", 3));
+
+	complete(transfer, USBTransfer::kCompleted, transfer->m_length);
+	link.flush();
+}
@@ -0,0 +1,182 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CMockArchUsbDataLink.h"
+#include "CUSBEventHandler.h"
+#include "CSocketMultiplexer.h"
+#include "CArch.h"
+#include "CArchAtomic.h"
+#include <sys/socket.h>
+#include <unistd.h>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+// stands in for libusb.  each descriptor is one end of a socket pair
+// and the test holds the other end.
+class CUSBEventHandlerTests : public ::testing::Test {
+protected:
+	CUSBEventHandlerTests() :
+		m_added(NULL),
+		m_removed(NULL),
+		m_userData(NULL),
+		m_handled(0),
+		m_removeFd(-1)
+	{
+		m_a[0] = m_a[1] = m_b[0] = m_b[1] = -1;
+	}
+
+	virtual void		SetUp()
+	{
+		ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, m_a));
+		ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, m_b));
+
+		ON_CALL(m_usb, usbSetPollfdNotifiers(_, _, _))
+			.WillByDefault(Invoke(this, &CUSBEventHandlerTests::setNotifiers));
+		ON_CALL(m_usb, usbHandleEvents())
+			.WillByDefault(Invoke(this, &CUSBEventHandlerTests::handleEvents));
+		ARCH->setUsb(&m_usb);
+	}
+
+	virtual void		TearDown()
+	{
+		ARCH->setUsb(NULL);
+		for (int i = 0; i < 2; ++i) {
+			if (m_a[i] != -1) {
+				close(m_a[i]);
+			}
+			if (m_b[i] != -1) {
+				close(m_b[i]);
+			}
+		}
+	}
+
+	bool				setNotifiers(USBPollfdAddedFunc added,
+							USBPollfdRemovedFunc removed, void* userData)
+	{
+		m_added    = added;
+		m_removed  = removed;
+		m_userData = userData;
+		return true;
+	}
+
+	// drain the descriptors and drop the one we were told to, like
+	// libusb does when a device is closed while handling events
+	void				handleEvents()
+	{
+		char buffer[16];
+		recv(m_a[0], buffer, sizeof(buffer), MSG_DONTWAIT);
+		recv(m_b[0], buffer, sizeof(buffer), MSG_DONTWAIT);
+
+		int fd = m_removeFd;
+		if (fd != -1) {
+			m_removeFd = -1;
+			m_removed(fd, m_userData);
+		}
+		CArchAtomic::add(&m_handled, 1);
+	}
+
+	bool				waitForHandled(SInt32 count)
+	{
+		for (int i = 0; i < 1000; ++i) {
+			if (CArchAtomic::load(&m_handled) >= count) {
+				return true;
+			}
+			ARCH->sleep(0.005);
+		}
+		return false;
+	}
+
+	// true iff nothing has the other end of \c fd open anymore.  our
+	// own copy of the end must have been closed first.  this doesn't
+	// write to the other end so it can't wake up a job still polling it.
+	bool				isPeerClosed(int fd)
+	{
+		for (int i = 0; i < 200; ++i) {
+			char c;
+			if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+				return true;
+			}
+			ARCH->sleep(0.005);
+		}
+		return false;
+	}
+
+	NiceMock<CMockArchUsbDataLink>	m_usb;
+	USBPollfdAddedFunc	m_added;
+	USBPollfdRemovedFunc	m_removed;
+	void*				m_userData;
+	volatile SInt32		m_handled;
+	int					m_removeFd;
+	int					m_a[2];
+	int					m_b[2];
+};
+
+TEST_F(CUSBEventHandlerTests, readyDescriptor_handlesUSBEvents)
+{
+	CSocketMultiplexer multiplexer;
+	CUSBEventHandler handler(&multiplexer);
+	ASSERT_TRUE(handler.isEnabled());
+
+	m_added(m_a[0], true, false, m_userData);
+	send(m_a[1], "x", 1, MSG_NOSIGNAL);
+	EXPECT_TRUE(waitForHandled(1));
+}
+
+TEST_F(CUSBEventHandlerTests, removedWhileHandlingOther_leavesPollSetAtOnce)
+{
+	CSocketMultiplexer multiplexer;
+	CUSBEventHandler handler(&multiplexer);
+	m_added(m_a[0], true, false, m_userData);
+	m_added(m_b[0], true, false, m_userData);
+
+	// b is dropped while handling events for a
+	m_removeFd = m_b[0];
+	send(m_a[1], "x", 1, MSG_NOSIGNAL);
+	ASSERT_TRUE(waitForHandled(1));
+
+	// the handler no longer holds b open
+	close(m_b[0]);
+	m_b[0] = -1;
+	EXPECT_TRUE(isPeerClosed(m_b[1]));
+
+	// and a is still serviced
+	send(m_a[1], "x", 1, MSG_NOSIGNAL);
+	EXPECT_TRUE(waitForHandled(2));
+}
+
+TEST_F(CUSBEventHandlerTests, removedWhileHandlingItself_leavesPollSet)
+{
+	CSocketMultiplexer multiplexer;
+	CUSBEventHandler handler(&multiplexer);
+	m_added(m_a[0], true, false, m_userData);
+	m_added(m_b[0], true, false, m_userData);
+
+	m_removeFd = m_a[0];
+	send(m_a[1], "x", 1, MSG_NOSIGNAL);
+	ASSERT_TRUE(waitForHandled(1));
+
+	close(m_a[0]);
+	m_a[0] = -1;
+	EXPECT_TRUE(isPeerClosed(m_a[1]));
+
+	// the other descriptor is unaffected
+	send(m_b[1], "x", 1, MSG_NOSIGNAL);
+	EXPECT_TRUE(waitForHandled(2));
+}
@@ -16,11 +16,16 @@
  */
 
 #include <gtest/gtest.h>
-#include "CClientProxy1_4.h"
 #include "CMockServer.h"
 #include "CMockStream.h"
 #include "CMockCryptoStream.h"
 #include "CMockEventQueue.h"
+#include "CClipboard.h"
+#include "CEventQueue.h"
+
+#define TEST_ENV
+#include "Global.h"
+#include "CClientProxy1_4.h"
 
 using ::testing::_;
 using ::testing::NiceMock;
@@ -34,6 +39,14 @@ UInt32 g_cryptoIvWrite_readBufferIndex;
 void cryptoIv_mockWrite(const void* in, UInt32 n);
 UInt8 cryptoIv_mockRead(void* out, UInt32 n);
 
+CString g_mouseMove_written;
+
+void mouseMove_mockWrite(const void* in, UInt32 n);
+
+CString g_recvClipboard_toRead;
+
+UInt32 recvClipboard_mockRead(void* out, UInt32 n);
+
 TEST(CClientProxyTests, cryptoIvWrite)
 {
 	g_cryptoIvWrite_writeBufferIndex = 0;
@@ -112,6 +125,66 @@ TEST(CClientProxyTests, cryptoIvWrite)
 	EXPECT_EQ('P', buffer[3]);
 }
 
+TEST(CClientProxyTests, mouseMove_paced_flushedBeforeButton)
+{
+	NiceMock<CMockEventQueue> eventQueue;
+	NiceMock<CMockStream>* stream = new NiceMock<CMockStream>;
+	NiceMock<CMockServer> server;
+
+	ON_CALL(*stream, write(_, _)).WillByDefault(Invoke(mouseMove_mockWrite));
+
+	CClientProxy1_4 clientProxy("stub", stream, &server, &eventQueue);
+
+	// one motion per second
+	COptionsList options;
+	options.push_back(kOptionMouseMoveRate);
+	options.push_back(1);
+	clientProxy.setOptions(options);
+	g_mouseMove_written.clear();
+
+	// the first move goes right away, the next are held back and only
+	// the last of them is sent, just before the button
+	clientProxy.mouseMove(1, 1);
+	clientProxy.mouseMove(2, 2);
+	clientProxy.mouseMove(3, 3);
+	EXPECT_EQ(CString("DMMV\0\1\0\1", 8), g_mouseMove_written);
+
+	clientProxy.mouseDown(1);
+	EXPECT_EQ(CString("DMMV\0\1\0\1DMMV\0\3\0\3DMDN\1", 21),
+				g_mouseMove_written);
+}
+
+TEST(CClientProxyTests, recvClipboard_unknownFormat_notRelayed)
+{
+	// a real queue since the clipboard changed event gets registered
+	CEventQueue eventQueue;
+	NiceMock<CMockStream>* stream = new NiceMock<CMockStream>;
+	NiceMock<CMockServer> server;
+
+	ON_CALL(*stream, read(_, _)).WillByDefault(Invoke(recvClipboard_mockRead));
+
+	CClientProxy1_4 clientProxy("stub", stream, &server, &eventQueue);
+
+	// clipboard 0, seqnum 1, then text "hi" and a format the server
+	// doesn't know
+	CString data("\0\0\0\2"
+				 "\0\0\0\0" "\0\0\0\2" "hi"
+				 "\0\0\0\x63" "\0\0\0\1" "x", 23);
+	g_recvClipboard_toRead = CString("\0" "\0\0\0\1", 5);
+	g_recvClipboard_toRead += CString("\0\0\0\x17", 4) + data;
+
+	EXPECT_TRUE(clientProxy.recvClipboard());
+
+	// the snapshot holds the data the server understood
+	CClipboard expected;
+	expected.open(0);
+	expected.add(IClipboard::kText, "hi");
+	expected.close();
+	CClipboardSnapshot snapshot = clientProxy.getClipboardSnapshot(0);
+	EXPECT_EQ(expected.marshall(), snapshot.getData());
+	EXPECT_EQ("hi", snapshot.get(IClipboard::kText));
+}
+
 void
 cryptoIv_mockWrite(const void* in, UInt32 n)
 {
@@ -128,3 +201,18 @@ cryptoIv_mockRead(void* out, UInt32 n)
 	g_cryptoIvWrite_readBufferIndex += n;
 	return n;
 }
+
+void
+mouseMove_mockWrite(const void* in, UInt32 n)
+{
+	g_mouseMove_written.append(static_cast<const char*>(in), n);
+}
+
+UInt32
+recvClipboard_mockRead(void* out, UInt32 n)
+{
+	n = std::min(n, (UInt32)g_recvClipboard_toRead.size());
+	memcpy(out, g_recvClipboard_toRead.data(), n);
+	g_recvClipboard_toRead.erase(0, n);
+	return n;
+}
@@ -0,0 +1,249 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CMockPrimaryClient.h"
+#include "CInputFilter.h"
+#include "CEventQueue.h"
+#include "CFunctionEventJob.h"
+#include "CStringUtil.h"
+
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+typedef std::vector<UInt32> CRuleNumbers;
+
+// a condition that records the rules that try to match an event and
+// matches any event it's offered if told to
+class CTestCondition : public CInputFilter::CCondition {
+public:
+	CTestCondition(CRuleNumbers* tried, UInt32 rule,
+							const CInputFilter::CEventKey& key, bool matches) :
+		m_tried(tried), m_rule(rule), m_key(key), m_matches(matches) { }
+
+	virtual CCondition*		clone() const
+	{
+		return new CTestCondition(m_tried, m_rule, m_key, m_matches);
+	}
+	virtual CString			format() const
+	{
+		return CStringUtil::print("test(%d)", m_rule);
+	}
+	virtual CInputFilter::EFilterStatus
+							match(const CEvent&)
+	{
+		m_tried->push_back(m_rule);
+		return m_matches ? CInputFilter::kActivate : CInputFilter::kNoMatch;
+	}
+	virtual CInputFilter::CEventKey
+							getEventKey() const { return m_key; }
+
+private:
+	CRuleNumbers*			m_tried;
+	UInt32					m_rule;
+	CInputFilter::CEventKey	m_key;
+	bool					m_matches;
+};
+
+// an action that records the rules that fired
+class CTestAction : public CInputFilter::CAction {
+public:
+	CTestAction(CRuleNumbers* fired, UInt32 rule) :
+		m_fired(fired), m_rule(rule) { }
+
+	virtual CAction*		clone() const
+	{
+		return new CTestAction(m_fired, m_rule);
+	}
+	virtual CString			format() const
+	{
+		return CStringUtil::print("test(%d)", m_rule);
+	}
+	virtual void			perform(const CEvent&)
+	{
+		m_fired->push_back(m_rule);
+	}
+
+private:
+	CRuleNumbers*			m_fired;
+	UInt32					m_rule;
+};
+
+static const CInputFilter::CEventKey
+						s_anyEvent;
+
+static CInputFilter::CEventKey
+hotKey(UInt32 id)
+{
+	return CInputFilter::CEventKey(CInputFilter::CEventKey::kHotKey, id, 0);
+}
+
+static CInputFilter::CEventKey
+button(ButtonID id)
+{
+	return CInputFilter::CEventKey(CInputFilter::CEventKey::kButton, id, 0);
+}
+
+// add a rule that records when it fires
+static void
+addRule(CInputFilter& filter, CInputFilter::CCondition* condition,
+							CRuleNumbers* fired)
+{
+	CInputFilter::CRule rule(condition);
+	rule.adoptAction(new CTestAction(fired, filter.getNumRules()), true);
+	filter.addFilterRule(rule);
+}
+
+static void
+passedThrough(const CEvent&, void* vpassed)
+{
+	*static_cast<bool*>(vpassed) = true;
+}
+
+// send an event with \p data to the filter.  returns true iff some
+// rule handled it, i.e. the filter didn't pass the event through.
+// the filter passes events through by delivering them immediately
+// with itself as the target.
+static bool
+sendEvent(CEventQueue& queue, CInputFilter& filter,
+							CEvent::Type type, void* data)
+{
+	bool passed = false;
+	queue.adoptHandler(type, &filter,
+							new CFunctionEventJob(&passedThrough, &passed));
+	CEvent event(type, NULL, data);
+	filter.handleEventForTest(event);
+	queue.removeHandler(type, &filter);
+	CEvent::deleteData(event);
+	return !passed;
+}
+
+static bool
+sendHotKey(CEventQueue& queue, CInputFilter& filter, UInt32 id)
+{
+	return sendEvent(queue, filter, IPrimaryScreen::getHotKeyDownEvent(),
+							IPrimaryScreen::CHotKeyInfo::alloc(id));
+}
+
+static bool
+sendButton(CEventQueue& queue, CInputFilter& filter, ButtonID id)
+{
+	return sendEvent(queue, filter, IPrimaryScreen::getButtonDownEvent(),
+							IPrimaryScreen::CButtonInfo::alloc(id, 0));
+}
+
+TEST(CInputFilterTests, handleEvent_mixedRules_triedInInsertionOrder)
+{
+	CEventQueue queue;
+	CInputFilter filter;
+	CRuleNumbers tried, fired;
+	addRule(filter, new CTestCondition(&tried, 0, hotKey(1), false), &fired);
+	addRule(filter, new CTestCondition(&tried, 1, s_anyEvent, false), &fired);
+	addRule(filter, new CTestCondition(&tried, 2, button(1), false), &fired);
+	addRule(filter, new CTestCondition(&tried, 3, hotKey(1), false), &fired);
+	addRule(filter, new CTestCondition(&tried, 4, s_anyEvent, false), &fired);
+	addRule(filter, new CTestCondition(&tried, 5, hotKey(2), true), &fired);
+	addRule(filter, new CTestCondition(&tried, 6, hotKey(1), true), &fired);
+	addRule(filter, new CTestCondition(&tried, 7, s_anyEvent, true), &fired);
+
+	// the hot key's rules and the catch-all rules until one matches
+	EXPECT_TRUE(sendHotKey(queue, filter, 1));
+	UInt32 hotKeyTried[] = { 0, 1, 3, 4, 6 };
+	EXPECT_EQ(CRuleNumbers(hotKeyTried, hotKeyTried + 5), tried);
+	EXPECT_EQ(CRuleNumbers(1, 6), fired);
+
+	// the button's rules and the catch-all rules
+	tried.clear();
+	fired.clear();
+	EXPECT_TRUE(sendButton(queue, filter, 1));
+	UInt32 buttonTried[] = { 1, 2, 4, 7 };
+	EXPECT_EQ(CRuleNumbers(buttonTried, buttonTried + 4), tried);
+	EXPECT_EQ(CRuleNumbers(1, 7), fired);
+}
+
+TEST(CInputFilterTests, handleEvent_noRuleMatches_passesEventThrough)
+{
+	CEventQueue queue;
+	CInputFilter filter;
+	CRuleNumbers tried, fired;
+	addRule(filter, new CTestCondition(&tried, 0, hotKey(1), true), &fired);
+	addRule(filter, new CTestCondition(&tried, 1, s_anyEvent, false), &fired);
+
+	EXPECT_FALSE(sendHotKey(queue, filter, 2));
+	EXPECT_EQ(CRuleNumbers(1, 1), tried);
+	EXPECT_TRUE(fired.empty());
+}
+
+TEST(CInputFilterTests, handleEvent_keystrokeButtonAndCatchAll_firstAddedFires)
+{
+	CEventQueue queue;
+	NiceMock<CMockPrimaryClient> primary;
+	ON_CALL(primary, getEventTarget()).WillByDefault(Return(&primary));
+	ON_CALL(primary, registerHotKey(kKeyF1, 0)).WillByDefault(Return(1));
+	ON_CALL(primary, registerHotKey(kKeyF2, 0)).WillByDefault(Return(2));
+
+	CInputFilter filter;
+	CRuleNumbers tried, fired;
+	addRule(filter, new CInputFilter::CKeystrokeCondition(kKeyF1, 0), &fired);
+	addRule(filter, new CInputFilter::CMouseButtonCondition(1, 0), &fired);
+	addRule(filter, new CTestCondition(&tried, 2, s_anyEvent, true), &fired);
+	addRule(filter, new CInputFilter::CKeystrokeCondition(kKeyF2, 0), &fired);
+	addRule(filter, new CInputFilter::CMouseButtonCondition(2, 0), &fired);
+	filter.setPrimaryClient(&primary);
+
+	EXPECT_TRUE(sendHotKey(queue, filter, 1));
+	EXPECT_TRUE(sendHotKey(queue, filter, 2));
+	EXPECT_TRUE(sendButton(queue, filter, 1));
+	EXPECT_TRUE(sendButton(queue, filter, 2));
+	UInt32 expected[] = { 0, 2, 1, 2 };
+	EXPECT_EQ(CRuleNumbers(expected, expected + 4), fired);
+
+	EXPECT_EQ(1, filter.getRule(0).getHits());
+	EXPECT_EQ(1, filter.getRule(1).getHits());
+	EXPECT_EQ(2, filter.getRule(2).getHits());
+	EXPECT_EQ(0, filter.getRule(3).getHits());
+	EXPECT_EQ(0, filter.getRule(4).getHits());
+
+	filter.setPrimaryClient(NULL);
+}
+
+TEST(CInputFilterTests, handleEvent_afterSetPrimaryClient_usesNewHotKeyIDs)
+{
+	CEventQueue queue;
+	NiceMock<CMockPrimaryClient> oldPrimary;
+	ON_CALL(oldPrimary, getEventTarget()).WillByDefault(Return(&oldPrimary));
+	ON_CALL(oldPrimary, registerHotKey(kKeyF1, 0)).WillByDefault(Return(1));
+	NiceMock<CMockPrimaryClient> newPrimary;
+	ON_CALL(newPrimary, getEventTarget()).WillByDefault(Return(&newPrimary));
+	ON_CALL(newPrimary, registerHotKey(kKeyF1, 0)).WillByDefault(Return(5));
+
+	CInputFilter filter;
+	CRuleNumbers fired;
+	addRule(filter, new CInputFilter::CKeystrokeCondition(kKeyF1, 0), &fired);
+	filter.setPrimaryClient(&oldPrimary);
+	EXPECT_TRUE(sendHotKey(queue, filter, 1));
+
+	EXPECT_CALL(oldPrimary, unregisterHotKey(1));
+	filter.setPrimaryClient(&newPrimary);
+	EXPECT_FALSE(sendHotKey(queue, filter, 1));
+	EXPECT_TRUE(sendHotKey(queue, filter, 5));
+	EXPECT_EQ(CRuleNumbers(2, 0), fired);
+	EXPECT_EQ(2, filter.getRule(0).getHits());
+
+	filter.setPrimaryClient(NULL);
+}
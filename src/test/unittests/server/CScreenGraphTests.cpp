@@ -0,0 +1,105 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "CScreenGraph.h"
+#include "CConfig.h"
+
+// a screen with two screens stacked to its right, the lower of which
+// has another screen to its right
+static void
+makeConfig(CConfig& config)
+{
+	config.addScreen("server");
+	config.addScreen("upper");
+	config.addScreen("lower");
+	config.addScreen("far");
+	config.addAlias("lower", "lower.example.com");
+	config.connect("server", kRight, 0.0f, 0.5f, "upper", 0.0f, 1.0f);
+	config.connect("server", kRight, 0.5f, 1.0f, "lower", 0.0f, 1.0f);
+	config.connect("upper", kLeft, 0.0f, 1.0f, "server", 0.0f, 0.5f);
+	config.connect("lower", kLeft, 0.0f, 1.0f, "server", 0.5f, 1.0f);
+	config.connect("lower", kRight, 0.25f, 1.0f, "far", 0.0f, 0.75f);
+}
+
+TEST(CScreenGraphTests, getID_aliasAndCase_sameAsCanonical)
+{
+	CConfig config;
+	makeConfig(config);
+	CScreenGraph graph;
+	graph.build(config);
+
+	CScreenGraph::ScreenID id = graph.getID("lower");
+	EXPECT_NE((CScreenGraph::ScreenID)CScreenGraph::kNoScreen, id);
+	EXPECT_EQ(id, graph.getID("LOWER"));
+	EXPECT_EQ(id, graph.getID("lower.example.com"));
+	EXPECT_EQ(CString("lower"), graph.getName(id));
+	EXPECT_EQ((CScreenGraph::ScreenID)CScreenGraph::kNoScreen,
+				graph.getID("unknown"));
+	EXPECT_EQ(4, graph.getNumScreens());
+}
+
+TEST(CScreenGraphTests, getNeighbor_matchesConfig)
+{
+	CConfig config;
+	makeConfig(config);
+	CScreenGraph graph;
+	graph.build(config);
+
+	for (CConfig::const_iterator name = config.begin();
+								name != config.end(); ++name) {
+		CScreenGraph::ScreenID id = graph.getID(*name);
+		for (int side = kFirstDirection; side <= kLastDirection; ++side) {
+			EDirection dir = static_cast<EDirection>(side);
+			for (int i = 0; i <= 16; ++i) {
+				float t = (float)i / 16.0f;
+				float expectedOut = -1.0f, out = -1.0f;
+				CString expected = config.getNeighbor(*name, dir, t,
+											&expectedOut);
+				CScreenGraph::ScreenID dst =
+					graph.getNeighbor(id, dir, t, &out);
+				if (expected.empty()) {
+					EXPECT_EQ((CScreenGraph::ScreenID)CScreenGraph::kNoScreen,
+								dst);
+				}
+				else {
+					ASSERT_NE((CScreenGraph::ScreenID)CScreenGraph::kNoScreen,
+								dst);
+					EXPECT_EQ(expected, graph.getName(dst));
+					EXPECT_EQ(expectedOut, out);
+				}
+			}
+		}
+	}
+}
+
+TEST(CScreenGraphTests, build_screensUnconnected)
+{
+	CConfig config;
+	makeConfig(config);
+	CScreenGraph graph;
+	graph.build(config);
+
+	CScreenGraph::ScreenID id = graph.getID("upper");
+	EXPECT_EQ(NULL, graph.getClient(id));
+	graph.setClient(id, reinterpret_cast<CBaseClientProxy*>(&graph));
+	EXPECT_EQ(reinterpret_cast<CBaseClientProxy*>(&graph),
+				graph.getClient(id));
+
+	graph.build(config);
+	EXPECT_EQ(NULL, graph.getClient(id));
+}
@@ -0,0 +1,125 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+#define TEST_ENV
+#include "Global.h"
+
+#include "CApp.h"
+#include "CArgsBase.h"
+
+class CTestApp : public CApp {
+public:
+	CTestApp() : CApp(NULL, new CArgsBase()) { }
+
+	void				help() { }
+	void				parseArgs(int, const char* const*) { }
+	void				loadConfig() { }
+	bool				loadConfig(const CString&) { return false; }
+	const char*			daemonInfo() const { return ""; }
+	const char*			daemonName() const { return ""; }
+	int					standardStartup(int, char**) { return 0; }
+	int					runInner(int, char**, ILogOutputter*, StartupFunc) { return 0; }
+	void				startNode() { }
+	int					mainLoop() { return 0; }
+	int					foregroundStartup(int, char**) { return 0; }
+	CScreen*			createScreen() { return NULL; }
+};
+
+class CExitException : public std::runtime_error {
+public:
+	CExitException(int code) :
+		std::runtime_error("exit"),
+		m_code(code) { }
+
+	int					m_code;
+};
+
+static void
+throwOnBye(int code)
+{
+	throw CExitException(code);
+}
+
+class CAppTests : public ::testing::Test {
+public:
+	CAppTests()
+	{
+		m_app.appUtil().adoptApp(&m_app);
+		m_app.setByeFunc(&throwOnBye);
+		m_app.argsBase().m_pname = "synergy";
+	}
+
+	// Parses one option and its value.  Returns the exit code passed to
+	// bye, or -1 if the option was accepted.
+	int					parse(const char* name, const char* value)
+	{
+		const char* argv[] = { name, value };
+		int i = 0;
+		try {
+			m_app.parseArg(2, argv, i);
+		}
+		catch (CExitException& e) {
+			return e.m_code;
+		}
+		EXPECT_EQ(1, i);
+		return -1;
+	}
+
+	CTestApp			m_app;
+};
+
+TEST_F(CAppTests, parseArg_logMaxSize_valueIsStored)
+{
+	EXPECT_EQ(-1, parse("--log-max-size", "25"));
+	EXPECT_EQ(25, m_app.argsBase().m_logMaxSize);
+
+	EXPECT_EQ(-1, parse("--log-max-size", "0"));
+	EXPECT_EQ(0, m_app.argsBase().m_logMaxSize);
+
+	EXPECT_EQ(-1, parse("--log-max-size", "4095"));
+	EXPECT_EQ(4095, m_app.argsBase().m_logMaxSize);
+}
+
+TEST_F(CAppTests, parseArg_logMaxSize_outOfRange_exitsWithUsageError)
+{
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", "4096"));
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", "-1"));
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", "99999999999999999999"));
+}
+
+TEST_F(CAppTests, parseArg_logMaxSize_notANumber_exitsWithUsageError)
+{
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", ""));
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", "ten"));
+	EXPECT_EQ(kExitArgs, parse("--log-max-size", "10mb"));
+}
+
+TEST_F(CAppTests, parseArg_logBackups_valueIsStored)
+{
+	EXPECT_EQ(-1, parse("--log-backups", "5"));
+	EXPECT_EQ(5, m_app.argsBase().m_logBackups);
+}
+
+TEST_F(CAppTests, parseArg_logBackups_invalid_exitsWithUsageError)
+{
+	EXPECT_EQ(kExitArgs, parse("--log-backups", "101"));
+	EXPECT_EQ(kExitArgs, parse("--log-backups", "-3"));
+	EXPECT_EQ(kExitArgs, parse("--log-backups", "3x"));
+}
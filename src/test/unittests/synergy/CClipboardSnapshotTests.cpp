@@ -0,0 +1,95 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+#include "CClipboardSnapshot.h"
+#include "CClipboard.h"
+
+TEST(CClipboardSnapshotTests, ctor_clipboard_dataIsMarshalled)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(IClipboard::kText, "synergy rocks!");
+	clipboard.add(IClipboard::kHTML, "<b>synergy</b>");
+	clipboard.close();
+
+	CClipboardSnapshot snapshot(&clipboard);
+
+	EXPECT_EQ(clipboard.marshall(), snapshot.getData());
+	EXPECT_TRUE(snapshot.has(IClipboard::kText));
+	EXPECT_FALSE(snapshot.has(IClipboard::kBitmap));
+	EXPECT_EQ("<b>synergy</b>", snapshot.get(IClipboard::kHTML));
+}
+
+TEST(CClipboardSnapshotTests, copy_snapshot_dataIsShared)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(IClipboard::kText, "synergy rocks!");
+	clipboard.close();
+	CClipboardSnapshot snapshot(&clipboard);
+
+	CClipboardSnapshot copy;
+	copy = snapshot;
+
+	EXPECT_TRUE(copy.isSame(snapshot));
+	EXPECT_EQ(snapshot.getData().data(), copy.getData().data());
+	EXPECT_EQ("synergy rocks!", copy.get(IClipboard::kText));
+}
+
+TEST(CClipboardSnapshotTests, ctor_truncatedData_formatIsDropped)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(IClipboard::kText, "synergy");
+	clipboard.add(IClipboard::kHTML, "<b>synergy</b>");
+	clipboard.close();
+	CString data = clipboard.marshall();
+
+	CClipboardSnapshot snapshot(data.substr(0, data.size() - 1), 0);
+
+	EXPECT_EQ("synergy", snapshot.get(IClipboard::kText));
+	EXPECT_FALSE(snapshot.has(IClipboard::kHTML));
+}
+
+TEST(CClipboardSnapshotTests, copy_toClipboard_dataWasCopied)
+{
+	CClipboardSnapshot snapshot(CString("\0\0\0\1\0\0\0\0\0\0\0\7synergy", 19), 5);
+	CClipboard clipboard;
+
+	CClipboard::copy(&clipboard, &snapshot);
+
+	clipboard.open(0);
+	EXPECT_EQ("synergy", clipboard.get(IClipboard::kText));
+	EXPECT_EQ(5, (int)clipboard.getTime());
+	clipboard.close();
+}
+
+TEST(CClipboardSnapshotTests, getHash_sameData_hashesAreEqual)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(IClipboard::kText, "synergy rocks!");
+	clipboard.close();
+
+	CClipboardSnapshot snapshot(&clipboard);
+	CClipboardSnapshot received(clipboard.marshall(), 0);
+
+	EXPECT_EQ(snapshot.getHash(), received.getHash());
+	EXPECT_NE(CClipboardSnapshot().getHash(), snapshot.getHash());
+}
@@ -401,3 +401,50 @@ TEST(CClipboardTests, copy_withSingleText_clipboardsAreEqual)
 	CString actual = clipboard2.get(CClipboard::kText);
 	EXPECT_EQ("synergy rocks!", actual);
 }
+
+TEST(CClipboardTests, getHash_sameData_hashesAreEqual)
+{
+	CClipboard clipboard1;
+	clipboard1.open(0);
+	clipboard1.add(CClipboard::kText, "synergy rocks!");
+	clipboard1.close();
+
+	CClipboard clipboard2;
+	CClipboard::copy(&clipboard2, &clipboard1);
+
+	EXPECT_EQ(clipboard1.getHash(), clipboard2.getHash());
+}
+
+TEST(CClipboardTests, getHash_dataChanged_hashChanged)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(CClipboard::kText, "synergy rocks!");
+	UInt64 textHash = clipboard.getHash();
+
+	clipboard.add(CClipboard::kText, "synergy rocks?");
+	EXPECT_NE(textHash, clipboard.getHash());
+
+	// same data in another format
+	clipboard.empty();
+	clipboard.add(CClipboard::kHTML, "synergy rocks!");
+	EXPECT_NE(textHash, clipboard.getHash());
+}
+
+TEST(CClipboardTests, marshall_dataChanged_marshallsNewData)
+{
+	CClipboard clipboard;
+	clipboard.open(0);
+	clipboard.add(CClipboard::kText, "synergy rocks!");
+	clipboard.close();
+	CString first = clipboard.marshall();
+	EXPECT_EQ(first, clipboard.marshall());
+
+	clipboard.open(0);
+	clipboard.add(CClipboard::kText, "synergy rocks?");
+	clipboard.close();
+
+	CString actual = clipboard.marshall();
+	EXPECT_NE(first, actual);
+	EXPECT_EQ(IClipboard::marshall(&clipboard), actual);
+}
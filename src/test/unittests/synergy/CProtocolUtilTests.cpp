@@ -0,0 +1,130 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ * 
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+#include "CProtocolUtil.h"
+#include "ProtocolTypes.h"
+#include "CMockStream.h"
+#include <string>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+std::string g_written;
+std::string g_toRead;
+void protocolUtil_mockWrite(const void* in, UInt32 n);
+UInt32 protocolUtil_mockRead(void* out, UInt32 n);
+
+TEST(CProtocolUtilTests, writeMessage_sameAsWritef)
+{
+	NiceMock<CMockStream> stream;
+	ON_CALL(stream, write(_, _)).WillByDefault(Invoke(protocolUtil_mockWrite));
+
+	CMsgCEnter enter;
+	enter.m_x      = -3;
+	enter.m_y      = 1200;
+	enter.m_seqNum = 0x01020304;
+	enter.m_mask   = 0x8001;
+	g_written.clear();
+	CProtocolUtil::writef(&stream, kMsgCEnter, -3, 1200, 0x01020304, 0x8001);
+	std::string expected = g_written;
+	g_written.clear();
+	CProtocolUtil::writeMessage(&stream, enter);
+	EXPECT_EQ(expected, g_written);
+
+	CMsgDKeyRepeat repeat;
+	repeat.m_id     = 0xefb1;
+	repeat.m_mask   = 0x0012;
+	repeat.m_count  = 3;
+	repeat.m_button = 0x0026;
+	g_written.clear();
+	CProtocolUtil::writef(&stream, kMsgDKeyRepeat, 0xefb1, 0x0012, 3, 0x0026);
+	expected = g_written;
+	g_written.clear();
+	CProtocolUtil::writeMessage(&stream, repeat);
+	EXPECT_EQ(expected, g_written);
+
+	CMsgDMouseDown down;
+	down.m_id = 3;
+	g_written.clear();
+	CProtocolUtil::writef(&stream, kMsgDMouseDown, 3);
+	expected = g_written;
+	g_written.clear();
+	CProtocolUtil::writeMessage(&stream, down);
+	EXPECT_EQ(expected, g_written);
+
+	CMsgDMouseMove move;
+	move.m_x = -1;
+	move.m_y = 32767;
+	g_written.clear();
+	CProtocolUtil::writef(&stream, kMsgDMouseMove, -1, 32767);
+	expected = g_written;
+	g_written.clear();
+	CProtocolUtil::writeMessage(&stream, move);
+	EXPECT_EQ(expected, g_written);
+
+	g_written.clear();
+	CProtocolUtil::writef(&stream, kMsgCKeepAlive);
+	expected = g_written;
+	g_written.clear();
+	CProtocolUtil::writeMessage(&stream, CMsgCKeepAlive());
+	EXPECT_EQ(expected, g_written);
+}
+
+TEST(CProtocolUtilTests, readMessage_decodesParameters)
+{
+	NiceMock<CMockStream> stream;
+	ON_CALL(stream, read(_, _)).WillByDefault(Invoke(protocolUtil_mockRead));
+
+	const char data[] = "\xff\xfe\x00\x02";
+	g_toRead.assign(data, 4);
+
+	CMsgDMouseWheel wheel;
+	EXPECT_TRUE(CProtocolUtil::readMessage(&stream, wheel));
+	EXPECT_EQ(-2, wheel.m_x);
+	EXPECT_EQ(2, wheel.m_y);
+}
+
+TEST(CProtocolUtilTests, readMessage_endOfStream)
+{
+	NiceMock<CMockStream> stream;
+	ON_CALL(stream, read(_, _)).WillByDefault(Invoke(protocolUtil_mockRead));
+
+	g_toRead.assign("\x00\x01", 2);
+
+	CMsgDKeyDown key;
+	EXPECT_FALSE(CProtocolUtil::readMessage(&stream, key));
+}
+
+void
+protocolUtil_mockWrite(const void* in, UInt32 n)
+{
+	g_written.append(static_cast<const char*>(in), n);
+}
+
+UInt32
+protocolUtil_mockRead(void* out, UInt32 n)
+{
+	if (n > g_toRead.size()) {
+		n = static_cast<UInt32>(g_toRead.size());
+	}
+	memcpy(out, g_toRead.data(), n);
+	g_toRead.erase(0, n);
+	return n;
+}
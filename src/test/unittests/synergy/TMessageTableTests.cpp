@@ -0,0 +1,77 @@
+/*
+ * synergy -- mouse and keyboard sharing utility
+ * Copyright (C) 2013 Bolton Software Ltd.
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file COPYING that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include "TMessageTable.h"
+#include "ProtocolTypes.h"
+
+TEST(TMessageTableTests, find_addedMessages_returnsValues)
+{
+	TMessageTable<int> table;
+	table.add(kMsgDMouseMove, 1);
+	table.add(kMsgCNoop, 2);
+	table.add(kMsgDKeyDown, 3);
+
+	EXPECT_EQ(1, *table.find(reinterpret_cast<const UInt8*>("DMMV")));
+	EXPECT_EQ(2, *table.find(reinterpret_cast<const UInt8*>("CNOP")));
+	EXPECT_EQ(3, *table.find(reinterpret_cast<const UInt8*>("DKDN")));
+}
+
+TEST(TMessageTableTests, find_allMessages_returnsEach)
+{
+	const char* msgs[] = {
+		kMsgCNoop, kMsgCClose, kMsgCEnter, kMsgCLeave, kMsgCClipboard,
+		kMsgCScreenSaver, kMsgCResetOptions, kMsgCInfoAck, kMsgCKeepAlive,
+		kMsgCGameTimingReq, kMsgCGameTimingResp, kMsgDKeyDown,
+		kMsgDKeyRepeat, kMsgDKeyUp, kMsgDMouseDown, kMsgDMouseUp,
+		kMsgDMouseMove, kMsgDMouseRelMove, kMsgDMouseWheel, kMsgDClipboard,
+		kMsgDInfo, kMsgDSetOptions, kMsgDGameButtons, kMsgDGameSticks,
+		kMsgDGameTriggers, kMsgDGameFeedback, kMsgDCryptoIv, kMsgQInfo,
+		kMsgEIncompatible, kMsgEBusy, kMsgEUnknown, kMsgEBad
+	};
+	const int n = sizeof(msgs) / sizeof(msgs[0]);
+
+	TMessageTable<int> table;
+	for (int i = 0; i < n; ++i) {
+		table.add(msgs[i], i);
+	}
+
+	for (int i = 0; i < n; ++i) {
+		const int* value = table.find(reinterpret_cast<const UInt8*>(msgs[i]));
+		ASSERT_TRUE(value != NULL);
+		EXPECT_EQ(i, *value);
+	}
+}
+
+TEST(TMessageTableTests, find_unknownMessage_returnsNull)
+{
+	TMessageTable<int> table;
+	EXPECT_EQ(NULL, table.find(reinterpret_cast<const UInt8*>("DMMV")));
+
+	table.add(kMsgDMouseMove, 1);
+	EXPECT_EQ(NULL, table.find(reinterpret_cast<const UInt8*>("DMMW")));
+	EXPECT_EQ(NULL, table.find(reinterpret_cast<const UInt8*>("CMMV")));
+}
+
+TEST(TMessageTableTests, add_existingMessage_replacesValue)
+{
+	TMessageTable<int> table;
+	table.add(kMsgCKeepAlive, 1);
+	table.add(kMsgCKeepAlive, 2);
+
+	EXPECT_EQ(2, *table.find(reinterpret_cast<const UInt8*>("CALV")));
+}